@@ -0,0 +1,20 @@
+/**
+ * @file workflow.h
+ * 
+ * @brief File which defines the function used by the client to read a workflow file into a #Request
+ * 
+ */
+
+#ifndef _WORKFLOW_H_
+
+/**
+ * @brief Include guard
+ * 
+ */
+#define _WORKFLOW_H_
+
+#include "request.h"
+
+bool parseWorkflow(char*, Request);
+
+#endif //_WORKFLOW_H_
@@ -7,12 +7,33 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "logging.h"
 #include "processArgs.h"
+#include "socketWrapper.h"
+#include "wire.h"
+
+/**
+ * @brief The environment variable giving the path of the socket of the server (#SOCKET_NAME if not set)
+ * 
+ */
+#define SOCKET_VARIABLE "SDSTORE_SOCKET"
+
+/**
+ * @brief The message printed when a stream cannot be sent because the server does not listen on a socket
+ * 
+ */
+#define STREAM_NEEDS_SOCKET "Streaming needs the server to listen on its socket"
+
+/**
+ * @brief The message printed when a request is too large to be sent through the FIFO of the server
+ * 
+ */
+#define REQUEST_TOO_LARGE "The request is too large to be sent through the FIFO of the server, which only takes frames written at once"
 
 /**
  * @brief Gets the name of the pipe to output the subroutine data to.
@@ -26,47 +47,114 @@ void getResponsePipeName(char* string) {
 }
 
 /**
- * @brief Main client's entry point
+ * @brief Makes a path absolute, from the working directory of the client
  * 
- * @param argc The number of arguments
- * @param argv The arguments of the client
- *
- * The arguments are {"sdstore" "status"} for a status request, or
- * {"sdstore" "proc-file" "<priority (0-5)>" "<input-file>" "<output-file>" "<transformation-1>" "<transformation-2>" ...}
+ * @param path The given path
  * 
- * The priority is optional.
+ * @return char* The path if it is already absolute, or the absolute path (malloc'ed)
+ */
+char* getAbsolutePath(char* path) {
+    char directory[4096];
+    if (path[0] == '/' || !getcwd(directory, sizeof(directory)))
+        return path;
+
+    char* absolute = malloc(strlen(directory) + strlen(path) + 2);
+    if (!absolute) {
+        printMessage(STDERR_FILENO, MALLOCFAILED);
+        _exit(1);
+    }
+    sprintf(absolute, "%s/%s", directory, path);
+    return absolute;
+}
+
+/**
+ * @brief Sends a #Request through the socket of the server, passing it the input and output files already
+ * open
  * 
- * @return 0 On success
+ * The paths of the files are made absolute, since the server does not share the working directory of the
+ * client, and they are still used for the outputs of the branches and to identify the files. A stream
+ * passes the standard input and output of the client instead, which the stages read and write directly
+ * 
+ * @param server The connection to the socket
+ * @param r The #Request to send
+ * 
+ * @return true If the #Request was sent
+ * @return false If its files cannot be opened or the server cannot be reached
  */
-int main(int argc, char* argv[])
-{
-    REQUEST r;
+bool sendThroughSocket(file_d server, Request r) {
+    r->sender = "";
+    if (r->type != STATUS) {
+        bool stream = isStreamRequest(r);
+        file_d files[2] = { STDIN_FILENO, STDOUT_FILENO };
 
-    if (!parseArguments(argc, argv, &r)) {
-        PRINTLN("Invalid arguments");
-        return 1;
+        if (!stream) {
+            r->inputFile = getAbsolutePath(r->inputFile);
+            r->outputFile = getAbsolutePath(r->outputFile);
+            for (int i = 0; i < r->branchCount; i++)
+                r->branches[i].outputFile = getAbsolutePath(r->branches[i].outputFile);
+
+            //The output is truncated by the server, which keeps it when it resumes the request
+            files[0] = open(r->inputFile, O_RDONLY | O_CLOEXEC);
+            files[1] = open(r->outputFile, O_WRONLY | O_CREAT | O_CLOEXEC, 0660);
+            if (files[0] < 0 || files[1] < 0) {
+                if (files[0] < 0)
+                    PRINTLN("Cannot open the input file");
+                else
+                    PRINTLN("Cannot open the output file");
+                return false;
+            }
+        }
+
+        WIRE_HEADER header = { .magic = WIRE_MAGIC, .version = WIRE_VERSION, .kind = WIRE_DESCRIPTORS, .length = 0 };
+        bool sent = sendDescriptors(server, &header, sizeof(header), files, 2);
+        if (!stream) {
+            close(files[0]);
+            close(files[1]);
+        }
+        if (!sent)
+            return false;
     }
 
-    char clientFifoName[32];
+    PIPE_WRITTER pw;
+    initPipeWritter(&pw, server);
+    writeRequest(&pw, r);
+    return flushPipe(&pw);
+}
+
+/**
+ * @brief Sends a #Request through the FIFO of the server, and opens the FIFO of the client to get the answers
+ * 
+ * @param r The #Request to send
+ * @param clientFifoName The name of the FIFO of the client (created, and removed on failure)
+ * 
+ * @return file_d The descriptor of the FIFO of the client (-1 on failure)
+ */
+file_d sendThroughFifo(Request r, char* clientFifoName) {
     getResponsePipeName(clientFifoName);
+    r->sender = clientFifoName;
+
+    //A larger frame could be interleaved with the frames of other clients
+    if (getRequestFrameLength(r) > WIRE_FIFO_MAX_SIZE) {
+        PRINTLN(REQUEST_TOO_LARGE);
+        return -1;
+    }
 
     if (mkfifo(clientFifoName, 0660) == -1) {
         printMessage(STDERR_FILENO, PIPECREATEFAILED);
-        return 1;
+        return -1;
     }
 
-    r.sender = clientFifoName;
     file_d serverFifo = open(SERVER_NAME, O_WRONLY);
 
     if (serverFifo < 0) {
         unlink(clientFifoName);
         PRINTLN("Server not reacheable");
-        return 1;
+        return -1;
     }
 
     PIPE_WRITTER pw;
     initPipeWritter(&pw, serverFifo);
-    writeRequest(&pw, &r);
+    writeRequest(&pw, r);
     flushPipe(&pw);
     close(serverFifo);
 
@@ -76,18 +164,70 @@ int main(int argc, char* argv[])
     if (clientFifo < 0) {
         unlink(clientFifoName);
         printMessage(STDIN_FILENO, OPENFAILED);
+    }
+    return clientFifo;
+}
+
+/**
+ * @brief Main client's entry point
+ * 
+ * @param argc The number of arguments
+ * @param argv The arguments of the client
+ *
+ * The arguments are {"sdstore" "status"} for a status request, or
+ * {"sdstore" "proc-file" "<priority (0-5)>" "<input-file>" "<output-file>" "<transformation-1>" "<transformation-2>" ...}
+ * 
+ * The priority is optional. The transformations can be followed by branches, each given as
+ * {"-b" "<number-of-operations>" "<output-file>" "<transformation-1>" ...}, which send the output of the
+ * first operations through other transformations to another output file, reading the input only once.
+ * 
+ * {"sdstore" "proc-stream" "-p" "<priority (0-5)>" "<transformation-1>" ...} sends the standard input of the
+ * client through the transformations to its standard output, the answers of the server going to its standard
+ * error instead. It needs the socket of the server, to pass it both streams.
+ * 
+ * The request is sent through the socket of the server if it listens on one, and through its FIFO otherwise
+ * 
+ * @return 0 On success
+ */
+int main(int argc, char* argv[])
+{
+    REQUEST r;
+
+    if (!parseArguments(argc, argv, &r)) {
+        PRINTLN("Invalid arguments");
         return 1;
     }
 
+    char clientFifoName[32] = "";
+    char* socketPath = getenv(SOCKET_VARIABLE);
+    file_d answers = connectSocket(socketPath ? socketPath : SOCKET_NAME);
+
+    //The standard output of a stream carries the data, so the answers go to the standard error
+    file_d messages = STDOUT_FILENO;
+    if (isStreamRequest(&r)) {
+        messages = STDERR_FILENO;
+        if (answers < 0) {
+            write(STDERR_FILENO, STREAM_NEEDS_SOCKET "\n", sizeof(STREAM_NEEDS_SOCKET));
+            return 1;
+        }
+    }
+
+    if (answers >= 0 && !sendThroughSocket(answers, &r)) {
+        close(answers);
+        return 1;
+    }
+    if (answers < 0 && (answers = sendThroughFifo(&r, clientFifoName)) < 0)
+        return 1;
+
     PIPE_READER pr;
-    initPipeReader(&pr, clientFifo);
+    initPipeReader(&pr, answers);
     //Server responses do not exceed 4096 bytes
     char response[4096];
     
     /*
-    Await for server to send response. Exit when pipe closes
+    Await for server to send response. Exit when the server marks the end of the answers or the pipe closes
     */
-    while (readString(&pr, response, sizeof(response)))
+    while (readString(&pr, response, sizeof(response)) && response[0])
     {
         int len = strlen(response);
 
@@ -95,10 +235,12 @@ int main(int argc, char* argv[])
         //as the server does not terminate messages with '\n'
         response[len++] = '\n'; 
         response[len] = '\0';
-        write(STDOUT_FILENO, response, len);
+        write(messages, response, len);
     }
 
-    close(clientFifo);
-    unlink(clientFifoName);
+    releasePipeReader(&pr);
+    close(answers);
+    if (clientFifoName[0])
+        unlink(clientFifoName);
     return 0;
 }
\ No newline at end of file
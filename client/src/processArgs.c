@@ -12,6 +12,7 @@
 #include "logging.h"
 
 #include "../include/processArgs.h"
+#include "../include/workflow.h"
 #include "request.h"
 
 /**
@@ -61,6 +62,49 @@ bool safeStrToInt(char* str, int* val) {
     return true;
 }
 
+/**
+ * @brief Parses the branches of a ::PROC_FILE #Request
+ * 
+ * Each branch is given as {"-b" "<number-of-operations>" "<output-file>" "<transformation-1>" ...}: the
+ * output of the first operations of the #Request goes through the transformations of the branch to its output
+ * file, as well as through the rest of the operations of the #Request
+ * 
+ * @param argc      The number of arguments left
+ * @param argv      The arguments left, starting with the first branch flag
+ * @param request   The #Request to write to (its operations already parsed)
+ * 
+ * @return 1        If the parsing is successful
+ * @return 0        If the parsing failed
+ */
+bool parseBranches(int argc, char* argv[], Request request) {
+    request->branchCount = 0;
+    for(int i = 0; i < argc; i++)
+        if(!strcmp(argv[i], BRANCH_FLAG))
+            request->branchCount++;
+
+    request->branches = malloc(sizeof(BRANCH) * request->branchCount);
+    if(!request->branches) {
+        printMessage(STDERR_FILENO, MALLOCFAILED);
+        _exit(1);
+    }
+
+    int currentArg = 0;
+    for(int i = 0; i < request->branchCount; i++) {
+        Branch branch = &request->branches[i];
+        branch->parent = -1;
+        if(currentArg + 2 >= argc || !safeStrToInt(argv[currentArg + 1], &branch->after) || branch->after > request->operationCount)
+            return false;
+
+        branch->outputFile = argv[currentArg + 2];
+        currentArg += 3;
+        branch->operations = argv + currentArg;
+        for(branch->operationCount = 0; currentArg < argc && strcmp(argv[currentArg], BRANCH_FLAG); currentArg++)
+            branch->operationCount++;
+    }
+
+    return true;
+}
+
 /**
  * @brief Parses the given arguments into a ::PROC_FILE #Request
  * 
@@ -76,9 +120,6 @@ bool parseProcFile(int argc, char* argv[], Request request)  {
     //the second argument corresponds to the proc_file command
     if(argc >= 5 && !strcmp(argv[1], PROC_FILE_COMMAND)) {
         request->type = PROCESS_FILE;
-        
-        //Client should not fill this with valid data
-        request->senderFD=-1;
         request->running = false;
         //Default priority value
         request->priority = 0;
@@ -88,41 +129,88 @@ bool parseProcFile(int argc, char* argv[], Request request)  {
         else
             currentArg = 2;
 
-        //IO files
-        request->inputFile = malloc(strlen(argv[currentArg]) + 1);
-        request->outputFile = malloc(strlen(argv[currentArg + 1]) + 1);
+        //IO files and operations point into the arguments, which outlive the request
+        request->inputFile = argv[currentArg++];
+        request->outputFile = argv[currentArg++];
 
-        //Check if malloc failed
-        if(!request->inputFile || !request->outputFile) {
-            printMessage(STDERR_FILENO, MALLOCFAILED);
-            _exit(1);
-        }
-
-        strcpy(request->inputFile, argv[currentArg++]);
-        strcpy(request->outputFile, argv[currentArg++]);
+        //Operations, up to the first branch
+        int branchArg = currentArg;
+        while(branchArg < argc && strcmp(argv[branchArg], BRANCH_FLAG))
+            branchArg++;
+        request->operationCount = branchArg - currentArg;
+        request->operations = argv + currentArg;
 
-        //Operations
-        request->operationCount = argc - currentArg;
-        request->operations = malloc(sizeof(char*) * request->operationCount);
-        if(!request->operations) {
-            printMessage(STDERR_FILENO, MALLOCFAILED);
-            _exit(1);
-        }
-        for(int i = currentArg; i < argc; i++) {
-            request->operations[i - currentArg] = malloc(strlen(argv[i]) + 1);
-            if(!request->operations[i - currentArg]) {
-                printMessage(STDERR_FILENO, MALLOCFAILED);
-                _exit(1);
-            }
-            request->operations[i - currentArg] = argv[i];
-        }
-        return true;
+        return parseBranches(argc - branchArg, argv + branchArg, request);
     } 
 
     return false;
 }
 
+/**
+ * @brief Parses the given arguments into a ::PROC_FILE #Request described by a workflow file
+ * 
+ * @param argc      The number of arguments
+ * @param argv      The arguments
+ * @param request   The #Request to write to
+ * 
+ * @return 1        If the parsing is successful
+ * @return 0        If the parsing failed
+ */
+bool parseProcFlow(int argc, char* argv[], Request request)  {
+    //Check for the correct number of arguments and that
+    //the second argument corresponds to the proc_flow command
+    if((argc == 3 || argc == 5) && !strcmp(argv[1], PROC_FLOW_COMMAND)) {
+        request->type = PROCESS_FILE;
+        request->running = false;
+        //Default priority value
+        request->priority = 0;
+        if(argc == 5 && (strcmp(argv[2], "-p") || !safeStrToInt(argv[3], &request->priority)))
+            return false;
+
+        return parseWorkflow(argv[argc - 1], request);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parses the given arguments into a ::PROCESS_STREAM #Request streaming the standard input of the client
+ * to its standard output
+ * 
+ * @param argc      The number of arguments
+ * @param argv      The arguments
+ * @param request   The #Request to write to
+ * 
+ * @return 1        If the parsing is successful
+ * @return 0        If the parsing failed
+ */
+bool parseProcStream(int argc, char* argv[], Request request)  {
+    //Check for the correct number of arguments and that
+    //the second argument corresponds to the proc_stream command
+    if(argc >= 3 && !strcmp(argv[1], PROC_STREAM_COMMAND)) {
+        request->type = PROCESS_STREAM;
+        request->running = false;
+        //Default priority value
+        request->priority = 0;
+        int currentArg = 2;
+        //A priority flag is never taken for a transformation, so it needs a valid value
+        if(!strcmp(argv[2], "-p")) {
+            if(argc < 5 || !safeStrToInt(argv[3], &request->priority))
+                return false;
+            currentArg = 4;
+        }
+
+        request->inputFile = request->outputFile = STANDARD_STREAMS;
+        request->operationCount = argc - currentArg;
+        request->operations = argv + currentArg;
+        request->branchCount = 0;
+        request->branches = NULL;
+
+        return true;
+    }
 
+    return false;
+}
 
 /**
  * @brief Parses the given arguments into the proper #Request to send to the server
@@ -135,5 +223,6 @@ bool parseProcFile(int argc, char* argv[], Request request)  {
  * @return 0        If the parsing failed
  */
 bool parseArguments(int argc, char* argv[], Request request) {
-    return parseStatus(argc, argv, request) || parseProcFile(argc, argv, request);
+    return parseStatus(argc, argv, request) || parseProcFile(argc, argv, request) || parseProcFlow(argc, argv, request)
+        || parseProcStream(argc, argv, request);
 }
\ No newline at end of file
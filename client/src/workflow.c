@@ -0,0 +1,210 @@
+/**
+ * @file workflow.c
+ * 
+ * @brief File implementing the reading of a workflow file into a #Request
+ * 
+ * A workflow is a graph of requests in which the output of a request (a node) can be the input of others.
+ * Each line of the file declares a node as ```<name> <input> <output> [<transformation>...]```, where the
+ * input is either a file or ```@<name>``` for the output of another node, and the output is either a file or
+ * ```-``` if the output is only streamed to the nodes reading it. Empty lines and lines starting with ```#```
+ * are ignored.
+ * 
+ * Since a node has a single input, the graph is a tree rooted at the input file, and it is sent to the server
+ * as a single #Request: the first node reading the file holds the operations of the #Request, and every
+ * other node is a branch forking after all the operations of the node it reads from (or after none, for the
+ * other nodes reading the file). The server schedules the whole workflow at once and streams the data between
+ * the nodes, without intermediate files.
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+#include "../include/workflow.h"
+#include "request.h"
+
+/**
+ * @brief The prefix of an input naming another node
+ * 
+ */
+#define NODE_REFERENCE '@'
+
+/**
+ * @brief A node of a workflow
+ * 
+ */
+typedef struct node {
+    char* name; ///< The name of the node
+    char* input; ///< The input of the node (a file, or another node after #NODE_REFERENCE)
+    char* output; ///< The output of the node (#STREAMED_OUTPUT if it is not written)
+    int operationCount; ///< The number of operations of the node
+    char** operations; ///< The operations of the node
+    int branch; ///< The branch of the #Request running the node (-1 for its operations, -2 if not placed yet)
+} NODE, * Node;
+
+/**
+ * @brief Reads a whole file into memory
+ * 
+ * @param path The path of the file
+ * 
+ * @return char* The contents of the file, terminated by '\0'
+ * @return NULL If the file cannot be read
+ */
+char* readWorkflowFile(char* path) {
+    struct stat st;
+    file_d fd = open(path, O_RDONLY);
+    if(fd < 0 || fstat(fd, &st)) {
+        printMessage(STDERR_FILENO, OPENFAILED);
+        return NULL;
+    }
+
+    char* contents = malloc(st.st_size + 1);
+    if(!contents) {
+        printMessage(STDERR_FILENO, MALLOCFAILED);
+        _exit(1);
+    }
+
+    long length = 0, bytesRead;
+    while(length < st.st_size && (bytesRead = read(fd, contents + length, st.st_size - length)) > 0)
+        length += bytesRead;
+    contents[length] = '\0';
+    close(fd);
+
+    return contents;
+}
+
+/**
+ * @brief Splits the lines of a workflow file into nodes
+ * 
+ * @param contents The contents of the file (split in place)
+ * @param nodes The array to write the nodes to (with room for one node per line)
+ * 
+ * @return int The number of nodes (-1 if a line is not a valid node)
+ */
+int parseNodes(char* contents, Node nodes) {
+    int count = 0;
+    char* savedLine;
+
+    for(char* line = strtok_r(contents, "\n", &savedLine); line; line = strtok_r(NULL, "\n", &savedLine)) {
+        char* savedWord;
+        char* words[strlen(line) / 2 + 1];
+        int wordCount = 0;
+
+        for(char* word = strtok_r(line, " \t\r", &savedWord); word; word = strtok_r(NULL, " \t\r", &savedWord))
+            words[wordCount++] = word;
+        if(!wordCount || words[0][0] == '#')
+            continue;
+        if(wordCount < 3)
+            return -1;
+
+        Node node = &nodes[count++];
+        node->name = words[0];
+        node->input = words[1];
+        node->output = strcmp(words[2], STREAMED_OUTPUT) ? words[2] : DISCARDED_OUTPUT;
+        node->operationCount = wordCount - 3;
+        node->operations = malloc(sizeof(char*) * node->operationCount);
+        if(!node->operations) {
+            printMessage(STDERR_FILENO, MALLOCFAILED);
+            _exit(1);
+        }
+        memcpy(node->operations, words + 3, sizeof(char*) * node->operationCount);
+        node->branch = -2;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Reads a workflow file into a ::PROC_FILE #Request
+ * 
+ * Every node must be reachable from the input file, which must be the same for every node reading a file,
+ * and one of those nodes must have operations
+ * 
+ * @param path The path of the workflow file
+ * @param request The #Request to write to (its type and priority already set)
+ * 
+ * @return 1 If the workflow is valid
+ * @return 0 If the workflow cannot be read or is not valid
+ */
+bool parseWorkflow(char* path, Request request) {
+    char* contents = readWorkflowFile(path);
+    if(!contents)
+        return false;
+
+    int lines = 1;
+    for(char* c = contents; *c; c++)
+        lines += *c == '\n';
+
+    NODE nodes[lines];
+    int count = parseNodes(contents, nodes);
+    if(count <= 0)
+        return false;
+
+    for(int i = 0; i < count; i++)
+        for(int j = 0; j < i; j++)
+            if(!strcmp(nodes[i].name, nodes[j].name))
+                return false;
+
+    //The first node reading a file with operations runs the operations of the request
+    int root = 0;
+    while(root < count && (nodes[root].input[0] == NODE_REFERENCE || !nodes[root].operationCount))
+        root++;
+    if(root == count)
+        return false;
+
+    request->inputFile = nodes[root].input;
+    request->outputFile = nodes[root].output;
+    request->operationCount = nodes[root].operationCount;
+    request->operations = nodes[root].operations;
+    nodes[root].branch = -1;
+
+    request->branchCount = 0;
+    request->branches = malloc(sizeof(BRANCH) * count);
+    if(!request->branches) {
+        printMessage(STDERR_FILENO, MALLOCFAILED);
+        _exit(1);
+    }
+
+    //Place the nodes breadth first, so that each branch comes after the one it reads from
+    Node placed[count];
+    int placedCount = 0;
+    for(int i = 0; i < count; i++) {
+        if(i == root || nodes[i].input[0] != NODE_REFERENCE) {
+            if(strcmp(nodes[i].input, request->inputFile))
+                return false;
+            placed[placedCount++] = &nodes[i];
+        }
+    }
+
+    for(int p = 0; p < placedCount; p++) {
+        Node node = placed[p];
+
+        if(node->branch == -2) {
+            Branch branch = &request->branches[request->branchCount];
+            //Nodes reading the file fork from the input, the others after all the operations of their parent
+            Node parent = &nodes[root];
+            for(int i = 0; i < count && node->input[0] == NODE_REFERENCE; i++)
+                if(!strcmp(node->input + 1, nodes[i].name))
+                    parent = &nodes[i];
+
+            branch->parent = parent->branch;
+            branch->after = node->input[0] == NODE_REFERENCE ? parent->operationCount : 0;
+            branch->outputFile = node->output;
+            branch->operationCount = node->operationCount;
+            branch->operations = node->operations;
+            node->branch = request->branchCount++;
+        }
+
+        for(int i = 0; i < count; i++)
+            if(nodes[i].input[0] == NODE_REFERENCE && !strcmp(nodes[i].input + 1, node->name))
+                placed[placedCount++] = &nodes[i];
+    }
+
+    //A node left out reads from a node that does not exist or from itself (through a cycle)
+    return placedCount == count;
+}
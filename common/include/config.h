@@ -13,6 +13,10 @@
  */
 #define _CONFIG_H_
 
+#include <sys/types.h>
+
+#include "utils.h"
+
 /**
  * @brief The number of different programs mentioned in the config file
  * 
@@ -25,6 +29,159 @@
  */
 #define MAX_PROGRAM_SIZE 256
 
+/**
+ * @brief The highest priority a #Request can have
+ * 
+ */
+#define MAX_PRIORITY 5
+
+/**
+ * @brief Value of #SchedulingClass::nice meaning the niceness of the stages is not changed
+ * 
+ */
+#define NICE_UNCHANGED 100
+
+/**
+ * @brief Value of #SchedulingClass::policy meaning the scheduling policy of the stages is not changed
+ * 
+ */
+#define POLICY_UNCHANGED -1
+
+/**
+ * @brief The OS scheduling settings applied to the stages of the requests with a given priority
+ * 
+ */
+typedef struct schedulingClass {
+    int nice; ///< The niceness of the stages (#NICE_UNCHANGED to keep the server's)
+    int ioClass; ///< The I/O scheduling class of the stages (0 to keep the server's)
+    int ioLevel; ///< The level within the I/O scheduling class (0 to 7)
+    int policy; ///< The CPU scheduling policy of the stages (#POLICY_UNCHANGED to keep the server's)
+} SCHEDULING_CLASS, * SchedulingClass;
+
+/**
+ * @brief Maximum number of devices with their own concurrency limit in the config file
+ * 
+ */
+#define MAX_DEVICE_LIMITS 16
+
+/**
+ * @brief The maximum number of requests using a given device that can be running at once
+ * 
+ */
+typedef struct deviceLimit {
+    dev_t device; ///< The device (st_dev of the path given in the config file)
+    int limit; ///< The maximum number of requests (0 for no limit)
+} DEVICE_LIMIT, * DeviceLimit;
+
+/**
+ * @brief The default maximum number of bytes of input files prefetched ahead of their requests
+ * 
+ */
+#define DEFAULT_PREFETCH_BUDGET (256L * 1024 * 1024)
+
+/**
+ * @brief The default number of bytes written by the last stage between write-behinds in large-file mode
+ * 
+ */
+#define DEFAULT_LARGE_FILE_WINDOW (8L * 1024 * 1024)
+
+/**
+ * @brief The default predicted output size from which output files are preallocated
+ * 
+ */
+#define DEFAULT_PREALLOCATE_THRESHOLD (1024L * 1024)
+
+/**
+ * @brief Value of #Config::pipeSizes meaning the capacity of the output pipe of a transformation is
+ * sized from its observed throughput
+ * 
+ */
+#define PIPE_SIZE_AUTO -1
+
+/**
+ * @brief Maximum length of the path of the result cache directory
+ * 
+ */
+#define MAX_CACHE_DIR_SIZE 1024
+
+/**
+ * @brief Maximum length of the path of the Unix domain socket of the server (that of sockaddr_un::sun_path)
+ * 
+ */
+#define MAX_SOCKET_PATH_SIZE 108
+
+/**
+ * @brief The default maximum number of bytes of outputs kept in the result cache
+ * 
+ */
+#define DEFAULT_CACHE_SIZE (1024L * 1024 * 1024)
+
+/**
+ * @brief The default number of requests sharing a prefix of operations from which the prefix is hot
+ * 
+ */
+#define DEFAULT_PREFIX_HOT 2
+
+/**
+ * @brief The default input size from which requests made only of chunkable transformations run in chunks
+ * 
+ */
+#define DEFAULT_CHUNK_THRESHOLD (256L * 1024 * 1024)
+
+/**
+ * @brief The default size of the chunks of the input of a request run in chunks
+ * 
+ */
+#define DEFAULT_CHUNK_SIZE (64L * 1024 * 1024)
+
+/**
+ * @brief The default number of bytes of input of a request run in chunks between two checkpoints of its progress
+ * 
+ */
+#define DEFAULT_CHECKPOINT_INTERVAL (1024L * 1024 * 1024)
+
+/**
+ * @brief The default number of jobs after which a persistent worker is replaced
+ * 
+ */
+#define DEFAULT_WORKER_JOBS 1000
+
+/**
+ * @brief The default interval between two samples of the progress of a running pipeline (milliseconds)
+ * 
+ */
+#define DEFAULT_PROGRESS_INTERVAL 500
+
+/**
+ * @brief How the stages of a transformation are run
+ * 
+ */
+typedef enum workerMode {
+    WORKER_NONE, ///< A process is started for every stage
+    WORKER_WRAPPED, ///< Persistent workers of the server run the executable for every stage
+    WORKER_NATIVE ///< The executable is a persistent worker speaking the worker protocol
+} WorkerMode;
+
+/**
+ * @brief The digests that can be computed on the output of the requests as it is written
+ * 
+ */
+typedef enum digestType {
+    DIGEST_NONE, ///< The output is not digested
+    DIGEST_CRC32C, ///< CRC32C (Castagnoli polynomial), with the SSE4.2 instructions when the CPU has them
+    DIGEST_XXH64, ///< XXH64 with seed 0
+    DIGEST_UNAVAILABLE ///< The digest asked for could not be computed (only reported to the client, never configured)
+} DigestType;
+
+/**
+ * @brief The policies for placing the stages of a pipeline on the CPUs of the machine
+ * 
+ */
+typedef enum placementPolicy {
+    PLACEMENT_NONE, ///< Stages are not pinned, the kernel decides where they run
+    PLACEMENT_PIPELINE ///< Stages of a pipeline are pinned to nearby cores, pipelines are spread across the machine
+} PlacementPolicy;
+
 /**
  * @brief Structure used to represent the configuration of the server
  * 
@@ -33,6 +190,37 @@ typedef struct config {
     int instances[NUMBER_PROGRAMS]; ///< Maximum number of instances of the programs
     char programs[NUMBER_PROGRAMS][MAX_PROGRAM_SIZE]; ///< Names of the programs
     int programCount; ///< Number of programs
+    long pipeSizes[NUMBER_PROGRAMS]; ///< Capacity of the output pipe of the programs (0 for the default, #PIPE_SIZE_AUTO)
+    bool identities[NUMBER_PROGRAMS]; ///< Whether the output of the programs is always equal to their input
+    bool chunkables[NUMBER_PROGRAMS]; ///< Whether the output of the programs on concatenated inputs is the concatenation of their outputs
+    char inverses[NUMBER_PROGRAMS][MAX_PROGRAM_SIZE]; ///< Names of the programs undoing the programs (empty if none)
+    bool plugins[NUMBER_PROGRAMS]; ///< Whether the programs run in the server, from their shared object (plugin)
+    WorkerMode workerModes[NUMBER_PROGRAMS]; ///< Whether the programs run on persistent workers, and how
+    PlacementPolicy placement; ///< The CPU placement policy of the stages of a pipeline
+    SCHEDULING_CLASS scheduling[MAX_PRIORITY + 1]; ///< The OS scheduling settings for each request priority
+    int deviceLimit; ///< The default maximum number of running requests using a device (0 for no limit)
+    DEVICE_LIMIT devices[MAX_DEVICE_LIMITS]; ///< The devices with their own limit
+    int deviceCount; ///< The number of devices with their own limit
+    int prefetchDepth; ///< The number of requests next in line whose input is prefetched (0 to disable)
+    long prefetchBudget; ///< The maximum number of bytes prefetched and not yet consumed at once
+    long largeFileThreshold; ///< The input size from which requests run in large-file mode (0 to disable)
+    long largeFileWindow; ///< The number of bytes between write-behinds / cache drops in large-file mode
+    bool largeFileDirect; ///< Whether large-file mode reads and writes the files with O_DIRECT
+    long preallocateThreshold; ///< The predicted output size from which output files are preallocated (0 to disable)
+    char cacheDir[MAX_CACHE_DIR_SIZE]; ///< The directory of the result cache (empty to disable)
+    long cacheSize; ///< The maximum number of bytes of outputs kept in the result cache
+    long prefixCacheSize; ///< The maximum number of bytes of intermediate outputs kept in the cache (0 to disable)
+    int prefixHot; ///< The number of requests sharing a prefix of operations from which its output is cached
+    bool coalesce; ///< Whether requests identical to one already in the server are attached to it
+    long chunkThreshold; ///< The input size from which requests of chunkable programs run in chunks (0 to disable)
+    long chunkSize; ///< The size of the chunks of the input of a request run in chunks
+    int chunkWidth; ///< The maximum number of chunks of a request run at once (0 for the number of CPUs)
+    long checkpointInterval; ///< The number of bytes of input between two checkpoints of a request run in chunks (0 to disable)
+    bool workerPool; ///< Whether the transformations declared with the "worker" attribute run on persistent workers
+    long workerJobs; ///< The number of jobs after which a persistent worker is replaced (0 for never)
+    DigestType outputDigest; ///< The digest computed on the output of the requests as it is written
+    long progressInterval; ///< The interval between two samples of the progress of a running pipeline (milliseconds, 0 to disable)
+    char socketPath[MAX_SOCKET_PATH_SIZE]; ///< The path of the Unix domain socket served along with the FIFO (empty to disable)
 } CONFIG, * Config;
 
 
@@ -41,7 +229,12 @@ char loadConfig(char*, Config);
 int getNumberInstances(char*, Config);
 
 int getProgramId(Config, char*);
+int getInverseId(Config, int);
 
 char* getProgramName(Config, int);
 
+SchedulingClass getSchedulingClass(Config, int);
+
+int getDeviceLimit(Config, dev_t);
+
 #endif // _CONFIG_H_
\ No newline at end of file
@@ -0,0 +1,38 @@
+/**
+ * @file hash.h
+ * 
+ * @brief File declaring the API used to compute XXH64 hashes of file contents
+ * 
+ */
+
+#ifndef _HASH_H_
+
+/**
+ * @brief Include guard
+ */
+#define _HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/**
+ * @brief The state of an incremental XXH64 computation
+ * 
+ */
+typedef struct hashState {
+    uint64_t accumulators[4]; ///< The accumulators of the four lanes
+    uint64_t totalLength; ///< The number of bytes hashed so far
+    unsigned char pending[32]; ///< The bytes not yet consumed by the lanes (less than a stripe)
+    int pendingLength; ///< The number of bytes in #pending
+    uint64_t seed; ///< The seed of the hash
+} HASH_STATE, * HashState;
+
+void initHash(HashState, uint64_t);
+void updateHash(HashState, const void*, size_t);
+uint64_t digestHash(HashState);
+uint64_t hashBytes(const void*, size_t, uint64_t);
+bool hashFile(file_d, uint64_t*);
+
+#endif // _HASH_H_
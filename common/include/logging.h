@@ -38,6 +38,7 @@ typedef enum errorsType{
     ENTRY(CREATEDWRITEPIPETOCLIENT,INFO,"Created a write pipe to client\n") \
     ENTRY(REQUESTWASVALIDATED,INFO,"Request was considered valid\n") \
     ENTRY(REQUESTWASNOTVALIDATED,WARNING,"Request was considered invalid\n") \
+    ENTRY(TOOMANYREQUESTS,WARNING,"Request refused, the router holds too many requests\n") \
     ENTRY(STATUSREQUEST,INFO,"Status was requested\n") \
     ENTRY(PROCESSFILEREQUEST,INFO,"Process file was requested\n") \
     ENTRY(SERVEREXITING,INFO,"Server exiting\n") \
@@ -50,12 +51,26 @@ typedef enum errorsType{
     ENTRY(PIPECREATEFAILED,ERROR,"The pipe could not be created\n") \
     ENTRY(OPENFAILED,ERROR,"Error opening file\n") \
     ENTRY(UNKNOWNREQUESTTYPE,ERROR,"Unknown request type\n") \
+    ENTRY(INVALIDFRAME,WARNING,"Invalid frame received, discarding it\n") \
+    ENTRY(UPDATETOOLARGE,ERROR,"writeUpdate: update larger than PIPE_BUF, not sent\n") \
+    ENTRY(SOCKETCREATEFAILED,WARNING,"Cant create the socket %s, only the FIFO is served\n") \
+    ENTRY(CLIENTCONNECTED,INFO,"Client connected through the socket (pid %d, uid %u)\n") \
     ENTRY(UNKNOWNUPDATETYPE,ERROR,"Unknown update type\n") \
     ENTRY(RELAYDELETEDFIFO,WARNING,"FIFO " SERVER_NAME " persisted after server closed. Clean up performed by Relay\n") \
     ENTRY(REQUESTDROPPED, WARNING, "Bad Request\n") \
     ENTRY(UNEXPECTEDERROR, ERROR, "An error occured in a process\n") \
     ENTRY(OPERATIONFINISHED,INFO,"Operation finished successfully\n") \
     ENTRY(REQUESTFINISHED,INFO,"Request finished successfully\n") \
+    ENTRY(REQUESTFAILED,ERROR,"Request failed\n") \
+    ENTRY(CACHEDOUTPUTLOST,WARNING,"A cached output was gone when its request was dispatched, running it again\n") \
+    ENTRY(REQUESTCOALESCED,INFO,"Request attached to the identical task #%d\n") \
+    ENTRY(REQUESTCHUNKED,INFO,"Request split into %d chunks, %d run at once\n") \
+    ENTRY(REQUESTRESUMED,INFO,"Request resumed after chunk %d\n") \
+    ENTRY(PLUGINLOADED,INFO,"Transformation %s runs in the server (plugin loaded)\n") \
+    ENTRY(PLUGINNOTLOADED,WARNING,"Cant load the plugin of %s, its executable is used\n") \
+    ENTRY(WORKERSTARTED,INFO,"Worker %d started for %s\n") \
+    ENTRY(WORKERRECYCLED,INFO,"Worker %d of %s replaced after %ld jobs\n") \
+    ENTRY(OUTPUTSIZEPREDICTED,INFO,"Output size predicted: %ld bytes, actual: %ld bytes (error %+.1f%%)\n") \
     ENTRY(CANTOPENINPUTFILE,ERROR,"Cant open input file does it exist?\n") \
     ENTRY(CANTOPENOUTPUTFILE,ERROR,"Cant open output file does it exist?\n") \
     ENTRY(MALLOCFAILED, FATAL_ERROR, "Cannot allocate memory\n") \
@@ -74,5 +89,6 @@ typedef enum ErrorCode {
 } ERROR_CODE;
 
 void printMessage(file_d fd, ERROR_CODE errorCode);
+void printFormattedMessage(file_d fd, ERROR_CODE errorCode, ...);
 
 #endif // __LOGGING_H__
\ No newline at end of file
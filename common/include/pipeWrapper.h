@@ -31,14 +31,19 @@
  */
 typedef struct pipeReader {
     file_d pipe; ///< The file descriptor of the pipe/fifo
-    char buffer[READER_BUFFER_SIZE]; ///< The intermediate buffer to which the data is written
+    char* buffer; ///< The intermediate buffer to which the data is written (#inlineBuffer, unless a frame did not fit in it)
+    int capacity; ///< The size of #buffer
     int available;  ///< The number of bytes available for reading to the buffer
     int pos;        ///< The next position to read from the buffer
+    char inlineBuffer[READER_BUFFER_SIZE]; ///< The initial buffer
 } PIPE_READER, * PipeReader;
 
 void initPipeReader(PipeReader, file_d);
+void releasePipeReader(PipeReader);
 bool readBytes(PipeReader, int, void*);
 char readString(PipeReader, char*, int n);
+char* peekBytes(PipeReader, int);
+void skipBytes(PipeReader, int);
 
 
 /**
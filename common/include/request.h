@@ -11,6 +11,9 @@
  */
 #define _REQUEST_H_
 
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "config.h"
 #include "pipeWrapper.h"
@@ -27,8 +30,9 @@
  * 
  */
 typedef enum requestType {
-    STATUS,      ///< Requesting the server status
-    PROCESS_FILE ///< Requesting to process a file
+    STATUS,        ///< Requesting the server status
+    PROCESS_FILE,  ///< Requesting to process a file
+    PROCESS_STREAM ///< Requesting to process the standard input of the client to its standard output
 } RequestType;
 
 /**
@@ -43,6 +47,56 @@ typedef enum requestType {
  */
 #define PROC_FILE_COMMAND "proc-file"
 
+/**
+ * @brief The flag of the client introducing a branch of a ::PROC_FILE command
+ * 
+ */
+#define BRANCH_FLAG "-b"
+
+/**
+ * @brief The string corresponding to the ::PROC_FLOW command
+ * 
+ */
+#define PROC_FLOW_COMMAND "proc-flow"
+
+/**
+ * @brief The string corresponding to the ::PROC_STREAM command
+ * 
+ */
+#define PROC_STREAM_COMMAND "proc-stream"
+
+/**
+ * @brief The name shown for the input and output file of a ::PROCESS_STREAM #Request, which are the standard
+ * input and output of the client, passed open to the server
+ * 
+ */
+#define STANDARD_STREAMS "-"
+
+/**
+ * @brief The output of a node of a workflow that is only streamed to the nodes depending on it
+ * 
+ */
+#define STREAMED_OUTPUT "-"
+
+/**
+ * @brief The file the output of a node of a workflow is written to when it is only streamed
+ * 
+ */
+#define DISCARDED_OUTPUT "/dev/null"
+
+/**
+ * @brief An extra output of a #Request: the data between two of its operations (or of the operations of
+ * another branch), sent through operations of its own to another file
+ * 
+ */
+typedef struct branch {
+    int parent; ///< The index of the branch whose operations feed the branch (-1 for those of the #Request, always lower than its own)
+    int after; ///< The number of operations of the parent whose output feeds the branch (0 for its input)
+    char* outputFile; ///< The name of the output file of the branch
+    int operationCount; ///< The number of operations of the branch (0 to write the data as it is)
+    char** operations; ///< The operations of the branch
+} BRANCH, * Branch;
+
 /**
  * @brief The type used to represent a #Request from the client to the server
  * 
@@ -52,21 +106,74 @@ typedef struct request {
     int priority; ///< The priority of the request (from 0 to 5)
     char* sender;   ///< The name of the input fifo of the client that sent the request
     file_d senderFD; ///< The writter to the client that sent the request
+    file_d inputFD; ///< The input file, passed open by a client of the socket (set by the server, -1 to open #inputFile)
+    file_d outputFD; ///< The output file, passed open by a client of the socket (set by the server, -1 to open #outputFile)
+    pid_t clientPid; ///< The process of the client of the socket that sent the request (set by the server, 0 for a client of the FIFO)
+    uid_t clientUid; ///< The user of the client of the socket, whose permissions the paths are opened with (set by the server)
+    gid_t clientGid; ///< The group of the client of the socket (set by the server)
     char* inputFile; ///< The name of the input file
     char* outputFile; ///< The name of the output file
     int operationCount; ///< The number of operations requested
     char** operations; ///< The request operations
+    int branchCount; ///< The number of branches of the request (0 if it has a single output)
+    BRANCH* branches; ///< The branches of the request
     int timeOfArrival; ///< Time of arrival in the server
+    long arrivalOrder; ///< The number of requests that arrived in the server before this one (set by the server)
     bool running; ///< Whether the server is processing the request
+    int cpuDomain; ///< The CPU domain the stages are placed on by the server (-1 if not pinned)
+    int cpuCore; ///< The core of #cpuDomain the first stage is placed on
+    int cpuLoad; ///< The number of processes of the request counted in the load of #cpuDomain
+    dev_t inputDevice; ///< The device holding the input file (set by the server)
+    dev_t outputDevice; ///< The device holding the output file (set by the server)
+    bool admitted; ///< Whether the request is queued to be dispatched (false while it waits for its devices to have capacity)
+    long prefetched; ///< The number of bytes of the input file prefetched by the server (0 if none)
+    long inputSize; ///< The size of the input file when the request was dispatched (set by the server)
+    long predictedSize; ///< The predicted size of the output file (set by the server, 0 if unknown)
+    int materializePrefix; ///< The number of operations whose intermediate output is cached (set by the server, 0 if none)
+    bool inputHashed; ///< Whether the hash of the contents of the input file is known (set by the server)
+    uint64_t inputHash; ///< The hash of the contents of the input file, learned from an earlier request (set by the server)
+    int cachedOperations; ///< The number of operations whose output is served from the result cache (set by the server, 0 if none)
+    bool cachedIntermediate; ///< Whether the output of #cachedOperations is an intermediate output (set by the server)
+    ino_t inputInode; ///< The inode of the input file when the request arrived (set by the server)
+    struct timespec inputModified; ///< The last modification of the input file when the request arrived (set by the server)
+    int chunkWidth; ///< The number of chunks of the input run at once (set by the server, 0 if not run in chunks)
+    int leader; ///< The #timeOfArrival of the identical request whose output is copied (set by the server, -1 if none)
 } REQUEST, * Request;
 
+/**
+ * @brief The file system user and group a thread had before it accessed the files of a client
+ * 
+ */
+typedef struct clientAccess {
+    uid_t uid; ///< The file system user
+    gid_t gid; ///< The file system group
+} CLIENT_ACCESS, * ClientAccess;
+
+int getStageCount(Request);
+char* getStageOperation(Request, int);
+int getBranchStage(Request, int);
+int getStageInput(Request, int);
+bool hasBranchesAfter(Request, int, int);
 int getOperationCount(Request, char*);
 int compareRequests(Request, Request);
-bool readRequest(PipeReader, Request);
+bool checkRequestFrame(char*, int);
+Request decodeRequest(char*, int);
+Request readRequest(PipeReader);
 bool writeRequest(PipeWritter, Request);
+int getRequestFrameLength(Request);
 char* requestToString(Request);
 char* getRequestStatus(Config, int[], Request*, int);
+bool isStreamRequest(Request);
+bool beginClientAccess(Request, ClientAccess);
+void endClientAccess(ClientAccess);
+file_d openAsClient(Request, char*, int, mode_t);
+file_d openRequestInput(Request);
+file_d openRequestOutput(Request, bool);
+file_d reopenRequestInput(Request);
+file_d reopenRequestOutput(Request);
+int statRequestInput(Request, struct stat*);
+int statRequestOutput(Request, struct stat*);
+bool getRequestOutputPath(Request, char*, int);
 void freeRequest(Request);
-void freeRequestContent(Request);
 
 #endif // _REQUEST_H_
\ No newline at end of file
@@ -0,0 +1,31 @@
+/**
+ * @file socketWrapper.h
+ * 
+ * @brief File declaring functions related to the Unix domain socket of the server, and to passing descriptors
+ * through it
+ * 
+ */
+
+#ifndef _SOCKETWRAPPER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _SOCKETWRAPPER_H_
+
+#include "utils.h"
+
+/**
+ * @brief The maximum number of descriptors passed with a single message
+ * 
+ */
+#define MAX_PASSED_DESCRIPTORS 4
+
+file_d connectSocket(char*);
+bool sendDescriptors(file_d, void*, int, file_d[], int);
+int receiveAvailable(file_d, void*, int, file_d[], int*, bool);
+bool receiveDescriptors(file_d, void*, int, file_d[], int*);
+bool writeSocket(file_d, void*, int);
+bool readSocket(file_d, void*, int);
+
+#endif // _SOCKETWRAPPER_H_
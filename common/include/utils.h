@@ -41,6 +41,12 @@ typedef char bool;
  */
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
+/**
+ * @brief Inline function for computing the maximum of two values
+ * 
+ */
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
 
 
 
@@ -57,4 +63,10 @@ typedef char bool;
  */
 #define SERVER_NAME "SDStore"
 
+/**
+ * @brief The default path of the Unix domain socket used by the server to receive requests from the clients
+ * 
+ */
+#define SOCKET_NAME "SDStore.sock"
+
 #endif // _UTILS_H_
\ No newline at end of file
@@ -0,0 +1,88 @@
+/**
+ * @file wire.h
+ * 
+ * @brief File declaring the frames exchanged between the client, the relay and the router, and the API used
+ * to read and write their fields
+ * 
+ */
+
+#ifndef _WIRE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _WIRE_H_
+
+#include <limits.h>
+#include <stdint.h>
+
+#include "pipeWrapper.h"
+#include "utils.h"
+
+/**
+ * @brief The first bytes of every frame ("SDSF")
+ * 
+ */
+#define WIRE_MAGIC 0x46534453
+
+/**
+ * @brief The version of the format of the frames (incremented when it changes)
+ * 
+ */
+#define WIRE_VERSION 1
+
+/**
+ * @brief The largest payload a frame may have (bytes)
+ * 
+ */
+#define WIRE_MAX_SIZE (1024 * 1024)
+
+/**
+ * @brief The different kinds of frames
+ * 
+ */
+typedef enum wireKind {
+    WIRE_REQUEST = 1, ///< A #Request
+    WIRE_DESCRIPTORS = 2 ///< The input and output files of the next #Request, passed with the header (no payload)
+} WireKind;
+
+/**
+ * @brief The header of a frame, followed by its payload
+ * 
+ */
+typedef struct wireHeader {
+    uint32_t magic; ///< #WIRE_MAGIC
+    uint16_t version; ///< #WIRE_VERSION
+    uint16_t kind; ///< The #WireKind of the payload
+    uint32_t length; ///< The length of the payload (bytes)
+} WIRE_HEADER, * WireHeader;
+
+/**
+ * @brief The largest payload a frame sent through the FIFO of the server may have (bytes)
+ * 
+ * A whole frame then fits in PIPE_BUF, so that it is written at once and never interleaved with the frames
+ * of other clients
+ * 
+ */
+#define WIRE_FIFO_MAX_SIZE (PIPE_BUF - (int)sizeof(WIRE_HEADER))
+
+/**
+ * @brief A position in the payload of a frame, from which its fields are taken in order
+ * 
+ */
+typedef struct wireCursor {
+    char* pos; ///< The next field
+    char* end; ///< The end of the payload
+} WIRE_CURSOR, * WireCursor;
+
+bool checkWireHeader(WireHeader);
+bool readFrame(PipeReader, WireHeader, char**, uint32_t);
+void writeWireHeader(PipeWritter, WireKind, int);
+void initWireCursor(WireCursor, char*, int);
+bool takeInt(WireCursor, int*);
+bool takeString(WireCursor, char**);
+void putInt(PipeWritter, int);
+void putString(PipeWritter, char*);
+int getStringFieldSize(char*);
+
+#endif // _WIRE_H_
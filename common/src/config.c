@@ -3,11 +3,19 @@
  * 
  * @brief File implementing the loading of the configuration file
  * 
+ * Each line of the configuration file is either empty, a comment (starting with '#'), a transformation
+ * declaration in the form "<name> <max-instances>", a server option in the form "option <key> <value>"
+ * the OS scheduling settings of a request priority in the form
+ * "priority <priority> [nice=<n>] [io=<rt|be|idle>[:<level>]] [sched=<other|batch|idle>]"
+ * or the concurrency limit of the device holding a path in the form "device <path> <max-requests>"
+ * 
  */
 
 #include <fcntl.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "config.h"
@@ -19,6 +27,30 @@
  */
 #define BUFFER_SIZE 128
 
+/**
+ * @brief Maximum number of tokens in a line of the config file
+ * 
+ */
+#define MAX_TOKENS 32
+
+/**
+ * @brief The keyword starting a server option line in the config file
+ * 
+ */
+#define OPTION_KEYWORD "option"
+
+/**
+ * @brief The keyword starting the scheduling settings of a priority in the config file
+ * 
+ */
+#define PRIORITY_KEYWORD "priority"
+
+/**
+ * @brief The keyword starting the concurrency limit of a device in the config file
+ * 
+ */
+#define DEVICE_KEYWORD "device"
+
 /**
  * @brief Get the id of the given program
  * 
@@ -28,7 +60,7 @@
  * @return int The id of the program (-1 if no such program)
  */
 int getProgramId(Config config, char* name) {
-    for(int i = 0; i < config->programCount; i++) 
+    for(int i = 0; i < config->programCount; i++)
         if(!strcmp(config->programs[i], name))
             return i;
 
@@ -36,34 +68,474 @@ int getProgramId(Config config, char* name) {
 }
 
 /**
- * @brief Retrieves the integer in a line of the config file
+ * @brief Gets the id of the program undoing the program with the given id
  * 
- * @note  The buffer is modified. The ' ' character and the '\n' are replaced by a null terminator
+ * @param config The given #Config
+ * @param id The id of the given program
  * 
- * @param buffer     The given buffer
- * @param bufferSize The size of the buffer
- * @param offset     The offset needed to put the descriptor pointing to the correct byte for the start of the next line
- * @return int       The number of instances allowed to run for a given program
+ * @return int The id of the program declared as its inverse (-1 if none)
  */
-int extractNumber(char* buffer, int bufferSize, int* offset) {
-    int count = 0;
-    int start = 0;
-    int result = 0;
-    for(; count < bufferSize; count++) {
-        if(buffer[count] == ' ') {
-            buffer[count] = '\0';
-            start = count + 1;
-        } else if(buffer[count] == '\n') {
-            buffer[count] = '\0';
-            count++;
-            result = atoi(&buffer[start]);  //TODO: trocar por safeStrToInt ??
+int getInverseId(Config config, int id) {
+    return config->inverses[id][0] ? getProgramId(config, config->inverses[id]) : -1;
+}
+
+/**
+ * @brief Reads the whole content of a file into a null terminated string
+ * 
+ * @param fileName The name of the file
+ * 
+ * @return char* The content of the file (must be freed)
+ * @return NULL  If the file could not be read
+ */
+char* readConfigFile(char* fileName) {
+    file_d file = open(fileName, O_RDONLY);
+    if(file < 0)
+        return NULL;
+
+    int capacity = BUFFER_SIZE;
+    int length = 0;
+    char* content = malloc(capacity);
+
+    while(content) {
+        if(length + BUFFER_SIZE >= capacity) {
+            capacity *= 2;
+            content = realloc(content, capacity);
+            if(!content)
+                break;
+        }
+
+        int bytesRead = read(file, content + length, BUFFER_SIZE);
+        if(bytesRead < 0) {
+            free(content);
+            content = NULL;
+        } else if(bytesRead == 0) {
+            content[length] = '\0';
             break;
+        } else {
+            length += bytesRead;
         }
     }
 
-    *offset = bufferSize - count;
+    close(file);
+    return content;
+}
 
-    return result;
+/**
+ * @brief Splits a line into whitespace separated tokens
+ * 
+ * @note  The line is modified. The whitespace after every token is replaced by a null terminator
+ * 
+ * @param line   The given line
+ * @param tokens The array to write the start of each token to
+ * 
+ * @return int   The number of tokens in the line (-1 if there are more than #MAX_TOKENS)
+ */
+int splitTokens(char* line, char* tokens[]) {
+    int count = 0;
+
+    for(char* token = strtok(line, " \t\r"); token; token = strtok(NULL, " \t\r")) {
+        if(count == MAX_TOKENS)
+            return -1;
+        tokens[count++] = token;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Safely converts a string to a (signed) integer
+ * 
+ * @param str   The string to convert
+ * @param value The integer in which to write the value
+ * 
+ * @return true  If the string corresponds to an integer
+ * @return false If the string is not an integer
+ */
+bool parseNumber(char* str, long* value) {
+    char* end;
+    *value = strtol(str, &end, 10);
+    return *str && !*end;
+}
+
+/**
+ * @brief Safely converts a size in bytes to an integer
+ * 
+ * The size may end with one of the suffixes 'K', 'M' or 'G' (powers of 1024)
+ * 
+ * @param str   The string to convert
+ * @param value The integer in which to write the value
+ * 
+ * @return true  If the string corresponds to a non negative size
+ * @return false If the string is not a size
+ */
+bool parseSize(char* str, long* value) {
+    char* end;
+    *value = strtol(str, &end, 10);
+
+    switch(*end) {
+        case 'G': *value *= 1024; //fall through
+        case 'M': *value *= 1024; //fall through
+        case 'K': *value *= 1024; end++; break;
+        default: break;
+    }
+
+    return *str && !*end && *value >= 0;
+}
+
+/**
+ * @brief Converts a string ("yes" or "no") to a boolean
+ * 
+ * @param str   The string to convert
+ * @param value The boolean in which to write the value
+ * 
+ * @return true  If the string corresponds to a boolean
+ * @return false If the string is not a boolean
+ */
+bool parseBool(char* str, bool* value) {
+    if(!strcmp(str, "yes"))
+        *value = true;
+    else if(!strcmp(str, "no"))
+        *value = false;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * @brief Parses a server option of the config file
+ * 
+ * @param config The #Config to write to
+ * @param key    The name of the option
+ * @param value  The value of the option
+ * 
+ * @return true  If the option is valid
+ * @return false If the option is unknown or has an invalid value
+ */
+bool parseOption(Config config, char* key, char* value) {
+    if(!strcmp(key, "placement")) {
+        if(!strcmp(value, "none"))
+            config->placement = PLACEMENT_NONE;
+        else if(!strcmp(value, "pipeline"))
+            config->placement = PLACEMENT_PIPELINE;
+        else
+            return false;
+        return true;
+    }
+
+    if(!strcmp(key, "device-limit")) {
+        long limit;
+        if(!parseNumber(value, &limit) || limit < 0)
+            return false;
+        config->deviceLimit = limit;
+        return true;
+    }
+
+    if(!strcmp(key, "prefetch-depth")) {
+        long depth;
+        if(!parseNumber(value, &depth) || depth < 0)
+            return false;
+        config->prefetchDepth = depth;
+        return true;
+    }
+
+    if(!strcmp(key, "prefetch-budget"))
+        return parseSize(value, &config->prefetchBudget);
+
+    if(!strcmp(key, "large-file-threshold"))
+        return parseSize(value, &config->largeFileThreshold);
+
+    if(!strcmp(key, "large-file-window"))
+        return parseSize(value, &config->largeFileWindow) && config->largeFileWindow > 0;
+
+    if(!strcmp(key, "large-file-direct"))
+        return parseBool(value, &config->largeFileDirect);
+
+    if(!strcmp(key, "preallocate-threshold"))
+        return parseSize(value, &config->preallocateThreshold);
+
+    if(!strcmp(key, "cache-dir")) {
+        if(strlen(value) >= MAX_CACHE_DIR_SIZE)
+            return false;
+        strcpy(config->cacheDir, value);
+        return true;
+    }
+
+    if(!strcmp(key, "cache-size"))
+        return parseSize(value, &config->cacheSize);
+
+    if(!strcmp(key, "chunk-threshold"))
+        return parseSize(value, &config->chunkThreshold);
+
+    if(!strcmp(key, "chunk-size"))
+        return parseSize(value, &config->chunkSize) && config->chunkSize > 0;
+
+    if(!strcmp(key, "chunk-width")) {
+        long width;
+        if(!parseNumber(value, &width) || width < 0)
+            return false;
+        config->chunkWidth = width;
+        return true;
+    }
+
+    if(!strcmp(key, "checkpoint-interval"))
+        return parseSize(value, &config->checkpointInterval);
+
+    if(!strcmp(key, "worker-pool"))
+        return parseBool(value, &config->workerPool);
+    if(!strcmp(key, "worker-jobs"))
+        return parseNumber(value, &config->workerJobs) && config->workerJobs >= 0;
+
+    if(!strcmp(key, "progress-interval"))
+        return parseNumber(value, &config->progressInterval) && config->progressInterval >= 0;
+
+    if(!strcmp(key, "socket")) {
+        if(strlen(value) >= MAX_SOCKET_PATH_SIZE)
+            return false;
+        strcpy(config->socketPath, strcmp(value, "none") ? value : "");
+        return true;
+    }
+
+    if(!strcmp(key, "output-digest")) {
+        if(!strcmp(value, "none"))
+            config->outputDigest = DIGEST_NONE;
+        else if(!strcmp(value, "crc32c"))
+            config->outputDigest = DIGEST_CRC32C;
+        else if(!strcmp(value, "xxh64"))
+            config->outputDigest = DIGEST_XXH64;
+        else
+            return false;
+        return true;
+    }
+
+    if(!strcmp(key, "coalesce"))
+        return parseBool(value, &config->coalesce);
+
+    if(!strcmp(key, "prefix-cache-size"))
+        return parseSize(value, &config->prefixCacheSize);
+
+    if(!strcmp(key, "prefix-hot")) {
+        long hot;
+        if(!parseNumber(value, &hot) || hot < 1)
+            return false;
+        config->prefixHot = hot;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parses the concurrency limit of a device in the config file
+ * 
+ * @param config The #Config to write to
+ * @param path   A path in the device
+ * @param value  The maximum number of running requests using the device
+ * 
+ * @return true  If the limit is valid
+ * @return false If the limit is invalid or the path does not exist
+ */
+bool parseDevice(Config config, char* path, char* value) {
+    struct stat st;
+    long limit;
+
+    if(config->deviceCount == MAX_DEVICE_LIMITS
+    || stat(path, &st) < 0
+    || !parseNumber(value, &limit)
+    || limit < 0)
+        return false;
+
+    DeviceLimit device = &config->devices[config->deviceCount++];
+    device->device = st.st_dev;
+    device->limit = limit;
+    return true;
+}
+
+/**
+ * @brief Parses the I/O scheduling class of a priority (in the form "<rt|be|idle>[:<level>]")
+ * 
+ * @param scheduling The #SchedulingClass to write to
+ * @param value      The given value
+ * 
+ * @return true  If the value is valid
+ * @return false If the value is invalid
+ */
+bool parseIoClass(SchedulingClass scheduling, char* value) {
+    char* level = strchr(value, ':');
+    long number = 4;
+
+    if(level) {
+        *level++ = '\0';
+        if(!parseNumber(level, &number) || number < 0 || number > 7)
+            return false;
+    }
+    scheduling->ioLevel = number;
+
+    if(!strcmp(value, "rt"))
+        scheduling->ioClass = 1;
+    else if(!strcmp(value, "be"))
+        scheduling->ioClass = 2;
+    else if(!strcmp(value, "idle"))
+        scheduling->ioClass = 3;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * @brief Parses the OS scheduling settings of a request priority in the config file
+ * 
+ * @param config The #Config to write to
+ * @param tokens The tokens of the line
+ * @param count  The number of tokens of the line
+ * 
+ * @return true  If the settings are valid
+ * @return false If the settings are invalid
+ */
+bool parsePriority(Config config, char* tokens[], int count) {
+    long priority;
+
+    if(count < 2 || !parseNumber(tokens[1], &priority) || priority < 0 || priority > MAX_PRIORITY)
+        return false;
+
+    SchedulingClass scheduling = &config->scheduling[priority];
+
+    for(int i = 2; i < count; i++) {
+        char* value = strchr(tokens[i], '=');
+        if(!value)
+            return false;
+        *value++ = '\0';
+
+        long number;
+        if(!strcmp(tokens[i], "nice")) {
+            if(!parseNumber(value, &number) || number < -20 || number > 19)
+                return false;
+            scheduling->nice = number;
+        } else if(!strcmp(tokens[i], "io")) {
+            if(!parseIoClass(scheduling, value))
+                return false;
+        } else if(!strcmp(tokens[i], "sched")) {
+            if(!strcmp(value, "other"))
+                scheduling->policy = SCHED_OTHER;
+            else if(!strcmp(value, "batch"))
+                scheduling->policy = SCHED_BATCH;
+            else if(!strcmp(value, "idle"))
+                scheduling->policy = SCHED_IDLE;
+            else
+                return false;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Parses an attribute of a transformation (in the form "<key>=<value>", or a flag such as "identity" or "plugin")
+ * in the config file
+ * 
+ * @param config The #Config to write to
+ * @param id     The id of the transformation
+ * @param token  The given attribute
+ * 
+ * @return true  If the attribute is valid
+ * @return false If the attribute is invalid
+ */
+bool parseProgramAttribute(Config config, int id, char* token) {
+    if(!strcmp(token, "identity")) {
+        config->identities[id] = true;
+        return true;
+    }
+
+    if(!strcmp(token, "chunkable")) {
+        config->chunkables[id] = true;
+        return true;
+    }
+
+    if(!strcmp(token, "plugin")) {
+        config->plugins[id] = true;
+        return true;
+    }
+
+    if(!strcmp(token, "worker")) {
+        config->workerModes[id] = WORKER_WRAPPED;
+        return true;
+    }
+
+    char* value = strchr(token, '=');
+    if(!value)
+        return false;
+    *value++ = '\0';
+
+    if(!strcmp(token, "inverse")) {
+        if(strlen(value) >= MAX_PROGRAM_SIZE)
+            return false;
+        strcpy(config->inverses[id], value);
+        return true;
+    }
+
+    if(!strcmp(token, "worker")) {
+        if(!strcmp(value, "wrapped"))
+            config->workerModes[id] = WORKER_WRAPPED;
+        else if(!strcmp(value, "native"))
+            config->workerModes[id] = WORKER_NATIVE;
+        else
+            return false;
+        return true;
+    }
+
+    if(!strcmp(token, "pipe")) {
+        if(!strcmp(value, "auto")) {
+            config->pipeSizes[id] = PIPE_SIZE_AUTO;
+            return true;
+        }
+        return parseSize(value, &config->pipeSizes[id]);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parses the declaration of a transformation in the config file
+ * 
+ * The declaration is the name of the transformation and its maximum number of instances, optionally
+ * followed by attributes
+ * 
+ * @param config The #Config to write to
+ * @param tokens The tokens of the line
+ * @param count  The number of tokens of the line
+ * 
+ * @return true  If the declaration is valid
+ * @return false If the declaration is invalid
+ */
+bool parseProgram(Config config, char* tokens[], int count) {
+    long instances;
+
+    if(count < 2
+    || config->programCount == NUMBER_PROGRAMS
+    || strlen(tokens[0]) >= MAX_PROGRAM_SIZE
+    || getProgramId(config, tokens[0]) != -1
+    || !parseNumber(tokens[1], &instances)
+    || instances < 0)
+        return false;
+
+    int id = config->programCount++;
+    strcpy(config->programs[id], tokens[0]);
+    config->instances[id] = instances;
+    config->pipeSizes[id] = 0;
+    config->identities[id] = false;
+    config->chunkables[id] = false;
+    config->plugins[id] = false;
+    config->workerModes[id] = WORKER_NONE;
+    config->inverses[id][0] = '\0';
+
+    for(int i = 2; i < count; i++)
+        if(!parseProgramAttribute(config, id, tokens[i]))
+            return false;
+
+    return true;
 }
 
 /**
@@ -76,37 +548,67 @@ int extractNumber(char* buffer, int bufferSize, int* offset) {
  * @return false on failure
  */
 bool loadConfig(char* fileName, Config config) {
+    char* content = readConfigFile(fileName);
+    if(!content)
+        return false;
+
+    config->programCount = 0;
+    config->placement = PLACEMENT_NONE;
+    config->deviceLimit = 0;
+    config->deviceCount = 0;
+    config->prefetchDepth = 0;
+    config->prefetchBudget = DEFAULT_PREFETCH_BUDGET;
+    config->largeFileThreshold = 0;
+    config->largeFileWindow = DEFAULT_LARGE_FILE_WINDOW;
+    config->largeFileDirect = false;
+    config->preallocateThreshold = DEFAULT_PREALLOCATE_THRESHOLD;
+    config->cacheDir[0] = '\0';
+    config->cacheSize = DEFAULT_CACHE_SIZE;
+    config->prefixCacheSize = 0;
+    config->prefixHot = DEFAULT_PREFIX_HOT;
+    config->coalesce = true;
+    config->chunkThreshold = DEFAULT_CHUNK_THRESHOLD;
+    config->chunkSize = DEFAULT_CHUNK_SIZE;
+    config->chunkWidth = 0;
+    config->checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+    config->workerPool = true;
+    config->workerJobs = DEFAULT_WORKER_JOBS;
+    config->outputDigest = DIGEST_NONE;
+    config->progressInterval = DEFAULT_PROGRESS_INTERVAL;
+    strcpy(config->socketPath, SOCKET_NAME);
+    for(int i = 0; i <= MAX_PRIORITY; i++) {
+        config->scheduling[i].nice = NICE_UNCHANGED;
+        config->scheduling[i].ioClass = 0;
+        config->scheduling[i].ioLevel = 0;
+        config->scheduling[i].policy = POLICY_UNCHANGED;
+    }
+
     bool result = true;
+    char* save;
 
-    char buffer[BUFFER_SIZE];
-    int bufferPosition = 0;
-    file_d file = open(fileName, O_RDONLY);
+    for(char* line = strtok_r(content, "\n", &save); line && result; line = strtok_r(NULL, "\n", &save)) {
+        char* tokens[MAX_TOKENS];
+        int count = splitTokens(line, tokens);
 
-    if(file >= 0) {
-        for(int i = 0; result; i++) {
-            int bytesRead = read(file, buffer, BUFFER_SIZE - bufferPosition);
-            if(bytesRead == -1)
-                result = false;
+        if(count == 0 || tokens[0][0] == '#')
+            continue;
 
-            if(bytesRead == 0) {
-                config->programCount = i;
-                break;
-            }       
-
-            int offset;
-            
-            config->instances[i] = extractNumber(buffer, bytesRead, &offset);
-            strcpy(config->programs[i], buffer);
-            if(lseek(file, -offset, SEEK_CUR) < 0) {
-                result = false;
-                break;
-            }
-        }
-        close(file);
-    } else {
-        result = false;
+        if(!strcmp(tokens[0], OPTION_KEYWORD))
+            result = count == 3 && parseOption(config, tokens[1], tokens[2]);
+        else if(!strcmp(tokens[0], PRIORITY_KEYWORD))
+            result = parsePriority(config, tokens, count);
+        else if(!strcmp(tokens[0], DEVICE_KEYWORD))
+            result = count == 3 && parseDevice(config, tokens[1], tokens[2]);
+        else
+            result = count > 0 && parseProgram(config, tokens, count);
     }
 
+    free(content);
+
+    //Inverses may be declared before the programs they name
+    for(int i = 0; i < config->programCount && result; i++)
+        result = !config->inverses[i][0] || getInverseId(config, i) != -1;
+
     return result;
 }
 
@@ -120,4 +622,37 @@ bool loadConfig(char* fileName, Config config) {
  */
 char* getProgramName(Config config, int id) {
     return config->programs[id];
+}
+
+/**
+ * @brief Gets the OS scheduling settings of the requests with the given priority
+ * 
+ * @param config The given #Config
+ * @param priority The priority of the request (clamped to the range [0, #MAX_PRIORITY])
+ * 
+ * @return SchedulingClass The scheduling settings
+ */
+SchedulingClass getSchedulingClass(Config config, int priority) {
+    if(priority < 0)
+        priority = 0;
+    if(priority > MAX_PRIORITY)
+        priority = MAX_PRIORITY;
+
+    return &config->scheduling[priority];
+}
+
+/**
+ * @brief Gets the maximum number of running requests that can use the given device
+ * 
+ * @param config The given #Config
+ * @param device The given device
+ * 
+ * @return int The maximum number of requests (0 for no limit)
+ */
+int getDeviceLimit(Config config, dev_t device) {
+    for(int i = 0; i < config->deviceCount; i++)
+        if(config->devices[i].device == device)
+            return config->devices[i].limit;
+
+    return config->deviceLimit;
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+/**
+ * @file hash.c
+ * 
+ * @brief File implementing the XXH64 hash function
+ * 
+ * XXH64 consumes its input in 32 byte stripes split in four 64 bit lanes, which makes it fast enough to
+ * hash whole files at the speed they are read from the page cache.
+ * 
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "utils.h"
+
+/**
+ * @brief The primes used by XXH64
+ * 
+ */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+/**
+ * @brief The size of the buffer used to hash a file
+ * 
+ */
+#define HASH_BUFFER_SIZE 65536
+
+/**
+ * @brief Rotates a 64 bit value to the left
+ * 
+ */
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/**
+ * @brief Reads a little-endian 64 bit value
+ * 
+ * @param p The address of the value
+ * 
+ * @return uint64_t The value
+ */
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Reads a little-endian 32 bit value
+ * 
+ * @param p The address of the value
+ * 
+ * @return uint64_t The value
+ */
+static inline uint64_t read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Mixes 8 bytes of input into an accumulator
+ * 
+ * @param accumulator The accumulator
+ * @param input The input
+ * 
+ * @return uint64_t The new accumulator
+ */
+static inline uint64_t hashRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME64_2;
+    accumulator = ROTL64(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+/**
+ * @brief Merges a lane accumulator into the hash
+ * 
+ * @param hash The hash
+ * @param accumulator The accumulator of the lane
+ * 
+ * @return uint64_t The new hash
+ */
+static inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+    hash ^= hashRound(0, accumulator);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+/**
+ * @brief Initializes an incremental hash computation
+ * 
+ * @param state The #HashState to initialize
+ * @param seed The seed of the hash
+ */
+void initHash(HashState state, uint64_t seed) {
+    state->accumulators[0] = seed + PRIME64_1 + PRIME64_2;
+    state->accumulators[1] = seed + PRIME64_2;
+    state->accumulators[2] = seed;
+    state->accumulators[3] = seed - PRIME64_1;
+    state->totalLength = 0;
+    state->pendingLength = 0;
+    state->seed = seed;
+}
+
+/**
+ * @brief Consumes a 32 byte stripe
+ * 
+ * @param state The given #HashState
+ * @param p The stripe
+ */
+static inline void consumeStripe(HashState state, const unsigned char* p) {
+    for(int i = 0; i < 4; i++)
+        state->accumulators[i] = hashRound(state->accumulators[i], read64(p + 8 * i));
+}
+
+/**
+ * @brief Adds data to an incremental hash computation
+ * 
+ * @param state The given #HashState
+ * @param data The data
+ * @param length The number of bytes of data
+ */
+void updateHash(HashState state, const void* data, size_t length) {
+    const unsigned char* p = data;
+    state->totalLength += length;
+
+    if(state->pendingLength + length < 32) {
+        memcpy(state->pending + state->pendingLength, p, length);
+        state->pendingLength += length;
+        return;
+    }
+
+    if(state->pendingLength) {
+        int missing = 32 - state->pendingLength;
+        memcpy(state->pending + state->pendingLength, p, missing);
+        consumeStripe(state, state->pending);
+        p += missing;
+        length -= missing;
+        state->pendingLength = 0;
+    }
+
+    for(; length >= 32; p += 32, length -= 32)
+        consumeStripe(state, p);
+
+    memcpy(state->pending, p, length);
+    state->pendingLength = length;
+}
+
+/**
+ * @brief Gets the hash of all the data added to an incremental hash computation
+ * 
+ * @param state The given #HashState
+ * 
+ * @return uint64_t The hash
+ */
+uint64_t digestHash(HashState state) {
+    uint64_t* v = state->accumulators;
+    uint64_t hash;
+
+    if(state->totalLength >= 32) {
+        hash = ROTL64(v[0], 1) + ROTL64(v[1], 7) + ROTL64(v[2], 12) + ROTL64(v[3], 18);
+        for(int i = 0; i < 4; i++)
+            hash = mergeRound(hash, v[i]);
+    } else {
+        hash = state->seed + PRIME64_5;
+    }
+    hash += state->totalLength;
+
+    const unsigned char* p = state->pending;
+    int length = state->pendingLength;
+
+    for(; length >= 8; p += 8, length -= 8) {
+        hash ^= hashRound(0, read64(p));
+        hash = ROTL64(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if(length >= 4) {
+        hash ^= read32(p) * PRIME64_1;
+        hash = ROTL64(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+        length -= 4;
+    }
+    for(; length > 0; p++, length--) {
+        hash ^= *p * PRIME64_5;
+        hash = ROTL64(hash, 11) * PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * @brief Computes the hash of a buffer
+ * 
+ * @param data The buffer
+ * @param length The number of bytes of the buffer
+ * @param seed The seed of the hash
+ * 
+ * @return uint64_t The hash
+ */
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed) {
+    HASH_STATE state;
+    initHash(&state, seed);
+    updateHash(&state, data, length);
+    return digestHash(&state);
+}
+
+/**
+ * @brief Computes the hash of the contents of a file, from its current offset until its end
+ * 
+ * @param fd The descriptor of the file
+ * @param hash Where to write the hash
+ * 
+ * @return true If the file was read until its end
+ * @return false If an error occurred
+ */
+bool hashFile(file_d fd, uint64_t* hash) {
+    char buffer[HASH_BUFFER_SIZE];
+    HASH_STATE state;
+    int bytesRead;
+
+    initHash(&state, 0);
+    while((bytesRead = read(fd, buffer, HASH_BUFFER_SIZE)) > 0)
+        updateHash(&state, buffer, bytesRead);
+
+    *hash = digestHash(&state);
+    return bytesRead == 0;
+}
@@ -5,6 +5,8 @@
  * 
  */
 
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -105,3 +107,24 @@ void printMessage(file_d fd, ERROR_CODE errorCode){
     getOutputErrorType(type,c,8);
     write(fd,c,strlen(c));
 }
+
+/**
+ * @brief Writes the given message to the given file descriptor, filling in its printf-style fields
+ * 
+ * @param fd The descriptor of the file to write to
+ * @param errorCode The given error (its description is used as the format)
+ * @param ... The values of the fields of the description
+ */
+void printFormattedMessage(file_d fd, ERROR_CODE errorCode, ...){
+    ERROR_TYPE type = INFO;
+    char format[256];
+    char c[8+21+256];
+    va_list args;
+    getCurrentTime(c+8);
+    getErrorMessage(errorCode,&type,format);
+    getOutputErrorType(type,c,8);
+    va_start(args, errorCode);
+    vsnprintf(c+8+20, 256, format, args);
+    va_end(args);
+    write(fd,c,strlen(c));
+}
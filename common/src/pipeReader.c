@@ -20,10 +20,24 @@
  */
 void initPipeReader(PipeReader pr, file_d fd) {
     pr->pipe = fd;
+    pr->buffer = pr->inlineBuffer;
+    pr->capacity = READER_BUFFER_SIZE;
     pr->available = 0;
     pr->pos = 0;
 }
 
+/**
+ * @brief Frees the buffer of a #PipeReader, if it had to grow
+ * 
+ * @param pr The given #PipeReader
+ */
+void releasePipeReader(PipeReader pr) {
+    if (pr->buffer != pr->inlineBuffer)
+        free(pr->buffer);
+    pr->buffer = pr->inlineBuffer;
+    pr->capacity = READER_BUFFER_SIZE;
+}
+
 /**
  * @brief Checks if the buffer of a #PipeReader is empty
  * 
@@ -48,7 +62,7 @@ bool isBufferEmpty(PipeReader pr) {
  * @return false If the pipe/fifo was closed
  */
 bool readPipe(PipeReader pr) {
-    pr->available = read(pr->pipe, pr->buffer, READER_BUFFER_SIZE);
+    pr->available = read(pr->pipe, pr->buffer, pr->capacity);
     pr->pos = 0;
     return pr->available > 0;
 }
@@ -123,4 +137,56 @@ bool readString(PipeReader pr, char* dest, int n)
 
     printMessage(STDERR_FILENO, BUFFERREACHEND);
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Gets a number of contiguous bytes from a #PipeReader without consuming them
+ * 
+ * The bytes not consumed yet are moved to the start of the buffer if they do not fit after their position,
+ * and the buffer grows if it cannot hold them all. The program halts until the bytes are received
+ * 
+ * @param pr The given #PipeReader
+ * @param n The number of bytes
+ * 
+ * @return char* The address of the bytes in the buffer (valid until the next read from the #PipeReader)
+ * @return NULL If the pipe/fifo was closed before n bytes were received
+ */
+char* peekBytes(PipeReader pr, int n) {
+    if (pr->pos + n > pr->capacity) {
+        int unread = MAX(pr->available - pr->pos, 0);
+
+        if (n > pr->capacity) {
+            int capacity = MAX(n, pr->capacity * 2);
+            char* buffer = malloc(capacity);
+            memcpy(buffer, pr->buffer + pr->pos, unread);
+            if (pr->buffer != pr->inlineBuffer)
+                free(pr->buffer);
+            pr->buffer = buffer;
+            pr->capacity = capacity;
+        } else {
+            memmove(pr->buffer, pr->buffer + pr->pos, unread);
+        }
+
+        pr->pos = 0;
+        pr->available = unread;
+    }
+
+    while (pr->available - pr->pos < n) {
+        int bytesRead = read(pr->pipe, pr->buffer + MAX(pr->available, 0), pr->capacity - MAX(pr->available, 0));
+        if (bytesRead <= 0)
+            return NULL;
+        pr->available = MAX(pr->available, 0) + bytesRead;
+    }
+
+    return pr->buffer + pr->pos;
+}
+
+/**
+ * @brief Consumes bytes of a #PipeReader obtained with peekBytes
+ * 
+ * @param pr The given #PipeReader
+ * @param n The number of bytes
+ */
+void skipBytes(PipeReader pr, int n) {
+    pr->pos += n;
+}
@@ -6,6 +6,7 @@
  */
 
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -76,15 +77,26 @@ void writeString(PipeWritter pw, char* str) {
  * @brief Flushes the #PipeWritter , i.e., writes to the pipe the data
  * in its buffer
  * 
+ * A write of more than PIPE_BUF bytes may be split by the kernel, or interrupted by a signal once part of it is
+ * written, so the rest is written until the whole buffer is
+ * 
  * @param pw The given #PipeWritter
+ * 
+ * @return true If the whole buffer was written
+ * @return false If an error occurred
  */
 bool flushPipe(PipeWritter pw) {
-    if (write(pw->pipe, pw->buffer, pw->pos) < 0) {
-        printMessage(STDERR_FILENO, WRITEFAILED);
-        return false;
+    for (int written = 0; written < pw->pos; ) {
+        ssize_t n = write(pw->pipe, pw->buffer + written, pw->pos - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            printMessage(STDERR_FILENO, WRITEFAILED);
+            return false;
+        }
+        written += n;
     }
-        
-    
+
     pw->pos = 0;
     return true;
 }
\ No newline at end of file
@@ -4,23 +4,136 @@
  * @brief File implementing the #Request type.
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/fsuid.h>
+#include <sys/stat.h>
 
 #include "request.h"
 #include "logging.h"
 #include "config.h"
+#include "wire.h"
 
 /**
- * @brief The default size of a string in a #Request
+ * @brief The default size of the string form of a #Request
  * 
  */
 #define STR_SIZE 256
 
 /**
- * @brief Gets the number of times the given transfomation occurs in a #Request
+ * @brief Gets the number of stages of a #Request: its operations, followed by the operations of each of its
+ * branches
+ * 
+ * @param r The given #Request
+ * 
+ * @return int The number of stages
+ */
+int getStageCount(Request r) {
+    int res = r->operationCount;
+
+    for(int i = 0; i < r->branchCount; i++)
+        res += r->branches[i].operationCount;
+
+    return res;
+}
+
+/**
+ * @brief Gets the transformation run by a stage of a #Request
+ * 
+ * @param r The given #Request
+ * @param stage The index of the stage (see getStageCount)
+ * 
+ * @return char* The transformation of the stage
+ */
+char* getStageOperation(Request r, int stage) {
+    if(stage < r->operationCount)
+        return r->operations[stage];
+
+    int i = 0;
+    for(stage -= r->operationCount; stage >= r->branches[i].operationCount; i++)
+        stage -= r->branches[i].operationCount;
+
+    return r->branches[i].operations[stage];
+}
+
+/**
+ * @brief Gets the index of the first stage of a branch of a #Request (see getStageCount)
+ * 
+ * @param r The given #Request
+ * @param branch The index of the branch (-1 for the operations of the #Request)
+ * 
+ * @return int The index of the stage running its first operation
+ */
+int getBranchStage(Request r, int branch) {
+    int stage = branch < 0 ? 0 : r->operationCount;
+
+    for(int b = 0; b < branch; b++)
+        stage += r->branches[b].operationCount;
+
+    return stage;
+}
+
+/**
+ * @brief Gets the stage whose output feeds the first operation of a branch of a #Request
+ * 
+ * @param r The given #Request
+ * @param branch The index of the branch
+ * 
+ * @return int The index of the stage (-1 for the input file)
+ */
+int getBranchInput(Request r, int branch) {
+    Branch b = &r->branches[branch];
+
+    if(b->after)
+        return getBranchStage(r, b->parent) + b->after - 1;
+
+    return b->parent < 0 ? -1 : getBranchInput(r, b->parent);
+}
+
+/**
+ * @brief Gets the stage whose output feeds a stage of a #Request
+ * 
+ * @param r The given #Request
+ * @param stage The index of the stage (see getStageCount)
+ * 
+ * @return int The index of the stage feeding it (-1 for the input file)
+ */
+int getStageInput(Request r, int stage) {
+    if(stage < r->operationCount)
+        return stage - 1;
+
+    int i = 0;
+    for(stage -= r->operationCount; stage >= r->branches[i].operationCount; i++)
+        stage -= r->branches[i].operationCount;
+
+    return stage ? getBranchStage(r, i) + stage - 1 : getBranchInput(r, i);
+}
+
+/**
+ * @brief Checks if a branch of a #Request forks after a number of the operations of the #Request or of one of
+ * its branches
+ * 
+ * @param r The given #Request
+ * @param parent The index of the branch (-1 for the operations of the #Request)
+ * @param after The number of operations
+ * 
+ * @return true If at least one branch is fed by the output of those operations
+ * @return false Otherwise
+ */
+bool hasBranchesAfter(Request r, int parent, int after) {
+    for(int i = 0; i < r->branchCount; i++)
+        if(r->branches[i].parent == parent && r->branches[i].after == after)
+            return true;
+
+    return false;
+}
+
+/**
+ * @brief Gets the number of times the given transfomation occurs in a #Request (in any of its stages)
  * 
  * @param r The given #Request
  * @param op The given transformation
@@ -30,8 +143,8 @@
 int getOperationCount(Request r, char* op) {
     int res = 0;
     
-    for(int i = 0; i < r->operationCount; i++) {
-        if(strcmp(r->operations[i], op) == 0)
+    for(int i = 0; i < getStageCount(r); i++) {
+        if(strcmp(getStageOperation(r, i), op) == 0)
             ++res;
     }
 
@@ -42,7 +155,8 @@ int getOperationCount(Request r, char* op) {
  * @brief Compares two #Request by their priority
  * 
  * One #Request is 'greater than' another one if it has a higher priority or, if they
- * have the same priority, it has a lower time of arrival
+ * have the same priority, it arrived first. #timeOfArrival is a reused slot of the list of
+ * requests of the server, so the order of arrival is taken from #arrivalOrder instead
  * 
  * @param r1 The first #Request
  * @param r2 The second #Request
@@ -54,64 +168,195 @@ int getOperationCount(Request r, char* op) {
  */
 int compareRequests(Request r1, Request r2) {
     if(r1->priority == r2->priority) 
-        return r1->timeOfArrival - r2->timeOfArrival;
+        return (r1->arrivalOrder < r2->arrivalOrder) - (r1->arrivalOrder > r2->arrivalOrder);
 
     return r1->priority - r2 -> priority;
 }
 
 /**
- * @brief Reads a #Request from a #PipeReader
+ * @brief Walks the payload of a request frame, checking that every field is inside it
  * 
- * @param pr The given #PipeReader
- * @param r The #Request to write to
+ * With a #Request to write to, its strings point into the payload and its operations and branches are
+ * written to the arrays given
  * 
- * @return true If the reading was successful 
- * @return false If the reading failed
+ * @param payload The payload
+ * @param length The length of the payload
+ * @param r The #Request to write to (NULL to only check the payload)
+ * @param operations The array to write the operations of the #Request and of its branches to
+ * @param branches The array to write the branches of the #Request to
+ * @param branchCount The variable to write the number of branches to (NULL if not needed)
+ * 
+ * @return int The number of operations of the #Request and of its branches (-1 if the payload is not valid)
  */
-bool readRequest(PipeReader pr, Request r) {
-    if (!readBytes(pr, sizeof(r->type), &r->type))
-        return false;
-    
-    switch (r->type) {
+int walkRequestFrame(char* payload, int length, Request r, char** operations, Branch branches, int* branchCount) {
+    WIRE_CURSOR cursor;
+    int type, priority, count, total = 0;
+    char *sender, *inputFile, *outputFile, *operation;
+
+    initWireCursor(&cursor, payload, length);
+    if (!takeInt(&cursor, &type) || !takeString(&cursor, &sender))
+        return -1;
+    if (r) {
+        r->type = type;
+        r->sender = sender;
+    }
+    if (branchCount)
+        *branchCount = 0;
+
+    if (type == STATUS)
+        return cursor.pos == cursor.end ? 0 : -1;
+    if (type != PROCESS_FILE && type != PROCESS_STREAM)
+        return -1;
+
+    if (!takeInt(&cursor, &priority) || !takeString(&cursor, &inputFile) || !takeString(&cursor, &outputFile)
+     || !takeInt(&cursor, &count) || count < 0)
+        return -1;
+    if (r) {
+        r->priority = priority;
+        r->inputFile = inputFile;
+        r->outputFile = outputFile;
+        r->operationCount = count;
+        r->operations = operations;
+    }
 
-        case STATUS:
-            r->sender = malloc(STR_SIZE * sizeof(char));
-            readString(pr, r->sender, STR_SIZE);
-            return true;
-            
-        case PROCESS_FILE:
+    for (int i = 0; i < count; i++, total++) {
+        if (!takeString(&cursor, &operation))
+            return -1;
+        if (r)
+            operations[total] = operation;
+    }
+
+    int branchTotal;
+    if (!takeInt(&cursor, &branchTotal) || branchTotal < 0)
+        return -1;
+    if (r) {
+        r->branchCount = branchTotal;
+        r->branches = branches;
+    }
 
-            r->sender = malloc(STR_SIZE * sizeof(char));
-            readString(pr, r->sender, STR_SIZE);
-            readBytes(pr, sizeof(r->timeOfArrival), &r->timeOfArrival);
-            readBytes(pr, sizeof(r->senderFD), &r->senderFD);
-            readBytes(pr, sizeof(r->priority), &r->priority);
+    for (int i = 0; i < branchTotal; i++) {
+        BRANCH b;
+        if (!takeInt(&cursor, &b.parent) || !takeInt(&cursor, &b.after) || !takeString(&cursor, &b.outputFile)
+         || !takeInt(&cursor, &b.operationCount) || b.operationCount < 0)
+            return -1;
+        b.operations = r ? operations + total : NULL;
+
+        for (int j = 0; j < b.operationCount; j++, total++) {
+            if (!takeString(&cursor, &operation))
+                return -1;
+            if (r)
+                operations[total] = operation;
+        }
+        if (r)
+            branches[i] = b;
+    }
+
+    if (branchCount)
+        *branchCount = branchTotal;
+    return cursor.pos == cursor.end ? total : -1;
+}
 
-            r->inputFile = malloc(STR_SIZE * sizeof(char));
-            r->outputFile = malloc(STR_SIZE * sizeof(char));
+/**
+ * @brief Checks the payload of a request frame without reading it
+ * 
+ * @param payload The payload
+ * @param length The length of the payload
+ * 
+ * @return true If every field is inside the payload
+ * @return false Otherwise
+ */
+bool checkRequestFrame(char* payload, int length) {
+    return walkRequestFrame(payload, length, NULL, NULL, NULL, NULL) >= 0;
+}
+
+/**
+ * @brief Reads a #Request from the payload of a request frame
+ * 
+ * The #Request is allocated in a single block of the exact size needed, holding the #Request, its branches,
+ * its operations and a copy of the payload, which its strings point into. The fields set by the server start
+ * zeroed, or at -1 where 0 is meaningful (its descriptors, #Request::cpuDomain and #Request::leader), and so do
+ * the fields a ::STATUS #Request does not have
+ * 
+ * @param payload The payload
+ * @param length The length of the payload
+ * 
+ * @return Request The #Request (freed with #freeRequest)
+ * @return NULL If the payload is not valid
+ */
+Request decodeRequest(char* payload, int length) {
+    int branchCount;
+    int total = walkRequestFrame(payload, length, NULL, NULL, NULL, &branchCount);
+    if (total < 0)
+        return NULL;
+
+    //The branches come after the request, then the operations and the payload, for every array to be aligned
+    long arrays = sizeof(REQUEST) + sizeof(BRANCH) * branchCount + sizeof(char*) * total;
+    char* block = calloc(1, arrays + length);
+    if (!block) {
+        printMessage(STDERR_FILENO, MALLOCFAILED);
+        return NULL;
+    }
 
-            readString(pr, r->inputFile, STR_SIZE);
-            readString(pr, r->outputFile, STR_SIZE);
+    Request r = (Request)block;
+    r->senderFD = r->inputFD = r->outputFD = -1;
+    r->cpuDomain = -1;
+    r->leader = -1;
+    Branch branches = (Branch)(block + sizeof(REQUEST));
+    memcpy(block + arrays, payload, length);
+    walkRequestFrame(block + arrays, length, r, (char**)(branches + branchCount), branches, NULL);
+    return r;
+}
 
+/**
+ * @brief Reads a #Request from a #PipeReader
+ * 
+ * @param pr The given #PipeReader
+ * 
+ * @return Request The #Request read (freed with #freeRequest)
+ * @return NULL If the reading failed
+ */
+Request readRequest(PipeReader pr) {
+    WIRE_HEADER header;
+    char* payload;
 
-            readBytes(pr, sizeof(r->operationCount), &r->operationCount);
-            r->operations = malloc(r->operationCount * sizeof(char*));
+    if (!readFrame(pr, &header, &payload, WIRE_MAX_SIZE))
+        return NULL;
 
-            for (int i = 0; i < r->operationCount; i++) {
-                r->operations[i] = malloc(STR_SIZE * sizeof(char));
-                readString(pr, r->operations[i], STR_SIZE);
-            }
+    Request r = payload && header.kind == WIRE_REQUEST ? decodeRequest(payload, header.length) : NULL;
+    if (!r)
+        printMessage(STDERR_FILENO, INVALIDFRAME);
 
-            return true;
+    return r;
+}
 
-        default:
-            printMessage(STDERR_FILENO, UNKNOWNREQUESTTYPE);
-            return false;
+/**
+ * @brief Gets the length of the payload of the request frame of a #Request
+ * 
+ * @param r The given #Request
+ * 
+ * @return int The length (bytes)
+ */
+int getRequestFrameLength(Request r) {
+    int length = sizeof(int32_t) + getStringFieldSize(r->sender);
+    if (r->type == STATUS)
+        return length;
+
+    length += 3 * sizeof(int32_t) + getStringFieldSize(r->inputFile) + getStringFieldSize(r->outputFile);
+    for (int i = 0; i < r->operationCount; i++)
+        length += getStringFieldSize(r->operations[i]);
+
+    for (int i = 0; i < r->branchCount; i++) {
+        Branch b = &r->branches[i];
+        length += 3 * sizeof(int32_t) + getStringFieldSize(b->outputFile);
+        for (int j = 0; j < b->operationCount; j++)
+            length += getStringFieldSize(b->operations[j]);
     }
+
+    return length;
 }
 
 /**
- * @brief Writes the given #Request to a #PipeWritter
+ * @brief Writes the given #Request to a #PipeWritter, as a request frame
  * 
  * @param pw The given #PipeWritter
  * @param r The given #Request
@@ -120,36 +365,55 @@ bool readRequest(PipeReader pr, Request r) {
  * @return false If the writting failed
  */
 bool writeRequest(PipeWritter pw, Request r) {
-    switch (r->type) {
-        case STATUS:
-            writeBytes(pw, sizeof(r->type), &r->type);
-            writeString(pw, r->sender);
-            break;
-
-        case PROCESS_FILE:
-            writeBytes(pw, sizeof(r->type), &r->type);
-            writeString(pw, r->sender);
-            writeBytes(pw, sizeof(r->timeOfArrival), &r->timeOfArrival);
-            writeBytes(pw, sizeof(r->senderFD), &r->senderFD);
-            writeBytes(pw, sizeof(r->priority), &r->priority);
-        
-            writeString(pw, r->inputFile);
-            writeString(pw, r->outputFile);
-
-            writeBytes(pw, sizeof(r->operationCount), &r->operationCount);
-            
-            for (int i = 0; i < r->operationCount; i++)
-                writeString(pw, r->operations[i]);
-            break;
-
-        default:
-            printMessage(STDERR_FILENO, UNKNOWNREQUESTTYPE);
-            break;
+    if (r->type != STATUS && r->type != PROCESS_FILE && r->type != PROCESS_STREAM) {
+        printMessage(STDERR_FILENO, UNKNOWNREQUESTTYPE);
+        return false;
     }
-    
+
+    writeWireHeader(pw, WIRE_REQUEST, getRequestFrameLength(r));
+    putInt(pw, r->type);
+    putString(pw, r->sender);
+    if (r->type == STATUS)
+        return true;
+
+    putInt(pw, r->priority);
+    putString(pw, r->inputFile);
+    putString(pw, r->outputFile);
+    putInt(pw, r->operationCount);
+    for (int i = 0; i < r->operationCount; i++)
+        putString(pw, r->operations[i]);
+
+    putInt(pw, r->branchCount);
+    for (int i = 0; i < r->branchCount; i++) {
+        Branch b = &r->branches[i];
+        putInt(pw, b->parent);
+        putInt(pw, b->after);
+        putString(pw, b->outputFile);
+        putInt(pw, b->operationCount);
+        for (int j = 0; j < b->operationCount; j++)
+            putString(pw, b->operations[j]);
+    }
+
     return true;
 }
 
+/**
+ * @brief Writes the start of the string form of a branch of a #Request
+ * 
+ * @param request The given #Request
+ * @param branch The index of the branch
+ * @param str The string to write to (NULL to only get the length)
+ * 
+ * @return int The length of the start of the string form
+ */
+int getBranchHeader(Request request, int branch, char* str) {
+    Branch b = &request->branches[branch];
+
+    if(b->parent < 0)
+        return snprintf(str, str ? STR_SIZE : 0, " [branch %d after %d: ", branch, b->after);
+    return snprintf(str, str ? STR_SIZE : 0, " [branch %d after %d of branch %d: ", branch, b->after, b->parent);
+}
+
 /**
  * @brief Converts a #Request to a string
  * 
@@ -159,12 +423,21 @@ bool writeRequest(PipeWritter pw, Request r) {
  */
 char* requestToString(Request request) {
     
-    //Number of predefined characters in the string 'proc-file', spaces, etc
-    int length = 17 + strlen(request->inputFile) + strlen(request->outputFile);
+    //Length of the priority and input file, followed by the output file, the newline and the terminator
+    int length = snprintf(NULL, 0, "PRIORITY: %d %s -> ", request->priority, request->inputFile)
+        + strlen(request->outputFile) + 2;
     
     for(int i = 0; i < request->operationCount; i++)
         length += strlen(request->operations[i]) + 4;
 
+    //Each branch is listed after the output, as " [branch <i> after <n> (of branch <parent>): <operations> -> <output>]"
+    for(int i = 0; i < request->branchCount; i++) {
+        length += getBranchHeader(request, i, NULL)
+            + strlen(request->branches[i].outputFile) + 1;
+        for(int j = 0; j < request->branches[i].operationCount; j++)
+            length += strlen(request->branches[i].operations[j]) + 4;
+    }
+
     char* result = malloc(sizeof(char) * length);
     result[0] = '\0';
     sprintf(result, "PRIORITY: %d %s -> ", request->priority, request->inputFile);
@@ -175,6 +448,16 @@ char* requestToString(Request request) {
         strcat(result, " -> ");
     }
     strcat(result,request->outputFile);
+
+    for(int i = 0; i < request->branchCount; i++) {
+        getBranchHeader(request, i, result + strlen(result));
+        for(int j = 0; j < request->branches[i].operationCount; j++) {
+            strcat(result, request->branches[i].operations[j]);
+            strcat(result, " -> ");
+        }
+        strcat(result, request->branches[i].outputFile);
+        strcat(result, "]");
+    }
     strcat(result, "\n");
     return result;
 }
@@ -242,50 +525,222 @@ char* getRequestStatus(Config config, int availableInstances[], Request* request
 }
 
 /**
- * @brief Frees the memory allocated to a #Request
+ * @brief Checks if a #Request streams the standard input of its client to its standard output
  * 
- * @param r The given #Request
+ * Its files have no path: the server can only use the descriptors passed by the client, from where they
+ * stand, and none of the features looking the files up by their path applies to it
+ * 
+ * @param request The given #Request
+ * 
+ * @return true If the #Request is a ::PROCESS_STREAM one
+ * @return false If it processes files (whatever their names)
  */
-void freeRequest(Request r) {
-    switch (r->type) {
-        case STATUS:
-            free(r->sender);
-            break;
-
-        case PROCESS_FILE:
-            free(r->inputFile);
-            free(r->outputFile);
-            free(r->sender);
-            for(int i = 0; i < r->operationCount; i++)
-                free(r->operations[i]);
-            free(r->operations);
-            break;
-        default:
-            break;
-    }
-    free(r);
+bool isStreamRequest(Request request) {
+    return request->type == PROCESS_STREAM;
+}
+
+/**
+ * @brief Makes the calling thread access the files with the permissions of the user of the client of a #Request
+ * 
+ * A client of the socket is identified by the relay (SO_PEERCRED): the file system user and group of the thread
+ * are switched to its own, which a server not run by root can only do for the clients of its own user. The files
+ * of a client of the FIFO are accessed with the permissions of the server, which the FIFO is restricted to
+ * 
+ * @param request The given #Request
+ * @param access The #CLIENT_ACCESS to fill, to give to endClientAccess
+ * 
+ * @return true If the files can be accessed as the client
+ * @return false If they cannot (errno is EACCES, and endClientAccess must still be called)
+ */
+bool beginClientAccess(Request request, ClientAccess access) {
+    //Called with an invalid id, setfsuid and setfsgid only return the current one
+    access->uid = setfsuid(-1);
+    access->gid = setfsgid(-1);
+    if (!request->clientPid)
+        return true;
+
+    setfsgid(request->clientGid);
+    setfsuid(request->clientUid);
+    if ((uid_t)setfsuid(-1) == request->clientUid && (gid_t)setfsgid(-1) == request->clientGid)
+        return true;
+
+    errno = EACCES;
+    return false;
+}
+
+/**
+ * @brief Makes the calling thread access the files with the permissions of the server again
+ * 
+ * @param access The #CLIENT_ACCESS filled by beginClientAccess
+ */
+void endClientAccess(ClientAccess access) {
+    int error = errno;
+    setfsuid(access->uid);
+    setfsgid(access->gid);
+    errno = error;
+}
+
+/**
+ * @brief Opens a path named by the client of a #Request, with the permissions of its user (see beginClientAccess)
+ * 
+ * @param request The given #Request
+ * @param path The path to open
+ * @param flags The flags of the open
+ * @param mode The mode of a file created
+ * 
+ * @return file_d The descriptor of the file (-1 if it cannot be opened, errno is EACCES if it was refused)
+ */
+file_d openAsClient(Request request, char* path, int flags, mode_t mode) {
+    CLIENT_ACCESS access;
+    file_d fd = beginClientAccess(request, &access) ? open(path, flags, mode) : -1;
+    endClientAccess(&access);
+    return fd;
+}
+
+/**
+ * @brief Opens the input file of a #Request, or takes the descriptor passed by its client
+ * 
+ * The descriptor of a file passed is duplicated, so that it stays open for the lookups keyed on it (see
+ * statRequestInput), while that of a standard stream is taken as it is
+ * 
+ * @param request The given #Request
+ * 
+ * @return file_d The descriptor of the input file (-1 if it cannot be opened)
+ */
+file_d openRequestInput(Request request) {
+    if (request->inputFD >= 0)
+        return isStreamRequest(request) ? request->inputFD : fcntl(request->inputFD, F_DUPFD_CLOEXEC, 0);
+    return openAsClient(request, request->inputFile, O_RDONLY, 0);
+}
+
+/**
+ * @brief Opens the output file of a #Request, or takes the descriptor passed by its client
+ * 
+ * A passed descriptor was opened by the client without truncating the file, so that a resumed #Request keeps
+ * what it already wrote. Like the input, it is duplicated unless it is a standard stream
+ * 
+ * @param request The given #Request
+ * @param truncate Whether the output file is emptied
+ * 
+ * @return file_d The descriptor of the output file (-1 if it cannot be opened)
+ */
+file_d openRequestOutput(Request request, bool truncate) {
+    if (request->outputFD < 0)
+        return openAsClient(request, request->outputFile, O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0660);
+
+    //The standard output of a client is written from where it stands (it may be a pipe, or appended to)
+    if (isStreamRequest(request))
+        return request->outputFD;
+
+    if (truncate)
+        ftruncate(request->outputFD, 0);
+    lseek(request->outputFD, 0, SEEK_SET);
+    return fcntl(request->outputFD, F_DUPFD_CLOEXEC, 0);
+}
+
+/**
+ * @brief Opens a descriptor of its own to a file passed by a client, with an offset of its own
+ * 
+ * @param fd The descriptor passed
+ * @param flags The flags of the open
+ * 
+ * @return file_d The new descriptor (-1 if it cannot be opened)
+ */
+file_d reopenDescriptor(file_d fd, int flags) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    return open(path, flags);
+}
+
+/**
+ * @brief Opens the input file of a #Request for reading, apart from the descriptor its stages read
+ * 
+ * The file passed by a client of the socket is opened again through the descriptor (its path is not resolved)
+ * 
+ * @param request The given #Request
+ * 
+ * @return file_d The new descriptor (-1 if it cannot be opened)
+ */
+file_d reopenRequestInput(Request request) {
+    if (request->inputFD >= 0)
+        return reopenDescriptor(request->inputFD, O_RDONLY | O_CLOEXEC);
+    return openAsClient(request, request->inputFile, O_RDONLY | O_CLOEXEC, 0);
+}
+
+/**
+ * @brief Opens the output file of a #Request for reading, apart from the descriptor its stages write
+ * 
+ * The file passed by a client of the socket is opened again through the descriptor (its path is not resolved)
+ * 
+ * @param request The given #Request
+ * 
+ * @return file_d The new descriptor (-1 if it cannot be opened)
+ */
+file_d reopenRequestOutput(Request request) {
+    if (request->outputFD >= 0)
+        return reopenDescriptor(request->outputFD, O_RDONLY | O_CLOEXEC);
+    return openAsClient(request, request->outputFile, O_RDONLY | O_CLOEXEC, 0);
+}
+
+/**
+ * @brief Gets the status of the input file of a #Request, from the descriptor passed by its client if any
+ * 
+ * @param request The given #Request
+ * @param st The status to fill
+ * 
+ * @return int 0 on success, -1 otherwise (like stat)
+ */
+int statRequestInput(Request request, struct stat* st) {
+    if (request->inputFD >= 0)
+        return fstat(request->inputFD, st);
+    return stat(request->inputFile, st);
+}
+
+/**
+ * @brief Gets the status of the output file of a #Request, from the descriptor passed by its client if any
+ * 
+ * @param request The given #Request
+ * @param st The status to fill
+ * 
+ * @return int 0 on success, -1 otherwise (like stat)
+ */
+int statRequestOutput(Request request, struct stat* st) {
+    if (request->outputFD >= 0)
+        return fstat(request->outputFD, st);
+    return stat(request->outputFile, st);
+}
+
+/**
+ * @brief Gets the path the output file of a #Request is at, to name the files kept next to it
+ * 
+ * The path of a file passed by a client of the socket is the one the kernel knows the descriptor by, not the
+ * one the client sent
+ * 
+ * @param request The given #Request
+ * @param path The string to write the path to
+ * @param size The capacity of the string
+ * 
+ * @return true If the path was written
+ * @return false If it is unknown or too long
+ */
+bool getRequestOutputPath(Request request, char* path, int size) {
+    if (request->outputFD < 0)
+        return snprintf(path, size, "%s", request->outputFile) < size;
+
+    char link[32];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", request->outputFD);
+    ssize_t length = readlink(link, path, size - 1);
+    if (length <= 0 || length == size - 1 || path[0] != '/')
+        return false;
+    path[length] = '\0';
+    return true;
 }
 
 /**
- * @brief Frees the memory allocated inside a #Request
+ * @brief Frees a #Request read from a frame, along with its strings and arrays
  * 
  * @param r The given #Request
  */
-void freeRequestContent(Request r) {
-    switch (r->type) {
-        case STATUS:
-            free(r->sender);
-            break;
-
-        case PROCESS_FILE:
-            free(r->inputFile);
-            free(r->outputFile);
-            free(r->sender);
-            for(int i = 0; i < r->operationCount; i++)
-                free(r->operations[i]);
-            free(r->operations);
-            break;
-        default:
-            break;
-    }
-}
\ No newline at end of file
+void freeRequest(Request r) {
+    free(r);
+}
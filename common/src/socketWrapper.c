@@ -0,0 +1,190 @@
+/**
+ * @file socketWrapper.c
+ * 
+ * @brief File implementing the connection to the Unix domain socket of the server, and the passing of
+ * descriptors through it
+ * 
+ * Descriptors are passed as SCM_RIGHTS ancillary data attached to the first bytes of a message: the receiver
+ * reads those bytes with recvmsg and gets its own copies of the descriptors, already open, along with them.
+ * 
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socketWrapper.h"
+#include "utils.h"
+
+/**
+ * @brief Connects to the Unix domain socket of the server
+ * 
+ * @param path The path of the socket
+ * 
+ * @return file_d The descriptor of the connection (-1 if the server does not listen on the socket)
+ */
+file_d connectSocket(char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, path);
+
+    file_d fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address))) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Sends data through a socket, passing descriptors with its first byte
+ * 
+ * @param socket The descriptor of the socket
+ * @param data The data to send (at least one byte)
+ * @param length The length of the data
+ * @param fds The descriptors to pass (they stay open in the sender)
+ * @param count The number of descriptors (at most #MAX_PASSED_DESCRIPTORS)
+ * 
+ * @return true If the data and the descriptors were sent
+ * @return false If an error occurred
+ */
+bool sendDescriptors(file_d socket, void* data, int length, file_d fds[], int count) {
+    char control[CMSG_SPACE(sizeof(file_d) * MAX_PASSED_DESCRIPTORS)];
+    struct iovec iov = { .iov_base = data, .iov_len = length };
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    if(count > 0) {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(file_d) * count);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(file_d) * count);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(file_d) * count);
+    }
+
+    ssize_t sent;
+    while((sent = sendmsg(socket, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+    if(sent <= 0)
+        return false;
+
+    //The descriptors went with the first bytes, the rest of the data is sent without them
+    return writeSocket(socket, (char*)data + sent, length - sent);
+}
+
+/**
+ * @brief Receives the data already in a socket, up to a given length, along with the descriptors passed with it
+ * 
+ * Unless told to, the call does not wait for data even if the socket is blocking, so that a socket shared with
+ * processes that write to it blocking can be polled. The descriptors received are closed on exec, and those
+ * beyond the room left in the array are discarded
+ * 
+ * @param socket The descriptor of the socket
+ * @param data The buffer to write the data to
+ * @param length The maximum length of the data to receive
+ * @param fds The array to write the descriptors to (of #MAX_PASSED_DESCRIPTORS descriptors)
+ * @param count The number of descriptors already in the array (incremented by those received)
+ * @param wait Whether to wait for the data if there is none yet
+ * 
+ * @return int The number of bytes received (0 if the socket was closed, -1 if an error occurred or, with
+ * errno set to EAGAIN, if there is no data yet)
+ */
+int receiveAvailable(file_d socket, void* data, int length, file_d fds[], int* count, bool wait) {
+    char control[CMSG_SPACE(sizeof(file_d) * MAX_PASSED_DESCRIPTORS)];
+    struct iovec iov = { .iov_base = data, .iov_len = length };
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control) };
+
+    ssize_t received;
+    while((received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC | (wait ? 0 : MSG_DONTWAIT))) < 0 && errno == EINTR);
+
+    for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); received >= 0 && cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        int passed = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(file_d);
+        int kept = MIN(passed, MAX_PASSED_DESCRIPTORS - *count);
+        memcpy(fds + *count, CMSG_DATA(cmsg), sizeof(file_d) * kept);
+        for(int i = kept; i < passed; i++)
+            close(((file_d*)CMSG_DATA(cmsg))[i]);
+        *count += kept;
+    }
+
+    return received;
+}
+
+/**
+ * @brief Receives data from a socket, along with the descriptors passed with its first byte
+ * 
+ * The descriptors received are closed on exec, and those beyond #MAX_PASSED_DESCRIPTORS are discarded
+ * 
+ * @param socket The descriptor of the socket
+ * @param data The buffer to write the data to
+ * @param length The length of the data to receive
+ * @param fds The array to write the descriptors to (of #MAX_PASSED_DESCRIPTORS descriptors)
+ * @param count The variable to write the number of descriptors received to
+ * 
+ * @return true If the whole data was received
+ * @return false If the socket was closed before (the descriptors received, if any, are closed)
+ */
+bool receiveDescriptors(file_d socket, void* data, int length, file_d fds[], int* count) {
+    *count = 0;
+    int received = receiveAvailable(socket, data, length, fds, count, true);
+    if(received > 0 && readSocket(socket, (char*)data + received, length - received))
+        return true;
+
+    for(int i = 0; i < *count; i++)
+        close(fds[i]);
+    *count = 0;
+    return false;
+}
+
+/**
+ * @brief Writes a given number of bytes to a socket
+ * 
+ * @param socket The descriptor of the socket
+ * @param data The bytes to write
+ * @param length The number of bytes to write
+ * 
+ * @return true If the bytes were written
+ * @return false If the socket was closed before, or an error occurred
+ */
+bool writeSocket(file_d socket, void* data, int length) {
+    while(length > 0) {
+        ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+        if(sent < 0 && errno == EINTR)
+            continue;
+        if(sent <= 0)
+            return false;
+        data = (char*)data + sent;
+        length -= sent;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads a given number of bytes from a socket
+ * 
+ * @param socket The descriptor of the socket
+ * @param data The buffer to write the data to
+ * @param length The number of bytes to read
+ * 
+ * @return true If the bytes were read
+ * @return false If the socket was closed before
+ */
+bool readSocket(file_d socket, void* data, int length) {
+    while(length > 0) {
+        ssize_t received = read(socket, data, length);
+        if(received < 0 && errno == EINTR)
+            continue;
+        if(received <= 0)
+            return false;
+        data = (char*)data + received;
+        length -= received;
+    }
+
+    return true;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file wire.c
+ * 
+ * @brief File implementing the reading and writing of frames
+ * 
+ * A frame is a #WireHeader followed by a payload of the length it gives. The payload is a sequence of fields:
+ * integers (4 bytes) and strings (their length as an integer, their characters and a terminating '\0'). A
+ * frame is read whole into the buffer of the #PipeReader, so that its strings can be used where they are,
+ * and every field is checked to be inside the payload before it is used. After an invalid header, the
+ * reading resumes at the next #WIRE_MAGIC, so that the valid frames that follow it are still read.
+ * 
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "wire.h"
+#include "pipeWrapper.h"
+#include "utils.h"
+
+/**
+ * @brief Checks that a #WireHeader starts a frame of this version of the format
+ * 
+ * @param header The given #WireHeader
+ * 
+ * @return true If the header is valid
+ * @return false Otherwise
+ */
+bool checkWireHeader(WireHeader header) {
+    return header->magic == WIRE_MAGIC && header->version == WIRE_VERSION && header->length <= WIRE_MAX_SIZE;
+}
+
+/**
+ * @brief Skips the buffered bytes of a #PipeReader up to the next #WIRE_MAGIC after its position
+ * 
+ * The bytes at the end of the buffer that may start a #WIRE_MAGIC whose end is not read yet are kept
+ * 
+ * @param pr The given #PipeReader
+ */
+void resyncFrames(PipeReader pr) {
+    uint32_t magic = WIRE_MAGIC;
+    int skip = 1;
+
+    for(; pr->pos + skip < pr->available; skip++)
+        if(!memcmp(pr->buffer + pr->pos + skip, &magic, MIN((int)sizeof(magic), pr->available - pr->pos - skip)))
+            break;
+
+    skipBytes(pr, skip);
+}
+
+/**
+ * @brief Reads the next frame from a #PipeReader
+ * 
+ * The payload is left in the buffer of the #PipeReader, and is only valid until the next read from it. A frame
+ * whose header is invalid, or whose payload is longer than allowed, is skipped up to the next #WIRE_MAGIC
+ * 
+ * @param pr The given #PipeReader
+ * @param header The #WireHeader to write to
+ * @param payload The pointer to write the address of the payload to (NULL if the frame is not valid)
+ * @param maxLength The longest payload allowed (#WIRE_FIFO_MAX_SIZE for the FIFO of the server, where longer
+ * frames may be interleaved with others)
+ * 
+ * @return true If a frame was read
+ * @return false If the pipe was closed
+ */
+bool readFrame(PipeReader pr, WireHeader header, char** payload, uint32_t maxLength) {
+    char* bytes = peekBytes(pr, sizeof(WIRE_HEADER));
+    if(!bytes)
+        return false;
+
+    memcpy(header, bytes, sizeof(WIRE_HEADER));
+    if(!checkWireHeader(header) || header->length > maxLength) {
+        resyncFrames(pr);
+        *payload = NULL;
+        return true;
+    }
+
+    bytes = peekBytes(pr, sizeof(WIRE_HEADER) + header->length);
+    if(!bytes)
+        return false;
+
+    skipBytes(pr, sizeof(WIRE_HEADER) + header->length);
+    *payload = bytes + sizeof(WIRE_HEADER);
+    return true;
+}
+
+/**
+ * @brief Writes the header of a frame to a #PipeWritter
+ * 
+ * @param pw The given #PipeWritter
+ * @param kind The #WireKind of the payload
+ * @param length The length of the payload, written next
+ */
+void writeWireHeader(PipeWritter pw, WireKind kind, int length) {
+    WIRE_HEADER header = { .magic = WIRE_MAGIC, .version = WIRE_VERSION, .kind = kind, .length = length };
+    writeBytes(pw, sizeof(header), &header);
+}
+
+/**
+ * @brief Places a #WireCursor at the start of a payload
+ * 
+ * @param cursor The given #WireCursor
+ * @param payload The payload
+ * @param length The length of the payload
+ */
+void initWireCursor(WireCursor cursor, char* payload, int length) {
+    cursor->pos = payload;
+    cursor->end = payload + length;
+}
+
+/**
+ * @brief Takes an integer from a payload
+ * 
+ * @param cursor The given #WireCursor
+ * @param value The integer to write to
+ * 
+ * @return true If the integer is inside the payload
+ * @return false Otherwise
+ */
+bool takeInt(WireCursor cursor, int* value) {
+    int32_t field;
+
+    if(cursor->end - cursor->pos < (long)sizeof(field))
+        return false;
+
+    memcpy(&field, cursor->pos, sizeof(field));
+    cursor->pos += sizeof(field);
+    *value = field;
+    return true;
+}
+
+/**
+ * @brief Takes a string from a payload, without copying it
+ * 
+ * @param cursor The given #WireCursor
+ * @param value The pointer to write the address of the string (inside the payload) to
+ * 
+ * @return true If the string and its terminating '\0' are inside the payload
+ * @return false Otherwise
+ */
+bool takeString(WireCursor cursor, char** value) {
+    int length;
+
+    if(!takeInt(cursor, &length) || length < 0 || cursor->end - cursor->pos <= length || cursor->pos[length])
+        return false;
+
+    *value = cursor->pos;
+    cursor->pos += length + 1;
+    return true;
+}
+
+/**
+ * @brief Writes an integer field to a #PipeWritter
+ * 
+ * @param pw The given #PipeWritter
+ * @param value The integer
+ */
+void putInt(PipeWritter pw, int value) {
+    int32_t field = value;
+    writeBytes(pw, sizeof(field), &field);
+}
+
+/**
+ * @brief Writes a string field to a #PipeWritter
+ * 
+ * @param pw The given #PipeWritter
+ * @param value The string
+ */
+void putString(PipeWritter pw, char* value) {
+    int length = strlen(value);
+    putInt(pw, length);
+    writeBytes(pw, length + 1, value);
+}
+
+/**
+ * @brief Gets the size of a string field
+ * 
+ * @param value The string
+ * 
+ * @return int The number of bytes written by putString
+ */
+int getStringFieldSize(char* value) {
+    return sizeof(int32_t) + strlen(value) + 1;
+}
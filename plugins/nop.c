@@ -0,0 +1,62 @@
+/**
+ * @file nop.c
+ * 
+ * @brief The nop transformation as a plugin: its output is its input
+ * 
+ * Built as bin/plugins/nop.so, it is used in place of the nop executable when the shared object is copied
+ * next to it and the transformation is declared with the "plugin" attribute
+ * 
+ */
+
+#include "plugin.h"
+
+/**
+ * @brief Creates the state of a stream (nop has none)
+ * 
+ * @param state The state to set
+ * 
+ * @return int 0
+ */
+static int nopInit(void** state) {
+    *state = NULL;
+    return 0;
+}
+
+/**
+ * @brief Emits a buffer of input unchanged
+ * 
+ * @param state The state of the stream
+ * @param data The input
+ * @param length The length of the input
+ * @param emit The callback receiving the output
+ * @param sink The sink to give to the callback
+ * 
+ * @return int 0 on success, -1 if the output could not be written
+ */
+static int nopProcess(void* state, const char* data, size_t length, PluginEmit emit, void* sink) {
+    return emit(sink, data, length);
+}
+
+/**
+ * @brief Ends a stream (nop holds no output back)
+ * 
+ * @param state The state of the stream
+ * @param emit The callback receiving the output
+ * @param sink The sink to give to the callback
+ * 
+ * @return int 0
+ */
+static int nopFinish(void* state, PluginEmit emit, void* sink) {
+    return 0;
+}
+
+/**
+ * @brief The ABI of the plugin
+ * 
+ */
+const PLUGIN_API sdstorePlugin = {
+    .abiVersion = PLUGIN_ABI_VERSION,
+    .init = nopInit,
+    .process = nopProcess,
+    .finish = nopFinish
+};
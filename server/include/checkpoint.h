@@ -0,0 +1,50 @@
+/**
+ * @file checkpoint.h
+ * 
+ * @brief File declaring the API used to record the progress of a #Request run in chunks, so that it can be
+ * resumed
+ * 
+ */
+
+#ifndef _CHECKPOINT_H_
+
+/**
+ * @brief Include guard
+ */
+#define _CHECKPOINT_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "config.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief The suffix added to the name of the output file to get the name of its journal
+ * 
+ */
+#define JOURNAL_SUFFIX ".sdjournal"
+
+/**
+ * @brief The progress of a #Request run in chunks, and what it was computed from
+ * 
+ */
+typedef struct checkpoint {
+    dev_t inputDevice; ///< The device of the input file
+    ino_t inputInode; ///< The inode of the input file
+    off_t inputSize; ///< The size of the input file
+    struct timespec inputModified; ///< The last modification of the input file
+    uint64_t operations; ///< The hash of the operations of the #Request
+    long chunkSize; ///< The size of the chunks of the input
+    int chunks; ///< The number of chunks whose output is in the output file
+    off_t written; ///< The size of the output of those chunks
+    long interval; ///< The number of bytes of input between two checkpoints
+    int saved; ///< The value of #chunks when the checkpoint was last saved
+} CHECKPOINT, * Checkpoint;
+
+bool loadCheckpoint(Config, Request, file_d, Checkpoint);
+bool saveCheckpoint(Request, Checkpoint, file_d);
+void clearCheckpoint(Request);
+
+#endif // _CHECKPOINT_H_
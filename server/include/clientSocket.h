@@ -0,0 +1,51 @@
+/**
+ * @file clientSocket.h
+ * 
+ * @brief File declaring the API of the Unix domain socket served by the relay along with the FIFO
+ * 
+ */
+
+#ifndef _CLIENTSOCKET_H_
+
+/**
+ * @brief Include guard
+ */
+#define _CLIENTSOCKET_H_
+
+#include <poll.h>
+#include <sys/types.h>
+
+#include "config.h"
+#include "pipeWrapper.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief The client that sent a #Request, as known by the relay
+ * 
+ */
+typedef struct peer {
+    pid_t pid; ///< The process of the client (0 for a client of the FIFO)
+    uid_t uid; ///< The user of the client (0 for a client of the FIFO)
+    gid_t gid; ///< The group of the client (0 for a client of the FIFO)
+    int descriptors; ///< The number of descriptors passed to the router with the #Request (0 for a client of the FIFO)
+} PEER, * Peer;
+
+typedef struct clientSocket *ClientSocket;
+
+/**
+ * @brief The number of descriptors a process of the server keeps for itself, out of those it may have open, rather
+ * than for the clients (its pipes, the files of the result cache and of the plugins, the workers...)
+ * 
+ */
+#define RESERVED_DESCRIPTORS 256
+
+int getClientLimit();
+ClientSocket newClientSocket(Config, file_d);
+void deleteClientSocket(ClientSocket);
+int getClientPollSize(ClientSocket);
+void fillClientPoll(ClientSocket, struct pollfd[]);
+void serveClients(ClientSocket, struct pollfd[], PipeWritter);
+Request receiveRequest(file_d, Peer);
+
+#endif // _CLIENTSOCKET_H_
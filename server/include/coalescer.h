@@ -0,0 +1,29 @@
+/**
+ * @file coalescer.h
+ * 
+ * @brief File declaring the API used to attach requests to an identical request already in the server
+ * 
+ */
+
+#ifndef _COALESCER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _COALESCER_H_
+
+#include "config.h"
+#include "digest.h"
+#include "request.h"
+#include "utils.h"
+
+typedef struct coalescer *Coalescer;
+
+Coalescer newCoalescer(Config);
+void deleteCoalescer(Coalescer);
+bool attachRequest(Coalescer, Request*, int, Request);
+void copyOutput(Request, Request, OutputSummary, file_d);
+void followerFinished(Coalescer, OutputSummary);
+char* getCoalescerStatus(Coalescer);
+
+#endif // _COALESCER_H_
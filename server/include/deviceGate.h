@@ -0,0 +1,36 @@
+/**
+ * @file deviceGate.h
+ * 
+ * @brief File declaring the API used to limit the number of running requests using each storage device
+ * 
+ */
+
+#ifndef _DEVICE_GATE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _DEVICE_GATE_H_
+
+#include <sys/types.h>
+
+#include "config.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief Value of the devices of a #Request when they could not be determined (no limit is applied)
+ * 
+ */
+#define NO_DEVICE ((dev_t) -1)
+
+typedef struct deviceGate *DeviceGate;
+
+DeviceGate newDeviceGate(Config);
+void deleteDeviceGate(DeviceGate);
+void identifyDevices(Request);
+bool acquireDevices(DeviceGate, Request);
+void releaseDevices(DeviceGate, Request);
+char* getDeviceStatus(DeviceGate);
+
+#endif // _DEVICE_GATE_H_
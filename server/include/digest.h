@@ -0,0 +1,62 @@
+/**
+ * @file digest.h
+ * 
+ * @brief File declaring the API used to digest the output of a #Request as it is written, and to summarize
+ * its files for the router
+ * 
+ */
+
+#ifndef _DIGEST_H_
+
+/**
+ * @brief Include guard
+ */
+#define _DIGEST_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "config.h"
+#include "hash.h"
+#include "utils.h"
+
+/**
+ * @brief The sizes of the files of a finished #Request, and the digest of its output, sent to the router
+ * 
+ */
+typedef struct outputSummary {
+    long inputBytes; ///< The size of the input (-1 if unknown)
+    long outputBytes; ///< The size of the output (-1 if unknown)
+    DigestType digestType; ///< The digest computed on the output (::DIGEST_NONE if none)
+    uint64_t digest; ///< The value of the digest
+} OUTPUT_SUMMARY, * OutputSummary;
+
+/**
+ * @brief A stage of a pipeline run by a thread of the job handler, writing the output to its file while
+ * digesting it (or the input to the first stage, to hash it for the result cache)
+ * 
+ */
+typedef struct digestStage {
+    DigestType type; ///< The digest computed
+    file_d in; ///< The read end of the pipe the output comes from (closed by the thread)
+    file_d out; ///< The output file (closed by the thread)
+    pthread_t thread; ///< The thread
+    bool running; ///< Whether the thread was started
+    bool ok; ///< Whether the whole output was written (valid once the stage is joined)
+    long bytes; ///< The number of bytes written
+    uint32_t crc; ///< The CRC32C of the output (::DIGEST_CRC32C)
+    HASH_STATE hash; ///< The XXH64 state of the output (::DIGEST_XXH64)
+} DIGEST_STAGE, * DigestStage;
+
+uint32_t updateCrc32c(uint32_t, const void*, size_t);
+void initDigest(DigestStage, DigestType);
+void updateDigest(DigestStage, const void*, size_t);
+void digestRange(DigestStage, file_d, off_t, off_t);
+void finishDigest(DigestStage, OutputSummary);
+bool startDigestStage(DigestStage, DigestType, file_d, file_d);
+bool joinDigestStage(DigestStage, OutputSummary);
+void summarizeFiles(OutputSummary, file_d, file_d);
+int formatDigest(OutputSummary, char*, int);
+
+#endif // _DIGEST_H_
@@ -0,0 +1,23 @@
+/**
+ * @file fileCopy.h
+ * 
+ * @brief File declaring the API used to copy the contents of a file to another one
+ * 
+ */
+
+#ifndef _FILE_COPY_H_
+
+/**
+ * @brief Include guard
+ */
+#define _FILE_COPY_H_
+
+#include <sys/types.h>
+
+#include "utils.h"
+
+bool copyFileRange(file_d, loff_t, file_d, loff_t, off_t);
+bool copyStream(file_d, file_d);
+bool copyFile(file_d, file_d);
+
+#endif // _FILE_COPY_H_
@@ -14,9 +14,13 @@
 #define _JOB_MANAGER_H_
 
 #include "config.h"
+#include "placement.h"
+#include "pluginEngine.h"
 #include "request.h"
+#include "usage.h"
 #include "utils.h"
+#include "workerPool.h"
 
-void runJobHandler(Request, file_d, char*, Config);
+void runJobHandler(Request, file_d, char*, Config, Placement, USAGE_STATS[], Plugins, WorkerPool);
 
 #endif // _JOB_MANAGER_H_
\ No newline at end of file
@@ -0,0 +1,41 @@
+/**
+ * @file largeFile.h
+ * 
+ * @brief File declaring the API used to keep requests on very large files from flooding the page cache
+ * 
+ */
+
+#ifndef _LARGE_FILE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _LARGE_FILE_H_
+
+#include <sys/types.h>
+
+#include "config.h"
+#include "utils.h"
+
+/**
+ * @brief The state of a #Request running in large-file mode
+ * 
+ */
+typedef struct largeFile {
+    bool enabled; ///< Whether the #Request runs in large-file mode
+    bool direct; ///< Whether the files should be accessed with O_DIRECT
+    long window; ///< The number of bytes between write-behinds / cache drops
+    file_d input; ///< The input file, shared with the first stage (-1 if read with O_DIRECT)
+    file_d output; ///< The output file, shared with the last stage (-1 if written with O_DIRECT)
+    long inputDropped; ///< The number of bytes at the start of the input dropped from the cache
+    long outputFlushed; ///< The number of bytes at the start of the output whose write-back was started
+    long outputDropped; ///< The number of bytes at the start of the output written back and dropped
+} LARGE_FILE, * LargeFile;
+
+bool initLargeFile(LargeFile, Config, file_d, file_d);
+file_d startInputPump(LargeFile, file_d, pid_t*);
+file_d startOutputPump(LargeFile, file_d, pid_t*);
+void largeFileTick(LargeFile);
+void finishLargeFile(LargeFile);
+
+#endif // _LARGE_FILE_H_
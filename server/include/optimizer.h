@@ -0,0 +1,26 @@
+/**
+ * @file optimizer.h
+ * 
+ * @brief File declaring the API used to remove the redundant operations of a #Request
+ * 
+ */
+
+#ifndef _OPTIMIZER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _OPTIMIZER_H_
+
+#include "config.h"
+#include "request.h"
+#include "utils.h"
+
+typedef struct optimizer *Optimizer;
+
+Optimizer newOptimizer(Config);
+void deleteOptimizer(Optimizer);
+char* optimizeRequest(Optimizer, Request);
+char* getOptimizerStatus(Optimizer);
+
+#endif // _OPTIMIZER_H_
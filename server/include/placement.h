@@ -0,0 +1,30 @@
+/**
+ * @file placement.h
+ * 
+ * @brief File declaring the API used to place the stages of a pipeline on the CPUs of the machine
+ * 
+ */
+
+#ifndef _PLACEMENT_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PLACEMENT_H_
+
+#include <sched.h>
+
+#include "config.h"
+#include "request.h"
+#include "utils.h"
+
+typedef struct placement *Placement;
+
+Placement newPlacement(PlacementPolicy);
+void deletePlacement(Placement);
+void placeRequest(Placement, Request, Config);
+void unplaceRequest(Placement, Request);
+bool getStageCpus(Placement, Request, int, cpu_set_t*);
+char* getPlacementStatus(Placement, Request*, int);
+
+#endif // _PLACEMENT_H_
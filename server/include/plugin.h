@@ -0,0 +1,63 @@
+/**
+ * @file plugin.h
+ * 
+ * @brief File declaring the ABI of the transformations run inside the server (plugins)
+ * 
+ * A plugin is a shared object named after its transformation (```<transformation>.so```) in the directory
+ * of the executables, exporting a #PLUGIN_API named #PLUGIN_SYMBOL. The server streams the input of a stage
+ * through it: #PLUGIN_API::init once, #PLUGIN_API::process for every buffer of input, and #PLUGIN_API::finish
+ * at the end of the input. The output is handed back to the server through the #PluginEmit callback, at any
+ * time and in any number of pieces.
+ * 
+ * This header does not depend on the rest of the server, so that plugins can be built on their own.
+ * 
+ */
+
+#ifndef _PLUGIN_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PLUGIN_H_
+
+#include <stddef.h>
+
+/**
+ * @brief The version of the ABI, checked by the server when it loads a plugin
+ * 
+ */
+#define PLUGIN_ABI_VERSION 1
+
+/**
+ * @brief The name of the #PLUGIN_API exported by a plugin
+ * 
+ */
+#define PLUGIN_SYMBOL "sdstorePlugin"
+
+/**
+ * @brief Hands output of a plugin to the server (the data is copied or consumed before it returns)
+ * 
+ * @param sink The sink given to the plugin along with the callback
+ * @param data The output
+ * @param length The length of the output
+ * 
+ * @return 0 On success
+ * @return -1 If the output cannot be written (the plugin must stop and return -1)
+ */
+typedef int (*PluginEmit)(void* sink, const char* data, size_t length);
+
+/**
+ * @brief The callbacks of a plugin, all returning 0 on success and -1 on failure
+ * 
+ * The calls for a stream are made from a single thread, but several streams may run at once on different
+ * threads, so a plugin must keep its state in the state of the stream
+ * 
+ */
+typedef struct pluginApi {
+    int abiVersion; ///< The #PLUGIN_ABI_VERSION the plugin was built against
+    int (*init)(void** state); ///< Creates the state of a stream
+    int (*process)(void* state, const char* data, size_t length, PluginEmit emit, void* sink); ///< Transforms a buffer of input
+    int (*finish)(void* state, PluginEmit emit, void* sink); ///< Flushes the rest of the output and frees the state of the stream
+} PLUGIN_API;
+
+#endif // _PLUGIN_H_
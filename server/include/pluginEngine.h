@@ -0,0 +1,58 @@
+/**
+ * @file pluginEngine.h
+ * 
+ * @brief File declaring the API used to load the plugins and run them in processes forked by a job handler
+ * 
+ */
+
+#ifndef _PLUGIN_ENGINE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PLUGIN_ENGINE_H_
+
+#include <sys/types.h>
+#include <time.h>
+
+#include "config.h"
+#include "plugin.h"
+#include "request.h"
+#include "usage.h"
+#include "utils.h"
+
+typedef struct plugins *Plugins;
+
+/**
+ * @brief A run of consecutive stages of a pipeline implemented by plugins, run by a single worker process
+ * 
+ * The buffers are passed directly from a stage to the next one, the segment only reads its input from and
+ * writes its output to descriptors (files, or pipes from and to the stages run as processes). A plugin that
+ * crashes only takes its worker down, which the job handler reports as a failed stage
+ * 
+ */
+typedef struct pluginSegment {
+    Plugins plugins; ///< The loaded plugins
+    int* opsId; ///< The identifiers of the transformations of the stages, in order
+    int count; ///< The number of stages
+    file_d in; ///< The descriptor the input is read from (closed by the worker)
+    file_d out; ///< The descriptor the output is written to (closed by the worker)
+    StageUsage usage; ///< The usage of each stage, filled once the worker is joined
+    StageUsage shared; ///< The usage of each stage, filled by the worker (mapped shared with it)
+    struct timespec started; ///< When the worker started
+    pid_t pid; ///< The pid of the worker (-1 if it was not started)
+    int status; ///< The exit status of the worker (valid once it is reaped)
+    bool reaped; ///< Whether the worker was reaped
+    bool ok; ///< Whether every stage succeeded (valid once the worker is joined)
+} PLUGIN_SEGMENT, * PluginSegment;
+
+Plugins loadPlugins(Config, char*);
+void unloadPlugins(Plugins);
+bool isPluginStage(Plugins, int);
+bool usesPlugins(Plugins, Config, Request);
+bool startPluginSegment(Plugins, PluginSegment, int[], int, file_d, file_d, StageUsage);
+bool reapPluginSegment(PLUGIN_SEGMENT[], int, pid_t);
+bool joinPluginSegment(PluginSegment);
+char* getPluginStatus(Plugins, Config);
+
+#endif // _PLUGIN_ENGINE_H_
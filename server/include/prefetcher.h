@@ -0,0 +1,27 @@
+/**
+ * @file prefetcher.h
+ * 
+ * @brief File declaring the API used to prefetch the input files of the requests next in line
+ * 
+ */
+
+#ifndef _PREFETCHER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PREFETCHER_H_
+
+#include "config.h"
+#include "request.h"
+#include "utils.h"
+
+typedef struct prefetcher *Prefetcher;
+
+Prefetcher newPrefetcher(Config);
+void deletePrefetcher(Prefetcher);
+void prefetchNextInputs(Prefetcher, Request*, int);
+void prefetchDispatched(Prefetcher, Request);
+char* getPrefetchStatus(Prefetcher);
+
+#endif // _PREFETCHER_H_
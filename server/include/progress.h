@@ -0,0 +1,27 @@
+/**
+ * @file progress.h
+ * 
+ * @brief File declaring the API used to follow the bytes moved by each stage of the running requests
+ * 
+ */
+
+#ifndef _PROGRESS_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PROGRESS_H_
+
+#include "request.h"
+#include "usage.h"
+#include "utils.h"
+
+typedef struct progressTracker *ProgressTracker;
+
+ProgressTracker newProgressTracker();
+void deleteProgressTracker(ProgressTracker);
+void recordProgress(ProgressTracker, Request, int, StageUsage, bool);
+char* finishProgress(ProgressTracker, Request);
+char* getProgressStatus(ProgressTracker, Request*, int);
+
+#endif // _PROGRESS_H_
@@ -0,0 +1,34 @@
+/**
+ * @file pump.h
+ * 
+ * @brief File declaring the API used to run the processes that move data between the stages of a
+ * pipeline and its files, when the stages cannot use the files directly
+ * 
+ */
+
+#ifndef _PUMP_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PUMP_H_
+
+#include <sys/types.h>
+
+#include "utils.h"
+
+/**
+ * @brief The exit status of a tee pump that forwarded all the data but could not copy all of it
+ * 
+ */
+#define TEE_COPY_INCOMPLETE 2
+
+int fillBuffer(file_d, char*, int);
+bool writeBuffer(file_d, char*, int);
+bool moveFromPipe(file_d, file_d, long);
+pid_t startDirectPump(file_d, file_d);
+pid_t startTeePump(file_d, file_d, file_d);
+pid_t startFanOutPump(file_d, file_d[], int);
+pid_t startRangePump(file_d, off_t, off_t, file_d);
+
+#endif // _PUMP_H_
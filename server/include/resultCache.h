@@ -0,0 +1,74 @@
+/**
+ * @file resultCache.h
+ * 
+ * @brief File declaring the API used to cache the outputs of finished requests
+ * 
+ */
+
+#ifndef _RESULT_CACHE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _RESULT_CACHE_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "config.h"
+#include "digest.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief How the result cache was used by a #Request
+ * 
+ */
+typedef enum cacheStatus {
+    CACHE_UNUSED, ///< The cache is disabled or the input could not be hashed
+    CACHE_HIT, ///< The output was copied from the cache, no transformation was run
+    CACHE_MISSED, ///< The output was not in the cache and could not be stored in it
+    CACHE_STORED, ///< The output was not in the cache and was stored in it
+    CACHE_LOST ///< The cached output the router found was gone when the job handler opened it (the #Request is run again)
+} CacheStatus;
+
+/**
+ * @brief The use of the result cache by a finished #Request, sent by its job handler to the router
+ * 
+ */
+typedef struct cacheOutcome {
+    CacheStatus status; ///< How the cache was used
+    bool hashed; ///< Whether the hash of the input is known
+    uint64_t inputHash; ///< The hash of the contents of the input
+    dev_t inputDevice; ///< The device holding the input file when it was hashed
+    ino_t inputInode; ///< The inode of the input file when it was hashed (0 if it was not read)
+    long inputSize; ///< The size of the input
+    struct timespec inputModified; ///< The last modification of the input file when it was hashed
+    uint64_t key; ///< The key of the output (hash of the input, of its size and of the operations)
+    long size; ///< The size of the output
+    int prefixHit; ///< The number of operations skipped by starting from a cached intermediate output (0 if none)
+    int prefixStored; ///< The number of operations whose intermediate output was stored in the cache (0 if none)
+    uint64_t prefixKey; ///< The key of the intermediate output stored in the cache
+    long prefixSize; ///< The size of the intermediate output stored in the cache
+} CACHE_OUTCOME, * CacheOutcome;
+
+typedef struct resultCache *ResultCache;
+
+ResultCache newResultCache(Config);
+void deleteResultCache(ResultCache);
+int lookupCache(ResultCache, Request);
+void choosePrefix(ResultCache, Request);
+void cacheFinished(ResultCache, CacheOutcome, Request);
+void cacheLost(ResultCache, Request);
+char* getCacheStatus(ResultCache);
+
+void initCacheOutcome(Config, Request, file_d, CacheOutcome);
+void finishInputHash(Request, CacheOutcome, bool, uint64_t);
+bool serveResult(Config, Request, file_d, CacheOutcome, OutputSummary);
+void storeResult(Config, Request, CacheOutcome, OutputSummary);
+file_d openPrefix(Config, Request, CacheOutcome, long*);
+file_d createIntermediate(Config, Request, CacheOutcome);
+void storeIntermediate(Config, Request, CacheOutcome, bool);
+
+#endif // _RESULT_CACHE_H_
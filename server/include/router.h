@@ -16,6 +16,6 @@
 #include "config.h"
 #include "utils.h"
 
-void runRouter(Config, file_d, file_d, char*);
+void runRouter(Config, file_d, file_d, file_d, char*);
 
 #endif
\ No newline at end of file
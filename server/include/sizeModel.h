@@ -0,0 +1,27 @@
+/**
+ * @file sizeModel.h
+ * 
+ * @brief File declaring the API used to predict the size of the output of a #Request
+ * 
+ */
+
+#ifndef _SIZE_MODEL_H_
+
+/**
+ * @brief Include guard
+ */
+#define _SIZE_MODEL_H_
+
+#include "config.h"
+#include "request.h"
+#include "utils.h"
+
+typedef struct sizeModel *SizeModel;
+
+SizeModel newSizeModel(Config);
+void deleteSizeModel(SizeModel);
+void predictOutputSize(SizeModel, Request);
+void learnOutputSize(SizeModel, Request, long);
+char* getSizeModelStatus(SizeModel);
+
+#endif // _SIZE_MODEL_H_
@@ -0,0 +1,31 @@
+/**
+ * @file stagePipe.h
+ * 
+ * @brief File declaring the API used to create and observe the pipes between the stages of a pipeline
+ * 
+ */
+
+#ifndef _STAGE_PIPE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _STAGE_PIPE_H_
+
+#include <sys/types.h>
+
+#include "config.h"
+#include "usage.h"
+#include "utils.h"
+
+/**
+ * @brief The capacity of a pipe created by the kernel
+ * 
+ */
+#define DEFAULT_PIPE_SIZE (64 * 1024)
+
+long getPipeSize(Config, USAGE_STATS[], int);
+bool openStagePipe(file_d[2], long);
+void sampleStagePipe(pid_t, StageUsage);
+
+#endif // _STAGE_PIPE_H_
@@ -13,8 +13,13 @@
  */
 #define _UPDATE_H_
 
+#include "clientSocket.h"
+#include "digest.h"
+#include "wire.h"
 #include "pipeWrapper.h"
 #include "request.h"
+#include "resultCache.h"
+#include "usage.h"
 #include "utils.h"
 
 /**
@@ -22,24 +27,37 @@
  * 
  */
 typedef enum updateType {
-    U_REQUEST, ///< A new #Request has arrived
+    U_REQUEST, ///< A new #Request has arrived (it follows through the channel of the relay)
     U_REQUEST_FINISHED, ///< A #Request has finished executing
     U_FINISHED_OP, ///< An operation has finished
+    U_STAGE_PROGRESS, ///< A sample of the bytes moved so far by a running stage
     U_SERVER_DISCONECTED ///< The server has disconnected
 } UpdateType;
 
 /**
  * @brief An update sent by the relay or the job managers to the router
  * 
+ * Every update but ::U_REQUEST has a fixed size, within PIPE_BUF, so that those written by the job handlers at
+ * the same time are never interleaved
+ * 
  */
 typedef struct update {
     UpdateType type; ///< The type of update
-    Request request; ///< The #Request
+    Request request; ///< The new #Request
+    PEER peer; ///< The client that sent the new #Request
     int operationId; ///< The id of the operation
+    int requestId; ///< The #Request running the stage of the operation, or the finished #Request (its time of arrival)
+    int stage; ///< The index of the stage of the operation in its #Request (-1 if it is not a stage of a pipeline)
+    STAGE_USAGE usage; ///< The resources used by the finished operation (so far, for a sample of its progress)
+    bool releases; ///< Whether the instance used by the finished operation is available again
+    CACHE_OUTCOME cache; ///< The use of the result cache by the finished #Request
+    OUTPUT_SUMMARY summary; ///< The sizes of the files of the finished #Request and the digest of its output
+    bool failed; ///< Whether the finished #Request failed (its output is incomplete)
 } UPDATE, * Update;
 
 void fromRequest(Update, Request);
 bool readUpdate(PipeReader, Update);
 bool writeUpdate(PipeWritter, Update);
+bool forwardRequest(PipeWritter, file_d, WireHeader, char*, Peer, file_d[]);
 
 #endif // _UPDATE_H_
\ No newline at end of file
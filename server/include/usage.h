@@ -0,0 +1,57 @@
+/**
+ * @file usage.h
+ * 
+ * @brief File declaring the API used to account for the resources used by the stages of a #Request
+ * 
+ */
+
+#ifndef _USAGE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _USAGE_H_
+
+#include <sys/resource.h>
+
+#include "config.h"
+#include "utils.h"
+
+/**
+ * @brief The resources used by a single stage (transformation process) of a pipeline
+ * 
+ */
+typedef struct stageUsage {
+    long userTime; ///< User CPU time (microseconds)
+    long systemTime; ///< System CPU time (microseconds)
+    long maxRss; ///< Maximum resident set size (KiB)
+    long voluntarySwitches; ///< Number of voluntary context switches
+    long involuntarySwitches; ///< Number of involuntary context switches
+    long blocksIn; ///< Number of block input operations
+    long blocksOut; ///< Number of block output operations
+    long realTime; ///< Wall-clock time from the start of the stage until it exited (microseconds)
+    long bytesRead; ///< Number of bytes read by the stage
+    long bytesWritten; ///< Number of bytes written by the stage
+    long pipeSamples; ///< Number of times the occupancy of the output pipe of the stage was sampled
+    long pipeFull; ///< Number of samples in which the output pipe was full (the stage was blocked writing)
+    long pipeEmpty; ///< Number of samples in which the output pipe was empty (the next stage was blocked reading)
+} STAGE_USAGE, * StageUsage;
+
+/**
+ * @brief The aggregated resource usage of all the stages of a transformation
+ * 
+ */
+typedef struct usageStats {
+    long stages; ///< The number of stages accounted for
+    STAGE_USAGE total; ///< The sum of the usage of every stage (except for maxRss)
+    long peakRss; ///< The highest maximum resident set size of any stage (KiB)
+} USAGE_STATS, * UsageStats;
+
+void fromRusage(StageUsage, struct rusage*);
+void readProcessIo(StageUsage, pid_t);
+bool readProcessCpu(StageUsage, pid_t);
+void initUsageStats(UsageStats);
+void addUsage(UsageStats, StageUsage);
+char* getUsageStatus(Config, USAGE_STATS[]);
+
+#endif // _USAGE_H_
@@ -0,0 +1,69 @@
+/**
+ * @file workerPool.h
+ * 
+ * @brief File declaring the API used to keep persistent workers for the transformations and run stages on them
+ * 
+ */
+
+#ifndef _WORKER_POOL_H_
+
+/**
+ * @brief Include guard
+ */
+#define _WORKER_POOL_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "config.h"
+#include "request.h"
+#include "usage.h"
+#include "utils.h"
+#include "workerProtocol.h"
+
+typedef struct workerPool *WorkerPool;
+
+/**
+ * @brief A persistent worker of a transformation
+ * 
+ */
+typedef struct worker {
+    pid_t pid; ///< The pid of the worker (0 if the slot is empty)
+    file_d jobs; ///< The descriptor the jobs are written to (standard input of the worker)
+    file_d results; ///< The descriptor the results are read from (standard output of the worker)
+    long done; ///< The number of jobs given to the worker
+    int owner; ///< The #Request::timeOfArrival of the request using the worker (-1 if idle)
+    int stage; ///< The stage of that request run by the worker
+} WORKER, * Worker;
+
+/**
+ * @brief A stage of a pipeline run by a #Worker, driven by two threads of the job handler: one sending the
+ * input to the worker, the other writing its output
+ * 
+ */
+typedef struct workerStage {
+    Worker worker; ///< The worker
+    file_d in; ///< The descriptor the input is read from (closed by the feeder)
+    file_d out; ///< The descriptor the output is written to (closed by the collector)
+    StageUsage usage; ///< The usage of the stage
+    struct timespec started; ///< When the stage started
+    STAGE_USAGE cpuBefore; ///< The CPU time used by the worker and its jobs when the stage started
+    pthread_t feeder; ///< The thread sending the input
+    pthread_t collector; ///< The thread writing the output
+    bool fed; ///< Whether the whole input was sent
+    bool ok; ///< Whether the worker succeeded (valid once the stage is joined)
+    bool running; ///< Whether the threads were started
+} WORKER_STAGE, * WorkerStage;
+
+WorkerPool newWorkerPool(Config, char*);
+void deleteWorkerPool(WorkerPool);
+void assignWorkers(WorkerPool, Config, Request);
+void releaseWorkers(WorkerPool, Request, bool);
+Worker getStageWorker(WorkerPool, Request, int);
+bool usesWorkers(WorkerPool, Request);
+bool startWorkerStage(WorkerStage, Worker, file_d, file_d, StageUsage);
+bool joinWorkerStage(WorkerStage);
+char* getWorkerPoolStatus(WorkerPool, Config);
+
+#endif // _WORKER_POOL_H_
@@ -0,0 +1,71 @@
+/**
+ * @file workerProtocol.h
+ * 
+ * @brief File declaring the framed protocol spoken by the persistent workers of the transformations
+ * 
+ * A worker is a long-lived process that reads jobs from its standard input and writes their outputs to its
+ * standard output, one job after the other. Every message is a frame: a #FRAME_HEADER followed by
+ * #FRAME_HEADER::length bytes of payload (integers in the byte order of the machine).
+ * 
+ * A job is sent to the worker as any number of #FRAME_DATA frames holding its input, followed by a
+ * #FRAME_END frame with no payload. The worker answers with any number of #FRAME_DATA frames holding the
+ * output, followed by a #FRAME_END frame whose payload is the exit status of the job (an int32_t, 0 on
+ * success). The worker must read the whole job, up to its #FRAME_END, even if it fails.
+ * 
+ * An executable speaking the protocol natively is started with the SDSTORE_WORKER environment variable set
+ * to the version of the protocol.
+ * 
+ * This header does not depend on the rest of the server, so that workers can be built on their own.
+ * 
+ */
+
+#ifndef _WORKER_PROTOCOL_H_
+
+/**
+ * @brief Include guard
+ */
+#define _WORKER_PROTOCOL_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The version of the protocol
+ * 
+ */
+#define WORKER_PROTOCOL_VERSION 1
+
+/**
+ * @brief The environment variable set for native workers
+ * 
+ */
+#define WORKER_ENVIRONMENT "SDSTORE_WORKER"
+
+/**
+ * @brief The maximum payload of a #FRAME_DATA frame
+ * 
+ */
+#define FRAME_MAX_DATA (64 * 1024)
+
+/**
+ * @brief A frame holding input (to the worker) or output (from the worker) of a job
+ * 
+ */
+#define FRAME_DATA 1
+
+/**
+ * @brief A frame ending the input of a job (to the worker, no payload) or the job (from the worker, with
+ * its status)
+ * 
+ */
+#define FRAME_END 2
+
+/**
+ * @brief The header of a frame
+ * 
+ */
+typedef struct frameHeader {
+    uint32_t type; ///< #FRAME_DATA or #FRAME_END
+    uint32_t length; ///< The length of the payload that follows
+} FRAME_HEADER;
+
+#endif // _WORKER_PROTOCOL_H_
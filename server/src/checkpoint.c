@@ -0,0 +1,179 @@
+/**
+ * @file checkpoint.c
+ * 
+ * @brief File implementing the journal recording the progress of a #Request run in chunks
+ * 
+ * The journal of an output file is kept next to it (with the #JOURNAL_SUFFIX suffix) while its #Request
+ * runs, and records how many chunks of the input have their output in the output file. It is saved after
+ * every #Config::checkpointInterval bytes of input (once the output is on disk), and when the #Request
+ * fails. A #Request with the same input (same version of the same file), operations and chunk size resumes
+ * from the last chunk recorded instead of the start of the input. The journal is removed once the #Request
+ * finishes.
+ * 
+ */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "config.h"
+#include "hash.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief The version of the format of the journal
+ * 
+ */
+#define JOURNAL_VERSION 1
+
+/**
+ * @brief Maximum length of a journal
+ * 
+ */
+#define JOURNAL_SIZE 256
+
+/**
+ * @brief The capacity of the path of a journal
+ * 
+ */
+#define JOURNAL_PATH_SIZE (PATH_MAX + sizeof(JOURNAL_SUFFIX))
+
+/**
+ * @brief Gets the path of the journal of a #Request, next to the file its output descriptor is open on
+ * 
+ * @param request The given #Request
+ * @param path The string to write to (of #JOURNAL_PATH_SIZE)
+ * 
+ * @return true If the path was written
+ * @return false If the path of the output is unknown
+ */
+bool getJournalPath(Request request, char* path) {
+    if(!getRequestOutputPath(request, path, PATH_MAX))
+        return false;
+    strcat(path, JOURNAL_SUFFIX);
+    return true;
+}
+
+/**
+ * @brief Prepares the #Checkpoint of a #Request about to run in chunks, resuming it from its journal if the
+ * journal matches the #Request
+ * 
+ * @param config The #Config of the server
+ * @param request The given #Request
+ * @param in The descriptor of the input file
+ * @param checkpoint The #Checkpoint to fill
+ * 
+ * @return true If the #Request resumes from the journal (#Checkpoint::chunks and #Checkpoint::written are set)
+ * @return false If the #Request starts from the beginning of its input
+ */
+bool loadCheckpoint(Config config, Request request, file_d in, Checkpoint checkpoint) {
+    struct stat st;
+    memset(checkpoint, 0, sizeof(CHECKPOINT));
+    checkpoint->chunkSize = config->chunkSize;
+    checkpoint->interval = config->checkpointInterval;
+    checkpoint->operations = 0;
+    for(int i = 0; i < request->operationCount; i++)
+        checkpoint->operations = hashBytes(request->operations[i], strlen(request->operations[i]) + 1, checkpoint->operations);
+
+    if(in < 0 || fstat(in, &st))
+        return false;
+    checkpoint->inputDevice = st.st_dev;
+    checkpoint->inputInode = st.st_ino;
+    checkpoint->inputSize = st.st_size;
+    checkpoint->inputModified = st.st_mtim;
+
+    char path[JOURNAL_PATH_SIZE];
+    char journal[JOURNAL_SIZE];
+    file_d fd = getJournalPath(request, path) ? openAsClient(request, path, O_RDONLY | O_CLOEXEC, 0) : -1;
+    if(fd < 0)
+        return false;
+    int length = read(fd, journal, JOURNAL_SIZE - 1);
+    close(fd);
+    if(length <= 0)
+        return false;
+    journal[length] = '\0';
+
+    int version, chunks;
+    unsigned long device, inode;
+    long size, seconds, nanoseconds, chunkSize, written;
+    uint64_t operations;
+    if(sscanf(journal, "sdjournal %d %lu %lu %ld %ld %ld %" SCNx64 " %ld %d %ld", &version, &device, &inode, &size,
+               &seconds, &nanoseconds, &operations, &chunkSize, &chunks, &written) != 10)
+        return false;
+
+    //The output must still hold the output of the chunks recorded
+    if(version != JOURNAL_VERSION || device != checkpoint->inputDevice || inode != checkpoint->inputInode
+     || size != checkpoint->inputSize || seconds != checkpoint->inputModified.tv_sec
+     || nanoseconds != checkpoint->inputModified.tv_nsec || operations != checkpoint->operations
+     || chunkSize != checkpoint->chunkSize || chunks <= 0 || statRequestOutput(request, &st) || st.st_size < written)
+        return false;
+
+    checkpoint->chunks = checkpoint->saved = chunks;
+    checkpoint->written = written;
+    return true;
+}
+
+/**
+ * @brief Saves the progress of a #Request to its journal, once the output it records is on disk
+ * 
+ * The journal is replaced atomically, so a crash leaves either the previous or the new checkpoint
+ * 
+ * @param request The given #Request
+ * @param checkpoint The #Checkpoint of the #Request
+ * @param out The descriptor of the output file
+ * 
+ * @return true If the journal was saved
+ * @return false If an error occurred
+ */
+bool saveCheckpoint(Request request, Checkpoint checkpoint, file_d out) {
+    char path[JOURNAL_PATH_SIZE];
+    char temporary[sizeof(path) + 16];
+    char journal[JOURNAL_SIZE];
+
+    if(fdatasync(out) || !getJournalPath(request, path))
+        return false;
+
+    int length = snprintf(journal, JOURNAL_SIZE, "sdjournal %d %lu %lu %ld %ld %ld %016" PRIx64 " %ld %d %ld\n", JOURNAL_VERSION,
+        (unsigned long)checkpoint->inputDevice, (unsigned long)checkpoint->inputInode, (long)checkpoint->inputSize,
+        (long)checkpoint->inputModified.tv_sec, checkpoint->inputModified.tv_nsec, checkpoint->operations,
+        checkpoint->chunkSize, checkpoint->chunks, (long)checkpoint->written);
+
+    //The journal is written next to the output with the permissions of the client
+    CLIENT_ACCESS access;
+    snprintf(temporary, sizeof(temporary), "%s.%d", path, getpid());
+    file_d fd = beginClientAccess(request, &access) ? open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660) : -1;
+    bool saved = fd >= 0 && write(fd, journal, length) == length && !fdatasync(fd);
+    if(fd >= 0)
+        close(fd);
+    if(fd >= 0 && (!saved || rename(temporary, path))) {
+        unlink(temporary);
+        saved = false;
+    }
+    endClientAccess(&access);
+    if(!saved)
+        return false;
+
+    checkpoint->saved = checkpoint->chunks;
+    return true;
+}
+
+/**
+ * @brief Removes the journal of a #Request that finished, or whose output is written again from the start
+ * 
+ * @param request The given #Request
+ */
+void clearCheckpoint(Request request) {
+    char path[JOURNAL_PATH_SIZE];
+    CLIENT_ACCESS access;
+    if(!getJournalPath(request, path))
+        return;
+    if(beginClientAccess(request, &access))
+        unlink(path);
+    endClientAccess(&access);
+}
@@ -0,0 +1,439 @@
+/**
+ * @file clientSocket.c
+ * 
+ * @brief File implementing the Unix domain socket served by the relay along with the FIFO
+ * 
+ * A client of the socket needs no FIFO of its own: the router answers it through its connection, which stays
+ * open for as many requests as the client sends, and the end of the answers to each #Request is marked by an
+ * empty string. Before a ::PROCESS_FILE or ::PROCESS_STREAM #Request, the client may send a ::WIRE_DESCRIPTORS
+ * frame passing its input and output files already open (SCM_RIGHTS), so that the server does not resolve
+ * their paths from its own working directory. The relay knows the process and the user behind each connection (SO_PEERCRED), and
+ * hands each #Request to the router through a socket of their own (the channel), along with the connection and
+ * the files, the pipe to the router only carrying the #Update announcing it.
+ * 
+ * The connections are read without waiting, each one buffering the frame it is receiving until it is whole, so
+ * that a client that stalls in the middle of a frame does not hold back the others. The connections and the
+ * requests the relay has room for are bounded by the descriptors a process may have open (#getClientLimit).
+ * 
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "clientSocket.h"
+#include "config.h"
+#include "logging.h"
+#include "pipeWrapper.h"
+#include "request.h"
+#include "socketWrapper.h"
+#include "update.h"
+#include "utils.h"
+#include "wire.h"
+
+/**
+ * @brief The initial number of connections the socket has room for (doubled as needed)
+ * 
+ */
+#define INITIAL_CONNECTIONS 8
+
+/**
+ * @brief A connection of a client to the socket
+ * 
+ */
+typedef struct connection {
+    file_d socket; ///< The descriptor of the connection
+    PEER peer; ///< The client at the other end
+    file_d files[MAX_PASSED_DESCRIPTORS - 1]; ///< The files passed for the next #Request
+    int fileCount; ///< The number of files passed for the next #Request
+    WIRE_HEADER header; ///< The header of the frame being received
+    char* payload; ///< The payload of the frame being received (NULL until its header is whole)
+    int received; ///< The number of bytes of the header, or of the payload once allocated, already received
+    file_d arriving[MAX_PASSED_DESCRIPTORS]; ///< The descriptors passed with the frame being received
+    int arrivingCount; ///< The number of descriptors passed with the frame being received
+} CONNECTION, * Connection;
+
+/**
+ * @brief The socket, and the connections of its clients
+ * 
+ */
+struct clientSocket {
+    char path[MAX_SOCKET_PATH_SIZE]; ///< The path of the socket
+    file_d listener; ///< The descriptor of the listening socket
+    file_d channel; ///< The socket the descriptors are passed to the router through
+    int count; ///< The number of connections
+    int capacity; ///< The number of connections there is room for
+    int limit; ///< The number of connections accepted at most (the others wait in the backlog)
+    Connection connections; ///< The connections
+};
+
+/**
+ * @brief Gets the number of clients whose descriptors a process of the server can hold at once
+ * 
+ * Each client holds up to #MAX_PASSED_DESCRIPTORS - 1 descriptors (its connection, and the input and the output
+ * files it passed). The limit of open descriptors of the process is first raised as far as allowed
+ * 
+ * @return int The number of clients (at least 1)
+ */
+int getClientLimit() {
+    struct rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit))
+        return 1;
+    if(limit.rlim_cur < limit.rlim_max) {
+        rlim_t current = limit.rlim_cur;
+        limit.rlim_cur = limit.rlim_max;
+        //The hard limit may be unlimited while the kernel still caps the descriptors of a process
+        if(setrlimit(RLIMIT_NOFILE, &limit))
+            limit.rlim_cur = current;
+    }
+
+    rlim_t clients = limit.rlim_cur > RESERVED_DESCRIPTORS
+        ? (limit.rlim_cur - RESERVED_DESCRIPTORS) / (MAX_PASSED_DESCRIPTORS - 1) : 1;
+    return (int)MAX(1, MIN(clients, (rlim_t)INT_MAX));
+}
+
+/**
+ * @brief Creates the socket at the path given by the #Config, and starts listening on it
+ * 
+ * @param config The #Config of the server
+ * @param channel The socket to pass the descriptors of the requests to the router through
+ * 
+ * @return ClientSocket The created #ClientSocket (NULL if the socket is disabled or cannot be created)
+ */
+ClientSocket newClientSocket(Config config, file_d channel) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(!config->socketPath[0])
+        return NULL;
+    strcpy(address.sun_path, config->socketPath);
+
+    //A socket left by a server that did not exit cleanly is replaced (only one server can hold the FIFO)
+    unlink(config->socketPath);
+    file_d listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address))
+     || chmod(config->socketPath, 0660) || listen(listener, SOMAXCONN)) {
+        printFormattedMessage(STDERR_FILENO, SOCKETCREATEFAILED, config->socketPath);
+        if(listener >= 0)
+            close(listener);
+        unlink(config->socketPath);
+        return NULL;
+    }
+
+    ClientSocket clients = malloc(sizeof(struct clientSocket));
+    strcpy(clients->path, config->socketPath);
+    clients->listener = listener;
+    clients->channel = channel;
+    clients->count = 0;
+    clients->capacity = INITIAL_CONNECTIONS;
+    clients->limit = getClientLimit();
+    clients->connections = malloc(sizeof(CONNECTION) * clients->capacity);
+    return clients;
+}
+
+/**
+ * @brief Closes the files passed for the next #Request of a connection
+ * 
+ * @param connection The given #Connection
+ */
+void releasePassedFiles(Connection connection) {
+    for(int i = 0; i < connection->fileCount; i++)
+        close(connection->files[i]);
+    connection->fileCount = 0;
+}
+
+/**
+ * @brief Discards the frame being received through a connection, to receive the next one
+ * 
+ * @param connection The given #Connection
+ */
+void resetFrame(Connection connection) {
+    for(int i = 0; i < connection->arrivingCount; i++)
+        close(connection->arriving[i]);
+    connection->arrivingCount = 0;
+    free(connection->payload);
+    connection->payload = NULL;
+    connection->received = 0;
+}
+
+/**
+ * @brief Closes a connection, moving the last one to its place
+ * 
+ * @param clients The given #ClientSocket
+ * @param index The index of the connection
+ */
+void closeConnection(ClientSocket clients, int index) {
+    releasePassedFiles(&clients->connections[index]);
+    resetFrame(&clients->connections[index]);
+    close(clients->connections[index].socket);
+    clients->connections[index] = clients->connections[--clients->count];
+}
+
+/**
+ * @brief Closes the socket and the connections of its clients, and removes the socket
+ * 
+ * @param clients The given #ClientSocket (NULL if the socket is disabled)
+ */
+void deleteClientSocket(ClientSocket clients) {
+    if(!clients)
+        return;
+
+    while(clients->count)
+        closeConnection(clients, 0);
+    close(clients->listener);
+    unlink(clients->path);
+    free(clients->connections);
+    free(clients);
+}
+
+/**
+ * @brief Gets the number of descriptors of the socket to poll
+ * 
+ * @param clients The given #ClientSocket (NULL if the socket is disabled)
+ * 
+ * @return int The number of descriptors (the listening socket and the connections)
+ */
+int getClientPollSize(ClientSocket clients) {
+    return clients ? 1 + clients->count : 0;
+}
+
+/**
+ * @brief Fills the entries of the descriptors of the socket to poll
+ * 
+ * @param clients The given #ClientSocket (NULL if the socket is disabled)
+ * @param polled The entries to fill (#getClientPollSize of them)
+ */
+void fillClientPoll(ClientSocket clients, struct pollfd polled[]) {
+    if(!clients)
+        return;
+
+    //Past the limit, the clients wait in the backlog of the socket until a connection is closed
+    polled[0].fd = clients->count < clients->limit ? clients->listener : -1;
+    polled[0].events = POLLIN;
+    for(int i = 0; i < clients->count; i++) {
+        polled[i + 1].fd = clients->connections[i].socket;
+        polled[i + 1].events = POLLIN;
+    }
+}
+
+/**
+ * @brief Accepts a new connection to the socket, identifying the client by its credentials
+ * 
+ * @param clients The given #ClientSocket
+ */
+void acceptClient(ClientSocket clients) {
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    file_d fd = accept4(clients->listener, NULL, NULL, SOCK_CLOEXEC);
+    if(fd < 0)
+        return;
+    if(getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length)) {
+        close(fd);
+        return;
+    }
+
+    if(clients->count == clients->capacity) {
+        clients->capacity *= 2;
+        clients->connections = realloc(clients->connections, sizeof(CONNECTION) * clients->capacity);
+    }
+
+    Connection connection = &clients->connections[clients->count++];
+    connection->socket = fd;
+    connection->peer.pid = credentials.pid;
+    connection->peer.uid = credentials.uid;
+    connection->peer.gid = credentials.gid;
+    connection->peer.descriptors = 0;
+    connection->fileCount = 0;
+    connection->payload = NULL;
+    connection->received = 0;
+    connection->arrivingCount = 0;
+    printFormattedMessage(STDERR_FILENO, CLIENTCONNECTED, credentials.pid, credentials.uid);
+}
+
+/**
+ * @brief Forwards a #Request received through a connection to the router, passing it the connection to
+ * answer through and the files passed for the #Request
+ * 
+ * @param clients The given #ClientSocket
+ * @param connection The connection the #Request came through
+ * @param header The #WireHeader of the frame of the #Request
+ * @param payload The payload of the frame (already checked)
+ * @param pw The #PipeWritter to the router
+ */
+void forwardClientRequest(ClientSocket clients, Connection connection, WireHeader header, char* payload, PipeWritter pw) {
+    file_d passed[MAX_PASSED_DESCRIPTORS];
+    PEER peer = connection->peer;
+
+    passed[0] = connection->socket;
+    memcpy(passed + 1, connection->files, sizeof(file_d) * connection->fileCount);
+    peer.descriptors = 1 + connection->fileCount;
+
+    if(!forwardRequest(pw, clients->channel, header, payload, &peer, passed))
+        printMessage(STDERR_FILENO, WRITEFAILED);
+}
+
+/**
+ * @brief Handles a frame whole received through a connection: keeps the files passed for the next #Request, or
+ * forwards the #Request to the router
+ * 
+ * @param clients The given #ClientSocket
+ * @param connection The given connection
+ * @param pw The #PipeWritter to the router
+ * 
+ * @return true If the connection is still usable
+ * @return false If the client sent something that is not a frame
+ */
+bool handleFrame(ClientSocket clients, Connection connection, PipeWritter pw) {
+    WireHeader header = &connection->header;
+
+    //The descriptors are only expected with the frame passing them, for the next request
+    if(header->kind == WIRE_DESCRIPTORS && connection->arrivingCount < MAX_PASSED_DESCRIPTORS) {
+        releasePassedFiles(connection);
+        memcpy(connection->files, connection->arriving, sizeof(file_d) * connection->arrivingCount);
+        connection->fileCount = connection->arrivingCount;
+        connection->arrivingCount = 0;
+        resetFrame(connection);
+        return true;
+    }
+
+    bool valid = header->kind == WIRE_REQUEST && checkRequestFrame(connection->payload, header->length);
+    if(!valid) {
+        printMessage(STDERR_FILENO, INVALIDFRAME);
+    } else {
+        printMessage(STDOUT_FILENO, REQUESTRECEIVED);
+        forwardClientRequest(clients, connection, header, connection->payload, pw);
+    }
+
+    releasePassedFiles(connection);
+    resetFrame(connection);
+    return valid;
+}
+
+/**
+ * @brief Receives what a connection sent since it was last served, without waiting for the rest of a frame,
+ * and handles the frames made whole
+ * 
+ * At most one #Request is forwarded per call, so that a client flooding its connection does not hold back
+ * the others
+ * 
+ * @param clients The given #ClientSocket
+ * @param connection The given connection
+ * @param pw The #PipeWritter to the router
+ * 
+ * @return true If the connection is still usable
+ * @return false If the client closed it, or sent something that is not a frame
+ */
+bool serveConnection(ClientSocket clients, Connection connection, PipeWritter pw) {
+    while(true) {
+        bool header = !connection->payload;
+        char* buffer = header ? (char*)&connection->header : connection->payload;
+        int length = header ? (int)sizeof(WIRE_HEADER) : (int)connection->header.length;
+
+        if(connection->received < length) {
+            int received = receiveAvailable(connection->socket, buffer + connection->received,
+                length - connection->received, connection->arriving, &connection->arrivingCount, false);
+            if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return true;
+            if(received <= 0)
+                return false;
+            connection->received += received;
+            if(connection->received < length)
+                continue;
+        }
+
+        //Unlike the FIFO, a connection has a single writer, so a frame that cannot be read ends it
+        if(header && (!checkWireHeader(&connection->header)
+         || (connection->header.kind == WIRE_DESCRIPTORS && connection->header.length))) {
+            printMessage(STDERR_FILENO, INVALIDFRAME);
+            return false;
+        }
+        if(header && connection->header.kind != WIRE_DESCRIPTORS) {
+            connection->payload = malloc(connection->header.length + 1);
+            connection->received = 0;
+            continue;
+        }
+
+        bool request = connection->header.kind == WIRE_REQUEST;
+        if(!handleFrame(clients, connection, pw))
+            return false;
+        if(request)
+            return true;
+    }
+}
+
+/**
+ * @brief Serves the descriptors of the socket found ready by a poll: reads the frames sent through the
+ * connections, closes those the clients closed, and accepts the new ones
+ * 
+ * @param clients The given #ClientSocket (NULL if the socket is disabled)
+ * @param polled The entries filled by #fillClientPoll, after the poll
+ * @param pw The #PipeWritter to the router
+ */
+void serveClients(ClientSocket clients, struct pollfd polled[], PipeWritter pw) {
+    if(!clients)
+        return;
+
+    //Backwards, so that the connection moved to the place of a closed one was already served
+    for(int i = clients->count - 1; i >= 0; i--)
+        if(polled[i + 1].revents && !serveConnection(clients, &clients->connections[i], pw))
+            closeConnection(clients, i);
+
+    if(polled[0].revents & POLLIN)
+        acceptClient(clients);
+}
+
+/**
+ * @brief Receives the #Request announced by a ::U_REQUEST #Update from the channel, along with the client that
+ * sent it and the descriptors passed with it (see forwardRequest)
+ * 
+ * For a client of the socket, the first descriptor is the connection to answer the client through, followed by
+ * the input and the output files, if the client passed them
+ * 
+ * @param channel The socket the requests are passed through by the relay
+ * @param peer The variable to write the client that sent the #Request to
+ * 
+ * @return Request The #Request, with its descriptors and client set (#Request::senderFD is -1 for a client of the FIFO)
+ * @return NULL If the channel was closed
+ */
+Request receiveRequest(file_d channel, Peer peer) {
+    file_d fds[MAX_PASSED_DESCRIPTORS];
+    WIRE_HEADER header;
+    char* payload = NULL;
+    int count;
+
+    if(!receiveDescriptors(channel, peer, sizeof(PEER), fds, &count))
+        return NULL;
+
+    //The frame was checked by the relay
+    Request request = NULL;
+    if(readSocket(channel, &header, sizeof(WIRE_HEADER)) && header.length <= WIRE_MAX_SIZE
+     && (payload = malloc(header.length)) && readSocket(channel, payload, header.length))
+        request = decodeRequest(payload, header.length);
+    free(payload);
+    if(!request) {
+        printMessage(STDERR_FILENO, INVALIDFRAME);
+        for(int i = 0; i < count; i++)
+            close(fds[i]);
+        return NULL;
+    }
+
+    if(count)
+        request->senderFD = fds[0];
+    //The paths named by a client of the socket are opened with the permissions of its user (see openAsClient)
+    request->clientPid = peer->pid;
+    request->clientUid = peer->uid;
+    request->clientGid = peer->gid;
+    if(count == 3) {
+        request->inputFD = fds[1];
+        request->outputFD = fds[2];
+    } else {
+        for(int i = 1; i < count; i++)
+            close(fds[i]);
+    }
+
+    return request;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file coalescer.c
+ * 
+ * @brief File implementing the coalescing of identical requests
+ * 
+ * A #Request whose input file (device, inode, size and last modification) and operations are the same as
+ * those of a #Request already running, or queued with at least its priority, is not scheduled: it is attached
+ * to that #Request, its leader, and gets a copy of the output of the leader once it finishes. Only the leader
+ * uses instances of the transformations. If the leader fails, the #Request attached to it are scheduled on
+ * their own.
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "coalescer.h"
+#include "config.h"
+#include "digest.h"
+#include "fileCopy.h"
+#include "logging.h"
+#include "request.h"
+#include "resultCache.h"
+#include "update.h"
+#include "utils.h"
+
+/**
+ * @brief Maximum length of the coalescing status line
+ * 
+ */
+#define COALESCER_LINE_SIZE 128
+
+/**
+ * @brief The number of requests attached to identical ones since the server started
+ * 
+ */
+struct coalescer {
+    long attached; ///< The number of requests attached to a leader
+    long copied; ///< The number of attached requests whose output was copied
+    long copiedBytes; ///< The number of bytes copied to the outputs of attached requests
+};
+
+/**
+ * @brief Creates a new #Coalescer
+ * 
+ * @param config The server #Config
+ * 
+ * @return Coalescer The created #Coalescer
+ * @return NULL If coalescing is disabled
+ */
+Coalescer newCoalescer(Config config) {
+    if(!config->coalesce)
+        return NULL;
+
+    return calloc(1, sizeof(struct coalescer));
+}
+
+/**
+ * @brief Frees the memory allocated to a #Coalescer
+ * 
+ * @param coalescer The given #Coalescer
+ */
+void deleteCoalescer(Coalescer coalescer) {
+    free(coalescer);
+}
+
+/**
+ * @brief Records the identity of the input file of a #Request
+ * 
+ * @param request The given #Request
+ * 
+ * @return true If the input file is a regular file
+ * @return false If it cannot be accessed or is streamed (the #Request is never coalesced)
+ */
+bool identifyInput(Request request) {
+    struct stat st;
+
+    if(isStreamRequest(request) || statRequestInput(request, &st) || !S_ISREG(st.st_mode)) {
+        request->inputInode = 0;
+        return false;
+    }
+
+    request->inputDevice = st.st_dev;
+    request->inputInode = st.st_ino;
+    request->inputModified = st.st_mtim;
+    request->inputSize = st.st_size;
+    return true;
+}
+
+/**
+ * @brief Checks if two #Request produce the same output
+ * 
+ * @param a The first #Request
+ * @param b The second #Request
+ * 
+ * @return true If they read the same version of the same file and apply the same operations to it
+ * @return false Otherwise (a #Request with branches is never identical to another one)
+ */
+bool isIdentical(Request a, Request b) {
+    if(a->inputInode != b->inputInode || a->inputDevice != b->inputDevice || a->inputSize != b->inputSize
+     || a->inputModified.tv_sec != b->inputModified.tv_sec || a->inputModified.tv_nsec != b->inputModified.tv_nsec
+     || a->operationCount != b->operationCount || a->branchCount || b->branchCount)
+        return false;
+
+    for(int i = 0; i < a->operationCount; i++)
+        if(strcmp(a->operations[i], b->operations[i]))
+            return false;
+
+    return true;
+}
+
+/**
+ * @brief Attaches a #Request that has just arrived to an identical #Request already in the server, if any
+ * 
+ * Sets the #leader of the #Request (-1 if it was not attached)
+ * 
+ * @param coalescer The given #Coalescer
+ * @param requests The list of all #Request in the server
+ * @param requestCount The number of #Request in the list
+ * @param request The #Request that has just arrived (already in the list)
+ * 
+ * @return true If the #Request was attached and must not be scheduled
+ * @return false If the #Request has to run
+ */
+bool attachRequest(Coalescer coalescer, Request* requests, int requestCount, Request request) {
+    request->leader = -1;
+    if(!coalescer || !identifyInput(request))
+        return false;
+
+    for(int i = 0; i < requestCount; i++) {
+        Request r = requests[i];
+        //A queued request only takes along requests that would not have been dispatched before it
+        if(r && r != request && r->leader < 0 && r->inputInode && (r->running || r->priority >= request->priority)
+         && isIdentical(r, request)) {
+            request->leader = r->timeOfArrival;
+            coalescer->attached++;
+            printFormattedMessage(STDERR_FILENO, REQUESTCOALESCED, r->timeOfArrival);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Copies the output of a finished #Request to the output of a #Request attached to it, and notifies
+ * the router
+ * 
+ * Called in a process forked by the router once the leader has finished
+ * 
+ * @param follower The attached #Request
+ * @param leader The finished #Request
+ * @param summary The #OutputSummary of the leader, which is also that of the copy
+ * @param fifo The descriptor of the pipe to the router
+ */
+void copyOutput(Request follower, Request leader, OutputSummary summary, file_d fifo) {
+    struct stat source, destination;
+    bool copied = true;
+    file_d in = reopenRequestOutput(leader);
+
+    if(in < 0) {
+        printMessage(STDERR_FILENO, CANTOPENINPUTFILE);
+        copied = false;
+    } else if(statRequestOutput(follower, &destination) || fstat(in, &source) || source.st_dev != destination.st_dev || source.st_ino != destination.st_ino) {
+        //Both requests may have asked for the same output file, which already holds the result
+        file_d out = openRequestOutput(follower, true);
+        copied = out >= 0 && copyFile(in, out);
+        if(!copied)
+            printMessage(STDERR_FILENO, CANTOPENOUTPUTFILE);
+        if(out >= 0)
+            close(out);
+    }
+    if(in >= 0)
+        close(in);
+
+    PIPE_WRITTER pw;
+    UPDATE update;
+    initPipeWritter(&pw, fifo);
+    memset(&update.cache, 0, sizeof(update.cache));
+    update.cache.status = CACHE_UNUSED;
+    update.summary = *summary;
+    update.requestId = follower->timeOfArrival;
+    update.failed = !copied;
+    update.type = U_REQUEST_FINISHED;
+    writeUpdate(&pw, &update);
+}
+
+/**
+ * @brief Accounts for an attached #Request whose output was copied
+ * 
+ * @param coalescer The given #Coalescer
+ * @param summary The #OutputSummary of the attached #Request
+ */
+void followerFinished(Coalescer coalescer, OutputSummary summary) {
+    coalescer->copied++;
+    if(summary->outputBytes > 0)
+        coalescer->copiedBytes += summary->outputBytes;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the coalescing of identical requests
+ * 
+ * @param coalescer The given #Coalescer
+ * 
+ * @return char* The coalescing status string
+ */
+char* getCoalescerStatus(Coalescer coalescer) {
+    char* result = malloc(COALESCER_LINE_SIZE);
+    *result = '\0';
+
+    if(coalescer)
+        snprintf(result, COALESCER_LINE_SIZE, "coalescing: %ld requests attached, %ld outputs copied (%ld KiB)\n",
+            coalescer->attached, coalescer->copied, coalescer->copiedBytes / 1024);
+
+    return result;
+}
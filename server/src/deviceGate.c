@@ -0,0 +1,201 @@
+/**
+ * @file deviceGate.c
+ * 
+ * @brief File implementing the limit on the number of running requests using each storage device
+ * 
+ * A #Request is only handed to the #RequestSorter once every device holding its input and output has
+ * capacity for it, so that pipelines competing for the same (spinning) device run one after another while
+ * work on different devices runs in parallel.
+ * 
+ */
+
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "config.h"
+#include "deviceGate.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief Maximum length of the status line of a single device
+ * 
+ */
+#define DEVICE_LINE_SIZE 64
+
+/**
+ * @brief The usage of a single device
+ * 
+ */
+typedef struct deviceUsage {
+    dev_t device; ///< The device
+    int running; ///< The number of admitted requests using the device
+    int limit; ///< The maximum number of admitted requests using the device (0 for no limit)
+} DEVICE_USAGE, * DeviceUsage;
+
+/**
+ * @brief The usage of every device used by a #Request since the server started
+ * 
+ */
+struct deviceGate {
+    Config config; ///< The server #Config
+    DEVICE_USAGE* devices; ///< The usage of each device
+    int deviceCount; ///< The number of devices
+};
+
+/**
+ * @brief Creates a new #DeviceGate
+ * 
+ * @param config The server #Config
+ * 
+ * @return DeviceGate The created #DeviceGate
+ */
+DeviceGate newDeviceGate(Config config) {
+    DeviceGate gate = malloc(sizeof(struct deviceGate));
+    gate->config = config;
+    gate->devices = NULL;
+    gate->deviceCount = 0;
+    return gate;
+}
+
+/**
+ * @brief Frees the memory allocated to a #DeviceGate
+ * 
+ * @param gate The given #DeviceGate
+ */
+void deleteDeviceGate(DeviceGate gate) {
+    free(gate->devices);
+    free(gate);
+}
+
+/**
+ * @brief Determines the devices holding the input and output files of a #Request
+ * 
+ * If the output file does not exist yet, the device of the directory it will be created in is used
+ * 
+ * @param request The given #Request
+ */
+void identifyDevices(Request request) {
+    struct stat st;
+
+    //The standard streams of a client are not files of a device
+    if(isStreamRequest(request)) {
+        request->inputDevice = request->outputDevice = NO_DEVICE;
+        return;
+    }
+
+    request->inputDevice = statRequestInput(request, &st) ? NO_DEVICE : st.st_dev;
+
+    //An output passed by a client of the socket always exists
+    if(!statRequestOutput(request, &st)) {
+        request->outputDevice = st.st_dev;
+    } else {
+        char path[strlen(request->outputFile) + 1];
+        strcpy(path, request->outputFile);
+        request->outputDevice = stat(dirname(path), &st) ? NO_DEVICE : st.st_dev;
+    }
+}
+
+/**
+ * @brief Gets the usage of a device, adding it to the #DeviceGate if it was never used
+ * 
+ * @param gate The given #DeviceGate
+ * @param device The given device
+ * 
+ * @return DeviceUsage The usage of the device
+ */
+DeviceUsage getDeviceUsage(DeviceGate gate, dev_t device) {
+    for(int i = 0; i < gate->deviceCount; i++)
+        if(gate->devices[i].device == device)
+            return &gate->devices[i];
+
+    gate->devices = realloc(gate->devices, sizeof(DEVICE_USAGE) * ++gate->deviceCount);
+    DeviceUsage usage = &gate->devices[gate->deviceCount - 1];
+    usage->device = device;
+    usage->running = 0;
+    usage->limit = getDeviceLimit(gate->config, device);
+    return usage;
+}
+
+/**
+ * @brief Checks if a device can take one more #Request
+ * 
+ * @param gate The given #DeviceGate
+ * @param device The given device
+ * 
+ * @return true If the device has capacity (or its usage is not limited)
+ * @return false If the device is at its limit
+ */
+bool hasCapacity(DeviceGate gate, dev_t device) {
+    if(device == NO_DEVICE)
+        return true;
+
+    DeviceUsage usage = getDeviceUsage(gate, device);
+    return !usage->limit || usage->running < usage->limit;
+}
+
+/**
+ * @brief Reserves the devices used by a #Request, if all of them have capacity for it
+ * 
+ * A #Request reading and writing to the same device counts only once towards its limit
+ * 
+ * @param gate The given #DeviceGate
+ * @param request The given #Request
+ * 
+ * @return true If the devices were reserved
+ * @return false If one of the devices is at its limit (nothing is reserved)
+ */
+bool acquireDevices(DeviceGate gate, Request request) {
+    if(!hasCapacity(gate, request->inputDevice) || !hasCapacity(gate, request->outputDevice))
+        return false;
+
+    if(request->inputDevice != NO_DEVICE)
+        getDeviceUsage(gate, request->inputDevice)->running++;
+    if(request->outputDevice != NO_DEVICE && request->outputDevice != request->inputDevice)
+        getDeviceUsage(gate, request->outputDevice)->running++;
+
+    return true;
+}
+
+/**
+ * @brief Releases the devices reserved by a #Request
+ * 
+ * @param gate The given #DeviceGate
+ * @param request The given #Request
+ */
+void releaseDevices(DeviceGate gate, Request request) {
+    if(request->inputDevice != NO_DEVICE)
+        getDeviceUsage(gate, request->inputDevice)->running--;
+    if(request->outputDevice != NO_DEVICE && request->outputDevice != request->inputDevice)
+        getDeviceUsage(gate, request->outputDevice)->running--;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the usage of each device
+ * 
+ * @param gate The given #DeviceGate
+ * 
+ * @return char* The device status string
+ */
+char* getDeviceStatus(DeviceGate gate) {
+    char* result = malloc(DEVICE_LINE_SIZE * gate->deviceCount + 1);
+    int length = 0;
+    *result = '\0';
+
+    for(int i = 0; i < gate->deviceCount; i++) {
+        DeviceUsage usage = &gate->devices[i];
+
+        if(usage->limit)
+            length += snprintf(result + length, DEVICE_LINE_SIZE, "device %u:%u: %d/%d (running/max)\n",
+                major(usage->device), minor(usage->device), usage->running, usage->limit);
+        else
+            length += snprintf(result + length, DEVICE_LINE_SIZE, "device %u:%u: %d (running)\n",
+                major(usage->device), minor(usage->device), usage->running);
+    }
+
+    return result;
+}
@@ -0,0 +1,344 @@
+/**
+ * @file digest.c
+ * 
+ * @brief File implementing the digest of the output of a #Request as it is written, and the summary of its
+ * files sent to the router
+ * 
+ * When the config file asks for an output digest, the last stage of the pipeline writes to a pipe read by a
+ * thread of the job handler instead of to the output file. The thread duplicates the data to a private pipe
+ * (tee), moves it to the output file (splice) and only reads the duplicate to digest it, so the output is
+ * digested without being read back from the file once it is complete.
+ * 
+ * The input hashed for the result cache on its way to the first stage goes the other way: the file is moved to
+ * the pipe of the stage by the kernel (splice), and the same range is read from the page cache to be hashed.
+ * 
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "digest.h"
+#include "hash.h"
+#include "pump.h"
+#include "utils.h"
+
+/**
+ * @brief The size of the buffer of a digest stage
+ * 
+ */
+#define DIGEST_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * @brief The reversed Castagnoli polynomial of CRC32C
+ * 
+ */
+#define CRC32C_POLYNOMIAL 0x82F63B78
+
+/**
+ * @brief The CRC32C of each byte, used when the CPU has no CRC32 instruction
+ * 
+ */
+uint32_t crc32cTable[256];
+
+/**
+ * @brief Fills #crc32cTable, once
+ * 
+ */
+void initCrc32cTable() {
+    if(crc32cTable[1])
+        return;
+
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for(int k = 0; k < 8; k++)
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        crc32cTable[i] = crc;
+    }
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief Updates a CRC32C register with the CRC32 instruction of SSE4.2, 8 bytes at a time
+ * 
+ * @param crc The register
+ * @param p The data
+ * @param length The length of the data
+ * 
+ * @return uint32_t The new register
+ */
+__attribute__((target("sse4.2")))
+uint32_t updateCrc32cHardware(uint32_t crc, const unsigned char* p, size_t length) {
+    uint64_t wide = crc;
+
+    for(; length >= sizeof(uint64_t); p += sizeof(uint64_t), length -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        wide = __builtin_ia32_crc32di(wide, word);
+    }
+
+    crc = wide;
+    while(length--)
+        crc = __builtin_ia32_crc32qi(crc, *p++);
+    return crc;
+}
+#endif
+
+/**
+ * @brief Computes the CRC32C of data following other data
+ * 
+ * @param crc The CRC32C of the data before (0 for none)
+ * @param data The data
+ * @param length The length of the data
+ * 
+ * @return uint32_t The CRC32C of both
+ */
+uint32_t updateCrc32c(uint32_t crc, const void* data, size_t length) {
+    const unsigned char* p = data;
+    crc = ~crc;
+
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("sse4.2"))
+        return ~updateCrc32cHardware(crc, p, length);
+#endif
+
+    initCrc32cTable();
+    while(length--)
+        crc = (crc >> 8) ^ crc32cTable[(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+/**
+ * @brief Prepares a digest stage to digest data
+ * 
+ * @param stage The #DigestStage to fill
+ * @param type The digest to compute (not ::DIGEST_NONE)
+ */
+void initDigest(DigestStage stage, DigestType type) {
+    stage->type = type;
+    stage->ok = true;
+    stage->bytes = 0;
+    stage->crc = 0;
+    initHash(&stage->hash, 0);
+    if(type == DIGEST_CRC32C)
+        initCrc32cTable();
+}
+
+/**
+ * @brief Digests data following the data already digested by a digest stage
+ * 
+ * @param stage The given #DigestStage
+ * @param data The data
+ * @param length The length of the data
+ */
+void updateDigest(DigestStage stage, const void* data, size_t length) {
+    if(stage->type == DIGEST_CRC32C)
+        stage->crc = updateCrc32c(stage->crc, data, length);
+    else
+        updateHash(&stage->hash, data, length);
+    stage->bytes += length;
+}
+
+/**
+ * @brief Digests a range of a file following the data already digested by a digest stage
+ * 
+ * Used where the output is not written by a digest stage (copied from the result cache, or appended by the
+ * chunks of a #Request). The digest becomes unavailable if the range cannot be read
+ * 
+ * @param stage The given #DigestStage
+ * @param fd The descriptor of the file (opened for reading)
+ * @param offset The offset of the range
+ * @param length The length of the range
+ */
+void digestRange(DigestStage stage, file_d fd, off_t offset, off_t length) {
+    char* buffer = malloc(DIGEST_BUFFER_SIZE);
+
+    while(stage->ok && length > 0) {
+        ssize_t bytes = pread(fd, buffer, MIN(length, DIGEST_BUFFER_SIZE), offset);
+        if(bytes < 0 && errno == EINTR)
+            continue;
+
+        stage->ok = bytes > 0;
+        if(stage->ok) {
+            updateDigest(stage, buffer, bytes);
+            offset += bytes;
+            length -= bytes;
+        }
+    }
+
+    free(buffer);
+}
+
+/**
+ * @brief Records the digest computed by a digest stage
+ * 
+ * @param stage The given #DigestStage
+ * @param summary The #OutputSummary to write to (its digest is ::DIGEST_UNAVAILABLE if some data could not
+ * be digested)
+ */
+void finishDigest(DigestStage stage, OutputSummary summary) {
+    summary->digestType = stage->ok ? stage->type : DIGEST_UNAVAILABLE;
+    summary->digest = stage->type == DIGEST_CRC32C ? stage->crc : digestHash(&stage->hash);
+}
+
+/**
+ * @brief Main function of the thread of a digest stage
+ * 
+ * @param arg The #DigestStage to run
+ * 
+ * @return void* NULL
+ */
+void* runDigest(void* arg) {
+    DigestStage stage = arg;
+    struct stat st;
+    file_d copy[2];
+
+    //A write to a pipe whose reader is gone must fail instead of killing the job handler
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    //The data is moved to the output by the kernel unless it comes from a file or the output cannot be spliced to
+    bool spliced = !fstat(stage->in, &st) && S_ISFIFO(st.st_mode)
+                && !fstat(stage->out, &st) && (S_ISREG(st.st_mode) || S_ISFIFO(st.st_mode))
+                && !(fcntl(stage->out, F_GETFL) & (O_DIRECT | O_APPEND)) && !pipe2(copy, O_CLOEXEC);
+    if(spliced)
+        fcntl(copy[1], F_SETPIPE_SZ, DIGEST_BUFFER_SIZE);
+
+    //A file moved to a pipe is spliced from its offset, and that range read back to be digested
+    loff_t offset = 0;
+    bool fromFile = !spliced && !fstat(stage->in, &st) && S_ISREG(st.st_mode)
+                 && !fstat(stage->out, &st) && S_ISFIFO(st.st_mode);
+
+    char* buffer = malloc(DIGEST_BUFFER_SIZE);
+    ssize_t length;
+    stage->ok = true;
+
+    while(stage->ok) {
+        if(spliced)
+            length = tee(stage->in, copy[1], DIGEST_BUFFER_SIZE, 0);
+        else if(fromFile)
+            length = splice(stage->in, &offset, stage->out, NULL, DIGEST_BUFFER_SIZE, 0);
+        else
+            length = read(stage->in, buffer, DIGEST_BUFFER_SIZE);
+        if(length < 0 && errno == EINTR)
+            continue;
+        if(length <= 0) {
+            stage->ok = !length;
+            break;
+        }
+
+        if(spliced)
+            stage->ok = moveFromPipe(stage->in, stage->out, length) && fillBuffer(copy[0], buffer, length) == length;
+        else if(fromFile)
+            stage->ok = pread(stage->in, buffer, length, offset - length) == length;
+        else
+            stage->ok = writeBuffer(stage->out, buffer, length);
+
+        updateDigest(stage, buffer, length);
+    }
+
+    if(spliced) {
+        close(copy[0]);
+        close(copy[1]);
+    }
+    free(buffer);
+    close(stage->in);
+    close(stage->out);
+    return NULL;
+}
+
+/**
+ * @brief Starts the thread of a digest stage
+ * 
+ * Must only be called once every process of the pipeline has been forked, since the thread owns the
+ * descriptors of the stage
+ * 
+ * @param stage The #DigestStage to fill
+ * @param type The digest to compute (not ::DIGEST_NONE)
+ * @param in The read end of the pipe the output comes from (closed by the thread)
+ * @param out The output file (closed by the thread)
+ * 
+ * @return true If the thread was started
+ * @return false If it could not be started (the descriptors are closed, and joining it reports a failure)
+ */
+bool startDigestStage(DigestStage stage, DigestType type, file_d in, file_d out) {
+    initDigest(stage, type);
+    stage->in = in;
+    stage->out = out;
+    stage->ok = false;
+
+    stage->running = !pthread_create(&stage->thread, NULL, runDigest, stage);
+    if(!stage->running) {
+        close(in);
+        close(out);
+    }
+
+    return stage->running;
+}
+
+/**
+ * @brief Waits for the thread of a digest stage to finish, and records the size and digest of the output
+ * 
+ * @param stage The given #DigestStage
+ * @param summary The #OutputSummary to write to
+ * 
+ * @return true If the whole output was written
+ * @return false Otherwise
+ */
+bool joinDigestStage(DigestStage stage, OutputSummary summary) {
+    if(stage->running)
+        pthread_join(stage->thread, NULL);
+
+    summary->outputBytes = stage->bytes;
+    finishDigest(stage, summary);
+    return stage->ok;
+}
+
+/**
+ * @brief Records the sizes of the files of a #Request from their descriptors, without a digest
+ * 
+ * Only a regular file has a size: a pipe or a device (a stream) is reported as unknown
+ * 
+ * @param summary The #OutputSummary to write to
+ * @param in The descriptor of the input file (-1 if it could not be opened)
+ * @param out The descriptor of the output file (-1 if it could not be opened)
+ */
+void summarizeFiles(OutputSummary summary, file_d in, file_d out) {
+    struct stat st;
+
+    summary->inputBytes = in >= 0 && !fstat(in, &st) && S_ISREG(st.st_mode) ? st.st_size : -1;
+    summary->outputBytes = out >= 0 && !fstat(out, &st) && S_ISREG(st.st_mode) ? st.st_size : -1;
+    summary->digestType = DIGEST_NONE;
+    summary->digest = 0;
+}
+
+/**
+ * @brief Writes the digest of an #OutputSummary, as ", <type>: <hexadecimal value>" (or ", digest: unavailable")
+ * 
+ * @param summary The given #OutputSummary
+ * @param str The string to write to
+ * @param size The size of the string
+ * 
+ * @return int The length written (0 if there is no digest)
+ */
+int formatDigest(OutputSummary summary, char* str, int size) {
+    switch(summary->digestType) {
+        case DIGEST_CRC32C:
+            return snprintf(str, size, ", crc32c: %08x", (uint32_t)summary->digest);
+        case DIGEST_XXH64:
+            return snprintf(str, size, ", xxh64: %016lx", (unsigned long)summary->digest);
+        case DIGEST_UNAVAILABLE:
+            return snprintf(str, size, ", digest: unavailable");
+        default:
+            *str = '\0';
+            return 0;
+    }
+}
@@ -0,0 +1,213 @@
+/**
+ * @file fileCopy.c
+ * 
+ * @brief File implementing the copy of the contents of a file to another one
+ * 
+ * The copy is done by the kernel, without the data going through the server: the destination shares
+ * the blocks of the source if the file system supports it (reflink), or the data is copied with
+ * copy_file_range, or moved through a pipe with splice when the two files are on file systems that
+ * copy_file_range cannot copy between. pread / pwrite is only used if none of them is possible.
+ * 
+ * Only the extents of the source holding data (SEEK_DATA / SEEK_HOLE) are copied, so the holes of a
+ * sparse file stay holes in the destination.
+ * 
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fileCopy.h"
+#include "utils.h"
+
+/**
+ * @brief The size of the buffer used when the kernel cannot copy the file
+ * 
+ */
+#define COPY_BUFFER_SIZE 65536
+
+/**
+ * @brief The maximum number of bytes moved by a single call to splice or copy_file_range
+ * 
+ */
+#define COPY_CHUNK_SIZE (1L << 30)
+
+/**
+ * @brief Copies a range of a file with pread / pwrite
+ * 
+ * @param in The descriptor of the source
+ * @param inOffset The offset of the range in the source
+ * @param out The descriptor of the destination
+ * @param outOffset The offset to copy the range to in the destination
+ * @param length The length of the range
+ * 
+ * @return true If the range was copied
+ * @return false If an error occurred
+ */
+bool copyWithBuffer(file_d in, off_t inOffset, file_d out, off_t outOffset, off_t length) {
+    char buffer[COPY_BUFFER_SIZE];
+
+    while(length > 0) {
+        ssize_t bytesRead = pread(in, buffer, MIN(length, COPY_BUFFER_SIZE), inOffset);
+        if(bytesRead <= 0)
+            return bytesRead == 0;
+
+        for(ssize_t written = 0, n; written < bytesRead; written += n)
+            if((n = pwrite(out, buffer + written, bytesRead - written, outOffset + written)) < 0)
+                return false;
+
+        inOffset += bytesRead;
+        outOffset += bytesRead;
+        length -= bytesRead;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies a range of a file by moving it through a pipe with splice
+ * 
+ * @param in The descriptor of the source
+ * @param inOffset The offset of the range in the source
+ * @param out The descriptor of the destination
+ * @param outOffset The offset to copy the range to in the destination
+ * @param length The length of the range
+ * 
+ * @return true If the range was copied
+ * @return false If an error occurred
+ */
+bool copyWithSplice(file_d in, loff_t inOffset, file_d out, loff_t outOffset, off_t length) {
+    file_d fd[2];
+    if(pipe2(fd, O_CLOEXEC))
+        return copyWithBuffer(in, inOffset, out, outOffset, length);
+
+    bool result = true;
+
+    while(result && length > 0) {
+        ssize_t moved = splice(in, &inOffset, fd[1], NULL, MIN(length, COPY_CHUNK_SIZE), SPLICE_F_MOVE);
+        if(moved <= 0) {
+            //Nothing was left in the pipe, so the rest of the range can be copied by other means
+            result = moved == 0 || copyWithBuffer(in, inOffset, out, outOffset, length);
+            break;
+        }
+
+        length -= moved;
+        while(result && moved > 0) {
+            ssize_t written = splice(fd[0], NULL, out, &outOffset, moved, SPLICE_F_MOVE);
+            result = written > 0;
+            moved -= written;
+        }
+    }
+
+    close(fd[0]);
+    close(fd[1]);
+    return result;
+}
+
+/**
+ * @brief Copies a range of a file with copy_file_range, falling back to splice
+ * 
+ * @param in The descriptor of the source
+ * @param inOffset The offset of the range in the source
+ * @param out The descriptor of the destination
+ * @param outOffset The offset to copy the range to in the destination
+ * @param length The length of the range
+ * 
+ * @return true If the range was copied
+ * @return false If an error occurred
+ */
+bool copyFileRange(file_d in, loff_t inOffset, file_d out, loff_t outOffset, off_t length) {
+    while(length > 0) {
+        ssize_t copied = copy_file_range(in, &inOffset, out, &outOffset, MIN(length, COPY_CHUNK_SIZE), 0);
+        if(copied == 0)
+            return true;
+        if(copied < 0) {
+            if(errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP && errno != ENOSYS)
+                return false;
+            return copyWithSplice(in, inOffset, out, outOffset, length);
+        }
+        length -= copied;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Moves the data of a stream to a file, from where the stream stands until its end
+ * 
+ * The data is spliced without being copied when either end is a pipe, and read and written otherwise
+ * 
+ * @param in The descriptor of the stream
+ * @param out The descriptor of the destination (opened for writing)
+ * 
+ * @return true If the whole stream was moved
+ * @return false If an error occurred
+ */
+bool copyStream(file_d in, file_d out) {
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t moved;
+
+    while((moved = splice(in, NULL, out, NULL, COPY_CHUNK_SIZE, SPLICE_F_MOVE)) > 0);
+    if(moved == 0 || errno != EINVAL)
+        return moved == 0;
+
+    while((moved = read(in, buffer, sizeof(buffer))) > 0)
+        for(ssize_t written = 0, n; written < moved; written += n)
+            if((n = write(out, buffer + written, moved - written)) < 0)
+                return false;
+
+    return moved == 0;
+}
+
+/**
+ * @brief Copies the contents of a file to another one
+ * 
+ * The source is copied from its start and the destination must be empty. The offsets of the
+ * descriptors are not used, unless the source is a stream (a pipe or a device), which has no start
+ * 
+ * @param in The descriptor of the source
+ * @param out The descriptor of the destination (opened for writing)
+ * 
+ * @return true If the file was copied
+ * @return false If an error occurred
+ */
+bool copyFile(file_d in, file_d out) {
+    struct stat st, outSt;
+
+    if(!ioctl(out, FICLONE, in))
+        return true;
+    if(fstat(in, &st) || fstat(out, &outSt))
+        return false;
+    if(!S_ISREG(st.st_mode))
+        return copyStream(in, out);
+
+    //A device or a pipe has neither holes nor a size, the data is sent to it as a stream
+    if(!S_ISREG(outSt.st_mode)) {
+        off_t offset = 0;
+        ssize_t sent;
+        while((sent = sendfile(out, in, &offset, COPY_CHUNK_SIZE)) > 0);
+        return sent == 0;
+    }
+
+    //Copy each extent holding data, leaving the holes between them unwritten
+    off_t data = 0;
+    while(data < st.st_size && (data = lseek(in, data, SEEK_DATA)) >= 0) {
+        off_t hole = lseek(in, data, SEEK_HOLE);
+        if(hole < 0)
+            hole = st.st_size;
+        if(!copyFileRange(in, data, out, data, hole - data))
+            return false;
+        data = hole;
+    }
+
+    //No data after the last hole (ENXIO) is the only expected failure
+    if(data < 0 && errno != ENXIO)
+        return false;
+
+    //A trailing hole is only a matter of the size of the destination
+    return !ftruncate(out, st.st_size);
+}
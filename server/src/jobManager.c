@@ -6,21 +6,39 @@
  */
 
 
+#include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "checkpoint.h"
 #include "config.h"
+#include "digest.h"
+#include "fileCopy.h"
 #include "jobManager.h"
+#include "largeFile.h"
 #include "logging.h"
+#include "placement.h"
+#include "pump.h"
+#include "resultCache.h"
 #include "request.h"
+#include "stagePipe.h"
 #include "update.h"
+#include "usage.h"
 #include "utils.h"
 
 /**
@@ -34,6 +52,55 @@ void getOutputPipeName(char* string) {
     sprintf(string, "%d", getpid());
 }
 
+/**
+ * @brief The interval at which a running pipeline is observed (occupancy of its pipes, trimming of the
+ * page cache in large-file mode)
+ * 
+ */
+#define MONITOR_TICK_MS 10
+
+/**
+ * @brief The ioprio_set "which" value for a single process (not exported by glibc)
+ * 
+ */
+#define IOPRIO_WHO_PROCESS 1
+
+/**
+ * @brief Builds an I/O priority from its class and level (not exported by glibc)
+ * 
+ */
+#define IOPRIO_VALUE(class, level) (((class) << 13) | (level))
+
+/**
+ * @brief The settings applied to the process of a stage before executing the transformation
+ * 
+ */
+typedef struct stageOptions {
+    bool pinned; ///< Whether the stage is pinned to #cpus
+    cpu_set_t cpus; ///< The CPUs the stage may run on
+    SchedulingClass scheduling; ///< The OS scheduling settings of the priority of the #Request
+} STAGE_OPTIONS, * StageOptions;
+
+/**
+ * @brief Applies OS scheduling settings to the calling process
+ * 
+ * Settings that cannot be applied (for example, lowering the niceness without privileges) are ignored
+ * 
+ * @param scheduling The given #SchedulingClass
+ */
+void applySchedulingClass(SchedulingClass scheduling) {
+    if (scheduling->policy != POLICY_UNCHANGED) {
+        struct sched_param param = { .sched_priority = 0 };
+        sched_setscheduler(0, scheduling->policy, &param);
+    }
+
+    if (scheduling->nice != NICE_UNCHANGED)
+        setpriority(PRIO_PROCESS, 0, scheduling->nice);
+
+    if (scheduling->ioClass)
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_VALUE(scheduling->ioClass, scheduling->ioLevel));
+}
+
 /**
  * @brief Executes a child process with redirected standard input and output
  * 
@@ -41,12 +108,16 @@ void getOutputPipeName(char* string) {
  * @param out The descriptor of the file to redirect standard output to
  * @param binPath The path of the executable file
  * @param operation The name of the operation
+ * @param options The #StageOptions to apply to the child process
  * 
  * @return pid_t The pid of the child process
  */
-pid_t execOperation(file_d in, file_d out, char*binPath, char*operation) {
+pid_t execOperation(file_d in, file_d out, char*binPath, char*operation, StageOptions options) {
     pid_t pid;
     if (!(pid = fork ())){
+        if (options->pinned)
+            sched_setaffinity(0, sizeof(options->cpus), &options->cpus);
+        applySchedulingClass(options->scheduling);
         dup2 (in, STDIN_FILENO);
         dup2 (out, STDOUT_FILENO);
         close (in);
@@ -64,6 +135,708 @@ pid_t execOperation(file_d in, file_d out, char*binPath, char*operation) {
 
 
 
+/**
+ * @brief Preallocates the predicted size of the output of a #Request, so that it is not fragmented
+ * as the last stage appends to it
+ * 
+ * The space is reserved beyond the end of the file (FALLOC_FL_KEEP_SIZE), so readers never see the
+ * unwritten part
+ * 
+ * @param config The #Config of the server
+ * @param request The given #Request
+ * @param out The descriptor of the output file
+ * 
+ * @return file_d A descriptor of the output file to trim at the end (-1 if nothing was preallocated)
+ */
+file_d preallocateOutput(Config config, Request request, file_d out) {
+    if (out < 0 || !config->preallocateThreshold || request->predictedSize < config->preallocateThreshold)
+        return -1;
+
+    if (fallocate(out, FALLOC_FL_KEEP_SIZE, 0, request->predictedSize))
+        return -1;
+
+    return dup(out);
+}
+
+/**
+ * @brief Releases the preallocated space left beyond the end of the output of a #Request
+ * 
+ * @param preallocated The descriptor returned by preallocateOutput
+ */
+void trimOutput(file_d preallocated) {
+    struct stat st;
+
+    if (preallocated < 0)
+        return;
+
+    if (!fstat(preallocated, &st))
+        ftruncate(preallocated, st.st_size);
+    close(preallocated);
+}
+
+/**
+ * @brief Gets the time elapsed since an instant
+ * 
+ * @param since The instant (CLOCK_MONOTONIC)
+ * 
+ * @return long The elapsed time (microseconds)
+ */
+long getElapsed(struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000L + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+/**
+ * @brief Reaps a process of a stage, waiting again if interrupted by a signal
+ * 
+ * @param pid The pid of the process
+ * @param status Where the exit status is stored
+ * @param ru Where the resource usage of the process is stored (zero if it cannot be waited for)
+ * 
+ * @return true If the process was reaped
+ * @return false If it cannot be waited for (the stage counts as failed, and #status is not set)
+ */
+bool reapStage(pid_t pid, int* status, struct rusage* ru) {
+    while (wait4(pid, status, 0, ru) < 0)
+        if (errno != EINTR) {
+            memset(ru, 0, sizeof(struct rusage));
+            return false;
+        }
+    return true;
+}
+
+/**
+ * @brief Sends the router a sample of the bytes read and written so far by each running stage of a #Request
+ * 
+ * The counters of a process are read from /proc, those of a stage run by a thread are kept by the thread
+ * 
+ * @param request The given #Request
+ * @param first The first stage that runs (the previous ones were served by the result cache)
+ * @param stageCount The number of stages of the #Request (see getStageCount)
+ * @param pids The pids of the stages
+ * @param reaped Whether each stage has finished (or is run by a thread)
+ * @param threaded Whether each operation of the #Request is run by a thread
+ * @param stageUsage The #StageUsage of each stage
+ * @param started The instant each stage started at
+ * @param pw The #PipeWritter to the router
+ */
+void sendProgress(Request request, int first, int stageCount, pid_t pids[], bool reaped[], bool threaded[], STAGE_USAGE stageUsage[], struct timespec started[], PipeWritter pw) {
+    UPDATE update;
+
+    update.type = U_STAGE_PROGRESS;
+    update.requestId = request->timeOfArrival;
+    for (int i = first; i < stageCount; i++) {
+        bool isThreaded = i < request->operationCount && threaded[i];
+        if (reaped[i] && !isThreaded)
+            continue;
+
+        update.stage = i;
+        update.usage = stageUsage[i];
+        if (!isThreaded)
+            readProcessIo(&update.usage, pids[i]);
+        update.usage.realTime = getElapsed(&started[i]);
+        writeUpdate(pw, &update);
+    }
+}
+
+/**
+ * @brief Notifies the router that a #Request failed, after giving back the instances of the stages that did not
+ * finish successfully
+ * 
+ * @param request The given #Request
+ * @param first The first stage that ran (the instances of the previous ones are given back by the router)
+ * @param opsId The id of the transformation of each stage
+ * @param reported Whether each stage already gave its instance back
+ * @param cached The use of the result cache by the #Request
+ * @param summary The sizes of the files of the #Request
+ * @param pw The #PipeWritter to the router
+ */
+void reportFailure(Request request, int first, int opsId[], bool reported[], CacheOutcome cached, OutputSummary summary, PipeWritter pw) {
+    UPDATE update;
+
+    //A stage that failed or was stopped has no usage to account for
+    update.type = U_FINISHED_OP;
+    update.requestId = request->timeOfArrival;
+    update.stage = -1;
+    update.releases = true;
+    memset(&update.usage, 0, sizeof(update.usage));
+    for (int i = first; i < getStageCount(request); i++) {
+        if (reported[i])
+            continue;
+        update.operationId = opsId[i];
+        writeUpdate(pw, &update);
+    }
+
+    printMessage(STDERR_FILENO, REQUESTFAILED);
+    update.requestId = request->timeOfArrival;
+    update.cache = *cached;
+    update.summary = *summary;
+    update.failed = true;
+    update.type = U_REQUEST_FINISHED;
+    writeUpdate(pw, &update);
+}
+
+/**
+ * @brief The thread observing the pipeline of a #Request (occupancy of its pipes, trimming of the page cache in
+ * large-file mode, progress of its stages) while the job handler is blocked waiting for its processes
+ * 
+ */
+typedef struct pipelineMonitor {
+    pthread_t thread; ///< The thread
+    bool running; ///< Whether the thread was started
+    bool stopping; ///< Whether the thread was asked to stop
+    pthread_mutex_t lock; ///< Held while the stages are sampled or reaped, so that a reaped pid is never sampled
+    pthread_cond_t stop; ///< Signalled when the thread is asked to stop
+    int first; ///< The first stage that runs (the previous ones were served by the result cache)
+    int operationCount; ///< The number of operations of the #Request
+    pid_t* pids; ///< The pids of the stages
+    bool* reaped; ///< Whether each stage has finished (or is run by a thread)
+    StageUsage stageUsage; ///< The #StageUsage of each stage
+    LargeFile large; ///< The #LargeFile of the #Request (NULL if it is not in large-file mode)
+    bool sampling; ///< Whether the pipeline has pipes between processes to sample
+    Request request; ///< The #Request
+    int stageCount; ///< The number of stages of the #Request (see getStageCount)
+    bool* threaded; ///< Whether each operation of the #Request is run by a thread
+    struct timespec* started; ///< The instant each stage started at
+    int progressInterval; ///< The interval between two reports of the progress of the stages (ms, 0 for none)
+    PipeWritter pw; ///< The #PipeWritter to the router (also written by the job handler while holding #lock)
+} PIPELINE_MONITOR, * PipelineMonitor;
+
+/**
+ * @brief Observes a pipeline every #MONITOR_TICK_MS (or every progress interval, if it has no pipe to sample
+ * and is not in large-file mode) until asked to stop
+ * 
+ * @param arg The #PipelineMonitor
+ * 
+ * @return void* NULL
+ */
+void* runMonitor(void* arg) {
+    PipelineMonitor monitor = arg;
+    long tick = monitor->sampling || monitor->large ? MONITOR_TICK_MS : monitor->progressInterval;
+    struct timespec deadline, lastProgress;
+
+    clock_gettime(CLOCK_MONOTONIC, &lastProgress);
+    pthread_mutex_lock(&monitor->lock);
+    while (!monitor->stopping) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += tick * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        if (pthread_cond_timedwait(&monitor->stop, &monitor->lock, &deadline) != ETIMEDOUT)
+            continue;
+
+        //A pipe is sampled through its reader, while both of its sides are running as processes
+        for (int j = monitor->first; j < monitor->operationCount - 1; j++)
+            if (!monitor->reaped[j] && !monitor->reaped[j + 1])
+                sampleStagePipe(monitor->pids[j + 1], &monitor->stageUsage[j]);
+
+        if (monitor->progressInterval && getElapsed(&lastProgress) >= monitor->progressInterval * 1000L) {
+            sendProgress(monitor->request, monitor->first, monitor->stageCount, monitor->pids, monitor->reaped,
+                monitor->threaded, monitor->stageUsage, monitor->started, monitor->pw);
+            clock_gettime(CLOCK_MONOTONIC, &lastProgress);
+        }
+
+        //The write-back of the output may block, and must not hold up the reaping of the stages
+        if (monitor->large) {
+            pthread_mutex_unlock(&monitor->lock);
+            largeFileTick(monitor->large);
+            pthread_mutex_lock(&monitor->lock);
+        }
+    }
+    pthread_mutex_unlock(&monitor->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Starts observing a pipeline, if there is anything to observe
+ * 
+ * @param monitor The #PipelineMonitor to start
+ * @param request The given #Request
+ * @param first The first stage that runs
+ * @param pids The pids of the stages
+ * @param reaped Whether each stage has finished (or is run by a thread)
+ * @param threaded Whether each operation of the #Request is run by a thread
+ * @param stageUsage The #StageUsage of each stage
+ * @param started The instant each stage started at
+ * @param large The #LargeFile of the #Request (NULL if it is not in large-file mode)
+ * @param progressInterval The interval between two reports of the progress of the stages (ms, 0 for none)
+ * @param pw The #PipeWritter to the router
+ */
+void startMonitor(PipelineMonitor monitor, Request request, int first, pid_t pids[], bool reaped[], bool threaded[], STAGE_USAGE stageUsage[], struct timespec started[], LargeFile large, int progressInterval, PipeWritter pw) {
+    monitor->request = request;
+    monitor->first = first;
+    monitor->operationCount = request->operationCount;
+    monitor->stageCount = getStageCount(request);
+    monitor->pids = pids;
+    monitor->reaped = reaped;
+    monitor->threaded = threaded;
+    monitor->stageUsage = stageUsage;
+    monitor->started = started;
+    monitor->large = large;
+    monitor->progressInterval = progressInterval;
+    monitor->pw = pw;
+    monitor->sampling = request->operationCount - first > 1;
+    monitor->stopping = false;
+    pthread_mutex_init(&monitor->lock, NULL);
+    pthread_cond_init(&monitor->stop, NULL);
+
+    monitor->running = (monitor->sampling || large || progressInterval)
+                    && !pthread_create(&monitor->thread, NULL, runMonitor, monitor);
+}
+
+/**
+ * @brief Reaps a stage of a pipeline that exited, recording its usage, without racing its sampling
+ * 
+ * @param monitor The #PipelineMonitor of the pipeline
+ * @param i The index of the stage
+ * @param isStage Whether the process is a stage (a pump has no usage to record)
+ * @param started The instant the stage started at
+ * @param status Where the exit status is stored
+ * @param ru Where the resource usage of the process is stored
+ * 
+ * @return true If the process was reaped
+ * @return false If it cannot be waited for (see reapStage)
+ */
+bool reapMonitoredStage(PipelineMonitor monitor, int i, bool isStage, struct timespec* started, int* status, struct rusage* ru) {
+    pthread_mutex_lock(&monitor->lock);
+    if (isStage) {
+        monitor->stageUsage[i].realTime = getElapsed(started);
+        readProcessIo(&monitor->stageUsage[i], monitor->pids[i]);
+    }
+    bool exited = reapStage(monitor->pids[i], status, ru);
+    monitor->reaped[i] = true;
+    pthread_mutex_unlock(&monitor->lock);
+    return exited;
+}
+
+/**
+ * @brief Stops observing a pipeline
+ * 
+ * @param monitor The given #PipelineMonitor
+ */
+void stopMonitor(PipelineMonitor monitor) {
+    pthread_mutex_lock(&monitor->lock);
+    monitor->stopping = true;
+    pthread_cond_signal(&monitor->stop);
+    pthread_mutex_unlock(&monitor->lock);
+
+    if (monitor->running)
+        pthread_join(monitor->thread, NULL);
+    pthread_mutex_destroy(&monitor->lock);
+    pthread_cond_destroy(&monitor->stop);
+}
+
+/**
+ * @brief Starts the branches of a #Request that fork after a number of the operations of the #Request or of
+ * another branch, and the fan-out pump copying the data at that point to each of them and to the rest of the
+ * pipeline they fork from
+ * 
+ * The stages of the branches run as processes, at the indexes that follow the operations of the #Request
+ * (see getStageCount), and the branches forking from them are started along with them. A branch without
+ * operations gets the data written to its output file as it is
+ * 
+ * @param request The given #Request
+ * @param parent The index of the branch the branches fork from (-1 for the operations of the #Request)
+ * @param after The number of operations of the parent after which the branches fork
+ * @param in The descriptor of the data at that point of the pipeline (closed)
+ * @param next The descriptor the rest of the pipeline gets the data from (closed, -1 to create a pipe)
+ * @param config The #Config of the server
+ * @param binPath The path to the binaries used
+ * @param placement The #Placement of the stages on the CPUs
+ * @param usage The #UsageStats of each transformation (used to size the pipes between stages)
+ * @param pids The pids of the processes of the pipeline (the stages of the branches and the pumps are set)
+ * @param processCount The number of processes of the pipeline (the pumps are added after them)
+ * @param opsId The identifiers of the transformations of the stages (those of the branches are set)
+ * @param started When each stage started (those of the branches are set)
+ * 
+ * @return file_d The read end of the pipe the rest of the pipeline reads from (-1 if #next was given)
+ */
+file_d startBranches(Request request, int parent, int after, file_d in, file_d next, Config config, char* binPath, Placement placement, USAGE_STATS usage[], pid_t pids[], int* processCount, int opsId[], struct timespec started[]) {
+    struct stat st;
+    file_d fd[2], result = -1;
+    file_d outs[request->branchCount + 1];
+    int count = 0;
+
+    //The pump duplicates pipes, so an input file is first moved to a pipe by the kernel
+    if (!fstat(in, &st) && !S_ISFIFO(st.st_mode) && openStagePipe(fd, 0)) {
+        pids[(*processCount)++] = startRangePump(in, 0, st.st_size, fd[1]);
+        close(fd[1]);
+        close(in);
+        in = fd[0];
+    }
+
+    int previous = getBranchStage(request, parent) + after - 1;
+    if (next < 0 && openStagePipe(fd, after ? getPipeSize(config, usage, opsId[previous]) : 0)) {
+        next = fd[1];
+        result = fd[0];
+    }
+    outs[count++] = next;
+
+    STAGE_OPTIONS options;
+    options.scheduling = getSchedulingClass(config, request->priority);
+
+    for (int b = 0; b < request->branchCount; b++) {
+        Branch branch = &request->branches[b];
+        if (branch->parent != parent || branch->after != after)
+            continue;
+
+        int stage = getBranchStage(request, b), ops = branch->operationCount;
+        file_d branchOut = openAsClient(request, branch->outputFile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660);
+        if (branchOut < 0) printMessage(STDERR_FILENO, CANTOPENOUTPUTFILE);
+        if ((!ops && !hasBranchesAfter(request, b, 0)) || !openStagePipe(fd, 0)) {
+            outs[count++] = branchOut;
+            continue;
+        }
+
+        outs[count++] = fd[1];
+        for (int j = 0; j < ops; j++) {
+            if (hasBranchesAfter(request, b, j))
+                fd[0] = startBranches(request, b, j, fd[0], -1, config, binPath, placement, usage, pids, processCount, opsId, started);
+
+            file_d stageOut[2] = { -1, branchOut };
+            opsId[stage + j] = getProgramId(config, branch->operations[j]);
+            if (j < ops - 1 || hasBranchesAfter(request, b, ops))
+                openStagePipe(stageOut, getPipeSize(config, usage, opsId[stage + j]));
+
+            //The stages of the branches run on the cores following those of the operations
+            options.pinned = getStageCpus(placement, request, stage + j, &options.cpus);
+            pids[stage + j] = execOperation(fd[0], stageOut[1], binPath, branch->operations[j], &options);
+            clock_gettime(CLOCK_MONOTONIC, &started[stage + j]);
+            close(fd[0]);
+            close(stageOut[1]);
+            fd[0] = stageOut[0];
+        }
+
+        //The output of the whole branch feeds other branches as well as its output file
+        if (hasBranchesAfter(request, b, ops))
+            startBranches(request, b, ops, fd[0], branchOut, config, binPath, placement, usage, pids, processCount, opsId, started);
+    }
+
+    pids[(*processCount)++] = startFanOutPump(in, outs, count);
+    close(in);
+    for (int k = 0; k < count; k++)
+        close(outs[k]);
+
+    return result;
+}
+
+/**
+ * @brief Gets the largest number of processes the pipeline of a #Request can be made of
+ * 
+ * Those are its stages, followed by the pumps: two in large-file mode, one feeding the stages from a cached
+ * output, one copying an intermediate output, and two at each point its branches fork at (the fan-out pump,
+ * and the pump moving an input file to a pipe)
+ * 
+ * @param request The given #Request
+ * 
+ * @return int The number of processes
+ */
+int getProcessCapacity(Request request) {
+    int capacity = getStageCount(request) + 4;
+
+    for (int b = 0; b < request->branchCount; b++) {
+        Branch branch = &request->branches[b];
+        int first = 0;
+        while (request->branches[first].parent != branch->parent || request->branches[first].after != branch->after)
+            first++;
+        //The branches forking at the same point share its pumps
+        if (first == b)
+            capacity += 2;
+    }
+
+    return capacity;
+}
+
+/**
+ * @brief Gives the instances of a chunk slot back to the router, without usage to account for
+ * 
+ * @param opsId The identifiers of the transformations of the slot
+ * @param ops The number of transformations
+ * @param pw The #PipeWritter to the router
+ * @param released Whether the instances were already given back (set to true)
+ */
+void releaseSlot(int opsId[], int ops, PipeWritter pw, bool* released) {
+    UPDATE update;
+
+    if (*released)
+        return;
+
+    memset(&update.usage, 0, sizeof(update.usage));
+    update.stage = -1;
+    for (int j = 0; j < ops; j++) {
+        update.type = U_FINISHED_OP;
+        update.operationId = opsId[j];
+        update.releases = true;
+        writeUpdate(pw, &update);
+    }
+    *released = true;
+}
+
+/**
+ * @brief Notifies the router that a #Request failed before running, since one of its files could not be opened,
+ * after giving back every instance reserved for it
+ * 
+ * @param request The given #Request
+ * @param config The #Config of the server
+ * @param pw The #PipeWritter to the router
+ */
+void reportUnopened(Request request, Config config, PipeWritter pw) {
+    int stageCount = getStageCount(request);
+    int opsId[stageCount];
+    bool reported[stageCount];
+    CACHE_OUTCOME cached;
+    OUTPUT_SUMMARY summary;
+
+    for (int i = 0; i < stageCount; i++)
+        opsId[i] = getProgramId(config, getStageOperation(request, i));
+    memset(reported, 0, sizeof(reported));
+
+    //A request run in chunks holds the instances of each of its slots
+    for (int s = 1; s < request->chunkWidth; s++) {
+        bool released = false;
+        releaseSlot(opsId, request->operationCount, pw, &released);
+    }
+
+    memset(&cached, 0, sizeof(cached));
+    cached.status = CACHE_UNUSED;
+    summarizeFiles(&summary, -1, -1);
+    reportFailure(request, request->cachedOperations, opsId, reported, &cached, &summary, pw);
+}
+
+/**
+ * @brief Opens an anonymous file in a directory, to hold the output of a chunk
+ * 
+ * Where O_TMPFILE is not supported (by the kernel or the file system), a named file is created and unlinked
+ * at once
+ * 
+ * @param directory The directory (of the output file)
+ * 
+ * @return file_d The descriptor of the file (-1 if it cannot be created)
+ */
+file_d openChunkOutput(char* directory) {
+    file_d result = open(directory, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (result >= 0)
+        return result;
+
+    char path[strlen(directory) + sizeof("/.sdchunk.XXXXXX")];
+    sprintf(path, "%s/.sdchunk.XXXXXX", directory);
+    result = mkostemp(path, O_CLOEXEC);
+    if (result >= 0)
+        unlink(path);
+    return result;
+}
+
+/**
+ * @brief Runs the operations of a #Request on chunks of its input, several chunks at once, and writes their
+ * outputs one after the other to the output file
+ * 
+ * Each of the #Request::chunkWidth slots runs one chunk at a time through its own copy of the pipeline (a
+ * pump feeding the chunk to the first stage, and the stages), writing to an anonymous file in the directory
+ * of the output. The outputs are appended to the output file in the order of the chunks. The instances used
+ * by a slot are only given back to the router once no chunk is left for it.
+ * 
+ * With a #Checkpoint, the chunks it records are skipped, and the progress is saved every
+ * #Checkpoint::interval bytes of input and when a process fails. The journal is removed once every chunk
+ * is processed.
+ * 
+ * @param request The given #Request
+ * @param config The #Config of the server
+ * @param in The descriptor of the input file
+ * @param out The descriptor of the output file (holding the output of the chunks of the #Checkpoint)
+ * @param binPath The path to the binaries used
+ * @param placement The #Placement of the stages on the CPUs
+ * @param usage The #UsageStats of each transformation (used to size the pipes between stages)
+ * @param pw The #PipeWritter to the router
+ * @param checkpoint The progress of the #Request (NULL if it is not checkpointed)
+ * @param digest The #DigestStage digesting the output as the chunks are appended (NULL if not digested)
+ * 
+ * @return true If every chunk was processed
+ * @return false If a process failed (the remaining processes are killed and the instances given back)
+ */
+bool runChunks(Request request, Config config, file_d in, file_d out, char* binPath, Placement placement, USAGE_STATS usage[], PipeWritter pw, Checkpoint checkpoint, DigestStage digest) {
+    struct stat st;
+    if (in < 0 || out < 0 || fstat(in, &st))
+        return false;
+
+    int ops = request->operationCount, width = request->chunkWidth, processes = ops + 1;
+    int chunks = (st.st_size + config->chunkSize - 1) / config->chunkSize;
+    //The outputs of the chunks are kept next to the output file (or in the temporary directory if its path is unknown)
+    char path[PATH_MAX];
+    char* directory = getRequestOutputPath(request, path, sizeof(path)) ? dirname(path) : P_tmpdir;
+
+    int opsId[ops];
+    STAGE_OPTIONS options[ops];
+    for (int j = 0; j < ops; j++) {
+        opsId[j] = getProgramId(config, request->operations[j]);
+        options[j].scheduling = getSchedulingClass(config, request->priority);
+    }
+
+    //The processes of each slot: the pump feeding the chunk, followed by the stages (0 once reaped)
+    pid_t pids[width * processes];
+    struct timespec started[width * processes];
+    STAGE_USAGE stageUsage[width * processes];
+    int slotChunk[width], alive[width];
+    bool released[width];
+    file_d slotResult[width];
+    file_d* results = malloc(sizeof(file_d) * chunks);
+    for (int s = 0; s < width; s++) {
+        slotChunk[s] = -1;
+        released[s] = false;
+    }
+    for (int c = 0; c < chunks; c++)
+        results[c] = -1;
+
+    printFormattedMessage(STDERR_FILENO, REQUESTCHUNKED, chunks, width);
+
+    UPDATE update;
+    int next = checkpoint ? checkpoint->chunks : 0, appended = next;
+    off_t written = checkpoint ? checkpoint->written : 0;
+    bool ok = true;
+
+    //The digest covers the part of the output written by an earlier run too
+    if (digest && written > 0) {
+        file_d saved = reopenRequestOutput(request);
+        digestRange(digest, saved, 0, written);
+        if (saved >= 0)
+            close(saved);
+    }
+
+    //The slots left without a chunk to run by the checkpoint give their instances back at once
+    for (int s = MAX(chunks - next, 0); s < width; s++)
+        releaseSlot(opsId, ops, pw, &released[s]);
+
+    while (ok && appended < chunks) {
+        //Give a chunk to every idle slot
+        for (int s = 0; s < width && next < chunks && ok; s++) {
+            if (slotChunk[s] >= 0)
+                continue;
+
+            file_d fd[2];
+            file_d result = openChunkOutput(directory);
+            if (result < 0 || pipe2(fd, O_CLOEXEC)) {
+                ok = false;
+                break;
+            }
+
+            pid_t* slot = &pids[s * processes];
+            off_t offset = (off_t)next * config->chunkSize;
+            slot[0] = startRangePump(in, offset, MIN(config->chunkSize, st.st_size - offset), fd[1]);
+            close(fd[1]);
+
+            memset(&stageUsage[s * processes], 0, sizeof(STAGE_USAGE) * processes);
+            for (int j = 0; j < ops; j++) {
+                file_d stage[2] = { -1, result };
+                if (j < ops - 1)
+                    openStagePipe(stage, getPipeSize(config, usage, opsId[j]));
+
+                //Each slot runs on cores of its own, after those of the previous slots
+                options[j].pinned = getStageCpus(placement, request, s * ops + j, &options[j].cpus);
+                slot[j + 1] = execOperation(fd[0], stage[1], binPath, request->operations[j], &options[j]);
+                clock_gettime(CLOCK_MONOTONIC, &started[s * processes + j + 1]);
+                close(fd[0]);
+                if (j < ops - 1)
+                    close(stage[1]);
+                fd[0] = stage[0];
+            }
+
+            slotResult[s] = result;
+            slotChunk[s] = next++;
+            alive[s] = processes;
+        }
+
+        //Wait for a process of any slot, without reaping it so that its /proc entry can still be read
+        siginfo_t info;
+        if (!ok || waitid(P_ALL, 0, &info, WEXITED | WNOWAIT)) {
+            ok = false;
+            break;
+        }
+
+        int i = 0;
+        while (i < width * processes && (pids[i] != info.si_pid || slotChunk[i / processes] < 0))
+            i++;
+        if (i == width * processes) {
+            waitpid(info.si_pid, NULL, 0);
+            continue;
+        }
+
+        int s = i / processes, status;
+        struct rusage ru;
+        if (i % processes) {
+            stageUsage[i].realTime = getElapsed(&started[i]);
+            readProcessIo(&stageUsage[i], pids[i]);
+        }
+        bool exited = reapStage(pids[i], &status, &ru);
+        pids[i] = 0;
+        fromRusage(&stageUsage[i], &ru);
+
+        if (!exited || !__WIFEXITED(status) || __WEXITSTATUS(status)) {
+            ok = false;
+            break;
+        }
+        if (--alive[s])
+            continue;
+
+        //The chunk is done: the instances of the slot go back to the router if no chunk is left for it
+        for (int j = 0; j < ops; j++) {
+            update.type = U_FINISHED_OP;
+            update.operationId = opsId[j];
+            update.stage = -1;
+            update.usage = stageUsage[s * processes + j + 1];
+            update.releases = next >= chunks;
+            writeUpdate(pw, &update);
+        }
+        released[s] = next >= chunks;
+        results[slotChunk[s]] = slotResult[s];
+        slotChunk[s] = -1;
+
+        //Append the outputs of the chunks that are next in order
+        for (; ok && appended < chunks && results[appended] >= 0; appended++) {
+            struct stat chunk;
+            ok = !fstat(results[appended], &chunk) && copyFileRange(results[appended], 0, out, written, chunk.st_size);
+            if (ok && digest)
+                digestRange(digest, results[appended], 0, chunk.st_size);
+            written += chunk.st_size;
+            close(results[appended]);
+            results[appended] = -1;
+        }
+
+        if (ok && checkpoint && checkpoint->interval && (long)(appended - checkpoint->saved) * config->chunkSize >= checkpoint->interval) {
+            checkpoint->chunks = appended;
+            checkpoint->written = written;
+            saveCheckpoint(request, checkpoint, out);
+        }
+    }
+
+    //Stop the rest of the chunks on a failure
+    for (int s = 0; s < width; s++) {
+        if (slotChunk[s] < 0)
+            continue;
+        for (int k = 0; k < processes; k++)
+            if (pids[s * processes + k] > 0)
+                kill(pids[s * processes + k], SIGKILL);
+        close(slotResult[s]);
+    }
+    //The instances of a failed request are given back, so that it can be run again
+    for (int s = 0; s < width; s++)
+        releaseSlot(opsId, ops, pw, &released[s]);
+    for (int c = appended; c < chunks; c++)
+        if (results[c] >= 0)
+            close(results[c]);
+    free(results);
+
+    //Keep the progress made for the next run of the request, or forget it once the output is complete
+    if (checkpoint && !ok && appended > checkpoint->saved) {
+        checkpoint->chunks = appended;
+        checkpoint->written = written;
+        saveCheckpoint(request, checkpoint, out);
+    } else if (checkpoint && ok)
+        clearCheckpoint(request);
+
+    return ok;
+}
+
 /**
  * @brief Main function for the process responsible for handling the instances of a subprogram in the server
  * 
@@ -73,67 +846,440 @@ pid_t execOperation(file_d in, file_d out, char*binPath, char*operation) {
  * @param binPath      The path to the binaries used
  * @param config       The #Config of the server
  * @param fifo         The descriptor of the FIFO to write the updates to
+ * @param placement    The #Placement of the stages on the CPUs (NULL if stages are not pinned)
+ * @param usage        The #UsageStats of each transformation (used to size the pipes between stages)
+ * @param plugins      The loaded #Plugins (NULL if every transformation runs as a process)
+ * @param workers      The #WorkerPool of the persistent workers (NULL if no transformation runs on workers)
  * 
  * @return 1           On success
  * @return 0           If an error occured
  */
-void runJobHandler(Request request, file_d fifo, char* binPath, Config config) {
+void runJobHandler(Request request, file_d fifo, char* binPath, Config config, Placement placement, USAGE_STATS usage[], Plugins plugins, WorkerPool workers) {
     file_d fd[2];
-    file_d in = open(request->inputFile, O_RDONLY);
-    if (in<0) printMessage(STDERR_FILENO, CANTOPENINPUTFILE);
+    PIPE_WRITTER pw;
+    initPipeWritter(&pw, fifo);
 
+    //A file that cannot be opened fails the request at once (the output is left as it is if the input is missing)
+    file_d in = openRequestInput(request);
+    if (in<0) {
+        printMessage(STDERR_FILENO, CANTOPENINPUTFILE);
+        reportUnopened(request, config, &pw);
+        return;
+    }
 
-    pid_t pids[request->operationCount];
-    int opsId[request->operationCount];
+    //A request run in chunks resumes from the checkpoint left by a previous run on the same input, if any
+    CHECKPOINT checkpoint;
+    bool checkpointed = request->chunkWidth && config->checkpointInterval;
+    bool resumed = checkpointed && loadCheckpoint(config, request, in, &checkpoint);
+    file_d out = openRequestOutput(request, !resumed);
+    if (out<0) {
+        printMessage(STDERR_FILENO, CANTOPENOUTPUTFILE);
+        close(in);
+        reportUnopened(request, config, &pw);
+        return;
+    }
+    if (resumed) {
+        ftruncate(out, checkpoint.written);
+        printFormattedMessage(STDERR_FILENO, REQUESTRESUMED, checkpoint.chunks);
+    }
+    //An output written from the start is not described by the journal left by an earlier run, if any
+    else if (!isStreamRequest(request))
+        clearCheckpoint(request);
 
-    PIPE_WRITTER pw;
-    initPipeWritter(&pw, fifo);
+    //The sizes of the files are sent to the router with the completion, so that it does not look them up
+    OUTPUT_SUMMARY summary;
+    summarizeFiles(&summary, in, -1);
 
-    //Setup pipes for the stdin and stdout of children
-    for (int i = 0; i < request->operationCount; i++){
-        if (i ==request->operationCount-1){
-            fd[1]=open(request->outputFile, O_WRONLY | O_TRUNC | O_CREAT, 0660);
-            if (fd[1]<0) printMessage(STDERR_FILENO, CANTOPENOUTPUTFILE);
+
+    //The stages (the operations, then those of the branches), followed by the pumps (see getProcessCapacity)
+    int stageCount = getStageCount(request);
+    int processCapacity = getProcessCapacity(request);
+    pid_t pids[processCapacity];
+    int opsId[stageCount];
+    int processCount = stageCount;
+
+    struct timespec started[stageCount];
+    STAGE_USAGE stageUsage[stageCount];
+    memset(stageUsage, 0, sizeof(stageUsage));
+    //Whether each stage gave its instance back to the router
+    bool reported[stageCount];
+    memset(reported, 0, sizeof(reported));
+
+    UPDATE update;
+    update.failed = false;
+
+    //A request whose operations were all optimized away is a copy of its input (a stream is moved from where
+    //its files stand), digested on its way by a digest stage when the config file asks for a digest
+    CACHE_OUTCOME cached;
+    if (!request->operationCount) {
+        if (config->outputDigest != DIGEST_NONE) {
+            DIGEST_STAGE copy;
+            startDigestStage(&copy, config->outputDigest, in, out);
+            update.failed = !joinDigestStage(&copy, &summary);
+        } else {
+            update.failed = !(isStreamRequest(request) ? copyStream(in, out) : copyFile(in, out));
+            summarizeFiles(&summary, in, out);
+            close(in);
+            close(out);
         }
-        else 
-            pipe(fd);
+        if (update.failed)
+            printMessage(STDERR_FILENO, UNEXPECTEDERROR);
+        memset(&cached, 0, sizeof(cached));
+        cached.status = CACHE_UNUSED;
+        update.requestId = request->timeOfArrival;
+        update.cache = cached;
+        update.summary = summary;
+        update.type = U_REQUEST_FINISHED;
+        writeUpdate(&pw, &update);
+        return;
+    }
 
-        pids[i]=execOperation(in, fd[1],binPath,request->operations[i]);
+    //On a hit in the result cache found by the router, the output is copied and no transformation is run (a
+    //resumed request keeps the output it already has)
+    if (resumed) {
+        memset(&cached, 0, sizeof(cached));
+        cached.status = CACHE_UNUSED;
+    } else
+        initCacheOutcome(config, request, in, &cached);
+    if (cached.status == CACHE_MISSED && request->cachedOperations == request->operationCount) {
+        serveResult(config, request, out, &cached, &summary);
+        close(in);
+        close(out);
+        update.requestId = request->timeOfArrival;
+        update.cache = cached;
+        update.summary = summary;
+        update.type = U_REQUEST_FINISHED;
+        writeUpdate(&pw, &update);
+        return;
+    }
+
+    //A request of chunkable transformations on a large input runs on several chunks at once
+    if (request->chunkWidth) {
+        file_d preallocated = preallocateOutput(config, request, out);
+        DIGEST_STAGE digest;
+        if (config->outputDigest != DIGEST_NONE)
+            initDigest(&digest, config->outputDigest);
+        bool done = runChunks(request, config, in, out, binPath, placement, usage, &pw, checkpointed ? &checkpoint : NULL,
+                              config->outputDigest != DIGEST_NONE ? &digest : NULL);
+        summarizeFiles(&summary, in, out);
+        if (config->outputDigest != DIGEST_NONE)
+            finishDigest(&digest, &summary);
+        close(in);
+        close(out);
+        trimOutput(preallocated);
+        if (!done) {
+            printMessage(STDERR_FILENO, UNEXPECTEDERROR);
+            //The slots gave their instances back as they stopped
+            memset(reported, true, sizeof(reported));
+            reportFailure(request, 0, opsId, reported, &cached, &summary, &pw);
+            return;
+        }
+
+        storeResult(config, request, &cached, &summary);
+        update.requestId = request->timeOfArrival;
+        update.cache = cached;
+        update.summary = summary;
+        update.type = U_REQUEST_FINISHED;
+        writeUpdate(&pw, &update);
+        return;
+    }
+
+    //Start from the cached output of a prefix of the operations found by the router, if any (without its
+    //trailer), or run again from the input if it is gone, since only the instances of the rest were reserved
+    int first = 0;
+    if (cached.status == CACHE_MISSED && request->cachedOperations) {
+        long prefixSize;
+        file_d prefix = openPrefix(config, request, &cached, &prefixSize);
+        if (prefix < 0) {
+            close(in);
+            close(out);
+            update.requestId = request->timeOfArrival;
+            update.cache = cached;
+            update.summary = summary;
+            update.type = U_REQUEST_FINISHED;
+            writeUpdate(&pw, &update);
+            return;
+        }
+        close(in);
+        openStagePipe(fd, 0);
+        pids[processCount] = startRangePump(prefix, 0, prefixSize, fd[1]);
+        if (pids[processCount] > 0) processCount++;
+        close(prefix);
+        close(fd[1]);
+        in = fd[0];
+        first = cached.prefixHit;
+    }
+
+    //Copy the output of the prefix chosen by the router to the cache, with a tee pump after its last stage
+    file_d intermediate = createIntermediate(config, request, &cached);
+    int teeStage = intermediate >= 0 ? request->materializePrefix - 1 : -1;
+    int teeIndex = -1;
+    bool teeComplete = true;
+
+    file_d preallocated = preallocateOutput(config, request, out);
+    file_d written = out >= 0 ? fcntl(out, F_DUPFD_CLOEXEC, 0) : -1;
+
+    //The standard streams of a client are left as they are (no O_DIRECT, nor page cache to drop)
+    LARGE_FILE large;
+    if (initLargeFile(&large, config, isStreamRequest(request) ? -1 : in, out)) {
+        in = startInputPump(&large, in, &pids[processCount]);
+        if (pids[processCount] > 0) processCount++;
+        out = startOutputPump(&large, out, &pids[processCount]);
+        if (pids[processCount] > 0) processCount++;
+    }
+
+    //An input whose hash is unknown is hashed by a thread on its way to the first stage, through a pipe
+    DIGEST_STAGE inputDigest;
+    OUTPUT_SUMMARY inputSummary;
+    file_d hashIn = -1, hashOut = -1;
+    if (cached.status == CACHE_MISSED && !cached.hashed && in >= 0) {
+        file_d hashPipe[2];
+        if (openStagePipe(hashPipe, 0)) {
+            hashIn = in;
+            hashOut = hashPipe[1];
+            in = hashPipe[0];
+        }
+    }
+
+    //The output is digested by a thread on its way to the file (or to the output pump), through a pipe
+    DIGEST_STAGE digest;
+    file_d digestIn = -1, digestOut = -1;
+    if (config->outputDigest != DIGEST_NONE && out >= 0) {
+        file_d digestPipe[2];
+        if (openStagePipe(digestPipe, 0)) {
+            digestIn = digestPipe[0];
+            digestOut = out;
+            out = digestPipe[1];
+        }
+    }
+
+    //The runs of consecutive stages run as plugins are run by worker processes of their own, and the stages
+    //run on persistent workers are driven by threads, all started once every stage process is forked
+    PLUGIN_SEGMENT segments[request->operationCount];
+    int segmentFirst[request->operationCount];
+    file_d segmentIn[request->operationCount];
+    int segmentCount = 0;
+    WORKER_STAGE remote[request->operationCount];
+    Worker stageWorkers[request->operationCount];
+    bool inProcess[request->operationCount + 1], threaded[request->operationCount + 1];
+    for (int i = first; i < request->operationCount; i++) {
         opsId[i] = getProgramId(config, request->operations[i]);
+        inProcess[i] = !request->branchCount && isPluginStage(plugins, opsId[i]);
+        stageWorkers[i] = inProcess[i] ? NULL : getStageWorker(workers, request, i);
+        threaded[i] = inProcess[i] || stageWorkers[i];
+    }
+    inProcess[request->operationCount] = threaded[request->operationCount] = false;
+
+    //Setup pipes for the stdin and stdout of children
+    for (int i = first; i < request->operationCount; i++){
+        //The data fed to the branches forking here goes through a fan-out pump first
+        if (hasBranchesAfter(request, -1, i))
+            in = startBranches(request, -1, i, in, -1, config, binPath, placement, usage, pids, &processCount, opsId, started);
+
+        //A plugin stage hands its output directly to the next one when it is a plugin stage too
+        if (inProcess[i]) {
+            pids[i] = 0;
+            if (i == first || !inProcess[i - 1]) {
+                segmentFirst[segmentCount] = i;
+                segmentIn[segmentCount] = in;
+            }
+            if (inProcess[i + 1])
+                continue;
+        }
+
+        if (i ==request->operationCount-1 && !hasBranchesAfter(request, -1, request->operationCount))
+            fd[1]=out;
+        else {
+            openStagePipe(fd, getPipeSize(config, usage, opsId[i]));
+        }
+
+        if (inProcess[i]) {
+            segments[segmentCount++].out = fd[1];
+            in = fd[0];
+            continue;
+        }
+        if (stageWorkers[i]) {
+            pids[i] = 0;
+            remote[i].in = in;
+            remote[i].out = fd[1];
+            in = fd[0];
+            continue;
+        }
+
+        STAGE_OPTIONS options;
+        options.pinned = getStageCpus(placement, request, i, &options.cpus);
+        options.scheduling = getSchedulingClass(config, request->priority);
+
+        pids[i]=execOperation(in, fd[1],binPath,request->operations[i], &options);
+        clock_gettime(CLOCK_MONOTONIC, &started[i]);
 
         close (fd[1]);
+        close (in);
+
+        if (i == teeStage) {
+            file_d tee[2];
+            openStagePipe(tee, getPipeSize(config, usage, opsId[i]));
+            pids[processCount] = startTeePump(fd[0], tee[1], intermediate);
+            teeIndex = processCount++;
+            close(fd[0]);
+            close(tee[1]);
+            close(intermediate);
+            fd[0] = tee[0];
+        }
 
         in = fd [0];
     }
-    close(in);
-    close(fd[1]);
-    UPDATE update;
 
-    //Wait for children to finish executing
-    for(int i = 0; i < request->operationCount; i++) {
+    if (hasBranchesAfter(request, -1, request->operationCount))
+        startBranches(request, -1, request->operationCount, in, out, config, binPath, placement, usage, pids, &processCount, opsId, started);
+    assert(processCount <= processCapacity);
+
+    //The workers of the plugin segments are forked last, keeping only their own descriptors, and before any
+    //thread is started; the threads own the descriptors of their stages, so they only start once no process
+    //is forked anymore
+    for (int s = 0; s < segmentCount; s++) {
+        int count = 1;
+        while (inProcess[segmentFirst[s] + count])
+            count++;
+        startPluginSegment(plugins, &segments[s], &opsId[segmentFirst[s]], count, segmentIn[s], segments[s].out, &stageUsage[segmentFirst[s]]);
+    }
+    digest.running = inputDigest.running = false;
+    if (digestIn >= 0)
+        startDigestStage(&digest, config->outputDigest, digestIn, digestOut);
+    if (hashIn >= 0)
+        startDigestStage(&inputDigest, DIGEST_XXH64, hashIn, hashOut);
+    int threadedCount = 0;
+    for (int i = first; i < request->operationCount; i++) {
+        threadedCount += threaded[i];
+        if (threaded[i])
+            clock_gettime(CLOCK_MONOTONIC, &started[i]);
+        if (stageWorkers[i])
+            startWorkerStage(&remote[i], stageWorkers[i], remote[i].in, remote[i].out, &stageUsage[i]);
+    }
+
+    //Wait for children to finish executing, in whichever order they exit (the threaded stages are not processes)
+    bool reaped[processCount];
+    memset(reaped, 0, sizeof(reaped));
+    for (int i = first; i < request->operationCount; i++)
+        reaped[i] = threaded[i];
+
+    //The pipeline is observed by a thread while it runs
+    PIPELINE_MONITOR monitor;
+    startMonitor(&monitor, request, first, pids, reaped, threaded, stageUsage, started, large.enabled ? &large : NULL, config->progressInterval, &pw);
+
+    bool ok = true;
+    for(int remaining = processCount - first - threadedCount; remaining > 0 && ok; remaining--) {
         int status;
+        struct rusage ru;
+        siginfo_t info;
+        int i = -1;
 
-        waitpid(pids[i],&status,0);
-
-        //Check for success
-        if(__WIFEXITED(status)) {
-            if(!__WEXITSTATUS(status)) {
-                update.operationId = opsId[i];
-                update.type = U_FINISHED_OP;
-                writeUpdate(&pw, &update);
-            } else {
-                printMessage(STDERR_FILENO, UNEXPECTEDERROR);
-                return;
+        //Wait for a process that exited without reaping it, so that its /proc entry can still be read
+        while (i < 0) {
+            if (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT)) {
+                if (errno == EINTR)
+                    continue;
+                break;
             }
-        } else {
-            printMessage(STDERR_FILENO, UNEXPECTEDERROR);
-            return;
+            for (int j = first; j < processCount && i < 0; j++)
+                if (!reaped[j] && pids[j] == info.si_pid)
+                    i = j;
+            //Not a process of the pipeline (the worker of a plugin segment is joined once they are all done)
+            if (i < 0 && !reapPluginSegment(segments, segmentCount, info.si_pid))
+                waitpid(info.si_pid, NULL, 0);
         }
+        if (i < 0)
+            break;
+
+        bool exited = reapMonitoredStage(&monitor, i, i < stageCount, &started[i], &status, &ru);
+
+        //A tee pump that could not copy the intermediate output still forwarded it
+        if (i == teeIndex && exited && __WIFEXITED(status) && __WEXITSTATUS(status) == TEE_COPY_INCOMPLETE) {
+            teeComplete = false;
+            continue;
+        }
+
+        //Check for success, and stop the rest of the pipeline on a failure
+        if(!exited || !__WIFEXITED(status) || __WEXITSTATUS(status)) {
+            for (int j = first; j < processCount; j++)
+                if (!reaped[j])
+                    kill(pids[j], SIGKILL);
+            ok = false;
+            continue;
+        }
+
+        if (i >= stageCount) continue;
+        update.operationId = opsId[i];
+        update.requestId = request->timeOfArrival;
+        update.stage = i;
+        fromRusage(&stageUsage[i], &ru);
+        update.usage = stageUsage[i];
+        update.releases = true;
+        update.type = U_FINISHED_OP;
+        pthread_mutex_lock(&monitor.lock);
+        writeUpdate(&pw, &update);
+        pthread_mutex_unlock(&monitor.lock);
+        reported[i] = true;
+    }
+
+    stopMonitor(&monitor);
+
+    //The stages run by threads are accounted for once all of them succeeded (on a failure, they stop once the
+    //processes around them are gone)
+    for (int s = 0; s < segmentCount; s++)
+        ok &= joinPluginSegment(&segments[s]);
+    for (int i = first; i < request->operationCount; i++)
+        if (stageWorkers[i])
+            ok &= joinWorkerStage(&remote[i]);
+    if (digestIn >= 0)
+        ok &= joinDigestStage(&digest, &summary);
+    //The first stage may not read the whole input, which is then not hashed (the stage is joined before its
+    //digest is read, since the arguments of a call are evaluated in no given order)
+    if (hashIn >= 0) {
+        bool hashed = joinDigestStage(&inputDigest, &inputSummary) && ok;
+        finishInputHash(request, &cached, hashed, inputSummary.digest);
+    }
+
+    //The files are released the same way whether the pipeline succeeded or not: the preallocated space is
+    //trimmed, and an intermediate output that was not completely copied is removed
+    finishLargeFile(&large);
+    trimOutput(preallocated);
+    if (ok && digestIn < 0 && written >= 0) {
+        struct stat st;
+        summary.outputBytes = fstat(written, &st) || !S_ISREG(st.st_mode) ? -1 : st.st_size;
+    }
+    if (written >= 0)
+        close(written);
+    if (intermediate >= 0) {
+        if (teeIndex < 0)
+            close(intermediate);
+        storeIntermediate(config, request, &cached, ok && teeIndex >= 0 && teeComplete);
+    }
+    if (!ok) {
+        printMessage(STDERR_FILENO, UNEXPECTEDERROR);
+        reportFailure(request, first, opsId, reported, &cached, &summary, &pw);
+        return;
+    }
+
+    for (int i = first; i < request->operationCount; i++) {
+        if (!threaded[i])
+            continue;
+        update.operationId = opsId[i];
+        update.requestId = request->timeOfArrival;
+        update.stage = i;
+        update.usage = stageUsage[i];
+        update.releases = true;
+        update.type = U_FINISHED_OP;
+        writeUpdate(&pw, &update);
+        reported[i] = true;
     }
+    storeResult(config, request, &cached, &summary);
 
     //Request has finished
     //Notify router
-    update.request = request;
+    update.requestId = request->timeOfArrival;
+    update.cache = cached;
+    update.summary = summary;
     update.type = U_REQUEST_FINISHED;
     writeUpdate(&pw, &update);
 
@@ -0,0 +1,174 @@
+/**
+ * @file largeFile.c
+ * 
+ * @brief File implementing the large-file mode, used to keep requests on very large files from flooding
+ * the page cache
+ * 
+ * The job handler keeps its own descriptors of the input and output files, which share their offsets with
+ * the first and last stages. As the stages advance, the input already consumed is dropped from the cache
+ * (posix_fadvise(POSIX_FADV_DONTNEED)) and the output is written back one window at a time
+ * (sync_file_range), the previous window being dropped once it reaches the disk. Every drop covers the file
+ * from its start, since the kernel only drops a folio of the cache that a single call covers entirely, and a
+ * large folio can straddle two windows (the pages already dropped are skipped). With O_DIRECT, the files
+ * are read and written by pumps with aligned buffers and do not go through the cache at all.
+ * 
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "largeFile.h"
+#include "pump.h"
+#include "utils.h"
+
+/**
+ * @brief Determines if a #Request runs in large-file mode, from the size of its input
+ * 
+ * @param large The #LargeFile to initialize
+ * @param config The server #Config
+ * @param in The descriptor of the input file (-1 if it cannot be opened, or is not to be touched)
+ * @param out The descriptor of the output file
+ * 
+ * @return true If the #Request runs in large-file mode
+ * @return false If its input is smaller than the threshold (or the mode is disabled)
+ */
+bool initLargeFile(LargeFile large, Config config, file_d in, file_d out) {
+    struct stat st;
+
+    large->enabled = config->largeFileThreshold && in >= 0 && out >= 0 && !fstat(in, &st)
+        && S_ISREG(st.st_mode) && st.st_size >= config->largeFileThreshold;
+    large->direct = config->largeFileDirect;
+    large->window = config->largeFileWindow;
+    large->input = large->enabled ? dup(in) : -1;
+    large->output = large->enabled ? dup(out) : -1;
+    large->inputDropped = large->outputFlushed = large->outputDropped = 0;
+
+    return large->enabled;
+}
+
+/**
+ * @brief Sets O_DIRECT on a file descriptor
+ * 
+ * @param fd The given file descriptor
+ * 
+ * @return true If the file system supports O_DIRECT
+ * @return false Otherwise
+ */
+bool setDirect(file_d fd) {
+    return !fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_DIRECT);
+}
+
+/**
+ * @brief Starts a pump reading the input file with O_DIRECT, if enabled
+ * 
+ * @param large The given #LargeFile
+ * @param in The descriptor of the input file (closed if a pump is started)
+ * @param pump Where to write the pid of the pump (-1 if none was started)
+ * 
+ * @return file_d The descriptor the first stage should read from
+ */
+file_d startInputPump(LargeFile large, file_d in, pid_t* pump) {
+    file_d fd[2];
+    *pump = -1;
+
+    if(!large->enabled || !large->direct || !setDirect(in) || pipe2(fd, O_CLOEXEC))
+        return in;
+
+    if((*pump = startDirectPump(in, fd[1])) < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return in;
+    }
+
+    close(fd[1]);
+    close(in);
+    close(large->input);
+    large->input = -1;
+    return fd[0];
+}
+
+/**
+ * @brief Starts a pump writing the output file with O_DIRECT, if enabled
+ * 
+ * @param large The given #LargeFile
+ * @param out The descriptor of the output file (closed if a pump is started)
+ * @param pump Where to write the pid of the pump (-1 if none was started)
+ * 
+ * @return file_d The descriptor the last stage should write to
+ */
+file_d startOutputPump(LargeFile large, file_d out, pid_t* pump) {
+    file_d fd[2];
+    *pump = -1;
+
+    if(!large->enabled || !large->direct || !setDirect(out) || pipe2(fd, O_CLOEXEC))
+        return out;
+
+    if((*pump = startDirectPump(fd[0], out)) < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return out;
+    }
+
+    close(fd[0]);
+    close(out);
+    close(large->output);
+    large->output = -1;
+    return fd[1];
+}
+
+/**
+ * @brief Drops the data the stages are done with from the page cache
+ * 
+ * Called periodically while the stages of a #Request in large-file mode are running
+ * 
+ * @param large The given #LargeFile
+ */
+void largeFileTick(LargeFile large) {
+    if(large->input >= 0) {
+        off_t consumed = lseek(large->input, 0, SEEK_CUR);
+
+        if(consumed - large->inputDropped >= large->window) {
+            posix_fadvise(large->input, 0, consumed, POSIX_FADV_DONTNEED);
+            large->inputDropped = consumed;
+        }
+    }
+
+    if(large->output >= 0) {
+        off_t written = lseek(large->output, 0, SEEK_CUR);
+
+        if(written - large->outputFlushed >= large->window) {
+            //Start the write-back of the new window, then wait for the previous one and drop it
+            sync_file_range(large->output, large->outputFlushed, written - large->outputFlushed, SYNC_FILE_RANGE_WRITE);
+            sync_file_range(large->output, large->outputDropped, large->outputFlushed - large->outputDropped,
+                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            posix_fadvise(large->output, 0, large->outputFlushed, POSIX_FADV_DONTNEED);
+            large->outputDropped = large->outputFlushed;
+            large->outputFlushed = written;
+        }
+    }
+}
+
+/**
+ * @brief Writes back and drops what remains of the files of a #Request in large-file mode from the page
+ * cache, once all of its stages have finished
+ * 
+ * @param large The given #LargeFile
+ */
+void finishLargeFile(LargeFile large) {
+    if(!large->enabled)
+        return;
+
+    if(large->input >= 0) {
+        posix_fadvise(large->input, 0, 0, POSIX_FADV_DONTNEED);
+        close(large->input);
+    }
+
+    if(large->output >= 0) {
+        sync_file_range(large->output, large->outputDropped, 0,
+            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(large->output, 0, 0, POSIX_FADV_DONTNEED);
+        close(large->output);
+    }
+}
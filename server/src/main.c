@@ -6,6 +6,8 @@
  */
 
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <signal.h>
@@ -13,7 +15,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "clientSocket.h"
 #include "config.h"
+#include "wire.h"
 #include "logging.h"
 #include "pipeWrapper.h"
 #include "request.h"
@@ -23,6 +27,7 @@
 
 
 file_d fifoInputFd; //< the file descriptor of the fifo entrance to the server
+bool relayStopped; //< whether the relay was asked to stop
 
 /**
  * @brief the handler in case a SIGTERM is received.
@@ -31,20 +36,58 @@ file_d fifoInputFd; //< the file descriptor of the fifo entrance to the server
  */
 void TermHandler(int sig)
 {
-    if (sig == SIGTERM)
+    if (sig == SIGTERM) {
+        relayStopped = true;
         close(fifoInputFd);
+    }
 }
 
 
 
+/**
+ * @brief Forwards the frames buffered from the FIFO to the router
+ * 
+ * @param pr The #PipeReader of the FIFO
+ * @param pw The #PipeWritter to the router
+ * @param channel The socket the requests are passed to the router through
+ * 
+ * @return true If the FIFO is still open
+ * @return false If it was closed
+ */
+bool relayFifo(PipeReader pr, PipeWritter pw, file_d channel)
+{
+    WIRE_HEADER header;
+    char* payload;
+    PEER peer = {0};
+
+    //Several frames may have been read at once, and the poll only sees those still in the FIFO
+    do {
+        if (!readFrame(pr, &header, &payload, WIRE_FIFO_MAX_SIZE))
+            return false;
+        //The frame is checked and sent to the router as it is, the router reads it into a request
+        if (!payload || header.kind != WIRE_REQUEST || !checkRequestFrame(payload, header.length)) {
+            printMessage(STDERR_FILENO, INVALIDFRAME);
+            continue;
+        }
+        printMessage(STDOUT_FILENO, REQUESTRECEIVED);
+        if (!forwardRequest(pw, channel, &header, payload, &peer, NULL))
+            printMessage(STDERR_FILENO, WRITEFAILED);
+    } while (pr->pos < pr->available);
+
+    return true;
+}
+
 /**
  * @brief Runs the relay of the server.
  * 
- * The job of the relay is to transmit the requests from the clients to the router
+ * The job of the relay is to transmit the requests from the clients to the router, from the FIFO and from the
+ * socket
  * 
+ * @param config The #Config of the server
  * @param output The descriptor of the write-end of the pipe to the router
+ * @param channel The socket to pass the requests, and the descriptors of those from the socket, to the router through
  */
-void runRelay(file_d output)
+void runRelay(Config config, file_d output, file_d channel)
 {
     PIPE_WRITTER pw;
     initPipeWritter(&pw, output);
@@ -62,22 +105,27 @@ void runRelay(file_d output)
         }
     PIPE_READER pr;
     initPipeReader(&pr, fifoInputFd);
-
-    Request request = malloc(sizeof(REQUEST));
+    ClientSocket clients = newClientSocket(config, channel);
     UPDATE update;
 
-    while (readRequest(&pr, request))
+    while (!relayStopped)
     {
-        printMessage(STDOUT_FILENO, REQUESTRECEIVED);
-        //send to router as an update through pipe (output)
-        fromRequest(&update, request);
-        writeUpdate(&pw, &update);
-        freeRequestContent(request);
+        struct pollfd polled[1 + getClientPollSize(clients)];
+        polled[0].fd = fifoInputFd;
+        polled[0].events = POLLIN;
+        fillClientPoll(clients, polled + 1);
+
+        if (poll(polled, 1 + getClientPollSize(clients), -1) < 0)
+            continue;
+        if (polled[0].revents && !relayFifo(&pr, &pw, channel))
+            break;
+        serveClients(clients, polled + 1, &pw);
     }
     update.type=U_SERVER_DISCONECTED;
     writeUpdate(&pw, &update);
+    deleteClientSocket(clients);
     close(tempOut);
-    free(request);
+    releasePipeReader(&pr);
     }
 
 /**
@@ -118,10 +166,10 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    file_d router_pipe[2];
+    file_d router_pipe[2], channel[2];
 
-    //create pipe relay -> router
-    if (pipe(router_pipe) == -1) {
+    //create pipe relay -> router, and the socket passing it the requests and the descriptors of the clients
+    if (pipe(router_pipe) == -1 || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel) == -1) {
         unlink(SERVER_NAME);
         printMessage(STDERR_FILENO, PIPECREATEFAILED);
         return 1;
@@ -129,14 +177,17 @@ int main(int argc, char* argv[]) {
     //create router
     pid_t router_pid = fork();
     if (!router_pid) {
-        runRouter(&config, router_pipe[0], router_pipe[1], argv[2]); //send write end too to pass along to the managers
+        close(channel[1]);
+        runRouter(&config, router_pipe[0], router_pipe[1], channel[0], argv[2]); //send write end too to pass along to the managers
         _exit(0);
     }
 
     close(router_pipe[0]);
+    close(channel[0]);
 
-    runRelay(router_pipe[1]);
+    runRelay(&config, router_pipe[1], channel[1]);
     close(router_pipe[1]);
+    close(channel[1]);
     unlink(SERVER_NAME);
     printMessage(STDERR_FILENO, SERVEREXITING);
     waitpid(router_pid,NULL,0);
@@ -0,0 +1,143 @@
+/**
+ * @file optimizer.c
+ * 
+ * @brief File implementing the removal of the redundant operations of a #Request
+ * 
+ * The operations are rewritten using the properties of the transformations declared in the config file:
+ * a transformation marked as "identity" is removed, and a transformation immediately followed by the
+ * transformation declared as its inverse ("inverse=<name>") is removed along with it. Pairs are matched
+ * like parentheses, so "bcompress gcompress gdecompress bdecompress" is removed entirely. A #Request left
+ * without operations is served with a copy of its input.
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "optimizer.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief Maximum length of the optimizer status line
+ * 
+ */
+#define OPTIMIZER_LINE_SIZE 128
+
+/**
+ * @brief The operations removed from the #Request since the server started
+ * 
+ */
+struct optimizer {
+    Config config; ///< The server #Config
+    long optimized; ///< The number of requests with at least one operation removed
+    long removed; ///< The number of operations removed
+    long emptied; ///< The number of requests left without operations (served with a copy of their input)
+};
+
+/**
+ * @brief Creates a new #Optimizer
+ * 
+ * @param config The server #Config
+ * 
+ * @return Optimizer The created #Optimizer
+ * @return NULL If no transformation is declared as an identity or with an inverse
+ */
+Optimizer newOptimizer(Config config) {
+    bool declared = false;
+    for(int i = 0; i < config->programCount; i++)
+        declared |= config->identities[i] || config->inverses[i][0];
+
+    if(!declared)
+        return NULL;
+
+    Optimizer optimizer = calloc(1, sizeof(struct optimizer));
+    optimizer->config = config;
+    return optimizer;
+}
+
+/**
+ * @brief Frees the memory allocated to an #Optimizer
+ * 
+ * @param optimizer The given #Optimizer
+ */
+void deleteOptimizer(Optimizer optimizer) {
+    free(optimizer);
+}
+
+/**
+ * @brief Removes the redundant operations of a #Request (it must be well formed, see checkRequestForm)
+ * 
+ * @param optimizer The given #Optimizer
+ * @param request The given #Request
+ * 
+ * @return char* The message to send to the client listing the removed operations
+ * @return NULL If no operation was removed
+ */
+char* optimizeRequest(Optimizer optimizer, Request request) {
+    //The branches of a request fork after a given number of its operations, which must be kept
+    if(!optimizer || request->branchCount)
+        return NULL;
+
+    Config config = optimizer->config;
+    int size = 96;
+    for(int i = 0; i < request->operationCount; i++)
+        size += strlen(request->operations[i]) + 2;
+
+    char* message = malloc(size);
+    int length = sprintf(message, "Removed redundant operations:");
+    int kept = 0;
+
+    for(int i = 0; i < request->operationCount; i++) {
+        char* operation = request->operations[i];
+        int id = getProgramId(config, operation);
+
+        //The operations removed stay in the frame the request was read from
+        if(config->identities[id]) {
+            length += sprintf(message + length, " %s", operation);
+        } else if(kept && getInverseId(config, getProgramId(config, request->operations[kept - 1])) == id) {
+            kept--;
+            length += sprintf(message + length, " %s %s", request->operations[kept], operation);
+        } else {
+            request->operations[kept++] = operation;
+        }
+    }
+
+    int removed = request->operationCount - kept;
+    request->operationCount = kept;
+    if(!removed) {
+        free(message);
+        return NULL;
+    }
+
+    optimizer->optimized++;
+    optimizer->removed += removed;
+    if(kept)
+        sprintf(message + length, " (%d left)", kept);
+    else {
+        optimizer->emptied++;
+        sprintf(message + length, " (none left, the input is copied)");
+    }
+
+    return message;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the removal of redundant operations
+ * 
+ * @param optimizer The given #Optimizer
+ * 
+ * @return char* The optimizer status string
+ */
+char* getOptimizerStatus(Optimizer optimizer) {
+    char* result = malloc(OPTIMIZER_LINE_SIZE);
+    *result = '\0';
+
+    if(optimizer)
+        snprintf(result, OPTIMIZER_LINE_SIZE, "optimizer: %ld requests shortened, %ld operations removed, %ld served as copies\n",
+            optimizer->optimized, optimizer->removed, optimizer->emptied);
+
+    return result;
+}
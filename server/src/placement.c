@@ -0,0 +1,371 @@
+/**
+ * @file placement.c
+ * 
+ * @brief File implementing the placement of the stages of a pipeline on the CPUs of the machine
+ * 
+ * The CPUs the server may use are grouped in cores (SMT siblings) and the cores are grouped in domains
+ * (cores sharing the last level cache, or the same socket if that information is not available).
+ * Every pipeline is placed on the least loaded domain, with consecutive stages on consecutive cores, so
+ * that the data handed through the pipes stays in a shared cache, while separate pipelines are spread
+ * across the domains of the machine.
+ * 
+ */
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "placement.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief Maximum number of characters read from a sysfs topology file
+ * 
+ */
+#define SYSFS_BUFFER_SIZE 1024
+
+/**
+ * @brief Maximum length of the placement status line of a #Request
+ * 
+ */
+#define PLACEMENT_LINE_SIZE 4096
+
+/**
+ * @brief A group of cores sharing a cache
+ * 
+ */
+typedef struct domain {
+    cpu_set_t cpus; ///< The CPUs of the domain
+    int* cores; ///< The ids of the cores of the domain
+    int coreCount; ///< The number of cores of the domain
+    int load; ///< The number of stages currently placed in the domain
+    int next; ///< The core of the domain the next pipeline starts on
+} DOMAIN, * Domain;
+
+/**
+ * @brief The topology of the machine and the current load of each part of it
+ * 
+ */
+struct placement {
+    PlacementPolicy policy; ///< The placement policy
+    cpu_set_t* cores; ///< The CPUs of each core (SMT siblings)
+    int coreCount; ///< The number of cores
+    DOMAIN* domains; ///< The domains of the machine
+    int domainCount; ///< The number of domains
+};
+
+/**
+ * @brief Parses a list of CPUs in the sysfs format (for example "0-3,8,10-11")
+ * 
+ * @param str The list of CPUs
+ * @param set The set to write the CPUs to
+ */
+void parseCpuList(char* str, cpu_set_t* set) {
+    CPU_ZERO(set);
+
+    while(*str >= '0' && *str <= '9') {
+        int first = strtol(str, &str, 10);
+        int last = first;
+
+        if(*str == '-')
+            last = strtol(str + 1, &str, 10);
+
+        for(int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, set);
+
+        if(*str == ',')
+            str++;
+    }
+}
+
+/**
+ * @brief Reads a list of CPUs from a sysfs topology file of the given CPU
+ * 
+ * @param cpu The given CPU
+ * @param file The path of the file, relative to the directory of the CPU
+ * @param set The set to write the CPUs to
+ * 
+ * @return true If the file was read
+ * @return false If the file does not exist
+ */
+bool readCpuList(int cpu, char* file, cpu_set_t* set) {
+    char path[128];
+    char buffer[SYSFS_BUFFER_SIZE];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, file);
+    file_d fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    int bytesRead = read(fd, buffer, SYSFS_BUFFER_SIZE - 1);
+    close(fd);
+    if(bytesRead <= 0)
+        return false;
+
+    buffer[bytesRead] = '\0';
+    parseCpuList(buffer, set);
+    return true;
+}
+
+/**
+ * @brief Converts a set of CPUs to the sysfs list format
+ * 
+ * @param set The given set
+ * @param str The string to write to
+ * @param size The capacity of the string
+ */
+void cpuListToString(cpu_set_t* set, char* str, int size) {
+    int length = 0;
+    *str = '\0';
+
+    for(int cpu = 0; cpu < CPU_SETSIZE && length < size; cpu++) {
+        if(!CPU_ISSET(cpu, set))
+            continue;
+
+        int last = cpu;
+        while(last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set))
+            last++;
+
+        if(last == cpu)
+            length += snprintf(str + length, size - length, "%s%d", length ? "," : "", cpu);
+        else
+            length += snprintf(str + length, size - length, "%s%d-%d", length ? "," : "", cpu, last);
+        cpu = last;
+    }
+}
+
+/**
+ * @brief Adds the core of the given CPU to the topology, if it was not added already
+ * 
+ * @param placement The given #Placement
+ * @param cpu The given CPU
+ * @param allowed The CPUs the server is allowed to run on
+ */
+void addCore(Placement placement, int cpu, cpu_set_t* allowed) {
+    cpu_set_t siblings, domainCpus;
+
+    if(!readCpuList(cpu, "topology/thread_siblings_list", &siblings)) {
+        CPU_ZERO(&siblings);
+        CPU_SET(cpu, &siblings);
+    }
+    CPU_AND(&siblings, &siblings, allowed);
+
+    for(int i = 0; i < placement->coreCount; i++)
+        if(CPU_ISSET(cpu, &placement->cores[i]))
+            return;
+
+    if(!readCpuList(cpu, "cache/index3/shared_cpu_list", &domainCpus)
+    && !readCpuList(cpu, "topology/core_siblings_list", &domainCpus))
+        domainCpus = *allowed;
+    CPU_AND(&domainCpus, &domainCpus, allowed);
+
+    int coreId = placement->coreCount++;
+    placement->cores = realloc(placement->cores, sizeof(cpu_set_t) * placement->coreCount);
+    placement->cores[coreId] = siblings;
+
+    int domainId = 0;
+    while(domainId < placement->domainCount && !CPU_ISSET(cpu, &placement->domains[domainId].cpus))
+        domainId++;
+
+    if(domainId == placement->domainCount) {
+        placement->domains = realloc(placement->domains, sizeof(DOMAIN) * ++placement->domainCount);
+        Domain domain = &placement->domains[domainId];
+        domain->cpus = domainCpus;
+        domain->cores = NULL;
+        domain->coreCount = domain->load = domain->next = 0;
+    }
+
+    Domain domain = &placement->domains[domainId];
+    domain->cores = realloc(domain->cores, sizeof(int) * ++domain->coreCount);
+    domain->cores[domain->coreCount - 1] = coreId;
+}
+
+/**
+ * @brief Creates a new #Placement, reading the topology of the machine
+ * 
+ * @param policy The placement policy
+ * 
+ * @return Placement The created #Placement
+ * @return NULL If the policy is ::PLACEMENT_NONE or the topology could not be determined
+ */
+Placement newPlacement(PlacementPolicy policy) {
+    cpu_set_t allowed;
+
+    if(policy == PLACEMENT_NONE || sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+        return NULL;
+
+    Placement placement = malloc(sizeof(struct placement));
+    placement->policy = policy;
+    placement->cores = NULL;
+    placement->coreCount = 0;
+    placement->domains = NULL;
+    placement->domainCount = 0;
+
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if(CPU_ISSET(cpu, &allowed))
+            addCore(placement, cpu, &allowed);
+
+    return placement;
+}
+
+/**
+ * @brief Frees the memory allocated to a #Placement
+ * 
+ * @param placement The given #Placement
+ */
+void deletePlacement(Placement placement) {
+    if(!placement)
+        return;
+
+    for(int i = 0; i < placement->domainCount; i++)
+        free(placement->domains[i].cores);
+    free(placement->domains);
+    free(placement->cores);
+    free(placement);
+}
+
+/**
+ * @brief Counts the processes a #Request about to be executed runs, as a load on the CPUs
+ * 
+ * Those are the stages it runs (each slot of a #Request run in chunks runs all of its operations, after the
+ * pump feeding it its chunk), and the pumps of its pipeline: the one feeding it a cached prefix, the one
+ * copying an intermediate output, the two moving the data of a large file and the two at each point its
+ * branches fork at
+ * 
+ * @param request The given #Request
+ * @param config The #Config of the server
+ * 
+ * @return int The number of processes
+ */
+int countProcesses(Request request, Config config) {
+    if(request->chunkWidth)
+        return request->chunkWidth * (request->operationCount + 1);
+
+    int processes = getStageCount(request) - request->cachedOperations;
+    if(request->cachedOperations && request->cachedOperations < request->operationCount)
+        processes++;
+    if(request->materializePrefix)
+        processes++;
+    if(config->largeFileThreshold && request->inputSize >= config->largeFileThreshold)
+        processes += 2;
+
+    for(int b = 0; b < request->branchCount; b++) {
+        int first = 0;
+        while(request->branches[first].parent != request->branches[b].parent
+           || request->branches[first].after != request->branches[b].after)
+            first++;
+        if(first == b)
+            processes += 2;
+    }
+
+    return processes;
+}
+
+/**
+ * @brief Chooses the CPUs the stages of a #Request will run on
+ * 
+ * The #Request is placed on the least loaded domain, starting on the core following the last pipeline
+ * placed on it, and every process it runs is counted in the load of that domain
+ * 
+ * @param placement The given #Placement
+ * @param request The #Request about to be executed (its chunks and cached operations already chosen)
+ * @param config The #Config of the server
+ */
+void placeRequest(Placement placement, Request request, Config config) {
+    request->cpuDomain = -1;
+    if(!placement || !placement->domainCount)
+        return;
+
+    int best = 0;
+    for(int i = 1; i < placement->domainCount; i++)
+        if(placement->domains[i].load < placement->domains[best].load)
+            best = i;
+
+    Domain domain = &placement->domains[best];
+    request->cpuDomain = best;
+    request->cpuCore = domain->next;
+    request->cpuLoad = countProcesses(request, config);
+    domain->load += request->cpuLoad;
+    domain->next = (domain->next + request->cpuLoad) % domain->coreCount;
+}
+
+/**
+ * @brief Releases the CPUs used by a #Request that has finished executing
+ * 
+ * @param placement The given #Placement
+ * @param request The finished #Request
+ */
+void unplaceRequest(Placement placement, Request request) {
+    if(placement && request->cpuDomain >= 0) {
+        placement->domains[request->cpuDomain].load -= request->cpuLoad;
+        request->cpuDomain = -1;
+    }
+}
+
+/**
+ * @brief Gets the CPUs a stage of a #Request may run on
+ * 
+ * @param placement The given #Placement
+ * @param request The given #Request
+ * @param stage The index of the stage in the pipeline (those of the branches follow the operations, see
+ * getStageCount, and for a #Request run in chunks they are counted across its slots: the stages of slot s start
+ * at s times the number of operations)
+ * @param cpus The set to write the CPUs to
+ * 
+ * @return true If the stage should be pinned to the CPUs
+ * @return false If the stage is not pinned
+ */
+bool getStageCpus(Placement placement, Request request, int stage, cpu_set_t* cpus) {
+    if(!placement || request->cpuDomain < 0)
+        return false;
+
+    Domain domain = &placement->domains[request->cpuDomain];
+    *cpus = placement->cores[domain->cores[(request->cpuCore + stage) % domain->coreCount]];
+    return true;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the CPUs the running #Request are placed on
+ * 
+ * @param placement The given #Placement
+ * @param requests The list of all #Request to have arrived at the server
+ * @param requestCount The number of #Request to have arrived at the server
+ * 
+ * @return char* The placement status string
+ */
+char* getPlacementStatus(Placement placement, Request* requests, int requestCount) {
+    int capacity = PLACEMENT_LINE_SIZE;
+    int length = 0;
+    char* result = malloc(capacity);
+    *result = '\0';
+
+    for(int i = 0; placement && i < requestCount; i++) {
+        Request r = requests[i];
+        if(!r || !r->running || r->cpuDomain < 0)
+            continue;
+
+        if(length + PLACEMENT_LINE_SIZE >= capacity) {
+            capacity *= 2;
+            result = realloc(result, capacity);
+        }
+
+        int start = length;
+        length += snprintf(result + length, capacity - length, "placement task #%d (domain %d, %d processes):", r->timeOfArrival, r->cpuDomain, r->cpuLoad);
+        for(int j = r->cachedOperations; j < getStageCount(r) && length - start < PLACEMENT_LINE_SIZE - (MAX_PROGRAM_SIZE + 96); j++) {
+            cpu_set_t cpus;
+            char list[64];
+
+            getStageCpus(placement, r, j, &cpus);
+            cpuListToString(&cpus, list, sizeof(list));
+            length += snprintf(result + length, capacity - length, " %s@%s", getStageOperation(r, j), list);
+        }
+        length += snprintf(result + length, capacity - length, "\n");
+    }
+
+    return result;
+}
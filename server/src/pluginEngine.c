@@ -0,0 +1,456 @@
+/**
+ * @file pluginEngine.c
+ * 
+ * @brief File implementing the loading of the plugins and their execution on worker processes
+ * 
+ * The router loads the shared objects of the transformations declared with the "plugin" attribute once, when
+ * it starts, so that every job handler it forks already has them mapped. A transformation whose plugin cannot
+ * be loaded runs its executable instead.
+ * 
+ * In a job handler, each run of consecutive plugin stages (#PluginSegment) is run by one worker process
+ * forked from it: the output emitted by a stage is passed directly to the next stage, without copies, pipes
+ * or processes of their own. The worker only reads from and writes to descriptors at the ends of the segment,
+ * which can be the files of the #Request or the pipes to the neighbouring stages run as processes, and the
+ * usage of its stages is written to a mapping shared with the job handler. A plugin that crashes kills its
+ * worker, not the job handler, which reports the #Request as failed.
+ * 
+ */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "logging.h"
+#include "plugin.h"
+#include "pluginEngine.h"
+#include "request.h"
+#include "usage.h"
+#include "utils.h"
+
+/**
+ * @brief The size of the buffers read by a worker
+ * 
+ */
+#define PLUGIN_BUFFER_SIZE (128 * 1024)
+
+/**
+ * @brief The suffix of the name of the shared object of a plugin
+ * 
+ */
+#define PLUGIN_SUFFIX ".so"
+
+/**
+ * @brief The directory, next to the executable of the server, the plugins are built into
+ * 
+ */
+#define PLUGIN_DIRECTORY "plugins/"
+
+/**
+ * @brief Maximum length of the plugin status line
+ * 
+ */
+#define PLUGIN_LINE_SIZE (32 + NUMBER_PROGRAMS * (MAX_PROGRAM_SIZE + 2))
+
+/**
+ * @brief The plugins loaded by the router
+ * 
+ */
+struct plugins {
+    void* handles[NUMBER_PROGRAMS]; ///< The handles of the shared objects (NULL if not loaded)
+    const PLUGIN_API* apis[NUMBER_PROGRAMS]; ///< The ABI of each transformation (NULL if it is run as a process)
+};
+
+/**
+ * @brief The sink given to a stage of a segment, to which it emits its output
+ * 
+ */
+typedef struct segmentSink {
+    struct segmentRun* run; ///< The run of the segment
+    int stage; ///< The index of the stage in the segment
+} SEGMENT_SINK, * SegmentSink;
+
+/**
+ * @brief The state of a segment while its worker runs it
+ * 
+ */
+typedef struct segmentRun {
+    PluginSegment segment; ///< The segment
+    void** states; ///< The state of the stream of each stage
+    SEGMENT_SINK* sinks; ///< The sink of each stage
+    int current; ///< The stage the worker is running
+    struct timespec mark; ///< The CPU time of the worker when it started running the current stage
+} SEGMENT_RUN, * SegmentRun;
+
+/**
+ * @brief Opens the shared object of the plugin of a transformation
+ * 
+ * It is looked for next to the executables of the transformations, and then in the #PLUGIN_DIRECTORY next
+ * to the executable of the server
+ * 
+ * @param binPath The path to the binaries (and plugins) of the transformations
+ * @param name The name of the transformation
+ * 
+ * @return void* The handle of the shared object
+ * @return NULL If it cannot be found or loaded
+ */
+void* openPlugin(char* binPath, char* name) {
+    char path[PATH_MAX + MAX_PROGRAM_SIZE + sizeof(PLUGIN_DIRECTORY) + sizeof(PLUGIN_SUFFIX)];
+
+    snprintf(path, sizeof(path), "%s%s%s", binPath, name, PLUGIN_SUFFIX);
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if(handle)
+        return handle;
+
+    ssize_t length = readlink("/proc/self/exe", path, PATH_MAX);
+    if(length <= 0)
+        return NULL;
+    path[length] = '\0';
+    char* slash = strrchr(path, '/');
+    if(!slash)
+        return NULL;
+    sprintf(slash + 1, "%s%s%s", PLUGIN_DIRECTORY, name, PLUGIN_SUFFIX);
+    return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+}
+
+/**
+ * @brief Loads the plugins of the transformations declared with the "plugin" attribute
+ * 
+ * The "plugin" attribute of the transformations whose plugin cannot be loaded is cleared, so that they run
+ * as processes
+ * 
+ * @param config The #Config of the server
+ * @param binPath The path to the binaries (and plugins) of the transformations
+ * 
+ * @return Plugins The loaded plugins
+ * @return NULL If no transformation runs as a plugin
+ */
+Plugins loadPlugins(Config config, char* binPath) {
+    Plugins plugins = calloc(1, sizeof(struct plugins));
+    bool loaded = false;
+
+    for(int i = 0; i < config->programCount; i++) {
+        if(!config->plugins[i])
+            continue;
+
+        void* handle = openPlugin(binPath, config->programs[i]);
+        const PLUGIN_API* api = handle ? dlsym(handle, PLUGIN_SYMBOL) : NULL;
+
+        if(!api || api->abiVersion != PLUGIN_ABI_VERSION || !api->init || !api->process || !api->finish) {
+            printFormattedMessage(STDERR_FILENO, PLUGINNOTLOADED, config->programs[i]);
+            if(handle)
+                dlclose(handle);
+            config->plugins[i] = false;
+            continue;
+        }
+
+        plugins->handles[i] = handle;
+        plugins->apis[i] = api;
+        loaded = true;
+        printFormattedMessage(STDERR_FILENO, PLUGINLOADED, config->programs[i]);
+    }
+
+    if(!loaded) {
+        free(plugins);
+        return NULL;
+    }
+
+    return plugins;
+}
+
+/**
+ * @brief Unloads the plugins and frees the memory allocated to them
+ * 
+ * @param plugins The given #Plugins
+ */
+void unloadPlugins(Plugins plugins) {
+    if(!plugins)
+        return;
+
+    for(int i = 0; i < NUMBER_PROGRAMS; i++)
+        if(plugins->handles[i])
+            dlclose(plugins->handles[i]);
+    free(plugins);
+}
+
+/**
+ * @brief Checks if a transformation runs as a plugin
+ * 
+ * @param plugins The loaded #Plugins
+ * @param id The id of the transformation
+ * 
+ * @return true If it runs in the server
+ * @return false If it runs as a process
+ */
+bool isPluginStage(Plugins plugins, int id) {
+    return plugins && id >= 0 && plugins->apis[id];
+}
+
+/**
+ * @brief Checks if any stage of a #Request runs as a plugin
+ * 
+ * @param plugins The loaded #Plugins
+ * @param config The #Config of the server
+ * @param request The given #Request
+ * 
+ * @return true If a stage runs in the server
+ * @return false If every stage runs as a process
+ */
+bool usesPlugins(Plugins plugins, Config config, Request request) {
+    for(int i = 0; plugins && i < request->operationCount; i++)
+        if(isPluginStage(plugins, getProgramId(config, request->operations[i])))
+            return true;
+
+    return false;
+}
+
+/**
+ * @brief Charges the CPU time used by the worker since the last switch to the stage it was running, and
+ * switches to another stage
+ * 
+ * @param run The run of the segment
+ * @param stage The stage the worker runs from now on
+ */
+void switchStage(SegmentRun run, int stage) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    run->segment->usage[run->current].userTime += (now.tv_sec - run->mark.tv_sec) * 1000000L
+                                                + (now.tv_nsec - run->mark.tv_nsec) / 1000;
+    run->mark = now;
+    run->current = stage;
+}
+
+/**
+ * @brief Writes a buffer entirely to a descriptor
+ * 
+ * @param fd The given descriptor
+ * @param data The buffer
+ * @param length The length of the buffer
+ * 
+ * @return true If the buffer was written
+ * @return false If an error occurred
+ */
+bool writeAll(file_d fd, const char* data, size_t length) {
+    while(length > 0) {
+        ssize_t written = write(fd, data, length);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        data += written;
+        length -= written;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Receives the output emitted by a stage, and gives it to the next stage or writes it to the output
+ * of the segment (#PluginEmit)
+ * 
+ * @param sink The #SegmentSink of the stage
+ * @param data The output
+ * @param length The length of the output
+ * 
+ * @return 0 On success
+ * @return -1 If the output could not be written
+ */
+int emitOutput(void* sink, const char* data, size_t length) {
+    SegmentSink from = sink;
+    SegmentRun run = from->run;
+    PluginSegment segment = run->segment;
+    int next = from->stage + 1;
+
+    segment->usage[from->stage].bytesWritten += length;
+    if(next == segment->count)
+        return writeAll(segment->out, data, length) ? 0 : -1;
+
+    segment->usage[next].bytesRead += length;
+    switchStage(run, next);
+    int result = segment->plugins->apis[segment->opsId[next]]->process(run->states[next], data, length, emitOutput, &run->sinks[next]);
+    switchStage(run, from->stage);
+    return result;
+}
+
+/**
+ * @brief Main function of the worker process of a segment
+ * 
+ * @param segment The #PluginSegment to run (its usage is the shared mapping)
+ */
+void runSegment(PluginSegment segment) {
+    const PLUGIN_API* first = segment->plugins->apis[segment->opsId[0]];
+    void* states[segment->count];
+    SEGMENT_SINK sinks[segment->count];
+    SEGMENT_RUN run = { .segment = segment, .states = states, .sinks = sinks, .current = 0 };
+    struct timespec now;
+
+    //A write to a pipe whose reader is gone fails like those of the stages run as processes
+    signal(SIGPIPE, SIG_IGN);
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &run.mark);
+    int initialized = 0;
+    segment->ok = true;
+    for(; segment->ok && initialized < segment->count; initialized++) {
+        sinks[initialized].run = &run;
+        sinks[initialized].stage = initialized;
+        switchStage(&run, initialized);
+        segment->ok = !segment->plugins->apis[segment->opsId[initialized]]->init(&states[initialized]);
+    }
+    if(!segment->ok)
+        initialized--;
+
+    char* buffer = malloc(PLUGIN_BUFFER_SIZE);
+    ssize_t bytesRead = 0;
+    while(segment->ok && (bytesRead = read(segment->in, buffer, PLUGIN_BUFFER_SIZE)) != 0) {
+        if(bytesRead < 0) {
+            segment->ok = errno == EINTR;
+            continue;
+        }
+        segment->usage[0].bytesRead += bytesRead;
+        switchStage(&run, 0);
+        segment->ok = !first->process(states[0], buffer, bytesRead, emitOutput, &sinks[0]);
+    }
+    free(buffer);
+
+    //Each stage flushes its output to the next one, which is finished after it; the states are always freed
+    for(int i = 0; i < initialized; i++) {
+        switchStage(&run, i);
+        if(segment->plugins->apis[segment->opsId[i]]->finish(states[i], emitOutput, &sinks[i]))
+            segment->ok = false;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        segment->usage[i].realTime = (now.tv_sec - segment->started.tv_sec) * 1000000L
+                                   + (now.tv_nsec - segment->started.tv_nsec) / 1000;
+    }
+    switchStage(&run, 0);
+
+    close(segment->in);
+    close(segment->out);
+}
+
+/**
+ * @brief Starts the worker process of a segment of plugin stages
+ * 
+ * Must only be called once every process of the pipeline has been forked, and before any thread is started
+ * in the job handler. The worker only keeps the descriptors of the segment open, so that the ends of the
+ * pipes it does not use are closed when the other processes are done with them
+ * 
+ * @param plugins The loaded #Plugins
+ * @param segment The #PluginSegment to fill
+ * @param opsId The identifiers of the transformations of the stages of the segment
+ * @param count The number of stages
+ * @param in The descriptor to read the input from (closed)
+ * @param out The descriptor to write the output to (closed)
+ * @param usage The #StageUsage of each stage (zeroed, then filled once the worker is joined)
+ * 
+ * @return true If the worker was started
+ * @return false If it could not be started (joining it reports a failure)
+ */
+bool startPluginSegment(Plugins plugins, PluginSegment segment, int opsId[], int count, file_d in, file_d out, StageUsage usage) {
+    segment->plugins = plugins;
+    segment->opsId = opsId;
+    segment->count = count;
+    segment->usage = usage;
+    segment->reaped = false;
+    segment->ok = false;
+    memset(usage, 0, sizeof(STAGE_USAGE) * count);
+    clock_gettime(CLOCK_MONOTONIC, &segment->started);
+
+    segment->shared = mmap(NULL, sizeof(STAGE_USAGE) * count, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    segment->pid = segment->shared == MAP_FAILED ? -1 : fork();
+    if(!segment->pid) {
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close_range(STDERR_FILENO + 1, ~0U, 0);
+        segment->in = STDIN_FILENO;
+        segment->out = STDOUT_FILENO;
+        segment->usage = segment->shared;
+        runSegment(segment);
+        _exit(!segment->ok);
+    }
+
+    close(in);
+    close(out);
+    if(segment->pid < 0 && segment->shared != MAP_FAILED)
+        munmap(segment->shared, sizeof(STAGE_USAGE) * count);
+    return segment->pid > 0;
+}
+
+/**
+ * @brief Reaps the worker of a segment that exited, keeping its exit status for joinPluginSegment
+ * 
+ * @param segments The segments of the pipeline
+ * @param count The number of segments
+ * @param pid The pid of a child of the job handler that exited
+ * 
+ * @return true If it was the worker of one of the segments
+ * @return false Otherwise (it is not reaped)
+ */
+bool reapPluginSegment(PLUGIN_SEGMENT segments[], int count, pid_t pid) {
+    for(int s = 0; s < count; s++) {
+        if(segments[s].pid != pid || segments[s].reaped)
+            continue;
+
+        segments[s].reaped = waitpid(pid, &segments[s].status, 0) == pid;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Waits for the worker of a segment to finish, and gets the usage of its stages
+ * 
+ * @param segment The given #PluginSegment
+ * 
+ * @return true If every stage of the segment succeeded
+ * @return false Otherwise (the worker failed or crashed)
+ */
+bool joinPluginSegment(PluginSegment segment) {
+    if(segment->pid < 0)
+        return false;
+
+    while(!segment->reaped) {
+        pid_t pid = waitpid(segment->pid, &segment->status, 0);
+        if(pid < 0 && errno != EINTR)
+            break;
+        segment->reaped = pid == segment->pid;
+    }
+
+    segment->ok = segment->reaped && WIFEXITED(segment->status) && !WEXITSTATUS(segment->status);
+    memcpy(segment->usage, segment->shared, sizeof(STAGE_USAGE) * segment->count);
+    munmap(segment->shared, sizeof(STAGE_USAGE) * segment->count);
+    segment->pid = -1;
+    return segment->ok;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the transformations run as plugins
+ * 
+ * @param plugins The loaded #Plugins
+ * @param config The #Config of the server
+ * 
+ * @return char* The plugin status string
+ */
+char* getPluginStatus(Plugins plugins, Config config) {
+    char* result = malloc(PLUGIN_LINE_SIZE);
+    *result = '\0';
+
+    if(!plugins)
+        return result;
+
+    int length = sprintf(result, "plugins:");
+    for(int i = 0; i < config->programCount; i++)
+        if(plugins->apis[i])
+            length += sprintf(result + length, " %s", config->programs[i]);
+    sprintf(result + length, " (run in the server)\n");
+
+    return result;
+}
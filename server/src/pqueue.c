@@ -70,7 +70,7 @@ PQueue createPQueue() {
  * @param position  The position in the heap of the current element
  */
 void bubbleUp(PQueue pqueue, int position) {
-    while (position > 0 && pqueue->requests[PARENT(position)] < pqueue->requests[position]) {
+    while (position > 0 && compareRequests(pqueue->requests[PARENT(position)], pqueue->requests[position]) < 0) {
  
         SWAP(pqueue->requests[PARENT(position)], pqueue->requests[position]);
  
@@ -89,13 +89,13 @@ void bubbleDown(PQueue pqueue, int position) {
  
     int l = LEFT_CHILD(position);
  
-    if (l < pqueue->numberElements && pqueue->requests[l] > pqueue->requests[maxIndex]) {
+    if (l < pqueue->numberElements && compareRequests(pqueue->requests[l], pqueue->requests[maxIndex]) > 0) {
         maxIndex = l;
     }
  
     int r = RIGHT_CHILD(position);
  
-    if (r < pqueue->numberElements && pqueue->requests[r] > pqueue->requests[maxIndex]) {
+    if (r < pqueue->numberElements && compareRequests(pqueue->requests[r], pqueue->requests[maxIndex]) > 0) {
         maxIndex = r;
     }
  
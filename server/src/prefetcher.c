@@ -0,0 +1,200 @@
+/**
+ * @file prefetcher.c
+ * 
+ * @brief File implementing the prefetching of the input files of the requests next in line
+ * 
+ * The input files of the pending #Request with the highest priority are read ahead into the page cache
+ * (posix_fadvise(POSIX_FADV_WILLNEED)) so that their first stage does not stall on cold reads once they
+ * are dispatched. A prefetch counts as a hit if the beginning of the input is still cached when the
+ * #Request is dispatched.
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "prefetcher.h"
+#include "request.h"
+#include "utils.h"
+
+/**
+ * @brief The number of bytes at the start of an input file checked to be cached when it is dispatched
+ * 
+ */
+#define HIT_PROBE_SIZE 65536
+
+/**
+ * @brief Maximum length of the prefetch status line
+ * 
+ */
+#define PREFETCH_LINE_SIZE 256
+
+/**
+ * @brief The state of the prefetching of input files
+ * 
+ */
+struct prefetcher {
+    int depth; ///< The number of requests next in line whose input is prefetched
+    long budget; ///< The maximum number of bytes prefetched and not yet dispatched
+    long inFlight; ///< The number of bytes prefetched and not yet dispatched
+    long issued; ///< The number of prefetches issued
+    long issuedBytes; ///< The number of bytes prefetched
+    long hits; ///< The number of prefetched requests whose input was cached when dispatched
+    long misses; ///< The number of prefetched requests whose input was evicted before being dispatched
+    long unprefetched; ///< The number of requests dispatched without being prefetched
+    Request* next; ///< Buffer with the requests next in line
+};
+
+/**
+ * @brief Creates a new #Prefetcher
+ * 
+ * @param config The server #Config
+ * 
+ * @return Prefetcher The created #Prefetcher
+ * @return NULL If prefetching is disabled
+ */
+Prefetcher newPrefetcher(Config config) {
+    if(!config->prefetchDepth || !config->prefetchBudget)
+        return NULL;
+
+    Prefetcher prefetcher = calloc(1, sizeof(struct prefetcher));
+    prefetcher->depth = config->prefetchDepth;
+    prefetcher->budget = config->prefetchBudget;
+    prefetcher->next = malloc(sizeof(Request) * config->prefetchDepth);
+    return prefetcher;
+}
+
+/**
+ * @brief Frees the memory allocated to a #Prefetcher
+ * 
+ * @param prefetcher The given #Prefetcher
+ */
+void deletePrefetcher(Prefetcher prefetcher) {
+    if(prefetcher) {
+        free(prefetcher->next);
+        free(prefetcher);
+    }
+}
+
+/**
+ * @brief Prefetches the beginning of the input file of a #Request, within the remaining budget
+ * 
+ * @param prefetcher The given #Prefetcher
+ * @param request The given #Request
+ */
+void prefetchInput(Prefetcher prefetcher, Request request) {
+    struct stat st;
+    file_d fd = isStreamRequest(request) ? -1 : reopenRequestInput(request);
+    if(fd < 0)
+        return;
+
+    if(!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+        long size = MIN(st.st_size, prefetcher->budget - prefetcher->inFlight);
+
+        if(!posix_fadvise(fd, 0, size, POSIX_FADV_WILLNEED)) {
+            request->prefetched = size;
+            prefetcher->inFlight += size;
+            prefetcher->issued++;
+            prefetcher->issuedBytes += size;
+        }
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief Prefetches the input files of the pending #Request with the highest priority
+ * 
+ * @param prefetcher The given #Prefetcher
+ * @param requests The list of all #Request in the server
+ * @param requestCount The number of #Request in the list
+ */
+void prefetchNextInputs(Prefetcher prefetcher, Request* requests, int requestCount) {
+    if(!prefetcher || prefetcher->inFlight >= prefetcher->budget)
+        return;
+
+    //Keep the pending requests with the highest priority, in the order they will be dispatched. The list
+    //of requests reuses its slots, so a request only moves ahead of another one that ranks strictly lower
+    //(compareRequests breaks ties between equal priorities by order of arrival)
+    int count = 0;
+    for(int i = 0; i < requestCount; i++) {
+        Request r = requests[i];
+        if(!r || r->running || !r->admitted)
+            continue;
+
+        int pos = count < prefetcher->depth ? count++ : prefetcher->depth;
+        while(pos > 0 && compareRequests(r, prefetcher->next[pos - 1]) > 0) {
+            if(pos < prefetcher->depth)
+                prefetcher->next[pos] = prefetcher->next[pos - 1];
+            pos--;
+        }
+        if(pos < prefetcher->depth)
+            prefetcher->next[pos] = r;
+    }
+
+    for(int i = 0; i < count && prefetcher->inFlight < prefetcher->budget; i++)
+        if(!prefetcher->next[i]->prefetched)
+            prefetchInput(prefetcher, prefetcher->next[i]);
+}
+
+/**
+ * @brief Accounts for a #Request that is about to be dispatched
+ * 
+ * Checks if the beginning of its input is still cached (without reading it from the disk) and releases
+ * the budget used by its prefetch
+ * 
+ * @param prefetcher The given #Prefetcher
+ * @param request The dispatched #Request
+ */
+void prefetchDispatched(Prefetcher prefetcher, Request request) {
+    if(!prefetcher)
+        return;
+
+    if(!request->prefetched) {
+        prefetcher->unprefetched++;
+        return;
+    }
+
+    char buffer[HIT_PROBE_SIZE];
+    struct iovec iov = { .iov_base = buffer, .iov_len = MIN(request->prefetched, HIT_PROBE_SIZE) };
+    file_d fd = reopenRequestInput(request);
+
+    if(fd >= 0 && preadv2(fd, &iov, 1, 0, RWF_NOWAIT) == (ssize_t)iov.iov_len)
+        prefetcher->hits++;
+    else
+        prefetcher->misses++;
+
+    if(fd >= 0)
+        close(fd);
+
+    prefetcher->inFlight -= request->prefetched;
+    request->prefetched = 0;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the prefetching of input files
+ * 
+ * @param prefetcher The given #Prefetcher
+ * 
+ * @return char* The prefetch status string
+ */
+char* getPrefetchStatus(Prefetcher prefetcher) {
+    char* result = malloc(PREFETCH_LINE_SIZE);
+    *result = '\0';
+
+    if(prefetcher) {
+        long dispatched = prefetcher->hits + prefetcher->misses;
+        snprintf(result, PREFETCH_LINE_SIZE,
+            "prefetch: %ld issued (%ld KiB), hit rate %ld/%ld (%ld%%), %ld dispatched without prefetch, %ld/%ld KiB in flight\n",
+            prefetcher->issued, prefetcher->issuedBytes / 1024,
+            prefetcher->hits, dispatched, dispatched ? prefetcher->hits * 100 / dispatched : 0,
+            prefetcher->unprefetched, prefetcher->inFlight / 1024, prefetcher->budget / 1024);
+    }
+
+    return result;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file progress.c
+ * 
+ * @brief File implementing the tracking of the bytes moved by each stage of the running requests
+ * 
+ * The job handlers sample the bytes read and written by each stage of their pipeline at a regular interval
+ * (and once more when the stage finishes), which gives the throughput of every stage and shows which one is
+ * the bottleneck of a chain. The progress of a stage is the share of its expected input it has read: the
+ * input of the first stages is the input file, and the input of the others is extrapolated from the
+ * output/input ratio observed so far on the stage feeding them.
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "progress.h"
+#include "request.h"
+#include "usage.h"
+#include "utils.h"
+
+/**
+ * @brief The initial number of requests the tracker has room for (doubled as needed)
+ * 
+ */
+#define INITIAL_TRACKED 16
+
+/**
+ * @brief Maximum length of the description of a single stage
+ * 
+ */
+#define STAGE_PROGRESS_SIZE (MAX_PROGRAM_SIZE + 96)
+
+/**
+ * @brief The samples of the stages of a running #Request
+ * 
+ */
+typedef struct requestProgress {
+    int stageCount; ///< The number of stages (0 if no sample was received)
+    STAGE_USAGE* last; ///< The last sample of each stage
+    STAGE_USAGE* previous; ///< The sample before the last one of each stage, for the current throughput
+    bool* finished; ///< Whether each stage has finished (its last sample is final)
+} REQUEST_PROGRESS, * RequestProgress;
+
+/**
+ * @brief The samples of the running requests, indexed by their time of arrival
+ * 
+ */
+struct progressTracker {
+    int capacity; ///< The number of requests there is room for
+    RequestProgress requests; ///< The samples of each #Request
+};
+
+/**
+ * @brief Creates a new #ProgressTracker, following no #Request
+ * 
+ * @return ProgressTracker The created #ProgressTracker
+ */
+ProgressTracker newProgressTracker() {
+    ProgressTracker tracker = malloc(sizeof(struct progressTracker));
+    tracker->capacity = INITIAL_TRACKED;
+    tracker->requests = calloc(tracker->capacity, sizeof(REQUEST_PROGRESS));
+    return tracker;
+}
+
+/**
+ * @brief Forgets the samples of a #Request
+ * 
+ * @param progress The samples
+ */
+void clearProgress(RequestProgress progress) {
+    free(progress->last);
+    free(progress->previous);
+    free(progress->finished);
+    memset(progress, 0, sizeof(REQUEST_PROGRESS));
+}
+
+/**
+ * @brief Frees the memory allocated to a #ProgressTracker
+ * 
+ * @param tracker The given #ProgressTracker
+ */
+void deleteProgressTracker(ProgressTracker tracker) {
+    for(int i = 0; i < tracker->capacity; i++)
+        clearProgress(&tracker->requests[i]);
+    free(tracker->requests);
+    free(tracker);
+}
+
+/**
+ * @brief Gets the samples of a #Request
+ * 
+ * @param tracker The given #ProgressTracker
+ * @param request The given #Request
+ * 
+ * @return RequestProgress The samples (NULL if none was received)
+ */
+RequestProgress getProgress(ProgressTracker tracker, Request request) {
+    if(request->timeOfArrival >= tracker->capacity || !tracker->requests[request->timeOfArrival].stageCount)
+        return NULL;
+    return &tracker->requests[request->timeOfArrival];
+}
+
+/**
+ * @brief Records a sample of the bytes moved by a stage of a running #Request
+ * 
+ * @param tracker The given #ProgressTracker
+ * @param request The #Request
+ * @param stage The index of the stage (see getStageCount)
+ * @param usage The #StageUsage of the stage so far (its bytes read and written, and its time running)
+ * @param finished Whether the stage has finished
+ */
+void recordProgress(ProgressTracker tracker, Request request, int stage, StageUsage usage, bool finished) {
+    if(request->timeOfArrival >= tracker->capacity) {
+        int capacity = tracker->capacity;
+        while(capacity <= request->timeOfArrival)
+            capacity *= 2;
+        tracker->requests = realloc(tracker->requests, capacity * sizeof(REQUEST_PROGRESS));
+        memset(tracker->requests + tracker->capacity, 0, (capacity - tracker->capacity) * sizeof(REQUEST_PROGRESS));
+        tracker->capacity = capacity;
+    }
+
+    RequestProgress progress = &tracker->requests[request->timeOfArrival];
+    if(!progress->stageCount) {
+        progress->stageCount = getStageCount(request);
+        progress->last = calloc(progress->stageCount, sizeof(STAGE_USAGE));
+        progress->previous = calloc(progress->stageCount, sizeof(STAGE_USAGE));
+        progress->finished = calloc(progress->stageCount, sizeof(bool));
+    }
+    if(stage >= progress->stageCount)
+        return;
+
+    progress->previous[stage] = progress->last[stage];
+    progress->last[stage] = *usage;
+    progress->finished[stage] = finished;
+}
+
+/**
+ * @brief Gets the expected number of bytes of input of a stage of a #Request
+ * 
+ * @param progress The samples of the #Request
+ * @param request The given #Request
+ * @param stage The index of the stage
+ * 
+ * @return double The expected input (0 if unknown)
+ */
+double getExpectedInput(RequestProgress progress, Request request, int stage) {
+    int from = getStageInput(request, stage);
+    if(from < 0)
+        return request->inputSize;
+
+    StageUsage usage = &progress->last[from];
+    if(progress->finished[from])
+        return usage->bytesWritten;
+
+    //A stage that was not sampled (served by the result cache) is assumed to keep the size of its input
+    double expected = getExpectedInput(progress, request, from);
+    return usage->bytesRead ? expected * usage->bytesWritten / usage->bytesRead : expected;
+}
+
+/**
+ * @brief Writes the progress and current throughput of each stage of a #Request
+ * 
+ * @param progress The samples of the #Request
+ * @param request The given #Request
+ * @param str The string to write to
+ * @param size The size of the string
+ * 
+ * @return int The length written
+ */
+int formatStages(RequestProgress progress, Request request, char* str, int size) {
+    int length = 0;
+
+    for(int i = 0; i < progress->stageCount && length < size; i++) {
+        StageUsage last = &progress->last[i], previous = &progress->previous[i];
+        if(!last->realTime)
+            continue;
+
+        //The throughput is the one since the previous sample, or the average one once the stage is done
+        long elapsed = last->realTime - previous->realTime;
+        long bytes = last->bytesRead - previous->bytesRead;
+        bool current = !progress->finished[i] && elapsed > 0;
+        double rate = current ? (double)bytes / elapsed : (double)last->bytesRead / last->realTime;
+        double expected = getExpectedInput(progress, request, i);
+
+        //A stage is described on its own first, so that a truncated string is never written past its end
+        char stage[STAGE_PROGRESS_SIZE];
+        if(progress->finished[i])
+            snprintf(stage, sizeof(stage), " %s done %.1f MB/s", getStageOperation(request, i), rate);
+        else if(expected > 0)
+            snprintf(stage, sizeof(stage), " %s %.0f%% %.1f MB/s", getStageOperation(request, i),
+                MIN(last->bytesRead * 100 / expected, 100), rate);
+        else
+            snprintf(stage, sizeof(stage), " %s %.1f MB/s", getStageOperation(request, i), rate);
+        length += snprintf(str + length, size - length, "%s", stage);
+    }
+
+    return MIN(length, size - 1);
+}
+
+/**
+ * @brief Stops following a finished #Request, and summarizes the bytes moved by each of its stages
+ * 
+ * @param tracker The given #ProgressTracker
+ * @param request The finished #Request
+ * 
+ * @return char* The summary to send to the client (NULL if no stage was sampled)
+ */
+char* finishProgress(ProgressTracker tracker, Request request) {
+    RequestProgress progress = getProgress(tracker, request);
+    if(!progress)
+        return NULL;
+
+    int size = STAGE_PROGRESS_SIZE * (progress->stageCount + 1);
+    char* result = malloc(size);
+    int length = snprintf(result, size, "Stages:");
+
+    for(int i = 0; i < progress->stageCount && length < size; i++) {
+        StageUsage usage = &progress->last[i];
+        if(!usage->realTime)
+            continue;
+
+        length += snprintf(result + length, size - length, " %s (%.1f MB in, %.1f MB out, %.1f MB/s)",
+            getStageOperation(request, i), usage->bytesRead / 1e6, usage->bytesWritten / 1e6,
+            (double)usage->bytesRead / usage->realTime);
+    }
+
+    clearProgress(progress);
+    return result;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the progress of the running requests
+ * 
+ * @param tracker The given #ProgressTracker
+ * @param requests The requests in the server
+ * @param requestCount The number of requests
+ * 
+ * @return char* The progress status string
+ */
+char* getProgressStatus(ProgressTracker tracker, Request* requests, int requestCount) {
+    int capacity = STAGE_PROGRESS_SIZE;
+    int length = 0;
+    char* result = malloc(capacity);
+    *result = '\0';
+
+    for(int i = 0; i < requestCount; i++) {
+        Request r = requests[i];
+        RequestProgress progress = r && r->running ? getProgress(tracker, r) : NULL;
+        if(!progress)
+            continue;
+
+        int lineSize = STAGE_PROGRESS_SIZE * (progress->stageCount + 1);
+        if(length + lineSize >= capacity) {
+            capacity = (length + lineSize) * 2;
+            result = realloc(result, capacity);
+        }
+
+        length += snprintf(result + length, capacity - length, "progress task #%d:", r->timeOfArrival);
+        length += formatStages(progress, r, result + length, capacity - length - 1);
+        length += snprintf(result + length, capacity - length, "\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,403 @@
+/**
+ * @file pump.c
+ * 
+ * @brief File implementing the processes that move data between the stages of a pipeline and its files,
+ * when the stages cannot use the files directly
+ * 
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pump.h"
+#include "utils.h"
+
+/**
+ * @brief The alignment required by O_DIRECT transfers (buffer address, size and file offset)
+ * 
+ */
+#define DIRECT_ALIGNMENT 4096
+
+/**
+ * @brief The size of the buffer of a pump (must be a multiple of #DIRECT_ALIGNMENT)
+ * 
+ */
+#define PUMP_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * @brief Clears the O_DIRECT flag of a file descriptor
+ * 
+ * @param fd The given file descriptor
+ */
+void clearDirect(file_d fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+}
+
+/**
+ * @brief Fills a buffer from a file descriptor, stopping only when it is full or at the end of the file
+ * 
+ * If the input was opened with O_DIRECT and the kernel refuses an unaligned read, O_DIRECT is cleared
+ * and the read is retried
+ * 
+ * @param in The descriptor to read from
+ * @param buffer The buffer to fill
+ * @param size The size of the buffer
+ * 
+ * @return int The number of bytes read (-1 on error)
+ */
+int fillBuffer(file_d in, char* buffer, int size) {
+    int length = 0;
+
+    while(length < size) {
+        int bytesRead = read(in, buffer + length, size - length);
+
+        if(bytesRead < 0 && errno == EINVAL && (fcntl(in, F_GETFL) & O_DIRECT)) {
+            clearDirect(in);
+            continue;
+        }
+        if(bytesRead < 0)
+            return -1;
+        if(bytesRead == 0)
+            break;
+        length += bytesRead;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Writes a whole buffer to a file descriptor
+ * 
+ * If the output was opened with O_DIRECT, the unaligned tail of the buffer is written after clearing it
+ * 
+ * @param out The descriptor to write to
+ * @param buffer The buffer to write
+ * @param size The number of bytes to write
+ * 
+ * @return true If the buffer was written
+ * @return false If an error occurred
+ */
+bool writeBuffer(file_d out, char* buffer, int size) {
+    if((fcntl(out, F_GETFL) & O_DIRECT) && size % DIRECT_ALIGNMENT) {
+        int aligned = size - size % DIRECT_ALIGNMENT;
+        if(!writeBuffer(out, buffer, aligned))
+            return false;
+        clearDirect(out);
+        buffer += aligned;
+        size -= aligned;
+    }
+
+    while(size > 0) {
+        int written = write(out, buffer, size);
+        if(written < 0)
+            return false;
+        buffer += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Starts a process copying all the data from a descriptor to another one through an aligned buffer,
+ * so that either of them can be a file opened with O_DIRECT
+ * 
+ * The pump only keeps the two descriptors open, so that the ends of the pipes it does not use are closed
+ * when the other processes are done with them
+ * 
+ * @param in The descriptor to read from
+ * @param out The descriptor to write to
+ * 
+ * @return pid_t The pid of the pump (-1 on error)
+ */
+pid_t startDirectPump(file_d in, file_d out) {
+    pid_t pid = fork();
+
+    if(!pid) {
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close_range(STDERR_FILENO + 1, ~0U, 0);
+
+        char* buffer;
+        if(posix_memalign((void**)&buffer, DIRECT_ALIGNMENT, PUMP_BUFFER_SIZE))
+            _exit(1);
+
+        int length;
+        while((length = fillBuffer(STDIN_FILENO, buffer, PUMP_BUFFER_SIZE)) > 0)
+            if(!writeBuffer(STDOUT_FILENO, buffer, length))
+                _exit(1);
+
+        _exit(length < 0);
+    }
+
+    return pid;
+}
+
+/**
+ * @brief Discards data from a pipe
+ * 
+ * @param in The read end of the pipe
+ * @param length The number of bytes to discard
+ * 
+ * @return true If the data was discarded
+ * @return false If an error occurred
+ */
+bool discardFromPipe(file_d in, long length) {
+    char buffer[PIPE_BUF];
+
+    while(length > 0) {
+        int bytesRead = read(in, buffer, MIN(length, PIPE_BUF));
+        if(bytesRead <= 0)
+            return false;
+        length -= bytesRead;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Starts a process forwarding all the data from a pipe to another one, while copying it to a file
+ * 
+ * The data is duplicated inside the kernel (tee) and moved to the file (splice), without going through
+ * the pump. If the copy fails, the data keeps being forwarded and the pump exits with
+ * #TEE_COPY_INCOMPLETE
+ * 
+ * @param in The read end of the input pipe
+ * @param out The write end of the output pipe
+ * @param copy The descriptor of the file to copy the data to
+ * 
+ * @return pid_t The pid of the pump (-1 on error)
+ */
+pid_t startTeePump(file_d in, file_d out, file_d copy) {
+    pid_t pid = fork();
+
+    if(!pid) {
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        dup2(copy, STDERR_FILENO + 1);
+        close_range(STDERR_FILENO + 2, ~0U, 0);
+        copy = STDERR_FILENO + 1;
+
+        bool copying = true;
+        ssize_t length;
+
+        while((length = copying ? tee(STDIN_FILENO, STDOUT_FILENO, PUMP_BUFFER_SIZE, 0)
+                                : splice(STDIN_FILENO, NULL, STDOUT_FILENO, NULL, PUMP_BUFFER_SIZE, 0)) > 0) {
+            if(!copying)
+                continue;
+
+            //Move the data duplicated to the output pipe from the input pipe to the file
+            while(length > 0) {
+                ssize_t moved = splice(STDIN_FILENO, NULL, copy, NULL, length, 0);
+                if(moved <= 0)
+                    break;
+                length -= moved;
+            }
+
+            if(length > 0) {
+                copying = false;
+                if(!discardFromPipe(STDIN_FILENO, length))
+                    _exit(1);
+            }
+        }
+
+        _exit(length < 0 ? 1 : copying ? 0 : TEE_COPY_INCOMPLETE);
+    }
+
+    return pid;
+}
+
+/**
+ * @brief Moves data from a pipe to a descriptor inside the kernel (splice)
+ * 
+ * @param in The read end of the pipe
+ * @param out The descriptor to move the data to
+ * @param length The number of bytes to move (at least that many bytes are in the pipe)
+ * 
+ * @return true If the data was moved
+ * @return false If an error occurred
+ */
+bool moveFromPipe(file_d in, file_d out, long length) {
+    while(length > 0) {
+        ssize_t moved = splice(in, NULL, out, NULL, length, 0);
+        if(moved < 0 && errno == EINTR)
+            continue;
+        if(moved <= 0)
+            return false;
+        length -= moved;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies all the data from a pipe to several descriptors
+ * 
+ * Each step duplicates the data at the head of the pipe to every output that is a pipe (tee), then takes it
+ * out of the input: it is moved (splice) to the only output still missing it, if any, or discarded. The data
+ * is only read by the pump when several outputs are missing part of it (files, or pipes that had no room for
+ * all of it)
+ * 
+ * @param in The read end of the input pipe
+ * @param outs The descriptors to write to
+ * @param count The number of descriptors
+ * 
+ * @return true If all the data was copied
+ * @return false If an error occurred
+ */
+bool fanOut(file_d in, file_d outs[], int count) {
+    struct stat st;
+    bool isPipe[count];
+    long missing[count];
+    char* buffer = NULL;
+    file_d devNull = open("/dev/null", O_WRONLY);
+
+    for(int k = 0; k < count; k++)
+        isPipe[k] = !fstat(outs[k], &st) && S_ISFIFO(st.st_mode);
+
+    while(true) {
+        //The first output that is a pipe waits for data and sets the length of the step
+        ssize_t length = -1;
+        for(int k = 0; k < count; k++) {
+            missing[k] = length;
+            if(!isPipe[k])
+                continue;
+
+            ssize_t copied = tee(in, outs[k], length < 0 ? PUMP_BUFFER_SIZE : length, 0);
+            if(copied < 0 && errno == EINTR) {
+                k--;
+                continue;
+            }
+            if(copied < 0)
+                return false;
+            if(length < 0)
+                length = copied;
+            missing[k] = length - copied;
+            if(!length)
+                return true;
+        }
+
+        //Without outputs that are pipes, every output is written from the buffer
+        if(length < 0) {
+            buffer = buffer ? buffer : malloc(PUMP_BUFFER_SIZE);
+            length = read(in, buffer, PUMP_BUFFER_SIZE);
+            if(length <= 0)
+                return !length;
+            for(int k = 0; k < count; k++)
+                if(!writeBuffer(outs[k], buffer, length))
+                    return false;
+            continue;
+        }
+
+        int missingCount = 0, last = -1;
+        for(int k = 0; k < count; k++) {
+            if(!isPipe[k])
+                missing[k] = length;
+            if(missing[k] > 0) {
+                missingCount++;
+                last = k;
+            }
+        }
+
+        if(!missingCount) {
+            if(!moveFromPipe(in, devNull, length) && !discardFromPipe(in, length))
+                return false;
+        } else if(missingCount == 1 && missing[last] == length) {
+            if(!moveFromPipe(in, outs[last], length))
+                return false;
+        } else {
+            buffer = buffer ? buffer : malloc(PUMP_BUFFER_SIZE);
+            if(fillBuffer(in, buffer, length) != length)
+                return false;
+            for(int k = 0; k < count; k++)
+                if(missing[k] > 0 && !writeBuffer(outs[k], buffer + length - missing[k], missing[k]))
+                    return false;
+        }
+    }
+}
+
+/**
+ * @brief Starts a process copying all the data from a pipe to several descriptors, mostly inside the kernel
+ * 
+ * The pump only keeps the input and the outputs open, so that the ends of the pipes it does not use are
+ * closed when the other processes are done with them
+ * 
+ * @param in The read end of the input pipe
+ * @param outs The descriptors to write to (pipes or files)
+ * @param count The number of descriptors
+ * 
+ * @return pid_t The pid of the pump (-1 on error)
+ */
+pid_t startFanOutPump(file_d in, file_d outs[], int count) {
+    pid_t pid = fork();
+
+    if(!pid) {
+        //Move the descriptors out of the way before renumbering them after the standard ones
+        file_d base = STDERR_FILENO + 1 + count;
+        file_d moved[count + 1];
+        moved[0] = fcntl(in, F_DUPFD, base);
+        for(int k = 0; k < count; k++)
+            moved[k + 1] = fcntl(outs[k], F_DUPFD, base);
+        for(int k = 0; k <= count; k++)
+            if(moved[k] < 0)
+                _exit(1);
+
+        dup2(moved[0], STDIN_FILENO);
+        for(int k = 0; k < count; k++) {
+            outs[k] = STDERR_FILENO + 1 + k;
+            dup2(moved[k + 1], outs[k]);
+        }
+        close_range(base, ~0U, 0);
+
+        _exit(!fanOut(STDIN_FILENO, outs, count));
+    }
+
+    return pid;
+}
+
+/**
+ * @brief Starts a process writing a range of a file to a pipe
+ * 
+ * The data is moved by the kernel (splice), and read with pread if the file cannot be spliced
+ * 
+ * @param in The descriptor of the file
+ * @param offset The offset of the range
+ * @param length The length of the range
+ * @param out The write end of the pipe
+ * 
+ * @return pid_t The pid of the pump (-1 on error)
+ */
+pid_t startRangePump(file_d in, off_t offset, off_t length, file_d out) {
+    pid_t pid = fork();
+
+    if(!pid) {
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close_range(STDERR_FILENO + 1, ~0U, 0);
+
+        loff_t position = offset;
+        ssize_t moved = 0;
+
+        while(length > 0 && (moved = splice(STDIN_FILENO, &position, STDOUT_FILENO, NULL, MIN(length, PUMP_BUFFER_SIZE), 0)) > 0)
+            length -= moved;
+
+        if(moved < 0 && length > 0) {
+            char* buffer = malloc(PUMP_BUFFER_SIZE);
+            while(length > 0 && (moved = pread(STDIN_FILENO, buffer, MIN(length, PUMP_BUFFER_SIZE), position)) > 0) {
+                if(!writeBuffer(STDOUT_FILENO, buffer, moved))
+                    _exit(1);
+                position += moved;
+                length -= moved;
+            }
+        }
+
+        _exit(moved < 0);
+    }
+
+    return pid;
+}
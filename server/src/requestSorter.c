@@ -23,8 +23,22 @@
 struct requestSorter {
     PQueue* queues; ///< The array of all the priority queues being used
     int numberOfQueues; ///< The number of priority queues being used
+    PQueue copies; ///< The queue of the #Request that need no instance (see needsNoInstance)
 };
 
+/**
+ * @brief Checks if a #Request needs no instance: it is a copy of its input (all of its operations were
+ * optimized away), or of its output found in the result cache
+ * 
+ * @param request The given #Request
+ * 
+ * @return true If it needs no instance
+ * @return false Otherwise
+ */
+bool needsNoInstance(Request request) {
+    return getStageCount(request) <= request->cachedOperations;
+}
+
 /**
  * @brief Creates a new #RequestSorter
  * 
@@ -45,6 +59,7 @@ RequestSorter newRequestSorter(int programCount) {
             for(int i = 0; i < programCount; i++) {
                 sorter->queues[i] = createPQueue();
             }
+            sorter->copies = createPQueue();
         } else {
             printMessage(STDOUT_FILENO,REQUESTSORTERFAILEDALLOCQUEUES);
             free(sorter);
@@ -66,6 +81,7 @@ void deleteRequestSolver(RequestSorter sorter) {
     for(int i = 0; i < sorter->numberOfQueues; i++) {
         freePQueue(sorter->queues[i]);
     }
+    freePQueue(sorter->copies);
     
     free(sorter->queues);
     free(sorter);
@@ -85,7 +101,7 @@ bool notEmpty(RequestSorter sorter) {
             return true;
     }
 
-    return false;
+    return !isEmpty(sorter->copies);
 }
 
 
@@ -100,13 +116,17 @@ bool notEmpty(RequestSorter sorter) {
  * @return false        If the push failed (no space left, #Request dropped)
  */
 bool enqueue(RequestSorter sorter, Request request, Config config) {
+    //A request that needs no instance is in no queue of a program, but still waits for its turn
+    if(needsNoInstance(request))
+        return push(sorter->copies, request);
+
     int done[config->programCount];
 
     for(int i = 0; i < config->programCount; i++)
         done[i] = 0;
 
-    for(int i = 0; i < request->operationCount; i++) {
-        done[getProgramId(config, request->operations[i])]++;
+    for(int i = 0; i < getStageCount(request); i++) {
+        done[getProgramId(config, getStageOperation(request, i))]++;
     }
 
     for(int i = 0; i < config->programCount; i++) {
@@ -165,20 +185,25 @@ Request nextInLine(RequestSorter sorter, Config config, int availableInstances[]
     for(int i = 0; i < config->programCount; i++) {
         if(!blocked[i] && tops[i]) {
             bool approved = true;
-            for(int j = 0; j < tops[i]->operationCount && approved; j++) {
-                int opId=getProgramId(config, tops[i]->operations[j]);
+            for(int j = 0; j < getStageCount(tops[i]) && approved; j++) {
+                int opId=getProgramId(config, getStageOperation(tops[i], j));
                 if(peek(sorter->queues[opId]) != tops[i] || blocked[opId])
                     approved = false;
             }
 
-            if(approved && (!result || compareRequests(result, tops[i]) > 0))
+            if(approved && (!result || compareRequests(result, tops[i]) < 0))
                 result = tops[i];
         }
     }
 
+    //A request that needs no instance is never blocked, and goes before those of lower priority
+    Request copy = peek(sorter->copies);
+    if(copy && (!result || compareRequests(result, copy) < 0))
+        return pop(sorter->copies);
+
     if(result) {
-        for(int i = 0; i < result->operationCount; i++) {
-            int id = getProgramId(config, result->operations[i]);
+        for(int i = 0; i < getStageCount(result); i++) {
+            int id = getProgramId(config, getStageOperation(result, i));
             if(!blocked[id]) {
                 //Prevent duplicated pops
                 blocked[id] = 1;
@@ -0,0 +1,989 @@
+/**
+ * @file resultCache.c
+ * 
+ * @brief File implementing the cache of the outputs of finished requests
+ * 
+ * The outputs are kept as files in the cache directory, named by a key derived from the hash and size of
+ * their input and from the ordered list of operations applied to it. Each file ends with a trailer holding
+ * all of these (the operations as they are, not hashed), checked before the output is used, so that two
+ * requests whose keys collide never share an output.
+ * 
+ * The router keeps the index of the cache, and the hashes of the inputs already read by a job handler
+ * (identified by their device, inode, size and last modification). A #Request whose input is known is
+ * looked up before any instance is reserved for it: on a hit, its job handler only copies the cached
+ * output. Otherwise its job handler hashes the input while it streams it into the first stage, and stores
+ * the output once the pipeline has finished. The least recently used outputs are evicted once their total
+ * size exceeds the bound set in the config file. The modification time of each file is its last use, so
+ * that the cache survives a restart of the server.
+ * 
+ * The output of a prefix of the operations is keyed like the output of a #Request with only those
+ * operations, so a #Request can start from any cached output of its prefixes and only run its remaining
+ * stages. Once enough requests share a prefix (it is hot), the stream between the prefix and the rest of
+ * the pipeline is also copied to the cache, as an intermediate output (with its own size bound).
+ * 
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "digest.h"
+#include "fileCopy.h"
+#include "hash.h"
+#include "pump.h"
+#include "request.h"
+#include "resultCache.h"
+#include "utils.h"
+
+/**
+ * @brief Maximum length of the path of a file in the cache
+ * 
+ */
+#define CACHE_PATH_SIZE (MAX_CACHE_DIR_SIZE + 64)
+
+/**
+ * @brief Maximum length of a line of the cache status
+ * 
+ */
+#define CACHE_LINE_SIZE 256
+
+/**
+ * @brief The suffix of the name of the files holding intermediate outputs
+ * 
+ */
+#define INTERMEDIATE_SUFFIX ".prefix"
+
+/**
+ * @brief The magic number ending every file of the cache
+ * 
+ */
+#define CACHE_MAGIC "SDCACHE1"
+
+/**
+ * @brief Maximum number of inputs whose hash is remembered by the router
+ * 
+ */
+#define MAX_KNOWN_INPUTS 1024
+
+/**
+ * @brief The end of a file of the cache, describing the output it holds
+ * 
+ * It follows the output and the operations applied to the input, each as its length (4 bytes) then its
+ * characters
+ * 
+ */
+typedef struct cacheTrailer {
+    uint64_t inputHash; ///< The hash of the contents of the input
+    int64_t inputSize; ///< The size of the input
+    uint64_t digestType; ///< The #DigestType of #digest (::DIGEST_NONE if the output was not digested)
+    uint64_t digest; ///< The digest of the output
+    uint32_t operationCount; ///< The number of operations applied to the input
+    uint32_t operationsLength; ///< The number of bytes taken by the operations
+    char magic[8]; ///< #CACHE_MAGIC
+} CACHE_TRAILER;
+
+/**
+ * @brief An output kept in the cache
+ * 
+ */
+typedef struct cacheEntry {
+    uint64_t key; ///< The key of the output
+    long size; ///< The size of the output
+    long lastUse; ///< The last time the output was stored or used (nanoseconds since the epoch)
+    bool intermediate; ///< Whether the output is the intermediate output of a prefix
+} CACHE_ENTRY, * CacheEntry;
+
+/**
+ * @brief An input file whose contents were hashed by a job handler
+ * 
+ */
+typedef struct knownInput {
+    dev_t device; ///< The device holding the file
+    ino_t inode; ///< The inode of the file
+    long size; ///< The size of the file when it was hashed
+    struct timespec modified; ///< The last modification of the file when it was hashed
+    uint64_t hash; ///< The hash of its contents
+    long lastUse; ///< The last time the hash was learned or used (nanoseconds since the epoch)
+} KNOWN_INPUT, * KnownInput;
+
+/**
+ * @brief The use of the cache by the requests sharing a prefix of operations
+ * 
+ */
+typedef struct prefixStats {
+    char* prefix; ///< The operations of the prefix, separated by spaces
+    long requests; ///< The number of requests dispatched with the prefix
+    long hits; ///< The number of requests that started from a cached output of the prefix
+    long stored; ///< The number of intermediate outputs of the prefix stored in the cache
+} PREFIX_STATS, * PrefixStats;
+
+/**
+ * @brief The index of the result cache, kept by the router
+ * 
+ */
+struct resultCache {
+    char* dir; ///< The cache directory
+    long capacity[2]; ///< The maximum total size of the outputs and of the intermediate outputs kept
+    long used[2]; ///< The total size of the outputs and of the intermediate outputs kept
+    CACHE_ENTRY* entries; ///< The outputs kept
+    int entryCount; ///< The number of outputs kept
+    KNOWN_INPUT* inputs; ///< The inputs whose hash is known
+    int inputCount; ///< The number of inputs whose hash is known
+    long hits; ///< The number of requests served from the cache
+    long misses; ///< The number of requests whose output was not in the cache
+    long evictions; ///< The number of outputs evicted
+    int prefixHot; ///< The number of requests sharing a prefix from which it is hot
+    PREFIX_STATS* prefixes; ///< The use of the cache by each prefix
+    int prefixCount; ///< The number of prefixes
+};
+
+/**
+ * @brief Gets the path of the file holding an output in the cache
+ * 
+ * @param dir The cache directory
+ * @param key The key of the output
+ * @param intermediate Whether the output is an intermediate output
+ * @param path The string to write to (of size #CACHE_PATH_SIZE)
+ */
+void getCachePath(char* dir, uint64_t key, bool intermediate, char* path) {
+    snprintf(path, CACHE_PATH_SIZE, "%s/%016" PRIx64 "%s", dir, key, intermediate ? INTERMEDIATE_SUFFIX : "");
+}
+
+/**
+ * @brief Gets the current time, in nanoseconds since the epoch
+ * 
+ * @return long The current time
+ */
+long getCacheTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/**
+ * @brief Writes the first operations of a #Request, each as its length (4 bytes) then its characters
+ * 
+ * @param request The given #Request
+ * @param length The number of operations
+ * @param buffer The buffer to write to (NULL to only get the size needed)
+ * 
+ * @return int The number of bytes taken by the operations
+ */
+int encodeOperations(Request request, int length, char* buffer) {
+    int size = 0;
+
+    for(int i = 0; i < length; i++) {
+        uint32_t operationLength = strlen(request->operations[i]);
+        if(buffer) {
+            memcpy(buffer + size, &operationLength, sizeof(operationLength));
+            memcpy(buffer + size + sizeof(operationLength), request->operations[i], operationLength);
+        }
+        size += sizeof(operationLength) + operationLength;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Computes the key of the output of the first operations of a #Request
+ * 
+ * The size of the input and the operations, in order, are chained to the hash of the input
+ * 
+ * @param inputHash The hash of the contents of the input
+ * @param inputSize The size of the input
+ * @param request The given #Request
+ * @param length The number of operations
+ * 
+ * @return uint64_t The key
+ */
+uint64_t getResultKey(uint64_t inputHash, long inputSize, Request request, int length) {
+    int size = encodeOperations(request, length, NULL);
+    char operations[size + 1];
+    encodeOperations(request, length, operations);
+
+    int64_t bytes = inputSize;
+    uint64_t key = hashBytes(&bytes, sizeof(bytes), inputHash);
+    return hashBytes(operations, size, key);
+}
+
+/**
+ * @brief Appends the trailer describing an output to the file holding it
+ * 
+ * @param fd The descriptor of the file (its whole output already written)
+ * @param inputHash The hash of the contents of the input
+ * @param inputSize The size of the input
+ * @param request The #Request the output belongs to
+ * @param length The number of operations applied to the input
+ * @param summary The #OutputSummary holding the digest of the output (NULL for an intermediate output)
+ * 
+ * @return true If the trailer was written
+ * @return false Otherwise
+ */
+bool writeTrailer(file_d fd, uint64_t inputHash, long inputSize, Request request, int length, OutputSummary summary) {
+    int size = encodeOperations(request, length, NULL);
+    char trailer[size + sizeof(CACHE_TRAILER)];
+    CACHE_TRAILER end;
+
+    encodeOperations(request, length, trailer);
+    memset(&end, 0, sizeof(end));
+    end.inputHash = inputHash;
+    end.inputSize = inputSize;
+    end.digestType = summary && (summary->digestType == DIGEST_CRC32C || summary->digestType == DIGEST_XXH64) ? summary->digestType : DIGEST_NONE;
+    end.digest = end.digestType != DIGEST_NONE ? summary->digest : 0;
+    end.operationCount = length;
+    end.operationsLength = size;
+    memcpy(end.magic, CACHE_MAGIC, sizeof(end.magic));
+    memcpy(trailer + size, &end, sizeof(end));
+
+    return lseek(fd, 0, SEEK_END) >= 0 && writeBuffer(fd, trailer, sizeof(trailer));
+}
+
+/**
+ * @brief Opens a file of the cache, checking that it holds the output of the given operations and input
+ * 
+ * @param dir The cache directory
+ * @param key The key of the output
+ * @param intermediate Whether the output is an intermediate output
+ * @param inputHash The hash of the contents of the input
+ * @param inputSize The size of the input
+ * @param request The #Request the output is looked up for
+ * @param length The number of operations applied to the input
+ * @param size Where to write the size of the output, without its trailer
+ * @param end Where to write the trailer of the file
+ * 
+ * @return file_d The descriptor of the file (-1 if it is missing, or holds the output of something else)
+ */
+file_d openCachedOutput(char* dir, uint64_t key, bool intermediate, uint64_t inputHash, long inputSize, Request request, int length, long* size, CACHE_TRAILER* end) {
+    char path[CACHE_PATH_SIZE];
+    int operationsLength = encodeOperations(request, length, NULL);
+    char operations[operationsLength + 1], stored[operationsLength + 1];
+    struct stat st;
+
+    getCachePath(dir, key, intermediate, path);
+    file_d fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+
+    encodeOperations(request, length, operations);
+    *size = fstat(fd, &st) ? -1 : st.st_size - (long)sizeof(*end) - operationsLength;
+    if(*size < 0 || pread(fd, end, sizeof(*end), st.st_size - sizeof(*end)) != sizeof(*end)
+    || memcmp(end->magic, CACHE_MAGIC, sizeof(end->magic)) || end->inputHash != inputHash || end->inputSize != inputSize
+    || end->operationCount != (uint32_t)length || end->operationsLength != (uint32_t)operationsLength
+    || pread(fd, stored, operationsLength, *size) != operationsLength || memcmp(stored, operations, operationsLength)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Checks if a file of the cache ends with a trailer
+ * 
+ * @param path The path of the file
+ * 
+ * @return true If it does
+ * @return false If it was left by an older server, or was not completely written
+ */
+bool hasTrailer(char* path) {
+    CACHE_TRAILER end;
+    struct stat st;
+
+    file_d fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+
+    bool valid = !fstat(fd, &st) && st.st_size >= (off_t)sizeof(end)
+              && pread(fd, &end, sizeof(end), st.st_size - sizeof(end)) == sizeof(end)
+              && !memcmp(end.magic, CACHE_MAGIC, sizeof(end.magic));
+    close(fd);
+    return valid;
+}
+
+/**
+ * @brief Finds the entry of an output in the cache
+ * 
+ * @param cache The given #ResultCache
+ * @param key The key of the output
+ * @param intermediate Whether the output is an intermediate output
+ * 
+ * @return CacheEntry The entry of the output (NULL if it is not in the cache)
+ */
+CacheEntry findEntry(ResultCache cache, uint64_t key, bool intermediate) {
+    for(int i = 0; i < cache->entryCount; i++)
+        if(cache->entries[i].key == key && cache->entries[i].intermediate == intermediate)
+            return &cache->entries[i];
+
+    return NULL;
+}
+
+/**
+ * @brief Adds an output to the index of the cache (or updates it)
+ * 
+ * @param cache The given #ResultCache
+ * @param key The key of the output
+ * @param intermediate Whether the output is an intermediate output
+ * @param size The size of the output
+ * @param lastUse The last time the output was stored or used
+ */
+void addEntry(ResultCache cache, uint64_t key, bool intermediate, long size, long lastUse) {
+    CacheEntry entry = findEntry(cache, key, intermediate);
+
+    if(!entry) {
+        cache->entries = realloc(cache->entries, sizeof(CACHE_ENTRY) * ++cache->entryCount);
+        entry = &cache->entries[cache->entryCount - 1];
+        entry->key = key;
+        entry->intermediate = intermediate;
+        entry->size = 0;
+    }
+
+    cache->used[(int)intermediate] += size - entry->size;
+    entry->size = size;
+    entry->lastUse = lastUse;
+}
+
+/**
+ * @brief Removes an output from the cache, and its file
+ * 
+ * @param cache The given #ResultCache
+ * @param entry The entry of the output
+ */
+void removeEntry(ResultCache cache, CacheEntry entry) {
+    char path[CACHE_PATH_SIZE];
+
+    getCachePath(cache->dir, entry->key, entry->intermediate, path);
+    unlink(path);
+    cache->used[(int)entry->intermediate] -= entry->size;
+    *entry = cache->entries[--cache->entryCount];
+}
+
+/**
+ * @brief Evicts the least recently used outputs of a kind until it is within its capacity
+ * 
+ * @param cache The given #ResultCache
+ * @param intermediate Whether to evict intermediate outputs or outputs of requests
+ */
+void evictEntries(ResultCache cache, bool intermediate) {
+    while(cache->used[(int)intermediate] > cache->capacity[(int)intermediate]) {
+        int oldest = -1;
+        for(int i = 0; i < cache->entryCount; i++)
+            if(cache->entries[i].intermediate == intermediate
+            && (oldest < 0 || cache->entries[i].lastUse < cache->entries[oldest].lastUse))
+                oldest = i;
+
+        removeEntry(cache, &cache->entries[oldest]);
+        cache->evictions++;
+    }
+}
+
+/**
+ * @brief Finds the hash of the contents of an input file
+ * 
+ * @param cache The given #ResultCache
+ * @param st The status of the file
+ * 
+ * @return KnownInput The hash of the file (NULL if it was never hashed, or was modified since)
+ */
+KnownInput findInput(ResultCache cache, struct stat* st) {
+    for(int i = 0; i < cache->inputCount; i++) {
+        KnownInput input = &cache->inputs[i];
+        if(input->device == st->st_dev && input->inode == st->st_ino && input->size == st->st_size
+        && input->modified.tv_sec == st->st_mtim.tv_sec && input->modified.tv_nsec == st->st_mtim.tv_nsec) {
+            input->lastUse = getCacheTime();
+            return input;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Remembers the hash of an input file computed by a job handler
+ * 
+ * An earlier hash of the same file is replaced, and the least recently used input is forgotten once
+ * #MAX_KNOWN_INPUTS are known
+ * 
+ * @param cache The given #ResultCache
+ * @param outcome The #CacheOutcome holding the identity and hash of the file
+ */
+void learnInput(ResultCache cache, CacheOutcome outcome) {
+    KnownInput input = NULL;
+
+    for(int i = 0; i < cache->inputCount && !input; i++)
+        if(cache->inputs[i].device == outcome->inputDevice && cache->inputs[i].inode == outcome->inputInode)
+            input = &cache->inputs[i];
+
+    if(!input && cache->inputCount < MAX_KNOWN_INPUTS) {
+        cache->inputs = realloc(cache->inputs, sizeof(KNOWN_INPUT) * ++cache->inputCount);
+        input = &cache->inputs[cache->inputCount - 1];
+    }
+
+    if(!input) {
+        input = &cache->inputs[0];
+        for(int i = 1; i < cache->inputCount; i++)
+            if(cache->inputs[i].lastUse < input->lastUse)
+                input = &cache->inputs[i];
+    }
+
+    input->device = outcome->inputDevice;
+    input->inode = outcome->inputInode;
+    input->size = outcome->inputSize;
+    input->modified = outcome->inputModified;
+    input->hash = outcome->inputHash;
+    input->lastUse = getCacheTime();
+}
+
+/**
+ * @brief Creates a new #ResultCache, indexing the outputs already in the cache directory
+ * 
+ * Temporary files left by job handlers that did not finish storing an output are removed, as are the
+ * files without a trailer
+ * 
+ * @param config The server #Config
+ * 
+ * @return ResultCache The created #ResultCache
+ * @return NULL If the cache is disabled or its directory cannot be opened
+ */
+ResultCache newResultCache(Config config) {
+    if(!config->cacheDir[0])
+        return NULL;
+
+    mkdir(config->cacheDir, 0770);
+    DIR* dir = opendir(config->cacheDir);
+    if(!dir)
+        return NULL;
+
+    ResultCache cache = calloc(1, sizeof(struct resultCache));
+    cache->dir = config->cacheDir;
+    cache->capacity[false] = config->cacheSize;
+    cache->capacity[true] = config->prefixCacheSize;
+    cache->prefixHot = config->prefixHot;
+
+    struct dirent* file;
+    while((file = readdir(dir))) {
+        char path[CACHE_PATH_SIZE];
+        struct stat st;
+        char* end;
+
+        snprintf(path, CACHE_PATH_SIZE, "%s/%s", cache->dir, file->d_name);
+        if(file->d_name[0] == '.' && strcmp(file->d_name, ".") && strcmp(file->d_name, ".."))
+            unlink(path);
+
+        uint64_t key = strtoull(file->d_name, &end, 16);
+        bool intermediate = !strcmp(end, INTERMEDIATE_SUFFIX);
+        if(end - file->d_name != 16 || (*end && !intermediate) || stat(path, &st) || !S_ISREG(st.st_mode))
+            continue;
+
+        if(hasTrailer(path))
+            addEntry(cache, key, intermediate, st.st_size, st.st_mtim.tv_sec * 1000000000L + st.st_mtim.tv_nsec);
+        else
+            unlink(path);
+    }
+
+    closedir(dir);
+    evictEntries(cache, false);
+    evictEntries(cache, true);
+    return cache;
+}
+
+/**
+ * @brief Frees the memory allocated to a #ResultCache (the cached outputs are kept)
+ * 
+ * @param cache The given #ResultCache
+ */
+void deleteResultCache(ResultCache cache) {
+    if(cache) {
+        for(int i = 0; i < cache->prefixCount; i++)
+            free(cache->prefixes[i].prefix);
+        free(cache->prefixes);
+        free(cache->entries);
+        free(cache->inputs);
+        free(cache);
+    }
+}
+
+/**
+ * @brief Gets the use of the cache by a prefix of operations, adding it if it was never used
+ * 
+ * @param cache The given #ResultCache
+ * @param request A #Request with the prefix
+ * @param length The number of operations of the prefix
+ * 
+ * @return PrefixStats The use of the cache by the prefix
+ */
+PrefixStats getPrefixStats(ResultCache cache, Request request, int length) {
+    int size = 0;
+    for(int i = 0; i < length; i++)
+        size += strlen(request->operations[i]) + 1;
+
+    char prefix[size + 1];
+    prefix[0] = '\0';
+    for(int i = 0; i < length; i++) {
+        if(i)
+            strcat(prefix, " ");
+        strcat(prefix, request->operations[i]);
+    }
+
+    for(int i = 0; i < cache->prefixCount; i++)
+        if(!strcmp(cache->prefixes[i].prefix, prefix))
+            return &cache->prefixes[i];
+
+    cache->prefixes = realloc(cache->prefixes, sizeof(PREFIX_STATS) * ++cache->prefixCount);
+    PrefixStats stats = &cache->prefixes[cache->prefixCount - 1];
+    stats->prefix = strdup(prefix);
+    stats->requests = stats->hits = stats->stored = 0;
+    return stats;
+}
+
+/**
+ * @brief Looks up the longest prefix of the operations of a #Request whose output is in the cache
+ * 
+ * Called by the router before reserving the instances of the #Request, which are only needed by the
+ * operations after that prefix (none if its whole output is cached). Only a #Request whose input was
+ * already hashed, and not modified since, can be found. The outputs of requests and the intermediate
+ * outputs can both be used
+ * 
+ * Sets the #inputHash, #inputHashed, #cachedOperations and #cachedIntermediate of the #Request, and the
+ * identity of its input
+ * 
+ * @param cache The given #ResultCache
+ * @param request The given #Request
+ * 
+ * @return int The number of operations whose output is cached (0 if none)
+ */
+int lookupCache(ResultCache cache, Request request) {
+    CACHE_TRAILER end;
+    struct stat st;
+    long size;
+
+    request->inputHashed = false;
+    request->cachedOperations = 0;
+    request->cachedIntermediate = false;
+    //The outputs of the branches of a request are not cached, nor those of a stream (it cannot be hashed)
+    if(!cache || !request->operationCount || request->branchCount || isStreamRequest(request)
+    || statRequestInput(request, &st) || !S_ISREG(st.st_mode))
+        return 0;
+
+    request->inputInode = st.st_ino;
+    request->inputModified = st.st_mtim;
+    request->inputSize = st.st_size;
+    KnownInput input = findInput(cache, &st);
+    if(!input)
+        return 0;
+
+    request->inputHash = input->hash;
+    request->inputHashed = true;
+    for(int length = request->operationCount; length > 0; length--) {
+        uint64_t key = getResultKey(input->hash, st.st_size, request, length);
+
+        for(int intermediate = false; intermediate <= (length < request->operationCount); intermediate++) {
+            if(!findEntry(cache, key, intermediate))
+                continue;
+
+            file_d fd = openCachedOutput(cache->dir, key, intermediate, input->hash, st.st_size, request, length, &size, &end);
+            if(fd >= 0) {
+                close(fd);
+                request->cachedOperations = length;
+                request->cachedIntermediate = intermediate;
+                return length;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Accounts for the prefixes of a #Request about to be dispatched, and chooses the prefix whose
+ * intermediate output it should store in the cache
+ * 
+ * The longest hot prefix is chosen (the last operation is not a prefix, its output is the output of the
+ * #Request)
+ * 
+ * @param cache The given #ResultCache
+ * @param request The given #Request
+ */
+void choosePrefix(ResultCache cache, Request request) {
+    request->materializePrefix = 0;
+    if(!cache || !cache->capacity[true] || isStreamRequest(request))
+        return;
+
+    for(int length = 1; length < request->operationCount; length++)
+        if(++getPrefixStats(cache, request, length)->requests >= cache->prefixHot)
+            request->materializePrefix = length;
+}
+
+/**
+ * @brief Accounts for the use of the cache by a finished #Request
+ * 
+ * @param cache The given #ResultCache
+ * @param outcome The #CacheOutcome sent by the job handler of the #Request
+ * @param request The finished #Request
+ */
+void cacheFinished(ResultCache cache, CacheOutcome outcome, Request request) {
+    if(!cache)
+        return;
+
+    CacheEntry entry;
+    if(outcome->hashed && outcome->inputInode)
+        learnInput(cache, outcome);
+
+    if(outcome->prefixHit)
+        getPrefixStats(cache, request, outcome->prefixHit)->hits++;
+
+    if(outcome->prefixStored) {
+        getPrefixStats(cache, request, outcome->prefixStored)->stored++;
+        addEntry(cache, outcome->prefixKey, true, outcome->prefixSize, getCacheTime());
+        evictEntries(cache, true);
+    }
+
+    switch(outcome->status) {
+        case CACHE_HIT:
+            cache->hits++;
+            if((entry = findEntry(cache, outcome->key, false)))
+                entry->lastUse = getCacheTime();
+            break;
+
+        case CACHE_STORED:
+            cache->misses++;
+            addEntry(cache, outcome->key, false, outcome->size, getCacheTime());
+            evictEntries(cache, false);
+            break;
+
+        case CACHE_MISSED:
+            cache->misses++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Forgets the cached output a #Request was dispatched to start from, once its job handler found it
+ * missing or replaced
+ * 
+ * The #Request is then run again from its input
+ * 
+ * @param cache The given #ResultCache
+ * @param request The given #Request
+ */
+void cacheLost(ResultCache cache, Request request) {
+    if(cache && request->cachedOperations) {
+        uint64_t key = getResultKey(request->inputHash, request->inputSize, request, request->cachedOperations);
+        CacheEntry entry = findEntry(cache, key, request->cachedIntermediate);
+        if(entry)
+            removeEntry(cache, entry);
+    }
+
+    request->cachedOperations = 0;
+    request->cachedIntermediate = false;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the result cache
+ * 
+ * @param cache The given #ResultCache
+ * 
+ * @return char* The cache status string
+ */
+char* getCacheStatus(ResultCache cache) {
+    if(!cache) {
+        char* result = malloc(1);
+        *result = '\0';
+        return result;
+    }
+
+    int capacity = CACHE_LINE_SIZE * 2;
+    for(int i = 0; i < cache->prefixCount; i++)
+        capacity += CACHE_LINE_SIZE + strlen(cache->prefixes[i].prefix);
+
+    char* result = malloc(capacity);
+    long lookups = cache->hits + cache->misses;
+    int length = snprintf(result, CACHE_LINE_SIZE,
+        "result cache: %ld/%ld KiB, hit rate %ld/%ld (%ld%%), %ld evicted, %d inputs hashed\n",
+        cache->used[false] / 1024, cache->capacity[false] / 1024,
+        cache->hits, lookups, lookups ? cache->hits * 100 / lookups : 0, cache->evictions, cache->inputCount);
+
+    if(cache->capacity[true])
+        length += snprintf(result + length, CACHE_LINE_SIZE, "prefix cache: %ld/%ld KiB\n",
+            cache->used[true] / 1024, cache->capacity[true] / 1024);
+
+    for(int i = 0; i < cache->prefixCount; i++) {
+        PrefixStats stats = &cache->prefixes[i];
+        length += sprintf(result + length, "prefix \"%s\": %ld requests, %ld hits, %ld stored\n",
+            stats->prefix, stats->requests, stats->hits, stats->stored);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Prepares the #CacheOutcome of a #Request, in its job handler
+ * 
+ * The hash of the input found by the router is used if the input was not modified since (or if the
+ * #Request starts from a cached output, and does not read its input). Otherwise the input has to be
+ * hashed while it is streamed into the first stage (see #finishInputHash)
+ * 
+ * @param config The server #Config
+ * @param request The given #Request
+ * @param in The descriptor of the input file
+ * @param outcome The #CacheOutcome to fill
+ */
+void initCacheOutcome(Config config, Request request, file_d in, CacheOutcome outcome) {
+    struct stat st;
+
+    memset(outcome, 0, sizeof(CACHE_OUTCOME));
+    outcome->status = CACHE_UNUSED;
+    if(!config->cacheDir[0] || request->branchCount || isStreamRequest(request))
+        return;
+
+    outcome->status = CACHE_MISSED;
+    if(request->cachedOperations) {
+        outcome->inputHash = request->inputHash;
+        outcome->inputSize = request->inputSize;
+        outcome->hashed = true;
+        return;
+    }
+
+    if(in < 0 || fstat(in, &st) || !S_ISREG(st.st_mode)) {
+        outcome->status = CACHE_UNUSED;
+        return;
+    }
+
+    outcome->inputDevice = st.st_dev;
+    outcome->inputInode = st.st_ino;
+    outcome->inputSize = st.st_size;
+    outcome->inputModified = st.st_mtim;
+    outcome->hashed = request->inputHashed && request->inputInode == st.st_ino && request->inputSize == st.st_size
+                   && request->inputModified.tv_sec == st.st_mtim.tv_sec && request->inputModified.tv_nsec == st.st_mtim.tv_nsec;
+    outcome->inputHash = outcome->hashed ? request->inputHash : 0;
+}
+
+/**
+ * @brief Records the hash of the input computed while it was streamed into the first stage
+ * 
+ * The hash is only kept if the whole input was read, and the input was not modified meanwhile
+ * 
+ * @param request The given #Request
+ * @param outcome The #CacheOutcome of the #Request
+ * @param complete Whether the whole input was hashed
+ * @param hash The hash of the input
+ */
+void finishInputHash(Request request, CacheOutcome outcome, bool complete, uint64_t hash) {
+    struct stat st;
+
+    if(outcome->status != CACHE_MISSED || outcome->hashed)
+        return;
+
+    if(complete && !statRequestInput(request, &st) && st.st_dev == outcome->inputDevice && st.st_ino == outcome->inputInode
+    && st.st_size == outcome->inputSize && st.st_mtim.tv_sec == outcome->inputModified.tv_sec
+    && st.st_mtim.tv_nsec == outcome->inputModified.tv_nsec) {
+        outcome->inputHash = hash;
+        outcome->hashed = true;
+    }
+}
+
+/**
+ * @brief Copies the output of a #Request found in the cache by the router to its output file
+ * 
+ * The digest of the output asked for by the config file is the one stored with it, or is computed from the
+ * cached output if it was stored with another one
+ * 
+ * @param config The server #Config
+ * @param request The given #Request (its #cachedOperations are all of its operations)
+ * @param out The descriptor of the (empty) output file
+ * @param outcome The #CacheOutcome of the #Request (::CACHE_HIT, or ::CACHE_LOST if the output could not be
+ * copied)
+ * @param summary The #OutputSummary of the #Request (the size and digest of the output are set on a hit)
+ * 
+ * @return true If the output was copied from the cache
+ * @return false If it has to be produced by the transformations (the #Request must be run again)
+ */
+bool serveResult(Config config, Request request, file_d out, CacheOutcome outcome, OutputSummary summary) {
+    CACHE_TRAILER end;
+    long size;
+
+    outcome->key = getResultKey(request->inputHash, request->inputSize, request, request->operationCount);
+    file_d cached = openCachedOutput(config->cacheDir, outcome->key, false, request->inputHash, request->inputSize, request, request->operationCount, &size, &end);
+
+    bool hit = cached >= 0 && out >= 0 && copyFileRange(cached, 0, out, 0, size);
+    if(hit) {
+        outcome->status = CACHE_HIT;
+        outcome->size = size;
+        summary->outputBytes = size;
+        if(config->outputDigest != DIGEST_NONE && end.digestType == config->outputDigest) {
+            summary->digestType = config->outputDigest;
+            summary->digest = end.digest;
+        } else if(config->outputDigest != DIGEST_NONE) {
+            DIGEST_STAGE digest;
+            initDigest(&digest, config->outputDigest);
+            digestRange(&digest, cached, 0, size);
+            finishDigest(&digest, summary);
+        }
+        futimens(cached, NULL);
+    } else {
+        outcome->status = CACHE_LOST;
+        if(out >= 0)
+            ftruncate(out, 0);
+    }
+
+    if(cached >= 0)
+        close(cached);
+    return hit;
+}
+
+/**
+ * @brief Stores the output of a #Request in the cache, if it was missing
+ * 
+ * Called by the job handler of the #Request, once its pipeline has finished. The output is copied to a
+ * temporary file, renamed once complete (with its trailer) so that it is never read partially written
+ * 
+ * @param config The server #Config
+ * @param request The given #Request
+ * @param outcome The #CacheOutcome of the #Request (updated if the output is stored)
+ * @param summary The #OutputSummary of the #Request (its digest, if any, is stored with the output)
+ */
+void storeResult(Config config, Request request, CacheOutcome outcome, OutputSummary summary) {
+    char path[CACHE_PATH_SIZE], temporary[CACHE_PATH_SIZE];
+    struct stat st;
+
+    if(outcome->status != CACHE_MISSED)
+        return;
+    //The output cannot be keyed without the hash of the input
+    if(!outcome->hashed) {
+        outcome->status = CACHE_UNUSED;
+        return;
+    }
+
+    file_d out = reopenRequestOutput(request);
+    if(out < 0)
+        return;
+
+    outcome->key = getResultKey(outcome->inputHash, outcome->inputSize, request, request->operationCount);
+    if(!fstat(out, &st) && st.st_size <= config->cacheSize) {
+        getCachePath(config->cacheDir, outcome->key, false, path);
+        snprintf(temporary, CACHE_PATH_SIZE, "%s/.%016" PRIx64 ".%d", config->cacheDir, outcome->key, getpid());
+
+        file_d copy = open(temporary, O_WRONLY | O_CREAT | O_EXCL, 0660);
+        if(copy >= 0) {
+            bool copied = copyFile(out, copy)
+                       && writeTrailer(copy, outcome->inputHash, outcome->inputSize, request, request->operationCount, summary);
+            struct stat stored;
+            copied = copied && !fstat(copy, &stored);
+            close(copy);
+
+            if(copied && !rename(temporary, path)) {
+                outcome->status = CACHE_STORED;
+                outcome->size = stored.st_size;
+            } else {
+                unlink(temporary);
+            }
+        }
+    }
+
+    close(out);
+}
+
+/**
+ * @brief Opens the cached output of the prefix of the operations of a #Request chosen by the router
+ * 
+ * @param config The server #Config
+ * @param request The given #Request (with #cachedOperations)
+ * @param outcome The #CacheOutcome of the #Request (its #prefixHit is set, or its status is ::CACHE_LOST if
+ * the output is missing)
+ * @param size Where to write the size of the output of the prefix (without its trailer)
+ * 
+ * @return file_d The descriptor of the cached output of the prefix (-1 if it is missing)
+ */
+file_d openPrefix(Config config, Request request, CacheOutcome outcome, long* size) {
+    CACHE_TRAILER end;
+    uint64_t key = getResultKey(request->inputHash, request->inputSize, request, request->cachedOperations);
+    file_d fd = openCachedOutput(config->cacheDir, key, request->cachedIntermediate, request->inputHash, request->inputSize, request, request->cachedOperations, size, &end);
+
+    if(fd < 0) {
+        outcome->status = CACHE_LOST;
+        return -1;
+    }
+
+    futimens(fd, NULL);
+    outcome->prefixHit = request->cachedOperations;
+    return fd;
+}
+
+/**
+ * @brief Gets the path of the temporary file an intermediate output is written to
+ * 
+ * @param config The server #Config
+ * @param path The string to write to (of size #CACHE_PATH_SIZE)
+ */
+void getIntermediateTemporary(Config config, char* path) {
+    snprintf(path, CACHE_PATH_SIZE, "%s/.intermediate" INTERMEDIATE_SUFFIX ".%d", config->cacheDir, getpid());
+}
+
+/**
+ * @brief Creates the file the intermediate output of the prefix chosen by the router is copied to
+ * 
+ * Nothing is stored if the pipeline already starts from a longer cached prefix
+ * 
+ * @param config The server #Config
+ * @param request The given #Request
+ * @param outcome The #CacheOutcome of the #Request (its #prefixStored is set)
+ * 
+ * @return file_d The descriptor of the temporary file (-1 if no intermediate output is stored)
+ */
+file_d createIntermediate(Config config, Request request, CacheOutcome outcome) {
+    char path[CACHE_PATH_SIZE];
+
+    if(outcome->status != CACHE_MISSED || request->materializePrefix <= outcome->prefixHit)
+        return -1;
+
+    getIntermediateTemporary(config, path);
+    file_d fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0660);
+    if(fd >= 0)
+        outcome->prefixStored = request->materializePrefix;
+    return fd;
+}
+
+/**
+ * @brief Stores an intermediate output in the cache, once it has been completely copied
+ * 
+ * It is keyed once the pipeline has finished, since the input may have been hashed on its way
+ * 
+ * @param config The server #Config
+ * @param request The given #Request
+ * @param outcome The #CacheOutcome of the #Request (its #prefixKey is set, or its #prefixStored cleared if
+ * the output is not stored)
+ * @param complete Whether the whole intermediate output was copied
+ */
+void storeIntermediate(Config config, Request request, CacheOutcome outcome, bool complete) {
+    char path[CACHE_PATH_SIZE], temporary[CACHE_PATH_SIZE];
+    struct stat st;
+
+    getIntermediateTemporary(config, temporary);
+    if(complete && outcome->hashed) {
+        outcome->prefixKey = getResultKey(outcome->inputHash, outcome->inputSize, request, outcome->prefixStored);
+        getCachePath(config->cacheDir, outcome->prefixKey, true, path);
+
+        file_d fd = open(temporary, O_WRONLY | O_CLOEXEC);
+        bool written = fd >= 0 && writeTrailer(fd, outcome->inputHash, outcome->inputSize, request, outcome->prefixStored, NULL)
+                    && !fstat(fd, &st);
+        if(fd >= 0)
+            close(fd);
+
+        if(written && st.st_size <= config->prefixCacheSize && !rename(temporary, path)) {
+            outcome->prefixSize = st.st_size;
+            return;
+        }
+    }
+
+    outcome->prefixStored = 0;
+    unlink(temporary);
+}
@@ -12,42 +12,100 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "clientSocket.h"
+#include "coalescer.h"
 #include "config.h"
+#include "deviceGate.h"
+#include "digest.h"
 #include "jobManager.h"
 #include "logging.h"
+#include "optimizer.h"
 #include "pipeWrapper.h"
+#include "placement.h"
+#include "pluginEngine.h"
+#include "prefetcher.h"
+#include "progress.h"
 #include "request.h"
 #include "requestSorter.h"
+#include "resultCache.h"
 #include "router.h"
+#include "sizeModel.h"
 #include "update.h"
+#include "usage.h"
 #include "utils.h"
+#include "workerPool.h"
 #include "list.h"
 
 /**
- * @brief Checks if a #Request is valid
+ * @brief Checks if a #Request is well formed, before its redundant operations are removed
  * 
- * A #Request is valid if it has at least 1 operation, input, output and senders attributes
- * set
+ * A #Request is well formed if it has at least 1 operation, input, output and senders attributes
+ * set, and its branches fork after existing operations of the #Request or of the branches listed before them.
+ * A stream is only valid if its client passed both of its standard streams. Every transformation must be one
+ * of those of the #Config
  * 
  * @param config  The server #Config
  * @param request The given #Request
  * 
- * @return true If the #Request is valid 
- * @return false If the #Request is not valid
+ * @return true If the #Request is well formed
+ * @return false Otherwise
  */
-bool validateRequest(Config config, Request request) {
-
+bool checkRequestForm(Config config, Request request) {
     if (request->inputFile == NULL
      || request->outputFile == NULL
      || request->operations == NULL
      || request->sender == NULL
-     || request->operationCount <= 0) {
+     || request->operationCount <= 0
+     || (isStreamRequest(request) && (request->inputFD < 0 || request->outputFD < 0))) {
         printMessage(STDERR_FILENO,REQUESTWASNOTVALIDATED);
         return false;
     }
 
-    for (int i = 0; i < request->operationCount; i++) {
-        if (getProgramId(config, request->operations[i]) == -1) {
+    for (int i = 0; i < request->branchCount; i++) {
+        int parent = request->branches[i].parent;
+        if (request->branches[i].outputFile == NULL
+         || parent < -1 || parent >= i
+         || request->branches[i].after < 0
+         || request->branches[i].after > (parent < 0 ? request->operationCount : request->branches[parent].operationCount)) {
+            printMessage(STDERR_FILENO,REQUESTWASNOTVALIDATED);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < getStageCount(request); i++) {
+        if (getProgramId(config, getStageOperation(request, i)) == -1) {
+            printMessage(STDERR_FILENO,REQUESTWASNOTVALIDATED);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks if a well formed #Request is valid, once its redundant operations are removed
+ * 
+ * Since every stage of a #Request (those of its branches included) runs at once, a transformation cannot appear
+ * in more stages than it has instances, or the #Request could never be dispatched. The operations removed need
+ * no instance
+ * 
+ * @param config  The server #Config
+ * @param request The given #Request (see checkRequestForm)
+ * @param reason  The string to write the reason the #Request is not valid to, for its client (left empty if
+ * there is no more to say than that it is not valid)
+ * @param size    The size of the string
+ * 
+ * @return true If the #Request is valid 
+ * @return false If the #Request is not valid
+ */
+bool validateRequest(Config config, Request request, char* reason, int size) {
+    *reason = '\0';
+
+    for (int i = 0; i < config->programCount; i++) {
+        int stages = getOperationCount(request, config->programs[i]);
+        if (stages > config->instances[i]) {
+            snprintf(reason, size, "The request has %d stages of %s (branches included), but at most %d can run at once",
+                stages, config->programs[i], config->instances[i]);
             printMessage(STDERR_FILENO,REQUESTWASNOTVALIDATED);
             return false;
         }
@@ -75,25 +133,173 @@ bool answerClient(file_d client, char* msg)
     return flushPipe(&P);
 }
 
+/**
+ * @brief Tells the client of a #Request that it will get no more answers about it, and closes the
+ * descriptors of the #Request
+ * 
+ * A client of the socket keeps its connection open for its next requests, so the end of the answers is
+ * marked by an empty string rather than by the end of the connection
+ * 
+ * @param request The given #Request
+ */
+void releaseClient(Request request) {
+    answerClient(request->senderFD, "");
+    close(request->senderFD);
+    if (request->inputFD >= 0)
+        close(request->inputFD);
+    if (request->outputFD >= 0)
+        close(request->outputFD);
+}
+
+/**
+ * @brief Closes, in a process forked by the router, the standard streams passed by the clients of the other
+ * #Request
+ * 
+ * The reader of the standard output of a client only sees its end once every copy of it is closed, and the
+ * job handler of another #Request may still be running by then
+ * 
+ * @param requests The list of all #Request in the server
+ * @param request The #Request the process is forked for
+ */
+void closeOtherStreams(RequestsList requests, Request request) {
+    for (int i = 0; i < getNumberInArray(requests); i++) {
+        Request other = requests->requests[i];
+        if (other && other != request && isStreamRequest(other)) {
+            close(other->inputFD);
+            close(other->outputFD);
+        }
+    }
+}
+
+/**
+ * @brief Gets the size of a file named by the client of a #Request, with the permissions of its user
+ * 
+ * @param request The given #Request
+ * @param path The path of the file
+ * 
+ * @return long The size of the file (-1 if it cannot be accessed)
+ */
+long getFileSize(Request request, char* path) {
+    struct stat st;
+    file_d fd = openAsClient(request, path, O_PATH | O_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    long size = fstat(fd, &st) ? -1 : st.st_size;
+    close(fd);
+    return size;
+}
+
 /**
  * @brief Gets the string to send to the client after the #Request has finished executing
  * 
+ * The sizes of the input and output files (and the digest of the output, if any) come from the job handler,
+ * which has both files open; only the outputs of the branches are looked up. A stream has no size, only the
+ * output counted by the digest, if any
+ * 
  * @param request The given #Request
+ * @param summary The #OutputSummary sent by the job handler
+ * @param failed Whether the #Request failed
  * 
  * @return char* The string to send to the client
  */
-char* getRequestEndResult(Request request) {
-    char* res = malloc(256);
-
-    //Get the size of the input and output files
-    file_d in = open(request->inputFile,O_RDONLY);
-    file_d out = open(request->outputFile,O_RDONLY);
-    snprintf(res, 256, "Concluded (bytes input: %ld, bytes output: %ld)", lseek(in,0,SEEK_END), lseek(out,0,SEEK_END));
-    close(in);
-    close(out);
+char* getRequestEndResult(Request request, OutputSummary summary, bool failed) {
+    int size = 256;
+    for (int i = 0; i < request->branchCount; i++)
+        size += strlen(request->branches[i].outputFile) + 32;
+    char* res = malloc(size);
+
+    int length;
+    if (failed) {
+        snprintf(res, size, "Failed (an operation did not complete, the output is incomplete)");
+        return res;
+    }
+    if (!isStreamRequest(request))
+        length = snprintf(res, size, "Concluded (bytes input: %ld, bytes output: %ld", summary->inputBytes, summary->outputBytes);
+    else if (summary->digestType != DIGEST_NONE)
+        length = snprintf(res, size, "Concluded (streamed, bytes output: %ld", summary->outputBytes);
+    else
+        length = snprintf(res, size, "Concluded (streamed");
+    length += formatDigest(summary, res + length, size - length);
+    for (int i = 0; i < request->branchCount; i++)
+        length += snprintf(res + length, size - length, ", %s: %ld", request->branches[i].outputFile, getFileSize(request, request->branches[i].outputFile));
+    snprintf(res + length, size - length, ")");
     return res;
 }
 
+/**
+ * @brief Appends a string to the end of another one, reallocating it
+ * 
+ * @param str The string to append to (must have been malloc'ed)
+ * @param suffix The string to append (it is freed)
+ * 
+ * @return char* The concatenated string
+ */
+char* appendStatus(char* str, char* suffix) {
+    str = realloc(str, strlen(str) + strlen(suffix) + 1);
+    strcat(str, suffix);
+    free(suffix);
+    return str;
+}
+
+/**
+ * @brief Queues again the #Request that were chosen to be dispatched while their devices were at their limit
+ * 
+ * The sorter orders them by priority, so the first to be dispatched once a device frees up is the
+ * #Request with the highest priority
+ * 
+ * @param sorter The #RequestSorter of the server
+ * @param config The #Config of the server
+ * @param requests The list of all #Request in the server
+ */
+void requeueWaitingRequests(RequestSorter sorter, Config config, RequestsList requests) {
+    //Attached requests are never scheduled
+    for (int i = 0; i < getNumberInArray(requests); i++) {
+        Request r = requests->requests[i];
+        if (r && !r->admitted && !r->running && r->leader < 0) {
+            r->admitted = true;
+            enqueue(sorter, r, config);
+        }
+    }
+}
+
+/**
+ * @brief Chooses how many chunks of the input of a #Request being dispatched run at once, and reserves the
+ * instances used by the extra chunks
+ * 
+ * Only a #Request without branches made of chunkable transformations whose input is a file of at least
+ * #Config::chunkThreshold bytes runs in chunks, and the extra chunks only use instances that are free when it is dispatched. A single
+ * chunk at a time is only worth it when the progress of the #Request is checkpointed, so it can be resumed
+ * 
+ * @param config The #Config of the server
+ * @param request The given #Request (its own instances already reserved)
+ * @param availableInstances The available instances of each transformation
+ * 
+ * @return int The number of chunks run at once (0 if the #Request does not run in chunks)
+ */
+int reserveChunks(Config config, Request request, int availableInstances[]) {
+    struct stat st;
+    long size = isStreamRequest(request) || statRequestInput(request, &st) ? -1 : st.st_size;
+    if (!request->operationCount || request->branchCount || !config->chunkThreshold || size < config->chunkThreshold || size <= config->chunkSize)
+        return 0;
+
+    long width = config->chunkWidth ? config->chunkWidth : sysconf(_SC_NPROCESSORS_ONLN);
+    width = MIN(width, (size + config->chunkSize - 1) / config->chunkSize);
+
+    for (int i = 0; i < request->operationCount; i++) {
+        int id = getProgramId(config, request->operations[i]);
+        if (!config->chunkables[id] || config->plugins[id])
+            return 0;
+        width = MIN(width, 1 + availableInstances[id] / getOperationCount(request, request->operations[i]));
+    }
+    if (width == 1 && !config->checkpointInterval)
+        return 0;
+
+    for (int i = 0; i < request->operationCount; i++)
+        availableInstances[getProgramId(config, request->operations[i])] -= width - 1;
+
+    return width;
+}
+
 /**
  * @brief Runs the router of the server
  * 
@@ -103,59 +309,125 @@ char* getRequestEndResult(Request request) {
  * @param config The #Config of the server
  * @param pipe_read The input pipe of the router
  * @param pipe_write The output pipe of the router (used to send to subprocesses)
+ * @param channel The socket the relay passes the requests, and the descriptors of those from the socket, through
  * @param binPath The path of the executables of the transformations
  */
-void runRouter(Config config, file_d pipe_read, file_d pipe_write, char* binPath) {
+void runRouter(Config config, file_d pipe_read, file_d pipe_write, file_d channel, char* binPath) {
     bool up = true;
     int inRouter=0;
+    //Every request held keeps the descriptors of its client open until it concludes
+    int requestLimit = getClientLimit();
     PIPE_READER pr;
     RequestSorter sorter = newRequestSorter(config->programCount);
     initPipeReader(&pr, pipe_read);
     int availableProcesses[config->programCount];
     for (int i = 0; i < config->programCount;i++) availableProcesses[i] = config->instances[i];
+    USAGE_STATS usage[config->programCount];
+    for (int i = 0; i < config->programCount;i++) initUsageStats(&usage[i]);
 
     UPDATE update;
     char *a;
 
     RequestsList requests = initRequestList();
-    
+    Placement placement = newPlacement(config->placement);
+    DeviceGate gate = newDeviceGate(config);
+    Prefetcher prefetcher = newPrefetcher(config);
+    SizeModel sizeModel = newSizeModel(config);
+    ResultCache cache = newResultCache(config);
+    Coalescer coalescer = newCoalescer(config);
+    Optimizer optimizer = newOptimizer(config);
+    Plugins plugins = loadPlugins(config, binPath);
+    WorkerPool workers = newWorkerPool(config, binPath);
+    ProgressTracker progress = newProgressTracker();
+    int waitingForDevices = 0;
+    long arrivals = 0;
+    char reason[MAX_PROGRAM_SIZE + 128];
+    Request finished;
+
     while ((up || inRouter) && readUpdate(&pr, &update))// || !notEmpty(sorter)) //readUpdate is always true while im holding the write end of the pipe
     {
         switch(update.type)
         {
             case U_REQUEST: 
-                update.request->senderFD=open(update.request->sender, O_WRONLY);
-                update.request->running=false;
+                if (!(update.request = receiveRequest(channel, &update.peer)))
+                    break;
+                if (update.request->senderFD < 0)
+                    update.request->senderFD=open(update.request->sender, O_WRONLY);
+                update.request->arrivalOrder=arrivals++;
 
                 if (update.request->senderFD>=0)
                     printMessage(STDERR_FILENO,CREATEDWRITEPIPETOCLIENT);
-                else break;
+                else {
+                    freeRequest(update.request);
+                    break;
+                }
                 switch (update.request->type)
                 {
                     //if status send status to client through fifo
                     case STATUS:
                         printMessage(STDERR_FILENO,STATUSREQUEST);
                         a = getRequestStatus(config, availableProcesses, requests->requests, getNumberInArray(requests));
+                        a = appendStatus(a, getProgressStatus(progress, requests->requests, getNumberInArray(requests)));
+                        a = appendStatus(a, getUsageStatus(config, usage));
+                        a = appendStatus(a, getPlacementStatus(placement, requests->requests, getNumberInArray(requests)));
+                        a = appendStatus(a, getDeviceStatus(gate));
+                        a = appendStatus(a, getPrefetchStatus(prefetcher));
+                        a = appendStatus(a, getSizeModelStatus(sizeModel));
+                        a = appendStatus(a, getCacheStatus(cache));
+                        a = appendStatus(a, getCoalescerStatus(coalescer));
+                        a = appendStatus(a, getOptimizerStatus(optimizer));
+                        a = appendStatus(a, getPluginStatus(plugins, config));
+                        a = appendStatus(a, getWorkerPoolStatus(workers, config));
                         answerClient(update.request->senderFD,a);
-                        close(update.request->senderFD);
+                        releaseClient(update.request);
                         free(a);
                         freeRequest(update.request);
                         break;
 
                     //if proc_file add to list
                     case PROCESS_FILE:
+                    case PROCESS_STREAM:
                         printMessage(STDERR_FILENO,PROCESSFILEREQUEST);
-                        if (validateRequest(config, update.request)) {
+                        if (inRouter >= requestLimit) {
+                            printMessage(STDERR_FILENO,TOOMANYREQUESTS);
+                            answerClient(update.request->senderFD, "Request received");
+                            answerClient(update.request->senderFD, "Request refused (the server holds too many requests, try again later)");
+                            answerClient(update.request->senderFD, "Concluded");
+                            releaseClient(update.request);
+                            freeRequest(update.request);
+                            break;
+                        }
+                        //The request is optimized before it is validated, since the operations removed need no instance
+                        *reason = '\0';
+                        bool formed = checkRequestForm(config, update.request);
+                        if (formed && (a = optimizeRequest(optimizer, update.request))) {
+                            answerClient(update.request->senderFD, a);
+                            free(a);
+                        }
+                        if (formed && validateRequest(config, update.request, reason, sizeof(reason))) {
                             inRouter++;
                             insertRequest(requests,update.request);
+                            if (attachRequest(coalescer, requests->requests, getNumberInArray(requests), update.request)) {
+                                update.request->admitted = false;
+                                answerClient(update.request->senderFD, "Pending (attached to an identical request)");
+                                break;
+                            }
+                            //A copy of the input, or of its output found in the result cache, uses no instance, but is
+                            //queued like the others, for its devices and its turn (see nextInLine)
+                            lookupCache(cache, update.request);
+                            //The devices are only reserved once the request is chosen to be dispatched
+                            identifyDevices(update.request);
+                            update.request->admitted = true;
                             enqueue(sorter, update.request,  config);
                             answerClient(update.request->senderFD, "Pending");
                         }
                         else{
                             answerClient(update.request->senderFD, "Request received");
                             answerClient(update.request->senderFD, "Request not considered valid");
+                            if (*reason)
+                                answerClient(update.request->senderFD, reason);
                             answerClient(update.request->senderFD, "Concluded");
-                            close(update.request->senderFD);
+                            releaseClient(update.request);
                             freeRequest(update.request);
                         }
                         break;
@@ -165,7 +437,18 @@ void runRouter(Config config, file_d pipe_read, file_d pipe_write, char* binPath
             //if operation finished mark as available
             case U_FINISHED_OP:
                 printMessage(STDERR_FILENO,OPERATIONFINISHED);
-                availableProcesses[update.operationId]++;
+                if (update.releases)
+                    availableProcesses[update.operationId]++;
+                //An instance given back by a chunk slot that was left idle or stopped has no usage to account for
+                if (update.usage.realTime)
+                    addUsage(&usage[update.operationId], &update.usage);
+                if (update.stage >= 0 && requests->requests[update.requestId])
+                    recordProgress(progress, requests->requests[update.requestId], update.stage, &update.usage, true);
+                break;
+
+            case U_STAGE_PROGRESS:
+                if (requests->requests[update.requestId])
+                    recordProgress(progress, requests->requests[update.requestId], update.stage, &update.usage, false);
                 break;
 
             case U_SERVER_DISCONECTED:
@@ -173,41 +456,143 @@ void runRouter(Config config, file_d pipe_read, file_d pipe_write, char* binPath
                 break;
 
             case U_REQUEST_FINISHED:
+                finished = requests->requests[update.requestId];
+                //The cached output the request was dispatched to start from is gone: it runs again from its input
+                if (update.cache.status == CACHE_LOST) {
+                    printMessage(STDERR_FILENO, CACHEDOUTPUTLOST);
+                    for (int i = finished->cachedOperations; i < getStageCount(finished); i++)
+                        availableProcesses[getProgramId(config, getStageOperation(finished, i))]++;
+                    cacheLost(cache, finished);
+                    unplaceRequest(placement, finished);
+                    releaseDevices(gate, finished);
+                    releaseWorkers(workers, finished, false);
+                    finished->running = false;
+                    identifyDevices(finished);
+                    finished->admitted = true;
+                    enqueue(sorter, finished, config);
+                    answerClient(finished->senderFD, "Pending (the cached output was evicted)");
+                    break;
+                }
                 inRouter--;
-                printMessage(STDERR_FILENO,REQUESTFINISHED);
-                a = getRequestEndResult(update.request);
-                answerClient(update.request->senderFD, a);
-                close(update.request->senderFD);
-                removeRequest(requests,update.request->timeOfArrival);
+                printMessage(STDERR_FILENO, update.failed ? REQUESTFAILED : REQUESTFINISHED);
+                if (finished->leader >= 0) {
+                    //An attached request only had the output of its leader copied
+                    if (!update.failed) {
+                        followerFinished(coalescer, &update.summary);
+                        answerClient(finished->senderFD, "Output copied from an identical request");
+                    }
+                } else {
+                    if (!update.failed)
+                        cacheFinished(cache, &update.cache, finished);
+                    if (update.cache.status == CACHE_HIT)
+                        answerClient(finished->senderFD, "Output served from the result cache");
+                    if (!update.failed)
+                        learnOutputSize(sizeModel, finished, update.summary.outputBytes);
+                    unplaceRequest(placement, finished);
+                    releaseDevices(gate, finished);
+                    releaseWorkers(workers, finished, update.failed);
+
+                    //The requests attached to this one get a copy of its output, or run on their own if it failed
+                    for (int i = 0; i < getNumberInArray(requests); i++) {
+                        Request follower = requests->requests[i];
+                        if (!follower || follower->leader != finished->timeOfArrival || follower->running)
+                            continue;
+                        if (update.failed) {
+                            follower->leader = -1;
+                            identifyDevices(follower);
+                            follower->admitted = true;
+                            enqueue(sorter, follower, config);
+                            answerClient(follower->senderFD, "Pending (the identical request failed)");
+                            continue;
+                        }
+                        follower->running = true;
+                        if (!fork()) {
+                            answerClient(follower->senderFD, "Processing");
+                            close(pipe_read);
+                            closeOtherStreams(requests, follower);
+                            copyOutput(follower, finished, &update.summary, pipe_write);
+                            _exit(0);
+                        }
+                    }
+                }
+                if ((a = finishProgress(progress, finished))) {
+                    answerClient(finished->senderFD, a);
+                    free(a);
+                }
+                a = getRequestEndResult(finished, &update.summary, update.failed);
+                answerClient(finished->senderFD, a);
+                releaseClient(finished);
+                removeRequest(requests,update.requestId);
+                if (waitingForDevices) {
+                    requeueWaitingRequests(sorter, config, requests);
+                    waitingForDevices = 0;
+                }
 
                 free(a);
-                freeRequest(update.request);
                 break;
 
             default:
                 printMessage(STDERR_FILENO, UNKNOWNUPDATETYPE);
-                freeRequest(update.request);
                 break;
         }
-        Request r = nextInLine(sorter, config, availableProcesses);
-        if (r != NULL){
-            for (int i = 0; i <r->operationCount; i++)
-                availableProcesses[getProgramId(config,r->operations[i])]--;
+        //Several requests may become runnable at once (for example, when a device frees up)
+        Request r;
+        while ((r = nextInLine(sorter, config, availableProcesses)) != NULL){
+            //A request queued as a copy of its cached output needs its instances if the output was evicted since
+            if (r->operationCount && r->cachedOperations == r->operationCount && lookupCache(cache, r) < r->operationCount) {
+                enqueue(sorter, r, config);
+                continue;
+            }
+            //A request whose devices are at their limit waits out of the sorter until one of them frees up
+            if (!acquireDevices(gate, r)) {
+                r->admitted = false;
+                waitingForDevices++;
+                continue;
+            }
             r->running=true;
+            prefetchDispatched(prefetcher, r);
+            predictOutputSize(sizeModel, r);
+            //The operations whose output is in the result cache need no instance (the output of a prefix is not
+            //split into chunks)
+            lookupCache(cache, r);
+            for (int i = r->cachedOperations; i < getStageCount(r); i++)
+                availableProcesses[getProgramId(config, getStageOperation(r, i))]--;
+            r->chunkWidth = r->cachedOperations ? 0 : reserveChunks(config, r, availableProcesses);
+            //The stages of a request with branches all run as processes
+            if (!r->chunkWidth && !r->branchCount && r->cachedOperations < r->operationCount)
+                assignWorkers(workers, config, r);
+            choosePrefix(cache, r);
+            if (r->chunkWidth || r->branchCount || usesPlugins(plugins, config, r) || usesWorkers(workers, r))
+                r->materializePrefix = 0;
+            //Placed once the processes it runs are known
+            placeRequest(placement, r, config);
             if (!fork()) {
 
                 answerClient(r->senderFD, "Processing");
                 close(pipe_read);
-                runJobHandler(r, pipe_write, binPath, config);
+                closeOtherStreams(requests, r);
+                runJobHandler(r, pipe_write, binPath, config, placement, usage, plugins, workers);
                 freeRequest(r);
 
                 _exit(0);
             }
         }
+        prefetchNextInputs(prefetcher, requests->requests, getNumberInArray(requests));
     }
 
     freeRequestList(requests);
     deleteRequestSolver(sorter);
+    deletePlacement(placement);
+    deleteDeviceGate(gate);
+    deletePrefetcher(prefetcher);
+    deleteSizeModel(sizeModel);
+    deleteResultCache(cache);
+    deleteCoalescer(coalescer);
+    deleteOptimizer(optimizer);
+    unloadPlugins(plugins);
+    deleteWorkerPool(workers);
+    deleteProgressTracker(progress);
+    releasePipeReader(&pr);
     close(pipe_read);
     printMessage(STDERR_FILENO, ROUTEREXITED);
     
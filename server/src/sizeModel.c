@@ -0,0 +1,159 @@
+/**
+ * @file sizeModel.c
+ * 
+ * @brief File implementing the prediction of the size of the output of a #Request
+ * 
+ * Every transformation is modelled as multiplying the size of its input by a ratio, learnt from the
+ * requests that used it. The ratios are kept as logarithms, so that the predicted output/input ratio
+ * of a pipeline is the exponential of the sum of the logarithms of its stages, and each finished
+ * #Request moves the estimates of its stages towards the ratio observed for the whole pipeline.
+ * 
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "logging.h"
+#include "request.h"
+#include "sizeModel.h"
+#include "utils.h"
+
+/**
+ * @brief The smallest learning rate of a transformation, reached after a few samples, so that the
+ * estimates keep following changes in the data
+ * 
+ */
+#define MIN_LEARNING_RATE 0.2
+
+/**
+ * @brief Maximum length of the status line of a single transformation
+ * 
+ */
+#define MODEL_LINE_SIZE (MAX_PROGRAM_SIZE + 64)
+
+/**
+ * @brief The output/input size ratios learnt for each transformation
+ * 
+ */
+struct sizeModel {
+    Config config; ///< The server #Config
+    double* logRatios; ///< The logarithm of the output/input size ratio of each transformation
+    long* samples; ///< The number of finished #Request used to learn the ratio of each transformation
+    long predictions; ///< The number of predictions checked against the actual output size
+    double totalError; ///< The sum of the absolute relative errors of the checked predictions
+};
+
+/**
+ * @brief Creates a new #SizeModel, with every transformation assumed to keep the size of its input
+ * 
+ * @param config The server #Config
+ * 
+ * @return SizeModel The created #SizeModel
+ */
+SizeModel newSizeModel(Config config) {
+    SizeModel model = malloc(sizeof(struct sizeModel));
+    model->config = config;
+    model->logRatios = calloc(config->programCount, sizeof(double));
+    model->samples = calloc(config->programCount, sizeof(long));
+    model->predictions = 0;
+    model->totalError = 0;
+    return model;
+}
+
+/**
+ * @brief Frees the memory allocated to a #SizeModel
+ * 
+ * @param model The given #SizeModel
+ */
+void deleteSizeModel(SizeModel model) {
+    free(model->logRatios);
+    free(model->samples);
+    free(model);
+}
+
+/**
+ * @brief Gets the logarithm of the predicted output/input size ratio of the pipeline of a #Request
+ * 
+ * @param model The given #SizeModel
+ * @param request The given #Request
+ * 
+ * @return double The predicted logarithm
+ */
+double getLogRatio(SizeModel model, Request request) {
+    double logRatio = 0;
+
+    for(int i = 0; i < request->operationCount; i++)
+        logRatio += model->logRatios[getProgramId(model->config, request->operations[i])];
+
+    return logRatio;
+}
+
+/**
+ * @brief Predicts the size of the output of a #Request about to be dispatched
+ * 
+ * Sets the #inputSize and #predictedSize of the #Request (0 if its input is empty or cannot be read)
+ * 
+ * @param model The given #SizeModel
+ * @param request The given #Request
+ */
+void predictOutputSize(SizeModel model, Request request) {
+    struct stat st;
+
+    request->inputSize = isStreamRequest(request) || statRequestInput(request, &st) ? 0 : st.st_size;
+    request->predictedSize = request->inputSize ? (long)(request->inputSize * exp(getLogRatio(model, request))) : 0;
+}
+
+/**
+ * @brief Logs the error of the prediction of a finished #Request and learns from its actual output size
+ * 
+ * The difference between the actual and the predicted logarithm of the ratio is split between the stages
+ * of the pipeline, each of them moving by its learning rate (the inverse of its number of samples, until
+ * #MIN_LEARNING_RATE)
+ * 
+ * @param model The given #SizeModel
+ * @param request The finished #Request
+ * @param outputSize The actual size of the output
+ */
+void learnOutputSize(SizeModel model, Request request, long outputSize) {
+    if(!request->inputSize || !request->predictedSize || outputSize <= 0)
+        return;
+
+    double error = (double)(request->predictedSize - outputSize) / outputSize;
+    printFormattedMessage(STDERR_FILENO, OUTPUTSIZEPREDICTED, request->predictedSize, outputSize, error * 100);
+    model->predictions++;
+    model->totalError += fabs(error);
+
+    double logError = log((double)outputSize / request->inputSize) - getLogRatio(model, request);
+    for(int i = 0; i < request->operationCount; i++) {
+        int id = getProgramId(model->config, request->operations[i]);
+        model->samples[id]++;
+        double rate = MAX(1.0 / model->samples[id], MIN_LEARNING_RATE);
+        model->logRatios[id] += rate * logError / request->operationCount;
+    }
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the output/input size ratios learnt
+ * 
+ * @param model The given #SizeModel
+ * 
+ * @return char* The size model status string
+ */
+char* getSizeModelStatus(SizeModel model) {
+    char* result = malloc(MODEL_LINE_SIZE * (model->config->programCount + 1));
+    int length = 0;
+
+    length += snprintf(result, MODEL_LINE_SIZE, "output size: %ld predictions, mean error %.1f%%\n",
+        model->predictions, model->predictions ? model->totalError * 100 / model->predictions : 0);
+
+    for(int i = 0; i < model->config->programCount; i++)
+        if(model->samples[i])
+            length += snprintf(result + length, MODEL_LINE_SIZE, "output size ratio %s: %.3f (%ld samples)\n",
+                model->config->programs[i], exp(model->logRatios[i]), model->samples[i]);
+
+    return result;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file stagePipe.c
+ * 
+ * @brief File implementing the creation and observation of the pipes between the stages of a pipeline
+ * 
+ * The output pipe of a stage is sized by the config file for its transformation, either to a fixed
+ * capacity or from the throughput observed for its previous stages (enough to hold #PIPE_AUTO_LATENCY
+ * of its output). While the pipeline runs, the occupancy of each pipe is sampled to find out how often
+ * the writer is blocked on a full pipe or the reader is blocked on an empty one.
+ * 
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "stagePipe.h"
+#include "usage.h"
+#include "utils.h"
+
+/**
+ * @brief The time of output of a transformation the pipes sized automatically can hold (microseconds)
+ * 
+ */
+#define PIPE_AUTO_LATENCY 20000
+
+/**
+ * @brief The smallest capacity of a pipe (one page)
+ * 
+ */
+#define MIN_PIPE_SIZE 4096
+
+/**
+ * @brief The file holding the maximum capacity of a pipe for unprivileged users
+ * 
+ */
+#define PIPE_MAX_SIZE_FILE "/proc/sys/fs/pipe-max-size"
+
+/**
+ * @brief Reads the maximum capacity of a pipe allowed by the kernel
+ * 
+ * @return long The maximum capacity (1 MiB if it cannot be read)
+ */
+long getMaxPipeSize() {
+    static long maxSize = 0;
+
+    if(!maxSize) {
+        char buffer[32];
+        file_d fd = open(PIPE_MAX_SIZE_FILE, O_RDONLY);
+        int bytesRead = fd < 0 ? -1 : read(fd, buffer, sizeof(buffer) - 1);
+
+        if(fd >= 0)
+            close(fd);
+        buffer[MAX(bytesRead, 0)] = '\0';
+        maxSize = bytesRead > 0 ? strtol(buffer, NULL, 10) : 0;
+        if(maxSize <= 0)
+            maxSize = 1024 * 1024;
+    }
+
+    return maxSize;
+}
+
+/**
+ * @brief Gets the capacity of the output pipe of a transformation
+ * 
+ * @param config The server #Config
+ * @param stats The #UsageStats of each transformation
+ * @param id The id of the transformation
+ * 
+ * @return long The capacity, a power of two within the limits of the kernel (0 to keep the default)
+ */
+long getPipeSize(Config config, USAGE_STATS stats[], int id) {
+    long size = config->pipeSizes[id];
+
+    if(size == PIPE_SIZE_AUTO) {
+        UsageStats s = &stats[id];
+        if(!s->total.realTime || !s->total.bytesWritten)
+            return 0;
+        size = (long)((double)s->total.bytesWritten / s->total.realTime * PIPE_AUTO_LATENCY);
+    }
+
+    if(!size)
+        return 0;
+
+    long capacity = MIN_PIPE_SIZE;
+    while(capacity < size && capacity < getMaxPipeSize())
+        capacity *= 2;
+
+    return MIN(capacity, getMaxPipeSize());
+}
+
+/**
+ * @brief Creates the pipe between two stages
+ * 
+ * Both ends are closed on exec, so that a stage only inherits the pipes it is given as its standard input
+ * and output
+ * 
+ * @param fd The descriptors of the pipe
+ * @param size The capacity of the pipe (0 to keep the default)
+ * 
+ * @return true If the pipe was created (even if its capacity could not be changed)
+ * @return false If the pipe could not be created
+ */
+bool openStagePipe(file_d fd[2], long size) {
+    if(pipe2(fd, O_CLOEXEC))
+        return false;
+
+    if(size)
+        fcntl(fd[1], F_SETPIPE_SZ, size);
+
+    return true;
+}
+
+/**
+ * @brief Samples the occupancy of a pipe between two stages
+ * 
+ * The pipe is full if a write of #PIPE_BUF bytes would block, and empty if a read would block. It is
+ * reached through the standard input of its reader and only held open while it is sampled: a read end
+ * kept open by the job handler would hide the exit of the reader from the writer
+ * 
+ * @param reader The pid of the process reading from the pipe (not reaped yet)
+ * @param usage The #StageUsage of the writer of the pipe
+ */
+void sampleStagePipe(pid_t reader, StageUsage usage) {
+    char path[32];
+    int occupancy;
+
+    snprintf(path, sizeof(path), "/proc/%d/fd/0", reader);
+    file_d readEnd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(readEnd < 0)
+        return;
+
+    int capacity = fcntl(readEnd, F_GETPIPE_SZ);
+    bool sampled = capacity >= 0 && ioctl(readEnd, FIONREAD, &occupancy) >= 0;
+    close(readEnd);
+    if(!sampled)
+        return;
+
+    usage->pipeSamples++;
+    if(occupancy == 0)
+        usage->pipeEmpty++;
+    else if(capacity - occupancy < PIPE_BUF)
+        usage->pipeFull++;
+}
@@ -5,11 +5,15 @@
  * 
  */
 
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "wire.h"
 #include "logging.h"
+#include "socketWrapper.h"
 #include "update.h"
 
 
@@ -28,6 +32,7 @@
 void fromRequest(Update u, Request r) {
     u->type = U_REQUEST;
     u->request = r;
+    memset(&u->peer, 0, sizeof(u->peer));
 }
 
 /**
@@ -46,12 +51,26 @@ bool readUpdate(PipeReader pr, Update u)
     switch (u->type) {
 
         case U_REQUEST_FINISHED:
+        return readBytes(pr, sizeof(u->requestId), &u->requestId)
+            && readBytes(pr, sizeof(u->cache), &u->cache)
+            && readBytes(pr, sizeof(u->summary), &u->summary)
+            && readBytes(pr, sizeof(u->failed), &u->failed);
+
+        //The #Request follows through the channel of the relay (see forwardRequest)
         case U_REQUEST:
-        u->request = malloc(sizeof(REQUEST));
-        return readRequest(pr, u->request);
+        return true;
 
         case U_FINISHED_OP:            
-        return readBytes(pr, sizeof(u->operationId), &u->operationId);
+        return readBytes(pr, sizeof(u->operationId), &u->operationId)
+            && readBytes(pr, sizeof(u->requestId), &u->requestId)
+            && readBytes(pr, sizeof(u->stage), &u->stage)
+            && readBytes(pr, sizeof(u->usage), &u->usage)
+            && readBytes(pr, sizeof(u->releases), &u->releases);
+
+        case U_STAGE_PROGRESS:
+        return readBytes(pr, sizeof(u->requestId), &u->requestId)
+            && readBytes(pr, sizeof(u->stage), &u->stage)
+            && readBytes(pr, sizeof(u->usage), &u->usage);
 
         case U_SERVER_DISCONECTED:
         return true;
@@ -76,14 +95,31 @@ bool writeUpdate(PipeWritter pw, Update u) {
     switch (u->type) {
 
         case U_REQUEST:
+        writeBytes(pw, sizeof(u->type), &u->type);
+        break;
+
         case U_REQUEST_FINISHED:
         writeBytes(pw, sizeof(u->type), &u->type);
-        writeRequest(pw, u->request);
+        writeBytes(pw, sizeof(u->requestId), &u->requestId);
+        writeBytes(pw, sizeof(u->cache), &u->cache);
+        writeBytes(pw, sizeof(u->summary), &u->summary);
+        writeBytes(pw, sizeof(u->failed), &u->failed);
         break;
 
         case U_FINISHED_OP:
         writeBytes(pw, sizeof(u->type), &u->type);
         writeBytes(pw, sizeof(u->operationId), &u->operationId);
+        writeBytes(pw, sizeof(u->requestId), &u->requestId);
+        writeBytes(pw, sizeof(u->stage), &u->stage);
+        writeBytes(pw, sizeof(u->usage), &u->usage);
+        writeBytes(pw, sizeof(u->releases), &u->releases);
+        break;
+
+        case U_STAGE_PROGRESS:
+        writeBytes(pw, sizeof(u->type), &u->type);
+        writeBytes(pw, sizeof(u->requestId), &u->requestId);
+        writeBytes(pw, sizeof(u->stage), &u->stage);
+        writeBytes(pw, sizeof(u->usage), &u->usage);
         break;
 
         case U_SERVER_DISCONECTED:
@@ -93,5 +129,41 @@ bool writeUpdate(PipeWritter pw, Update u) {
         default:
         printMessage(STDERR_FILENO, UNKNOWNUPDATETYPE);
     }
+
+    //The job handlers share the pipe to the router: an update is only written at once if it fits in PIPE_BUF
+    if (pw->pos > PIPE_BUF) {
+        printMessage(STDERR_FILENO, UPDATETOOLARGE);
+        pw->pos = 0;
+        return false;
+    }
     return flushPipe(pw);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Forwards a request frame received from a client to the router, without reading it into a #Request
+ * 
+ * The pipe to the router only gets a ::U_REQUEST #Update, of a few bytes, announcing the #Request. The client,
+ * the frame and the descriptors passed with it follow through the channel, which only the relay writes to, as
+ * a single message (see receiveRequest): they stay together whatever the size of the frame, and never get out
+ * of step with the #Update. The #Update is written first, since the router only reads the channel once it has
+ * read it, and the message may not fit in the channel until then
+ * 
+ * @param pw The given #PipeWritter
+ * @param channel The socket the requests are passed to the router through
+ * @param header The #WireHeader of the frame
+ * @param payload The payload of the frame (already checked)
+ * @param peer The client that sent the frame (#PEER::descriptors is the number of descriptors passed)
+ * @param fds The descriptors passed with the frame (they stay open in the relay)
+ * 
+ * @return true If the #Request was sent
+ * @return false Otherwise (the channel is closed, the router is gone)
+ */
+bool forwardRequest(PipeWritter pw, file_d channel, WireHeader header, char* payload, Peer peer, file_d fds[]) {
+    UPDATE update;
+    update.type = U_REQUEST;
+
+    return writeUpdate(pw, &update)
+        && sendDescriptors(channel, peer, sizeof(PEER), fds, peer->descriptors)
+        && writeSocket(channel, header, sizeof(WIRE_HEADER))
+        && writeSocket(channel, payload, header->length);
+}
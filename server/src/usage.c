@@ -0,0 +1,185 @@
+/**
+ * @file usage.c
+ * 
+ * @brief File implementing the accounting of the resources used by the stages of a #Request
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "stagePipe.h"
+#include "usage.h"
+#include "utils.h"
+
+/**
+ * @brief Maximum length of the status line of a single transformation
+ * 
+ */
+#define USAGE_LINE_SIZE (MAX_PROGRAM_SIZE + 640)
+
+/**
+ * @brief Converts a struct timeval to microseconds
+ * 
+ */
+#define TO_MICROSECONDS(tv) ((long)(tv).tv_sec * 1000000 + (long)(tv).tv_usec)
+
+/**
+ * @brief Fills a #StageUsage from the struct rusage returned by wait4
+ * 
+ * @param usage The #StageUsage to write to
+ * @param ru The resource usage of the reaped process
+ */
+void fromRusage(StageUsage usage, struct rusage* ru) {
+    usage->userTime = TO_MICROSECONDS(ru->ru_utime);
+    usage->systemTime = TO_MICROSECONDS(ru->ru_stime);
+    usage->maxRss = ru->ru_maxrss;
+    usage->voluntarySwitches = ru->ru_nvcsw;
+    usage->involuntarySwitches = ru->ru_nivcsw;
+    usage->blocksIn = ru->ru_inblock;
+    usage->blocksOut = ru->ru_oublock;
+}
+
+/**
+ * @brief Reads the number of bytes read and written by a process from /proc/<pid>/io
+ * 
+ * The process must not have been reaped yet
+ * 
+ * @param usage The #StageUsage to write to
+ * @param pid The pid of the process
+ */
+void readProcessIo(StageUsage usage, pid_t pid) {
+    char path[64];
+    char buffer[512];
+
+    snprintf(path, sizeof(path), "/proc/%d/io", pid);
+    file_d fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return;
+
+    int bytesRead = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if(bytesRead <= 0)
+        return;
+    buffer[bytesRead] = '\0';
+
+    char* field;
+    if((field = strstr(buffer, "rchar: ")))
+        usage->bytesRead = strtol(field + 7, NULL, 10);
+    if((field = strstr(buffer, "wchar: ")))
+        usage->bytesWritten = strtol(field + 7, NULL, 10);
+}
+
+/**
+ * @brief Reads the CPU time used so far by a running process and by the children it waited for, from /proc
+ * 
+ * @param usage The #StageUsage to write the user and system CPU times to
+ * @param pid The pid of the process
+ * 
+ * @return true If the times were read
+ * @return false If the process is gone
+ */
+bool readProcessCpu(StageUsage usage, pid_t pid) {
+    char path[64];
+    char buffer[1024];
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    file_d fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    int bytesRead = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if(bytesRead <= 0)
+        return false;
+    buffer[bytesRead] = '\0';
+
+    //The name of the process, between parentheses, may hold spaces: the fields are read after it
+    unsigned long user, system;
+    long childrenUser, childrenSystem;
+    char* fields = strrchr(buffer, ')');
+    if(!fields || sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld",
+                         &user, &system, &childrenUser, &childrenSystem) != 4)
+        return false;
+
+    long tick = sysconf(_SC_CLK_TCK);
+    usage->userTime = (long)(user + childrenUser) * 1000000 / tick;
+    usage->systemTime = (long)(system + childrenSystem) * 1000000 / tick;
+    return true;
+}
+
+/**
+ * @brief Initializes an empty #UsageStats
+ * 
+ * @param stats The given #UsageStats
+ */
+void initUsageStats(UsageStats stats) {
+    memset(stats, 0, sizeof(USAGE_STATS));
+}
+
+/**
+ * @brief Adds the usage of a stage to the aggregated usage of its transformation
+ * 
+ * @param stats The #UsageStats of the transformation
+ * @param usage The #StageUsage of the stage
+ */
+void addUsage(UsageStats stats, StageUsage usage) {
+    stats->stages++;
+    stats->total.userTime += usage->userTime;
+    stats->total.systemTime += usage->systemTime;
+    stats->total.maxRss += usage->maxRss;
+    stats->total.voluntarySwitches += usage->voluntarySwitches;
+    stats->total.involuntarySwitches += usage->involuntarySwitches;
+    stats->total.blocksIn += usage->blocksIn;
+    stats->total.blocksOut += usage->blocksOut;
+    stats->total.realTime += usage->realTime;
+    stats->total.bytesRead += usage->bytesRead;
+    stats->total.bytesWritten += usage->bytesWritten;
+    stats->total.pipeSamples += usage->pipeSamples;
+    stats->total.pipeFull += usage->pipeFull;
+    stats->total.pipeEmpty += usage->pipeEmpty;
+
+    if(usage->maxRss > stats->peakRss)
+        stats->peakRss = usage->maxRss;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the resources used by each transformation
+ * 
+ * @param config The server #Config
+ * @param stats The #UsageStats of each transformation
+ * 
+ * @return char* The usage string
+ */
+char* getUsageStatus(Config config, USAGE_STATS stats[]) {
+    char* result = malloc(USAGE_LINE_SIZE * (config->programCount + 1));
+    *result = '\0';
+    int length = 0;
+
+    for(int i = 0; i < config->programCount; i++) {
+        UsageStats s = &stats[i];
+        long averageRss = s->stages ? s->total.maxRss / s->stages : 0;
+        long samples = MAX(s->total.pipeSamples, 1);
+        long pipeSize = getPipeSize(config, stats, i);
+
+        length += snprintf(result + length, USAGE_LINE_SIZE,
+            "usage %s: %ld stages, cpu %ld.%03lds user / %ld.%03lds sys, rss %ld KiB avg / %ld KiB peak, "
+            "ctx switches %ld vol / %ld invol, blocks %ld in / %ld out, io %ld KiB read / %ld KiB written, "
+            "output pipe %ld KiB%s: %ld%% full / %ld%% empty (%ld samples)\n",
+            config->programs[i], s->stages,
+            s->total.userTime / 1000000, (s->total.userTime / 1000) % 1000,
+            s->total.systemTime / 1000000, (s->total.systemTime / 1000) % 1000,
+            averageRss, s->peakRss,
+            s->total.voluntarySwitches, s->total.involuntarySwitches,
+            s->total.blocksIn, s->total.blocksOut,
+            s->total.bytesRead / 1024, s->total.bytesWritten / 1024,
+            (pipeSize ? pipeSize : DEFAULT_PIPE_SIZE) / 1024, config->pipeSizes[i] == PIPE_SIZE_AUTO ? " (auto)" : "",
+            s->total.pipeFull * 100 / samples, s->total.pipeEmpty * 100 / samples, s->total.pipeSamples);
+    }
+
+    return result;
+}
@@ -0,0 +1,547 @@
+/**
+ * @file workerPool.c
+ * 
+ * @brief File implementing the persistent workers of the transformations
+ * 
+ * The router keeps up to #Config::instances workers for each transformation declared with the "worker"
+ * attribute, started the first time they are needed. When a #Request is dispatched, each of its stages of
+ * such a transformation is given an idle worker (a hit), or a newly started one when none is idle (a miss).
+ * The job handler, which inherits the descriptors of the workers, sends the input of the stage as a job
+ * over the framed protocol of workerProtocol.h and writes the output it gets back. The workers are given back
+ * once the #Request finishes, and replaced when they died or ran #Config::workerJobs jobs.
+ * 
+ * An executable speaking the protocol ("worker=native") is the worker itself. Any other executable
+ * ("worker") is wrapped: the worker is a process of the server that runs the executable for every job, so
+ * the job handler is spared the setup of the stage.
+ * 
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "logging.h"
+#include "pump.h"
+#include "request.h"
+#include "usage.h"
+#include "utils.h"
+#include "workerPool.h"
+#include "workerProtocol.h"
+
+/**
+ * @brief Maximum length of the worker pool status line
+ * 
+ */
+#define WORKER_LINE_SIZE 192
+
+/**
+ * @brief The workers of every transformation, and how well they were reused
+ * 
+ */
+struct workerPool {
+    Config config; ///< The server #Config
+    char* binPath; ///< The path to the executables of the transformations
+    Worker workers[NUMBER_PROGRAMS]; ///< The worker slots of each transformation (NULL if it has no workers)
+    long hits; ///< The number of stages given an idle worker
+    long misses; ///< The number of stages for which a worker had to be started
+    long fallbacks; ///< The number of stages run as processes since every worker was busy
+    long started; ///< The number of workers started
+    long recycled; ///< The number of workers replaced (died or reached #Config::workerJobs)
+};
+
+/**
+ * @brief Writes a frame
+ * 
+ * @param fd The descriptor to write to
+ * @param type The type of the frame
+ * @param data The payload
+ * @param length The length of the payload
+ * 
+ * @return true If the frame was written
+ * @return false If an error occurred
+ */
+bool writeFrame(file_d fd, uint32_t type, void* data, uint32_t length) {
+    FRAME_HEADER header = { .type = type, .length = length };
+    return writeBuffer(fd, (char*)&header, sizeof(header)) && (!length || writeBuffer(fd, data, length));
+}
+
+/**
+ * @brief Reads the header of a frame, checking it
+ * 
+ * @param fd The descriptor to read from
+ * @param header The header to fill
+ * 
+ * @return true If a valid header was read
+ * @return false At the end of the stream or on an error
+ */
+bool readFrameHeader(file_d fd, FRAME_HEADER* header) {
+    return fillBuffer(fd, (char*)header, sizeof(FRAME_HEADER)) == sizeof(FRAME_HEADER)
+        && (header->type == FRAME_DATA || header->type == FRAME_END) && header->length <= FRAME_MAX_DATA;
+}
+
+/**
+ * @brief Main loop of a worker wrapping an executable that does not speak the protocol
+ * 
+ * For every job, the executable is started with pipes as its standard input and output. A child of the
+ * worker feeds it the input of the job while the worker turns its output into frames
+ * 
+ * @param exe The path of the executable
+ */
+void runWrappedWorker(char* exe) {
+    FRAME_HEADER header;
+    char* buffer = malloc(FRAME_MAX_DATA);
+    signal(SIGPIPE, SIG_IGN);
+
+    while(readFrameHeader(STDIN_FILENO, &header)) {
+        file_d input[2], output[2];
+        if(pipe(input) || pipe(output))
+            _exit(1);
+
+        pid_t program = fork();
+        if(!program) {
+            signal(SIGPIPE, SIG_DFL);
+            dup2(input[0], STDIN_FILENO);
+            dup2(output[1], STDOUT_FILENO);
+            close_range(3, ~0U, 0);
+            execl(exe, exe, NULL);
+            _exit(1);
+        }
+
+        //The rest of the job is read by the feeder, which keeps reading after the executable stopped
+        if(!fork()) {
+            close(input[0]);
+            close(output[0]);
+            close(output[1]);
+            bool writing = true;
+            while(header.type == FRAME_DATA) {
+                if(fillBuffer(STDIN_FILENO, buffer, header.length) != header.length)
+                    _exit(1);
+                writing = writing && writeBuffer(input[1], buffer, header.length);
+                if(!readFrameHeader(STDIN_FILENO, &header))
+                    _exit(1);
+            }
+            _exit(header.length != 0);
+        }
+        close(input[0]);
+        close(input[1]);
+        close(output[1]);
+
+        ssize_t bytesRead;
+        bool answered = true;
+        while((bytesRead = read(output[0], buffer, FRAME_MAX_DATA)) != 0) {
+            if(bytesRead < 0 && errno == EINTR)
+                continue;
+            if(bytesRead < 0 || !(answered = writeFrame(STDOUT_FILENO, FRAME_DATA, buffer, bytesRead)))
+                break;
+        }
+        close(output[0]);
+
+        int status, feederStatus;
+        waitpid(program, &status, 0);
+        wait(&feederStatus);
+
+        //A broken stream cannot be resynchronized: the worker stops and is replaced
+        int32_t result = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        if(!answered || !WIFEXITED(feederStatus) || WEXITSTATUS(feederStatus)
+         || !writeFrame(STDOUT_FILENO, FRAME_END, &result, sizeof(result)))
+            _exit(1);
+    }
+
+    _exit(0);
+}
+
+/**
+ * @brief Starts a worker in an empty slot
+ * 
+ * @param pool The given #WorkerPool
+ * @param id The id of the transformation
+ * @param worker The empty slot
+ * 
+ * @return true If the worker was started
+ * @return false If an error occurred
+ */
+bool startWorker(WorkerPool pool, int id, Worker worker) {
+    file_d jobs[2], results[2];
+    char* name = pool->config->programs[id];
+    char exe[strlen(pool->binPath) + strlen(name) + 1];
+    sprintf(exe, "%s%s", pool->binPath, name);
+
+    if(pipe2(jobs, O_CLOEXEC))
+        return false;
+    if(pipe2(results, O_CLOEXEC)) {
+        close(jobs[0]);
+        close(jobs[1]);
+        return false;
+    }
+
+    pid_t pid = fork();
+    if(!pid) {
+        dup2(jobs[0], STDIN_FILENO);
+        dup2(results[1], STDOUT_FILENO);
+        close_range(3, ~0U, 0);
+        if(pool->config->workerModes[id] == WORKER_NATIVE) {
+            char version[16];
+            sprintf(version, "%d", WORKER_PROTOCOL_VERSION);
+            setenv(WORKER_ENVIRONMENT, version, 1);
+            execl(exe, exe, NULL);
+            _exit(1);
+        }
+        runWrappedWorker(exe);
+    }
+
+    close(jobs[0]);
+    close(results[1]);
+    if(pid < 0) {
+        close(jobs[1]);
+        close(results[0]);
+        return false;
+    }
+
+    worker->pid = pid;
+    worker->jobs = jobs[1];
+    worker->results = results[0];
+    worker->done = 0;
+    worker->owner = -1;
+    pool->started++;
+    printFormattedMessage(STDERR_FILENO, WORKERSTARTED, pid, name);
+    return true;
+}
+
+/**
+ * @brief Stops a worker and empties its slot
+ * 
+ * @param worker The given #Worker
+ */
+void stopWorker(Worker worker) {
+    close(worker->jobs);
+    close(worker->results);
+    kill(worker->pid, SIGKILL);
+    waitpid(worker->pid, NULL, 0);
+    worker->pid = 0;
+    worker->owner = -1;
+}
+
+/**
+ * @brief Creates a new #WorkerPool (no worker is started until it is needed)
+ * 
+ * @param config The server #Config
+ * @param binPath The path to the executables of the transformations
+ * 
+ * @return WorkerPool The created #WorkerPool
+ * @return NULL If no transformation runs on workers (or the pool is disabled)
+ */
+WorkerPool newWorkerPool(Config config, char* binPath) {
+    WorkerPool pool = NULL;
+    if(!config->workerPool)
+        return NULL;
+
+    for(int i = 0; i < config->programCount; i++) {
+        if(config->workerModes[i] == WORKER_NONE || !config->instances[i])
+            continue;
+        if(!pool) {
+            pool = calloc(1, sizeof(struct workerPool));
+            pool->config = config;
+            pool->binPath = binPath;
+        }
+        pool->workers[i] = calloc(config->instances[i], sizeof(WORKER));
+        for(int j = 0; j < config->instances[i]; j++)
+            pool->workers[i][j].owner = -1;
+    }
+
+    return pool;
+}
+
+/**
+ * @brief Stops the workers and frees the memory allocated to a #WorkerPool
+ * 
+ * @param pool The given #WorkerPool
+ */
+void deleteWorkerPool(WorkerPool pool) {
+    if(!pool)
+        return;
+
+    for(int i = 0; i < NUMBER_PROGRAMS; i++) {
+        for(int j = 0; pool->workers[i] && j < pool->config->instances[i]; j++)
+            if(pool->workers[i][j].pid)
+                stopWorker(&pool->workers[i][j]);
+        free(pool->workers[i]);
+    }
+    free(pool);
+}
+
+/**
+ * @brief Gives a worker to every stage of a #Request being dispatched whose transformation runs on workers
+ * 
+ * A stage for which no worker is left (they are only given back once their #Request finishes) runs as a
+ * process, and a transformation loaded as a plugin runs as a plugin
+ * 
+ * @param pool The given #WorkerPool
+ * @param config The server #Config
+ * @param request The given #Request
+ */
+void assignWorkers(WorkerPool pool, Config config, Request request) {
+    if(!pool)
+        return;
+
+    for(int i = 0; i < request->operationCount; i++) {
+        int id = getProgramId(config, request->operations[i]);
+        Worker workers = pool->workers[id], chosen = NULL;
+        if(!workers || config->plugins[id])
+            continue;
+
+        for(int j = 0; j < config->instances[id] && !chosen; j++)
+            if(workers[j].pid && workers[j].owner < 0)
+                chosen = &workers[j];
+        if(chosen)
+            pool->hits++;
+
+        for(int j = 0; j < config->instances[id] && !chosen; j++)
+            if(!workers[j].pid && startWorker(pool, id, &workers[j])) {
+                chosen = &workers[j];
+                pool->misses++;
+            }
+
+        if(!chosen) {
+            pool->fallbacks++;
+            continue;
+        }
+        chosen->owner = request->timeOfArrival;
+        chosen->stage = i;
+        chosen->done++;
+    }
+}
+
+/**
+ * @brief Gives back the workers of a #Request that finished, replacing those that died or ran their share
+ * of jobs
+ * 
+ * The workers of a #Request that failed are replaced too, since a job may have been left half sent
+ * 
+ * @param pool The given #WorkerPool
+ * @param request The given #Request
+ * @param failed Whether the #Request failed
+ */
+void releaseWorkers(WorkerPool pool, Request request, bool failed) {
+    if(!pool)
+        return;
+
+    for(int i = 0; i < NUMBER_PROGRAMS; i++) {
+        for(int j = 0; pool->workers[i] && j < pool->config->instances[i]; j++) {
+            Worker worker = &pool->workers[i][j];
+            if(!worker->pid || worker->owner != request->timeOfArrival)
+                continue;
+
+            worker->owner = -1;
+            bool exhausted = pool->config->workerJobs && worker->done >= pool->config->workerJobs;
+            if(failed || exhausted || waitpid(worker->pid, NULL, WNOHANG)) {
+                printFormattedMessage(STDERR_FILENO, WORKERRECYCLED, worker->pid, pool->config->programs[i], worker->done);
+                stopWorker(worker);
+                pool->recycled++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Gets the worker given to a stage of a #Request
+ * 
+ * @param pool The given #WorkerPool
+ * @param request The given #Request
+ * @param stage The index of the stage
+ * 
+ * @return Worker The worker of the stage
+ * @return NULL If the stage runs as a process
+ */
+Worker getStageWorker(WorkerPool pool, Request request, int stage) {
+    for(int i = 0; pool && i < NUMBER_PROGRAMS; i++)
+        for(int j = 0; pool->workers[i] && j < pool->config->instances[i]; j++)
+            if(pool->workers[i][j].pid && pool->workers[i][j].owner == request->timeOfArrival && pool->workers[i][j].stage == stage)
+                return &pool->workers[i][j];
+
+    return NULL;
+}
+
+/**
+ * @brief Checks if any stage of a #Request runs on a worker
+ * 
+ * @param pool The given #WorkerPool
+ * @param request The given #Request
+ * 
+ * @return true If a stage runs on a worker
+ * @return false Otherwise
+ */
+bool usesWorkers(WorkerPool pool, Request request) {
+    for(int i = 0; pool && i < request->operationCount; i++)
+        if(getStageWorker(pool, request, i))
+            return true;
+
+    return false;
+}
+
+/**
+ * @brief Main function of the thread sending the input of a stage to its worker
+ * 
+ * @param arg The #WorkerStage
+ * 
+ * @return void* NULL
+ */
+void* feedWorker(void* arg) {
+    WorkerStage stage = arg;
+    char* buffer = malloc(FRAME_MAX_DATA);
+    bool sent = true;
+    int bytesRead;
+
+    //The job is always ended, so that the worker stays in step with the protocol
+    while(sent && (bytesRead = fillBuffer(stage->in, buffer, FRAME_MAX_DATA)) > 0) {
+        sent = writeFrame(stage->worker->jobs, FRAME_DATA, buffer, bytesRead);
+        stage->usage->bytesRead += bytesRead;
+    }
+    stage->fed = sent && bytesRead == 0;
+    if(sent)
+        writeFrame(stage->worker->jobs, FRAME_END, NULL, 0);
+
+    free(buffer);
+    close(stage->in);
+    return NULL;
+}
+
+/**
+ * @brief Main function of the thread writing the output of a stage, as its worker sends it
+ * 
+ * @param arg The #WorkerStage
+ * 
+ * @return void* NULL
+ */
+void* collectWorker(void* arg) {
+    WorkerStage stage = arg;
+    char* buffer = malloc(FRAME_MAX_DATA);
+    FRAME_HEADER header;
+    bool written = true;
+    int32_t status = -1;
+
+    //The output is read up to the end of the job even if it cannot be written, to keep the worker usable
+    while(readFrameHeader(stage->worker->results, &header) && fillBuffer(stage->worker->results, buffer, header.length) == header.length) {
+        if(header.type == FRAME_END) {
+            if(header.length == sizeof(status))
+                memcpy(&status, buffer, sizeof(status));
+            break;
+        }
+        written = written && writeBuffer(stage->out, buffer, header.length);
+        stage->usage->bytesWritten += header.length;
+    }
+    stage->ok = written && !status;
+
+    //The job is charged the CPU time the worker used meanwhile (a wrapped worker has waited for the processes
+    //of the job before ending it, so theirs is included)
+    STAGE_USAGE cpuAfter;
+    if(readProcessCpu(&cpuAfter, stage->worker->pid)) {
+        stage->usage->userTime = cpuAfter.userTime - stage->cpuBefore.userTime;
+        stage->usage->systemTime = cpuAfter.systemTime - stage->cpuBefore.systemTime;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    stage->usage->realTime = (now.tv_sec - stage->started.tv_sec) * 1000000L + (now.tv_nsec - stage->started.tv_nsec) / 1000;
+
+    free(buffer);
+    close(stage->out);
+    return NULL;
+}
+
+/**
+ * @brief Starts running a stage on its worker
+ * 
+ * Must only be called once every process of the pipeline has been forked, since the threads own the
+ * descriptors of the stage
+ * 
+ * @param stage The #WorkerStage to fill
+ * @param worker The worker of the stage
+ * @param in The descriptor to read the input from (closed once sent)
+ * @param out The descriptor to write the output to (closed once written)
+ * @param usage The #StageUsage of the stage (zeroed, then filled by the threads)
+ * 
+ * @return true If the threads were started
+ * @return false If they could not be started (the descriptors are closed, and joining it reports a failure)
+ */
+bool startWorkerStage(WorkerStage stage, Worker worker, file_d in, file_d out, StageUsage usage) {
+    sigset_t mask, previous;
+    stage->worker = worker;
+    stage->in = in;
+    stage->out = out;
+    stage->usage = usage;
+    stage->ok = stage->fed = false;
+    memset(usage, 0, sizeof(STAGE_USAGE));
+    clock_gettime(CLOCK_MONOTONIC, &stage->started);
+    memset(&stage->cpuBefore, 0, sizeof(STAGE_USAGE));
+    readProcessCpu(&stage->cpuBefore, worker->pid);
+
+    //The threads inherit the mask: a write to a pipe whose reader is gone must fail instead of killing the job handler
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &mask, &previous);
+    stage->running = !pthread_create(&stage->feeder, NULL, feedWorker, stage);
+    if(stage->running && pthread_create(&stage->collector, NULL, collectWorker, stage)) {
+        //Without a collector the job cannot be completed, the worker is replaced when it is given back
+        pthread_join(stage->feeder, NULL);
+        close(out);
+        kill(worker->pid, SIGKILL);
+        stage->running = false;
+    } else if(!stage->running) {
+        close(in);
+        close(out);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    return stage->running;
+}
+
+/**
+ * @brief Waits for a stage run on a worker to finish
+ * 
+ * @param stage The given #WorkerStage
+ * 
+ * @return true If the whole input was sent and the worker succeeded
+ * @return false Otherwise
+ */
+bool joinWorkerStage(WorkerStage stage) {
+    if(!stage->running)
+        return false;
+
+    pthread_join(stage->feeder, NULL);
+    pthread_join(stage->collector, NULL);
+    return stage->ok && stage->fed;
+}
+
+/**
+ * @brief Gets the string to send to the client regarding the persistent workers
+ * 
+ * @param pool The given #WorkerPool
+ * @param config The server #Config
+ * 
+ * @return char* The worker pool status string
+ */
+char* getWorkerPoolStatus(WorkerPool pool, Config config) {
+    char* result = malloc(WORKER_LINE_SIZE);
+    *result = '\0';
+
+    if(!pool)
+        return result;
+
+    int running = 0;
+    for(int i = 0; i < config->programCount; i++)
+        for(int j = 0; pool->workers[i] && j < config->instances[i]; j++)
+            running += pool->workers[i][j].pid != 0;
+
+    long assigned = pool->hits + pool->misses + pool->fallbacks;
+    snprintf(result, WORKER_LINE_SIZE, "workers: %d running, %ld started, %ld recycled, hit rate %.1f%% (%ld hits, %ld misses, %ld run as processes)\n",
+        running, pool->started, pool->recycled, assigned ? 100.0 * pool->hits / assigned : 0.0,
+        pool->hits, pool->misses, pool->fallbacks);
+
+    return result;
+}
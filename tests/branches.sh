@@ -0,0 +1,46 @@
+#!/bin/sh
+# Regression test of the branches: each branch sends the output of the prefix it forks from through transformations
+# of its own to its own file, a branch without transformations saving that intermediate output, while the input and
+# the shared prefix are run once. A request with more stages of a transformation than it has instances, branches
+# included, is rejected as invalid.
+# Runs a server of bin/ in a directory of its own, with a nop that counts how many times it runs.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "branches: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+printf '#!/bin/sh\necho >> "%s/runs"\nexec cat\n' "$DIR" > nop
+chmod +x nop
+cp "$ROOT/sample-transformations/gcompress" "$ROOT/sample-transformations/bcompress" .
+printf 'nop 1\ngcompress 2\nbcompress 1\n' > config.txt
+seq 1 200000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.bz2 nop bcompress -b 1 out.gz gcompress -b 1 out.nop -b 0 in.gz gcompress > branches.log 2>&1 || fail "the request with branches did not conclude"
+[ "$(wc -l < runs)" -eq 1 ] || fail "the shared prefix was not run once"
+bzip2 -dc out.bz2 | cmp -s - in.txt || fail "the output of the operations is not the compressed input"
+gzip -dc out.gz | cmp -s - in.txt || fail "the output of the branch is not the compressed input"
+gzip -dc in.gz | cmp -s - in.txt || fail "the output of the branch of the input is not the compressed input"
+cmp -s out.nop in.txt || fail "the intermediate output saved is not the output of the prefix"
+
+# Three stages of gcompress, which has two instances
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz gcompress -b 0 a.gz gcompress -b 0 b.gz gcompress > invalid.log 2>&1
+grep -q "Request not considered valid" invalid.log || fail "the request with too many stages was not rejected"
+[ ! -e a.gz ] && [ ! -e b.gz ] || fail "the outputs of the rejected request were written"
+
+echo "branches: OK" >&2
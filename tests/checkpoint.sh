@@ -0,0 +1,64 @@
+#!/bin/sh
+# Regression test of the checkpoints of the requests run in chunks: the progress of a request whose stage fails
+# is kept in the journal next to its output, and the same request submitted again resumes after the last chunk
+# recorded, its output holding every chunk once. The journal is removed once the request finishes, and once
+# another request writes the output from the start.
+# Runs a server of bin/ in a directory of its own, with a chunkable transformation compressing its input that fails
+# on the n-th chunk it is given since the server started, n being read from the file "failing" (5 at first).
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "checkpoint: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cat > flaky <<SCRIPT
+#!/bin/sh
+calls=\$((\$(cat "$DIR/calls" 2>/dev/null || echo 0) + 1))
+echo \$calls > "$DIR/calls"
+if [ \$calls -eq "\$(cat "$DIR/failing")" ]; then
+    cat > /dev/null
+    exit 1
+fi
+exec gzip -c
+SCRIPT
+chmod +x flaky
+echo 5 > failing
+cp "$ROOT/sample-transformations/nop" .
+printf 'flaky 1 chunkable\nnop 1\noption chunk-threshold 1M\noption chunk-size 256K\noption checkpoint-interval 256K\n' > config.txt
+seq 1 400000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+# One chunk at a time, the fifth failing
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz flaky > failed.log 2>&1
+grep -q "^Failed" failed.log || fail "the failed request was not reported as failed"
+[ -e out.gz.sdjournal ] || fail "the progress of the failed request was not kept"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz flaky > resumed.log 2>&1 || fail "the resumed request did not conclude"
+grep -q "Request resumed after chunk 4" server.log || fail "the request did not resume after the chunks done"
+[ "$(cat calls)" -eq 12 ] || fail "the request did not run only the chunks left ($(cat calls) stages)"
+gzip -dc out.gz | cmp -s - in.txt || fail "the resumed output is not the compressed input"
+[ ! -e out.gz.sdjournal ] || fail "the journal of the finished request was kept"
+
+# A journal left by a failed run no longer describes an output written from the start by another request
+echo $(($(cat calls) + 3)) > failing
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz flaky > again.log 2>&1
+[ -e out.gz.sdjournal ] || fail "the progress of the request failed again was not kept"
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz nop > rewritten.log 2>&1 || fail "the request not run in chunks did not conclude"
+[ ! -e out.gz.sdjournal ] || fail "the journal of an output written from the start was kept"
+cmp -s out.gz in.txt || fail "the output written from the start is not the input"
+
+echo "checkpoint: OK" >&2
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Regression test of the requests run in chunks: a request made only of chunkable transformations on an input of
+# at least chunk-threshold bytes is split into chunks, run at once within the instances that are free, and their
+# outputs are appended to the output in order, forming a valid multi-member stream. A request on a smaller input,
+# or with a transformation that is not chunkable, is run as a single pipeline.
+# Runs a server of bin/ in a directory of its own, with gcompress chunkable and small chunks.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "chunks: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cp "$ROOT/sample-transformations/gcompress" "$ROOT/sample-transformations/nop" .
+printf 'gcompress 3 chunkable\nnop 1\noption chunk-threshold 1M\noption chunk-size 256K\noption chunk-width 4\noption checkpoint-interval 0\n' > config.txt
+seq 1 400000 > in.txt
+seq 1 1000 > small.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+# 2688895 bytes in chunks of 256 KiB, at most as many at once as there are instances of gcompress
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz gcompress > chunked.log 2>&1 || fail "the chunked request did not conclude"
+grep -q "Request split into 11 chunks, 3 run at once" server.log || fail "the request was not split into chunks"
+gzip -dc out.gz | cmp -s - in.txt || fail "the chunks of the output are not the compressed input in order"
+[ "$(gzip -dc out.gz | wc -c)" -eq "$(stat -c %s in.txt)" ] || fail "the output has chunks missing or repeated"
+[ ! -e out.gz.sdjournal ] || fail "the journal of the finished request was kept"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file small.txt small.gz gcompress > small.log 2>&1 || fail "the small request did not conclude"
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt mixed.gz gcompress nop > mixed.log 2>&1 || fail "the request with nop did not conclude"
+[ "$(grep -c "Request split into" server.log)" -eq 1 ] || fail "a request that cannot run in chunks was split"
+gzip -dc small.gz | cmp -s - small.txt || fail "the output of the small request is not its compressed input"
+gzip -dc mixed.gz | cmp -s - in.txt || fail "the output of the request with nop is not its compressed input"
+
+echo "chunks: OK" >&2
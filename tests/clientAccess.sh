@@ -0,0 +1,53 @@
+#!/bin/sh
+# Regression test of the permissions of the clients of the socket: a path named by a client must be opened with
+# the permissions of its user (SO_PEERCRED), not those of the server. Needs a server run by root, and is skipped
+# otherwise.
+# Runs a server of bin/ in a directory of its own, and a client as nobody whose branch writes to a directory only
+# root can write to, then to one it can write to.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+if [ "$(id -u)" -ne 0 ] || ! command -v setpriv > /dev/null; then
+    echo "clientAccess: SKIPPED (needs root and setpriv)" >&2
+    exit 0
+fi
+
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "clientAccess: FAILED ($1)" >&2
+    sed 's/^/  server: /' "$DIR/server.log" >&2
+    exit 1
+}
+
+cp "$ROOT/sample-transformations/nop" .
+printf 'nop 4\n' > config.txt
+seq 1 100000 > in.txt
+mkdir private public
+chmod 755 "$DIR" private
+chmod 777 public
+chmod 644 in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+chmod 777 SDStore.sock
+
+cd public
+SDSTORE_SOCKET="$DIR/SDStore.sock" timeout 20 setpriv --reuid=nobody --regid=nogroup --clear-groups \
+    "$ROOT/bin/sdstore" proc-file "$DIR/in.txt" out.txt nop -b 1 "$DIR/private/branch.txt" nop > ../refused.log 2>&1
+[ -e "$DIR/private/branch.txt" ] && fail "the server wrote where its client cannot"
+cmp -s out.txt "$DIR/in.txt" || fail "the output passed by the client was not written"
+
+SDSTORE_SOCKET="$DIR/SDStore.sock" timeout 20 setpriv --reuid=nobody --regid=nogroup --clear-groups \
+    "$ROOT/bin/sdstore" proc-file "$DIR/in.txt" out2.txt nop -b 1 "$DIR/public/branch.txt" nop > ../allowed.log 2>&1
+cmp -s branch.txt "$DIR/in.txt" || fail "the branch the client can write was not written"
+[ "$(stat -c %U branch.txt)" = nobody ] || fail "the branch was not created as the client"
+
+echo "clientAccess: OK" >&2
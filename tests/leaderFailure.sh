@@ -0,0 +1,51 @@
+#!/bin/sh
+# Regression test of the coalescing of identical requests: a request attached to an identical request that
+# fails must be queued on its own and complete, instead of waiting forever for the output of its leader.
+# Runs a server of bin/ in a directory of its own, with a transformation that fails the first time it runs.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "leaderFailure: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+# Slow enough for the second request to attach to the first one while it runs
+cat > flaky <<EOF
+#!/bin/sh
+if [ -e "$DIR/failed" ]; then exec cat; fi
+touch "$DIR/failed"
+sleep 1
+exit 1
+EOF
+chmod +x flaky
+printf 'flaky 2\noption coalesce yes\n' > config.txt
+seq 1 100000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt leader.txt flaky > leader.log 2>&1 &
+LEADER=$!
+sleep 0.3
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt follower.txt flaky > follower.log 2>&1
+FOLLOWER=$?
+wait $LEADER
+
+grep -q "^Failed" leader.log || fail "the leader was not reported as failed"
+grep -q "attached to an identical request" follower.log || fail "the follower was not attached to the leader"
+[ $FOLLOWER -eq 0 ] || fail "the follower did not conclude (exit status $FOLLOWER)"
+grep -q "the identical request failed" follower.log || fail "the follower was not queued on its own"
+cmp -s follower.txt in.txt || fail "the output of the follower is not its input"
+
+echo "leaderFailure: OK" >&2
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Regression test of the persistent workers: the native nop worker of bin/workers must be started once, as its
+# own executable rather than a wrapper of the server, and run every request given to it over the protocol.
+# Runs a server of bin/ in a directory of its own, with nop declared as a native worker.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "nativeWorker: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cp "$ROOT/bin/workers/nop" nop || fail "the native worker was not built"
+printf 'nop 2 worker=native\n' > config.txt
+seq 1 100000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+for i in 1 2 3; do
+    timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out$i.txt nop > out$i.log 2>&1 || fail "request $i did not conclude"
+    cmp -s out$i.txt in.txt || fail "the output of request $i is not its input"
+done
+
+WORKER=$(sed -n 's/.*Worker \([0-9]*\) started for nop.*/\1/p' server.log)
+[ "$(echo "$WORKER" | wc -w)" -eq 1 ] || fail "the worker was not started once"
+[ "$(readlink "/proc/$WORKER/exe")" = "$DIR/nop" ] || fail "the worker is not the native executable"
+"$ROOT/bin/sdstore" status > status.log 2>&1
+grep -q "workers: 1 running, 1 started, 0 recycled, hit rate 66.7% (2 hits, 1 misses" status.log || fail "the worker was not reused"
+
+echo "nativeWorker: OK" >&2
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Regression test of the optimizer: identities and the pairs of a transformation followed by its inverse must be
+# removed before the request is checked against the instances, so that a request with more stages than there
+# are instances is served once it is left with few enough of them, and a request left without operations is
+# served with a copy of its input.
+# Runs a server of bin/ in a directory of its own, with nop declared as an identity and gdecompress as the
+# inverse of gcompress.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "optimizer: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cp "$ROOT/sample-transformations/nop" "$ROOT/sample-transformations/gcompress" "$ROOT/sample-transformations/gdecompress" .
+printf 'nop 3 identity\ngcompress 2 inverse=gdecompress\ngdecompress 2\n' > config.txt
+seq 1 100000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+# Four stages of nop, which has three instances
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt copy.txt nop nop nop nop > copy.log 2>&1 || fail "the chain of nop did not conclude"
+grep -q "Removed redundant operations: nop nop nop nop (none left, the input is copied)" copy.log || fail "the chain of nop was not removed"
+cmp -s copy.txt in.txt || fail "the copy is not the input"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt nested.txt gcompress gcompress gdecompress gdecompress > nested.log 2>&1 || fail "the nested pairs did not conclude"
+grep -q "Removed redundant operations: gcompress gdecompress gcompress gdecompress (none left" nested.log || fail "the nested pairs were not removed"
+cmp -s nested.txt in.txt || fail "the copy of the nested pairs is not the input"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out.gz gcompress nop gdecompress gcompress > left.log 2>&1 || fail "the shortened request did not conclude"
+grep -q "Removed redundant operations: nop gcompress gdecompress (1 left)" left.log || fail "the request was not shortened"
+gzip -dc out.gz | cmp -s - in.txt || fail "the output of the operation left is not the compressed input"
+
+"$ROOT/bin/sdstore" status > status.log 2>&1
+grep -q "optimizer: 3 requests shortened, 11 operations removed, 2 served as copies" status.log || fail "the removals were not accounted for"
+
+echo "optimizer: OK" >&2
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Regression test of the plugins: consecutive plugin stages run in a worker of their own, connected by pipes to the
+# stages run as processes around them, and the output of the request is the same as if every stage were a process.
+# Runs a server of bin/ in a directory of its own, with nop run from the plugin of bin/plugins.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "pluginChain: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cp "$ROOT/sample-transformations/nop" "$ROOT/sample-transformations/gcompress" .
+printf 'nop 4 plugin\ngcompress 1\n' > config.txt
+seq 1 200000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+grep -q "nop runs in the server" server.log || fail "the plugin was not loaded"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt plugins.txt nop nop > plugins.log 2>&1 || fail "the request of plugins did not conclude"
+cmp -s plugins.txt in.txt || fail "the output of the plugins is not their input"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt mixed.gz nop nop gcompress nop > mixed.log 2>&1 || fail "the mixed request did not conclude"
+gzip -dc mixed.gz | cmp -s - in.txt || fail "the output of the mixed request is not the compressed input"
+
+echo "pluginChain: OK" >&2
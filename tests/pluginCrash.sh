@@ -0,0 +1,57 @@
+#!/bin/sh
+# Regression test of the plugins: a plugin that crashes must fail its request, instead of killing the job
+# handler and leaving the request (and the instances it holds) running forever, and the server must keep
+# serving the requests that follow it.
+# Runs a server of bin/ in a directory of its own, with a transformation whose plugin crashes on its input.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "pluginCrash: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cat > crash.c <<EOF
+#include <signal.h>
+#include "plugin.h"
+static int crashInit(void** state) { *state = 0; return 0; }
+static int crashProcess(void* state, const char* data, size_t length, PluginEmit emit, void* sink) {
+    raise(SIGSEGV);
+    return emit(sink, data, length);
+}
+static int crashFinish(void* state, PluginEmit emit, void* sink) { return 0; }
+const PLUGIN_API sdstorePlugin = { PLUGIN_ABI_VERSION, crashInit, crashProcess, crashFinish };
+EOF
+gcc -shared -fPIC -o crash.so crash.c -I"$ROOT/server/include" || fail "the plugin did not build"
+printf '#!/bin/sh\nexec cat\n' > crash
+cp "$ROOT/sample-transformations/nop" .
+chmod +x crash
+printf 'crash 1 plugin\nnop 2\n' > config.txt
+seq 1 100000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+grep -q "crash runs in the server" server.log || fail "the plugin was not loaded"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt crashed.txt nop crash nop > crashed.log 2>&1
+CRASHED=$?
+[ $CRASHED -ne 124 ] || fail "the request of the crashing plugin never finished"
+grep -q "^Failed" crashed.log || fail "the request of the crashing plugin was not reported as failed"
+
+# The instance of the plugin was given back: the same request is run again instead of waiting for it
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt again.txt crash > again.log 2>&1
+[ $? -ne 124 ] || fail "the instance of the crashing plugin was not given back"
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt nop.txt nop > nop.log 2>&1 || fail "a later request did not conclude"
+cmp -s nop.txt in.txt || fail "the output of the later request is not its input"
+
+echo "pluginCrash: OK" >&2
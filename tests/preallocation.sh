@@ -0,0 +1,53 @@
+#!/bin/sh
+# Regression test of the preallocation of the outputs: an output is preallocated to its predicted size, and the
+# space beyond what the request wrote must be given back once it finishes, as well as when one of its stages
+# fails. The size model must learn from the outputs that were wrong.
+# Runs a server of bin/ in a directory of its own, with transformations whose output is far smaller than their
+# input, one of them failing.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "preallocation: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+# Whether the space allocated to a file is at most 64 KiB beyond its size
+fitted() {
+    [ $(($(stat -c '%b * %B' "$1"))) -le $(($(stat -c %s "$1") + 65536)) ]
+}
+
+printf '#!/bin/sh\nexec head -c 100000\n' > shrink
+printf '#!/bin/sh\nhead -c 1000\nexit 1\n' > broken
+chmod +x shrink broken
+printf 'shrink 1\nbroken 1\noption preallocate-threshold 64K\n' > config.txt
+seq 1 400000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+# Nothing is learnt yet: both outputs are predicted as large as the input
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt shrunk.txt shrink > shrunk.log 2>&1 || fail "the request did not conclude"
+[ "$(stat -c %s shrunk.txt)" -eq 100000 ] || fail "the output does not hold what the stage wrote"
+fitted shrunk.txt || fail "the space preallocated to the output of a finished request was kept"
+grep -q "Output size predicted: $(stat -c %s in.txt) bytes, actual: 100000 bytes" server.log || fail "the prediction was not checked"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file in.txt broken.txt broken > broken.log 2>&1
+grep -q "^Failed" broken.log || fail "the failed request was not reported as failed"
+fitted broken.txt || fail "the space preallocated to the output of a failed request was kept"
+
+"$ROOT/bin/sdstore" status > status.log 2>&1
+grep -q "output size: 1 predictions, mean error 2588.9%" status.log || fail "the prediction was not accounted for"
+grep -q "output size ratio shrink: 0.037 (1 samples)" status.log || fail "the ratio of the transformation was not learnt"
+
+echo "preallocation: OK" >&2
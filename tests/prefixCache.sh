@@ -0,0 +1,61 @@
+#!/bin/sh
+# Regression test of the prefix cache: once a prefix of operations was used by prefix-hot requests, the next one
+# using it stores its intermediate output in the cache, and the later requests sharing the prefix and the input
+# start right after it, only running their remaining operations. The requests, hits and stores of each prefix
+# are shown by status.
+# Runs a server of bin/ in a directory of its own, with a nop that counts how many times it runs, and a copy that
+# does not.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "prefixCache: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+# Runs a request on the input, failing if it does not conclude
+run() {
+    output=$1
+    shift
+    timeout 20 "$ROOT/bin/sdstore" proc-file in.txt "$output" "$@" > request.log 2>&1 || fail "the request $* did not conclude"
+}
+
+printf '#!/bin/sh\necho >> "%s/runs"\nexec cat\n' "$DIR" > nop
+printf '#!/bin/sh\nexec cat\n' > copy
+chmod +x nop copy
+cp "$ROOT/sample-transformations/gcompress" "$ROOT/sample-transformations/bcompress" .
+mkdir cache
+printf 'nop 1\ncopy 1\ngcompress 1\nbcompress 1\noption cache-dir %s/cache\noption prefix-cache-size 4M\noption prefix-hot 2\noption coalesce no\n' "$DIR" > config.txt
+seq 1 200000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+# The second request makes the prefix nop hot, and stores its intermediate output
+run out.gz nop gcompress
+run out.bz2 nop bcompress
+run copy.gz nop copy gcompress
+# The output of a request is the intermediate output of the longer requests starting with its operations
+run out.gz.bz2 nop gcompress bcompress
+[ "$(wc -l < runs)" -eq 2 ] || fail "the prefix was run $(wc -l < runs) times instead of being served from the cache"
+gzip -dc out.gz | cmp -s - in.txt || fail "the output of nop gcompress is wrong"
+bzip2 -dc out.bz2 | cmp -s - in.txt || fail "the output of nop bcompress is wrong"
+bzip2 -dc out.gz.bz2 | gzip -dc | cmp -s - in.txt || fail "the output of nop gcompress bcompress is wrong"
+gzip -dc copy.gz | cmp -s - in.txt || fail "the output started after the cached prefix is wrong"
+
+"$ROOT/bin/sdstore" status > status.log 2>&1
+grep -q "prefix cache: 1258/4096 KiB" status.log || fail "the intermediate output was not accounted for"
+grep -q 'prefix "nop": 4 requests, 1 hits, 1 stored' status.log || fail "the hit on the intermediate output was not accounted for"
+grep -q 'prefix "nop gcompress": 1 requests, 1 hits, 0 stored' status.log || fail "the hit on the output of a request was not accounted for"
+
+echo "prefixCache: OK" >&2
@@ -0,0 +1,71 @@
+#!/bin/sh
+# Regression test of the result cache: a request on an input already read, with the same operations as an earlier
+# one, is served with a copy of the cached output without running any transformation, and one on an input modified
+# since is run again. The least recently used outputs are evicted once the cache is full, and the hits, misses and
+# evictions are shown by status.
+# Runs a server of bin/ in a directory of its own, with a nop that counts how many times it runs and a cache with
+# room for two of the outputs.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "resultCache: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+# Runs a request, failing if it does not conclude
+run() {
+    timeout 20 "$ROOT/bin/sdstore" proc-file "$1" "$2" nop > request.log 2>&1 || fail "the request on $1 did not conclude"
+    cmp -s "$1" "$2" || fail "the output of the request on $1 is not its input"
+}
+
+# Whether nop ran the given number of times
+ran() {
+    [ "$(wc -l < runs)" -eq "$1" ]
+}
+
+printf '#!/bin/sh\necho >> "%s/runs"\nexec cat\n' "$DIR" > nop
+chmod +x nop
+mkdir cache
+printf 'nop 1\noption cache-dir %s/cache\noption cache-size 700K\noption coalesce no\n' "$DIR" > config.txt
+for input in a b c; do
+    head -c 300000 /dev/urandom > $input.bin
+done
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+run a.bin a1.out
+ran 1 || fail "the first request was not run"
+run a.bin a2.out
+ran 1 || fail "the request on the same input was not served from the cache"
+
+# A modified input is another input
+head -c 300000 /dev/urandom > a.bin
+run a.bin a3.out
+ran 2 || fail "the request on the modified input was served from the cache"
+run a.bin a4.out
+ran 2 || fail "the request on the modified input was not cached"
+
+# b then c fill the cache, evicting a
+run b.bin b1.out
+run c.bin c1.out
+run a.bin a5.out
+ran 5 || fail "the least recently used output was not evicted"
+run c.bin c2.out
+ran 5 || fail "the output used most recently was evicted"
+
+"$ROOT/bin/sdstore" status > status.log 2>&1
+grep -q "result cache: 586/700 KiB, hit rate 3/8 (37%), 3 evicted" status.log || fail "the hits and evictions were not accounted for"
+
+echo "resultCache: OK" >&2
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Regression test of the scheduling classes of the priorities: the stages of a request must run with the niceness
+# and CPU scheduling policy configured for its priority, and those of the priorities without settings with the
+# ones of the server.
+# Runs a server of bin/ in a directory of its own, with a transformation that records how it is scheduled.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "schedulingClass: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+# The niceness and the policy of the process, fields 19 and 41 of its stat (its name holds no space)
+cat > show <<EOF
+#!/bin/sh
+cut -d' ' -f19,41 /proc/\$\$/stat > "$DIR/scheduled.txt"
+exec cat
+EOF
+chmod +x show
+printf 'show 1\npriority 0 nice=10 sched=batch\n' > config.txt
+seq 1 1000 > in.txt
+SERVER_SCHEDULING=$(cut -d' ' -f19,41 /proc/$$/stat)
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file -p 0 in.txt low.txt show > low.log 2>&1 || fail "the request of priority 0 did not conclude"
+cmp -s low.txt in.txt || fail "the output of the request of priority 0 is not its input"
+# SCHED_BATCH is policy 3
+[ "$(cat scheduled.txt)" = "10 3" ] || fail "priority 0 ran as $(cat scheduled.txt) instead of nice 10 and SCHED_BATCH"
+
+timeout 20 "$ROOT/bin/sdstore" proc-file -p 3 in.txt high.txt show > high.log 2>&1 || fail "the request of priority 3 did not conclude"
+[ "$(cat scheduled.txt)" = "$SERVER_SCHEDULING" ] || fail "priority 3 ran as $(cat scheduled.txt) instead of $SERVER_SCHEDULING"
+
+echo "schedulingClass: OK" >&2
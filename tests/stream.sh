@@ -0,0 +1,54 @@
+#!/bin/sh
+# Regression test of the streams: proc-stream sends the standard input of the client through the transformations
+# to its standard output, the answers of the server going to its standard error, and is checked against the
+# instances like proc-file. A "-" given to proc-file is a file named so, and not a stream.
+# Runs a server of bin/ in a directory of its own.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "stream: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cp "$ROOT/sample-transformations/nop" "$ROOT/sample-transformations/gcompress" .
+printf 'nop 2\ngcompress 1\n' > config.txt
+seq 1 200000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+seq 1 200000 | timeout 20 "$ROOT/bin/sdstore" proc-stream -p 3 nop gcompress 2> stream.log > out.gz || fail "the stream did not conclude"
+gzip -dc out.gz | cmp -s - in.txt || fail "the output of the stream is not its compressed input"
+grep -q "^Concluded" stream.log || fail "the answers of the server did not go to the standard error"
+
+# Three stages of nop, which has two instances
+timeout 20 "$ROOT/bin/sdstore" proc-stream nop nop nop < in.txt 2> instances.log > /dev/null
+grep -q "Request not considered valid" instances.log || fail "the stream with too many stages was not rejected"
+
+for arguments in "-p nop" "-p x nop" "-p 1"; do
+    timeout 20 "$ROOT/bin/sdstore" proc-stream $arguments < in.txt > arguments.log 2>&1 && fail "proc-stream $arguments was accepted"
+    grep -q "Invalid arguments" arguments.log || fail "proc-stream $arguments was not rejected by the client"
+done
+
+SDSTORE_SOCKET=/nonexistent timeout 20 "$ROOT/bin/sdstore" proc-stream nop < in.txt > fifo.log 2>&1 && fail "the stream was sent without the socket"
+grep -q "Streaming needs the server to listen on its socket" fifo.log || fail "the stream without the socket was not refused"
+
+# A file named "-", through the socket and through the FIFO
+cp in.txt ./-
+timeout 20 "$ROOT/bin/sdstore" proc-file - socket.txt nop > socket.log 2>&1 || fail "the request on the file - did not conclude"
+cmp -s socket.txt in.txt || fail "the output of the request on the file - is not its input"
+SDSTORE_SOCKET=/nonexistent timeout 20 "$ROOT/bin/sdstore" proc-file in.txt - nop > fifo.log 2>&1 || fail "the request on the file - through the FIFO did not conclude"
+cmp -s ./- in.txt || fail "the output written to the file - through the FIFO is not its input"
+
+echo "stream: OK" >&2
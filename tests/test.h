@@ -0,0 +1,69 @@
+/**
+ * @file test.h
+ * 
+ * @brief File declaring the checks shared by the unit tests
+ * 
+ * Each test is a program of its own, which reports the checks that failed and exits with 1 if any did
+ * 
+ */
+
+#ifndef _TEST_H_
+
+/**
+ * @brief Include guard
+ */
+#define _TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+/**
+ * @brief The number of checks that failed so far (defined by each test)
+ * 
+ */
+extern int testFailures;
+
+/**
+ * @brief Checks a condition, reporting where it failed if it does not hold
+ * 
+ */
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        testFailures++; \
+    } \
+} while(0)
+
+/**
+ * @brief Reports the result of a test, returning the exit status of its program
+ * 
+ */
+#define TEST_RESULT(name) (fprintf(stderr, "%s: %s\n", name, testFailures ? "FAILED" : "OK"), testFailures != 0)
+
+/**
+ * @brief Loads a #Config from the lines of a configuration file, written to a temporary file
+ * 
+ * @param lines The contents of the configuration file
+ * @param config The #Config to load
+ * 
+ * @return true If the configuration was loaded
+ * @return false Otherwise
+ */
+static inline bool loadTestConfig(const char* lines, Config config) {
+    char path[] = "/tmp/testConfigXXXXXX";
+    file_d fd = mkstemp(path);
+    if(fd < 0)
+        return false;
+
+    bool written = write(fd, lines, strlen(lines)) == (ssize_t)strlen(lines);
+    close(fd);
+    bool loaded = written && loadConfig(path, config);
+    unlink(path);
+    return loaded;
+}
+
+#endif // _TEST_H_
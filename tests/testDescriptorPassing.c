@@ -0,0 +1,133 @@
+/**
+ * @file testDescriptorPassing.c
+ * 
+ * @brief File testing the requests passed to the router with the descriptors of their client
+ * 
+ * The relay passes each #Request through a socket along with its client and the descriptors it received from it:
+ * the connection to answer through, then the input and the output files already opened by the client, which the
+ * #Request is given instead of its paths. A #Request passed without both files opens its paths.
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "clientSocket.h"
+#include "pipeWrapper.h"
+#include "request.h"
+#include "socketWrapper.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief Checks that two descriptors refer to the same file
+ * 
+ * @param first The first descriptor
+ * @param second The second descriptor
+ * 
+ * @return true If they do
+ * @return false Otherwise
+ */
+bool sameFile(file_d first, file_d second) {
+    struct stat st1, st2;
+    return first >= 0 && second >= 0 && !fstat(first, &st1) && !fstat(second, &st2)
+        && st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+
+/**
+ * @brief Passes a #Request through a socket the way the relay does, and receives it the way the router does
+ * 
+ * @param sent The #Request to pass
+ * @param peer The client of the #Request
+ * @param fds The descriptors passed with it
+ * @param count The number of descriptors
+ * 
+ * @return Request The #Request received (NULL if none was)
+ */
+Request passRequest(Request sent, Peer peer, file_d fds[], int count) {
+    file_d channel[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, channel))
+        return NULL;
+
+    PIPE_WRITTER pw;
+    initPipeWritter(&pw, channel[0]);
+    bool passed = sendDescriptors(channel[0], peer, sizeof(PEER), fds, count) && writeRequest(&pw, sent) && flushPipe(&pw);
+    close(channel[0]);
+
+    PEER received;
+    Request request = passed ? receiveRequest(channel[1], &received) : NULL;
+    close(channel[1]);
+    if(request && (received.pid != peer->pid || received.uid != peer->uid || received.descriptors != peer->descriptors)) {
+        freeRequest(request);
+        return NULL;
+    }
+    return request;
+}
+
+int main() {
+    char* operations[] = { "nop" };
+    REQUEST sent;
+    memset(&sent, 0, sizeof(REQUEST));
+    sent.type = PROCESS_FILE;
+    sent.sender = "";
+    sent.inputFile = "/nonexistent/in";
+    sent.outputFile = "/nonexistent/out";
+    sent.operationCount = 1;
+    sent.operations = operations;
+
+    char inPath[] = "/tmp/testDescriptorPassingXXXXXX", outPath[] = "/tmp/testDescriptorPassingXXXXXX";
+    file_d in = mkstemp(inPath), out = mkstemp(outPath);
+    CHECK(in >= 0 && out >= 0 && write(in, "data", 4) == 4);
+    //The files are only reachable through their descriptors
+    unlink(inPath);
+    unlink(outPath);
+    file_d connection[2];
+    CHECK(!socketpair(AF_UNIX, SOCK_STREAM, 0, connection));
+
+    PEER peer = { getpid(), 1000, 1000, 3 };
+    file_d fds[] = { connection[1], in, out };
+    Request r = passRequest(&sent, &peer, fds, 3);
+    CHECK(r != NULL);
+    if(r) {
+        CHECK(r->clientPid == getpid() && r->clientUid == 1000 && r->clientGid == 1000);
+        CHECK(sameFile(r->senderFD, connection[1]) && sameFile(r->inputFD, in) && sameFile(r->outputFD, out));
+        //The files opened are the ones passed, not the paths of the request
+        file_d opened = openRequestInput(r);
+        char data[4];
+        CHECK(opened >= 0 && pread(opened, data, 4, 0) == 4 && !memcmp(data, "data", 4));
+        close(opened);
+        opened = openRequestOutput(r, true);
+        CHECK(sameFile(opened, out));
+        close(opened);
+
+        close(r->senderFD);
+        close(r->inputFD);
+        close(r->outputFD);
+        freeRequest(r);
+    }
+
+    //Without both files, the paths are opened instead
+    peer.descriptors = 2;
+    r = passRequest(&sent, &peer, fds, 2);
+    CHECK(r != NULL && r->senderFD >= 0 && r->inputFD == -1 && r->outputFD == -1);
+    CHECK(r && openRequestInput(r) < 0);
+    if(r) {
+        close(r->senderFD);
+        freeRequest(r);
+    }
+
+    //A client of the FIFO passes nothing
+    PEER fifoPeer = { 0, 0, 0, 0 };
+    sent.sender = "fifo";
+    r = passRequest(&sent, &fifoPeer, NULL, 0);
+    CHECK(r != NULL && r->senderFD == -1 && r->inputFD == -1 && r->clientPid == 0 && !strcmp(r->sender, "fifo"));
+    if(r)
+        freeRequest(r);
+
+    return TEST_RESULT("testDescriptorPassing");
+}
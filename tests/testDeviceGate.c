@@ -0,0 +1,162 @@
+/**
+ * @file testDeviceGate.c
+ * 
+ * @brief File testing the limit on the number of running requests using each storage device
+ * 
+ * The devices of a request are those of its input and of the directory its output will be created in. A
+ * request is only given its devices if all of them have capacity for it, counting a device once for a
+ * request that reads and writes to it, and gives them back when it finishes. The requests on other devices,
+ * and the streams, which use none, are not held back. A request held back goes back to the queue, and leaves it
+ * by priority and then in its order of arrival, as the others do.
+ * 
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "deviceGate.h"
+#include "request.h"
+#include "requestSorter.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief Fills a #Request of a file, from the client of a FIFO
+ * 
+ * @param request The #Request to fill
+ * @param input The path of its input file
+ * @param output The path of its output file
+ */
+void fillRequest(Request request, char* input, char* output) {
+    memset(request, 0, sizeof(REQUEST));
+    request->type = PROCESS_FILE;
+    request->inputFile = input;
+    request->outputFile = output;
+    request->inputFD = request->outputFD = -1;
+}
+
+/**
+ * @brief Creates a file in the given directory
+ * 
+ * @param path The template of its path, replaced with the path of the file
+ * 
+ * @return true If the file was created
+ * @return false Otherwise
+ */
+bool createFile(char* path) {
+    file_d fd = mkstemp(path);
+    if(fd < 0)
+        return false;
+    close(fd);
+    return true;
+}
+
+/**
+ * @brief Checks that the #Request queued leave the #RequestSorter by priority, then in their order of arrival,
+ * including one put back in the queue because its devices were at their limit
+ * 
+ * @param config The server #Config (declaring nop)
+ * 
+ * @return true If they leave in that order
+ * @return false Otherwise
+ */
+bool checkArrivalOrder(Config config) {
+    char* operations[] = { "nop" };
+    REQUEST requests[4];
+    int instances[config->programCount];
+    for(int i = 0; i < config->programCount; i++)
+        instances[i] = config->instances[i];
+
+    RequestSorter sorter = newRequestSorter(config->programCount);
+    for(int i = 0; i < 4; i++) {
+        fillRequest(&requests[i], "in", "out");
+        requests[i].operationCount = 1;
+        requests[i].operations = operations;
+        requests[i].arrivalOrder = i;
+        requests[i].priority = i == 2;
+    }
+
+    for(int i = 0; i < 3; i++)
+        enqueue(sorter, &requests[i], config);
+    bool ordered = nextInLine(sorter, config, instances) == &requests[2];
+
+    //The first one in line is held back by its devices and queued again, after a later arrival
+    Request held = nextInLine(sorter, config, instances);
+    ordered = ordered && held == &requests[0];
+    enqueue(sorter, &requests[3], config);
+    enqueue(sorter, held, config);
+
+    ordered = ordered && nextInLine(sorter, config, instances) == &requests[0];
+    ordered = ordered && nextInLine(sorter, config, instances) == &requests[1];
+    ordered = ordered && nextInLine(sorter, config, instances) == &requests[3];
+    ordered = ordered && !notEmpty(sorter);
+    deleteRequestSolver(sorter);
+    return ordered;
+}
+
+int main() {
+    CONFIG config;
+    char input[] = "/tmp/testDeviceGateXXXXXX";
+    char shared[] = "/dev/shm/testDeviceGateXXXXXX";
+    struct stat st;
+    CHECK(createFile(input) && !stat(input, &st));
+
+    REQUEST first, second, third, stream;
+    fillRequest(&first, input, "/tmp/testDeviceGateFirst");
+    fillRequest(&second, input, "/tmp/testDeviceGateSecond");
+    fillRequest(&third, input, "/tmp/testDeviceGateThird");
+    fillRequest(&stream, STANDARD_STREAMS, STANDARD_STREAMS);
+    stream.type = PROCESS_STREAM;
+
+    //The output does not exist yet: the device is that of the directory it will be created in
+    identifyDevices(&first);
+    identifyDevices(&second);
+    identifyDevices(&third);
+    identifyDevices(&stream);
+    CHECK(first.inputDevice == st.st_dev && first.outputDevice == st.st_dev);
+    CHECK(stream.inputDevice == NO_DEVICE && stream.outputDevice == NO_DEVICE);
+
+    CHECK(loadTestConfig("nop 3\noption device-limit 1\n", &config));
+    DeviceGate gate = newDeviceGate(&config);
+    CHECK(acquireDevices(gate, &first));
+    CHECK(!acquireDevices(gate, &second));
+    CHECK(acquireDevices(gate, &stream));
+
+    char expected[64];
+    snprintf(expected, sizeof(expected), "device %u:%u: 1/1 (running/max)\n", major(st.st_dev), minor(st.st_dev));
+    char* status = getDeviceStatus(gate);
+    CHECK(!strcmp(status, expected));
+    free(status);
+
+    //A request on another device runs alongside
+    if(createFile(shared)) {
+        REQUEST other;
+        fillRequest(&other, shared, "/dev/shm/testDeviceGateOther");
+        identifyDevices(&other);
+        if(other.inputDevice != st.st_dev)
+            CHECK(acquireDevices(gate, &other));
+        unlink(shared);
+    }
+
+    releaseDevices(gate, &first);
+    CHECK(acquireDevices(gate, &second));
+    deleteDeviceGate(gate);
+
+    //A device given a limit of its own
+    CHECK(loadTestConfig("nop 3\noption device-limit 1\ndevice /tmp 2\n", &config));
+    gate = newDeviceGate(&config);
+    CHECK(acquireDevices(gate, &first));
+    CHECK(acquireDevices(gate, &second));
+    CHECK(!acquireDevices(gate, &third));
+    deleteDeviceGate(gate);
+
+    CHECK(checkArrivalOrder(&config));
+
+    unlink(input);
+    return TEST_RESULT("testDeviceGate");
+}
@@ -0,0 +1,161 @@
+/**
+ * @file testDigest.c
+ * 
+ * @brief File testing the digests of the outputs against known answers
+ * 
+ * The CRC32C vectors are the check value of the algorithm and those of RFC 3720 (iSCSI). They are computed by
+ * whichever implementation the machine running the test uses (the CRC32 instruction of SSE4.2, or the table),
+ * directly, in several updates, and by a digest stage writing them to a file. The XXH64 of an input file
+ * moved to a pipe by a digest stage, as it is hashed for the result cache, must be that of its contents.
+ * 
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "digest.h"
+#include "hash.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief The size of the largest vector
+ * 
+ */
+#define MAX_VECTOR_SIZE 1024
+
+/**
+ * @brief An input of the CRC32C and its known CRC32C
+ * 
+ */
+typedef struct crcVector {
+    unsigned char data[MAX_VECTOR_SIZE]; ///< The input
+    size_t length; ///< The length of the input
+    uint32_t crc; ///< The known CRC32C
+} CRC_VECTOR;
+
+/**
+ * @brief Fills the known answers
+ * 
+ * @param vectors The array of vectors to fill (5 of them)
+ */
+void fillVectors(CRC_VECTOR vectors[]) {
+    memset(vectors, 0, sizeof(CRC_VECTOR) * 5);
+    vectors[0].crc = 0;
+
+    memcpy(vectors[1].data, "123456789", 9);
+    vectors[1].length = 9;
+    vectors[1].crc = 0xE3069283;
+
+    vectors[2].length = 32;
+    vectors[2].crc = 0x8A9136AA;
+
+    memset(vectors[3].data, 0xFF, 32);
+    vectors[3].length = 32;
+    vectors[3].crc = 0x62A8AB43;
+
+    for(int i = 0; i < MAX_VECTOR_SIZE; i++)
+        vectors[4].data[i] = i;
+    vectors[4].length = MAX_VECTOR_SIZE;
+    vectors[4].crc = 0x2CDF6E8F;
+}
+
+/**
+ * @brief Runs a digest stage on data written to a pipe, checking what it writes to its output file
+ * 
+ * @param type The digest to compute
+ * @param data The data (at most the capacity of a pipe)
+ * @param length The length of the data
+ * @param summary The #OutputSummary to write the digest to
+ * 
+ * @return true If the stage wrote the whole data to its output file
+ * @return false Otherwise
+ */
+bool runDigestStage(DigestType type, const unsigned char* data, size_t length, OutputSummary summary) {
+    char path[] = "/tmp/testDigestXXXXXX";
+    DIGEST_STAGE stage;
+    unsigned char written[MAX_VECTOR_SIZE + 1];
+    file_d fds[2];
+
+    file_d out = mkstemp(path);
+    if(out < 0 || pipe(fds))
+        return false;
+    unlink(path);
+    file_d check = dup(out);
+
+    bool ok = startDigestStage(&stage, type, fds[0], out);
+    ok = write(fds[1], data, length) == (ssize_t)length && ok;
+    close(fds[1]);
+    ok = joinDigestStage(&stage, summary) && ok;
+
+    ok = pread(check, written, sizeof(written), 0) == (ssize_t)length && !memcmp(written, data, length) && ok;
+    close(check);
+    return ok;
+}
+
+/**
+ * @brief Runs a digest stage moving a file to a pipe, checking what it writes to the pipe
+ * 
+ * @param data The contents of the file (at most the capacity of a pipe)
+ * @param length The length of the contents
+ * @param summary The #OutputSummary to write the digest to
+ * 
+ * @return true If the stage wrote the whole file to the pipe
+ * @return false Otherwise
+ */
+bool runInputStage(const unsigned char* data, size_t length, OutputSummary summary) {
+    char path[] = "/tmp/testDigestXXXXXX";
+    DIGEST_STAGE stage;
+    unsigned char written[MAX_VECTOR_SIZE + 1];
+    file_d fds[2];
+
+    file_d in = mkstemp(path);
+    if(in < 0 || pipe(fds))
+        return false;
+    unlink(path);
+
+    bool ok = write(in, data, length) == (ssize_t)length && !lseek(in, 0, SEEK_SET);
+    ok = startDigestStage(&stage, DIGEST_XXH64, in, fds[1]) && ok;
+    ok = joinDigestStage(&stage, summary) && ok;
+
+    ok = read(fds[0], written, sizeof(written)) == (ssize_t)length && !memcmp(written, data, length) && ok;
+    close(fds[0]);
+    return ok;
+}
+
+int main() {
+    CRC_VECTOR vectors[5];
+    fillVectors(vectors);
+
+    for(int i = 0; i < 5; i++) {
+        CRC_VECTOR* v = &vectors[i];
+        CHECK(updateCrc32c(0, v->data, v->length) == v->crc);
+
+        //Any split of the data gives the same CRC32C, the first part ending in or past a word
+        for(size_t split = 1; split < v->length; split += 5)
+            CHECK(updateCrc32c(updateCrc32c(0, v->data, split), v->data + split, v->length - split) == v->crc);
+
+        DIGEST_STAGE stage;
+        OUTPUT_SUMMARY summary;
+        initDigest(&stage, DIGEST_CRC32C);
+        for(size_t done = 0; done < v->length; done += 3)
+            updateDigest(&stage, v->data + done, v->length - done < 3 ? v->length - done : 3);
+        finishDigest(&stage, &summary);
+        CHECK(summary.digestType == DIGEST_CRC32C && summary.digest == v->crc && stage.bytes == (long)v->length);
+
+        CHECK(runDigestStage(DIGEST_CRC32C, v->data, v->length, &summary));
+        CHECK(summary.digestType == DIGEST_CRC32C && summary.digest == v->crc);
+
+        CHECK(runDigestStage(DIGEST_XXH64, v->data, v->length, &summary));
+        CHECK(summary.digestType == DIGEST_XXH64 && summary.digest == hashBytes(v->data, v->length, 0));
+
+        CHECK(runInputStage(v->data, v->length, &summary));
+        CHECK(summary.digestType == DIGEST_XXH64 && summary.digest == hashBytes(v->data, v->length, 0));
+    }
+
+    return TEST_RESULT("testDigest");
+}
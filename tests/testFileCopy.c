@@ -0,0 +1,144 @@
+/**
+ * @file testFileCopy.c
+ * 
+ * @brief File testing the copies made by the kernel for the requests left without operations
+ * 
+ * A file is copied to another file (the holes of a sparse one staying holes), to a file on another file
+ * system, to a pipe and from a pipe, and a range of it to a given offset, each copy holding the data of the
+ * source.
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fileCopy.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief The size of the sparse file
+ * 
+ */
+#define SPARSE_SIZE (8 * 1024 * 1024)
+
+/**
+ * @brief The size of the extents of data of the sparse file
+ * 
+ */
+#define EXTENT_SIZE (64 * 1024)
+
+/**
+ * @brief Creates a temporary file, unlinked
+ * 
+ * @param directory The directory of the file
+ * 
+ * @return file_d The file (-1 on error)
+ */
+file_d createFile(const char* directory) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/testFileCopyXXXXXX", directory);
+    file_d fd = mkstemp(path);
+    if(fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+/**
+ * @brief Checks that two files hold the same data
+ * 
+ * @param first The first file
+ * @param second The second file
+ * 
+ * @return true If they do
+ * @return false Otherwise
+ */
+bool sameContents(file_d first, file_d second) {
+    static char a[EXTENT_SIZE], b[EXTENT_SIZE];
+    struct stat st1, st2;
+    if(fstat(first, &st1) || fstat(second, &st2) || st1.st_size != st2.st_size)
+        return false;
+
+    for(off_t offset = 0; offset < st1.st_size; offset += EXTENT_SIZE) {
+        ssize_t length = pread(first, a, EXTENT_SIZE, offset);
+        if(length <= 0 || pread(second, b, EXTENT_SIZE, offset) != length || memcmp(a, b, length))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies a file to a pipe, read back by a child writing it to another file
+ * 
+ * @param in The file
+ * @param out The file the child writes to
+ * 
+ * @return true If the file was copied
+ * @return false Otherwise
+ */
+bool copyThroughPipe(file_d in, file_d out) {
+    file_d fd[2];
+    if(pipe(fd))
+        return false;
+
+    pid_t reader = fork();
+    if(reader == 0) {
+        close(fd[1]);
+        _exit(!copyFile(fd[0], out));
+    }
+
+    close(fd[0]);
+    bool copied = reader > 0 && copyFile(in, fd[1]);
+    close(fd[1]);
+
+    int status;
+    return copied && waitpid(reader, &status, 0) == reader && WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+int main() {
+    static char data[EXTENT_SIZE];
+    for(int i = 0; i < EXTENT_SIZE; i++)
+        data[i] = i % 253 + 1;
+
+    //Data at the start and in the middle, and a hole at the end
+    file_d sparse = createFile(".");
+    CHECK(sparse >= 0);
+    CHECK(pwrite(sparse, data, EXTENT_SIZE, 0) == EXTENT_SIZE);
+    CHECK(pwrite(sparse, data, EXTENT_SIZE, SPARSE_SIZE / 2) == EXTENT_SIZE);
+    CHECK(!ftruncate(sparse, SPARSE_SIZE));
+
+    struct stat source, copied;
+    file_d copy = createFile(".");
+    CHECK(copy >= 0 && copyFile(sparse, copy));
+    CHECK(sameContents(sparse, copy));
+    CHECK(!fstat(sparse, &source) && !fstat(copy, &copied) && copied.st_blocks <= source.st_blocks);
+
+    file_d other = createFile("/dev/shm");
+    if(other >= 0) {
+        CHECK(copyFile(sparse, other));
+        CHECK(sameContents(sparse, other));
+        close(other);
+    }
+
+    file_d piped = createFile(".");
+    CHECK(piped >= 0 && copyThroughPipe(sparse, piped));
+    CHECK(sameContents(sparse, piped));
+
+    //A range copied to another offset
+    file_d range = createFile(".");
+    CHECK(range >= 0 && copyFileRange(sparse, SPARSE_SIZE / 2, range, 4096, EXTENT_SIZE));
+    static char read[EXTENT_SIZE];
+    CHECK(pread(range, read, EXTENT_SIZE, 4096) == EXTENT_SIZE && !memcmp(read, data, EXTENT_SIZE));
+
+    file_d empty = createFile("."), emptyCopy = createFile(".");
+    CHECK(copyFile(empty, emptyCopy) && !fstat(emptyCopy, &copied) && copied.st_size == 0);
+
+    return TEST_RESULT("testFileCopy");
+}
@@ -0,0 +1,113 @@
+/**
+ * @file testHash.c
+ * 
+ * @brief File testing the XXH64 hashes of file contents against known answers
+ * 
+ * The vectors cover the empty input, the tail of fewer than 8 bytes, a seed, and inputs longer than a stripe
+ * (32 bytes), which go through the four lanes. The incremental hash must give the same answers whatever the
+ * sizes of the updates.
+ * 
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief An input of the hash and its known hash
+ * 
+ */
+typedef struct hashVector {
+    const char* data; ///< The input (NULL for #LONG_VECTOR_SIZE bytes counting from 0 to 255)
+    uint64_t seed; ///< The seed
+    uint64_t hash; ///< The known hash
+} HASH_VECTOR;
+
+/**
+ * @brief The size of the vector generated rather than written
+ * 
+ */
+#define LONG_VECTOR_SIZE 1024
+
+/**
+ * @brief The known answers, from the reference implementation of XXH64
+ * 
+ */
+static const HASH_VECTOR vectors[] = {
+    { "", 0, 0xEF46DB3751D8E999ULL },
+    { "a", 0, 0xD24EC4F1A98C6E5BULL },
+    { "abc", 0, 0x44BC2CF5AD770999ULL },
+    { "abc", 1, 0xBEA9CA8199328908ULL },
+    { "Nobody inspects the spammish repetition", 0, 0xFBCEA83C8A378BF1ULL },
+    { NULL, 0x1234, 0x8CA99DADC83770FAULL }
+};
+
+/**
+ * @brief Hashes a vector incrementally, in updates of a given size
+ * 
+ * @param data The input
+ * @param length The length of the input
+ * @param seed The seed
+ * @param step The size of the updates
+ * 
+ * @return uint64_t The hash
+ */
+uint64_t hashInSteps(const unsigned char* data, size_t length, uint64_t seed, size_t step) {
+    HASH_STATE state;
+    initHash(&state, seed);
+    for(size_t done = 0; done < length; done += step)
+        updateHash(&state, data + done, length - done < step ? length - done : step);
+    return digestHash(&state);
+}
+
+/**
+ * @brief Hashes a vector written to a pipe, as the contents of a file
+ * 
+ * @param data The input (at most the capacity of a pipe)
+ * @param length The length of the input
+ * @param hash The variable to write the hash to
+ * 
+ * @return true If the whole input was hashed
+ * @return false Otherwise
+ */
+bool hashThroughPipe(const unsigned char* data, size_t length, uint64_t* hash) {
+    file_d fds[2];
+    if(pipe(fds))
+        return false;
+
+    bool written = write(fds[1], data, length) == (ssize_t)length;
+    close(fds[1]);
+    bool hashed = hashFile(fds[0], hash);
+    close(fds[0]);
+    return written && hashed;
+}
+
+int main() {
+    unsigned char generated[LONG_VECTOR_SIZE];
+    for(int i = 0; i < LONG_VECTOR_SIZE; i++)
+        generated[i] = i;
+
+    for(size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const unsigned char* data = vectors[i].data ? (const unsigned char*)vectors[i].data : generated;
+        size_t length = vectors[i].data ? strlen(vectors[i].data) : LONG_VECTOR_SIZE;
+
+        CHECK(hashBytes(data, length, vectors[i].seed) == vectors[i].hash);
+        //Updates of a byte, shorter than a stripe, not aligned to it, and longer than one
+        CHECK(hashInSteps(data, length, vectors[i].seed, 1) == vectors[i].hash);
+        CHECK(hashInSteps(data, length, vectors[i].seed, 7) == vectors[i].hash);
+        CHECK(hashInSteps(data, length, vectors[i].seed, 33) == vectors[i].hash);
+        CHECK(hashInSteps(data, length, vectors[i].seed, 100) == vectors[i].hash);
+
+        uint64_t hash;
+        if(!vectors[i].seed)
+            CHECK(hashThroughPipe(data, length, &hash) && hash == vectors[i].hash);
+    }
+
+    return TEST_RESULT("testHash");
+}
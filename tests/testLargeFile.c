@@ -0,0 +1,174 @@
+/**
+ * @file testLargeFile.c
+ * 
+ * @brief File testing the large-file mode, which keeps requests on very large files from flooding the page cache
+ * 
+ * A stage copies a file larger than the threshold through the descriptors it shares with the job handler,
+ * which drops what was read and written back from the page cache one window at a time, and the rest once the
+ * stage is done. The pages of both files still cached are counted with mincore, where the file system lets
+ * them be dropped (tmpfs keeps them, being the page cache itself). With O_DIRECT, the data goes through pumps.
+ * 
+ */
+
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/vfs.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "largeFile.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief The size of the input file
+ * 
+ */
+#define INPUT_SIZE (4 * 1024 * 1024)
+
+/**
+ * @brief The number of bytes the stage reads and writes at once
+ * 
+ */
+#define STAGE_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Counts the pages of a file in the page cache
+ * 
+ * @param fd The file
+ * @param size The size of the file
+ * 
+ * @return long The number of pages cached (-1 if unknown)
+ */
+long countCachedPages(file_d fd, long size) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    long pages = (size + pageSize - 1) / pageSize;
+    unsigned char* resident = malloc(pages);
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    long cached = -1;
+
+    if(map != MAP_FAILED && !mincore(map, size, resident)) {
+        cached = 0;
+        for(long i = 0; i < pages; i++)
+            cached += resident[i] & 1;
+    }
+
+    if(map != MAP_FAILED)
+        munmap(map, size);
+    free(resident);
+    return cached;
+}
+
+/**
+ * @brief Creates a temporary file in the current directory, unlinked
+ * 
+ * @return file_d The file (-1 on error)
+ */
+file_d createFile() {
+    char path[] = "testLargeFileXXXXXX";
+    file_d fd = mkstemp(path);
+    if(fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+/**
+ * @brief Checks the contents of a file, through a description of its own (that of the file may have O_DIRECT)
+ * 
+ * @param fd The file
+ * @param data The expected contents
+ * @param length The length of the expected contents
+ * 
+ * @return true If the file holds them
+ * @return false Otherwise
+ */
+bool hasContents(file_d fd, const char* data, long length) {
+    static char contents[INPUT_SIZE + 1];
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+    file_d own = open(path, O_RDONLY);
+    bool same = own >= 0 && pread(own, contents, sizeof(contents), 0) == length && !memcmp(contents, data, length);
+    if(own >= 0)
+        close(own);
+    return same;
+}
+
+/**
+ * @brief Copies the input of a stage to its output, letting the job handler trim the page cache as it goes
+ * 
+ * @param large The #LargeFile of the job handler
+ * @param in The input of the stage
+ * @param out The output of the stage
+ * 
+ * @return long The number of bytes copied
+ */
+long runStage(LargeFile large, file_d in, file_d out) {
+    static char buffer[STAGE_BUFFER_SIZE];
+    long copied = 0;
+    ssize_t bytesRead;
+
+    while((bytesRead = read(in, buffer, sizeof(buffer))) > 0) {
+        if(write(out, buffer, bytesRead) != bytesRead)
+            return -1;
+        copied += bytesRead;
+        largeFileTick(large);
+    }
+
+    return copied;
+}
+
+int main() {
+    CONFIG config;
+    LARGE_FILE large;
+    static char data[INPUT_SIZE];
+    struct statfs fs;
+    for(long i = 0; i < INPUT_SIZE; i++)
+        data[i] = i * 7919 % 251;
+
+    file_d in = createFile(), out = createFile(), small = createFile();
+    CHECK(in >= 0 && out >= 0 && small >= 0);
+    //Written back first, as dirty pages cannot be dropped
+    CHECK(write(in, data, INPUT_SIZE) == INPUT_SIZE && !fsync(in) && !lseek(in, 0, SEEK_SET));
+    CHECK(write(small, data, 1024) == 1024);
+    bool droppable = !fstatfs(in, &fs) && fs.f_type != TMPFS_MAGIC;
+
+    CHECK(loadTestConfig("nop 1\noption large-file-threshold 1M\noption large-file-window 256K\n", &config));
+    CHECK(!initLargeFile(&large, &config, small, out));
+    CHECK(initLargeFile(&large, &config, in, out));
+    CHECK(runStage(&large, in, out) == INPUT_SIZE);
+    CHECK(large.inputDropped >= INPUT_SIZE - config.largeFileWindow);
+    CHECK(large.outputDropped > 0 && large.outputFlushed >= INPUT_SIZE - config.largeFileWindow);
+    finishLargeFile(&large);
+
+    if(droppable) {
+        CHECK(countCachedPages(in, INPUT_SIZE) == 0);
+        CHECK(countCachedPages(out, INPUT_SIZE) == 0);
+    }
+    CHECK(hasContents(out, data, INPUT_SIZE));
+
+    //Through the O_DIRECT pumps (or the files themselves, where O_DIRECT is not supported)
+    file_d directOut = createFile();
+    pid_t inputPump, outputPump;
+    CHECK(directOut >= 0 && !lseek(in, 0, SEEK_SET));
+    CHECK(loadTestConfig("nop 1\noption large-file-threshold 1M\noption large-file-direct yes\n", &config));
+    CHECK(initLargeFile(&large, &config, in, directOut));
+    file_d stageIn = startInputPump(&large, dup(in), &inputPump);
+    file_d stageOut = startOutputPump(&large, dup(directOut), &outputPump);
+    CHECK(runStage(&large, stageIn, stageOut) == INPUT_SIZE);
+    close(stageIn);
+    close(stageOut);
+    int status;
+    CHECK(inputPump < 0 || (waitpid(inputPump, &status, 0) == inputPump && WIFEXITED(status) && !WEXITSTATUS(status)));
+    CHECK(outputPump < 0 || (waitpid(outputPump, &status, 0) == outputPump && WIFEXITED(status) && !WEXITSTATUS(status)));
+    finishLargeFile(&large);
+    CHECK(hasContents(directOut, data, INPUT_SIZE));
+
+    return TEST_RESULT("testLargeFile");
+}
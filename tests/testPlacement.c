@@ -0,0 +1,100 @@
+/**
+ * @file testPlacement.c
+ * 
+ * @brief File testing the placement of the stages of a request on the CPUs of the machine
+ * 
+ * Every process a request runs counts in the load of its domain: its stages, those of its branches with the
+ * pumps at their fork point, and every stage of every slot of a request run in chunks with the pump feeding
+ * it. Every stage, those of the branches included, is pinned to CPUs the server may run on.
+ * 
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "placement.h"
+#include "request.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief Checks that every stage of a #Request is pinned to CPUs the server may run on
+ * 
+ * @param placement The given #Placement
+ * @param request The placed #Request
+ * @param stages The number of stages to check
+ * 
+ * @return true If every stage is pinned
+ * @return false Otherwise
+ */
+bool stagesPinned(Placement placement, Request request, int stages) {
+    cpu_set_t allowed, cpus, outside;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    for(int i = 0; i < stages; i++) {
+        if(!getStageCpus(placement, request, i, &cpus) || !CPU_COUNT(&cpus))
+            return false;
+        CPU_XOR(&outside, &cpus, &allowed);
+        CPU_AND(&outside, &outside, &cpus);
+        if(CPU_COUNT(&outside))
+            return false;
+    }
+
+    return true;
+}
+
+int main() {
+    CONFIG config;
+    CHECK(loadTestConfig("nop 3\ngcompress 2\noption placement pipeline\n", &config));
+
+    char* operations[] = { "nop", "gcompress" };
+    char* branchOperations[] = { "gcompress" };
+    BRANCH branches[] = {
+        { .parent = -1, .after = 1, .outputFile = "branch.gz", .operationCount = 1, .operations = branchOperations },
+        { .parent = -1, .after = 1, .outputFile = "branch", .operationCount = 0, .operations = NULL }
+    };
+    REQUEST plain = { .type = PROCESS_FILE, .operationCount = 2, .operations = operations, .timeOfArrival = 1 };
+    REQUEST branched = plain, chunked = plain;
+    branched.timeOfArrival = 2;
+    branched.branchCount = 2;
+    branched.branches = branches;
+    chunked.timeOfArrival = 3;
+    chunked.chunkWidth = 4;
+
+    CHECK(newPlacement(PLACEMENT_NONE) == NULL);
+    Placement placement = newPlacement(config.placement);
+    CHECK(placement != NULL);
+
+    placeRequest(placement, &plain, &config);
+    CHECK(plain.cpuDomain >= 0 && plain.cpuLoad == 2);
+    CHECK(stagesPinned(placement, &plain, 2));
+
+    //Three stages and the two pumps of the fork point after nop
+    placeRequest(placement, &branched, &config);
+    CHECK(branched.cpuDomain >= 0 && branched.cpuLoad == 5);
+    CHECK(stagesPinned(placement, &branched, getStageCount(&branched)));
+
+    //Four slots running both operations after the pump feeding them their chunk
+    placeRequest(placement, &chunked, &config);
+    CHECK(chunked.cpuDomain >= 0 && chunked.cpuLoad == 12);
+    CHECK(stagesPinned(placement, &chunked, chunked.chunkWidth * chunked.operationCount));
+
+    Request requests[] = { &plain, &branched, &chunked };
+    for(int i = 0; i < 3; i++)
+        requests[i]->running = true;
+    char* status = getPlacementStatus(placement, requests, 3);
+    CHECK(strstr(status, "placement task #2 (domain ") != NULL && strstr(status, ", 5 processes): nop@") != NULL);
+    CHECK(strstr(strstr(status, "task #2"), " gcompress@") != NULL);
+    free(status);
+
+    unplaceRequest(placement, &branched);
+    CHECK(branched.cpuDomain == -1);
+    cpu_set_t cpus;
+    CHECK(!getStageCpus(placement, &branched, 0, &cpus));
+
+    deletePlacement(placement);
+    return TEST_RESULT("testPlacement");
+}
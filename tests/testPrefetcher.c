@@ -0,0 +1,91 @@
+/**
+ * @file testPrefetcher.c
+ * 
+ * @brief File testing the prefetching of the input files of the requests next in line
+ * 
+ * The requests prefetched are the pending ones that will be dispatched first: by priority, then in their order
+ * of arrival, whatever the slots they hold in the list of the router. The bytes prefetched stay within the
+ * budget, which a request gives back when it is dispatched, its input then counting as a hit if still cached.
+ * 
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "prefetcher.h"
+#include "request.h"
+#include "test.h"
+
+int testFailures;
+
+/**
+ * @brief The size of each input file
+ * 
+ */
+#define INPUT_SIZE (40 * 1024)
+
+/**
+ * @brief The number of requests in the list of the router
+ * 
+ */
+#define REQUEST_COUNT 5
+
+int main() {
+    CONFIG config;
+    CHECK(loadTestConfig("nop 3\noption prefetch-depth 2\noption prefetch-budget 60K\n", &config));
+
+    char paths[REQUEST_COUNT][32];
+    REQUEST requests[REQUEST_COUNT];
+    static char data[INPUT_SIZE];
+    for(int i = 0; i < REQUEST_COUNT; i++) {
+        strcpy(paths[i], "/tmp/testPrefetcherXXXXXX");
+        file_d fd = mkstemp(paths[i]);
+        CHECK(fd >= 0 && write(fd, data, INPUT_SIZE) == INPUT_SIZE);
+        close(fd);
+
+        memset(&requests[i], 0, sizeof(REQUEST));
+        requests[i].type = PROCESS_FILE;
+        requests[i].inputFile = requests[i].outputFile = paths[i];
+        requests[i].inputFD = requests[i].outputFD = -1;
+        requests[i].admitted = true;
+    }
+
+    //Slots of the router in a different order than the arrivals: the first two to be dispatched are 1 and 4
+    requests[0].arrivalOrder = 5;
+    requests[1].arrivalOrder = 2;
+    requests[2].arrivalOrder = 1;
+    requests[2].running = true;
+    requests[3].arrivalOrder = 3;
+    requests[3].admitted = false;
+    requests[4].arrivalOrder = 4;
+    Request list[REQUEST_COUNT + 1] = { &requests[0], &requests[1], &requests[2], NULL, &requests[3], &requests[4] };
+
+    Prefetcher prefetcher = newPrefetcher(&config);
+    CHECK(prefetcher != NULL);
+    prefetchNextInputs(prefetcher, list, REQUEST_COUNT + 1);
+    CHECK(requests[1].prefetched == INPUT_SIZE);
+    CHECK(requests[4].prefetched == 60 * 1024 - INPUT_SIZE);
+    CHECK(!requests[0].prefetched && !requests[2].prefetched && !requests[3].prefetched);
+
+    //The budget given back by a dispatched request goes to the next one in line
+    prefetchDispatched(prefetcher, &requests[1]);
+    CHECK(!requests[1].prefetched);
+    requests[1].running = true;
+    prefetchNextInputs(prefetcher, list, REQUEST_COUNT + 1);
+    CHECK(requests[0].prefetched == INPUT_SIZE);
+    prefetchDispatched(prefetcher, &requests[2]);
+
+    char* status = getPrefetchStatus(prefetcher);
+    CHECK(strstr(status, "prefetch: 3 issued (100 KiB), hit rate 1/1 (100%), 1 dispatched without prefetch, 60/60 KiB in flight") != NULL);
+    free(status);
+    deletePrefetcher(prefetcher);
+
+    CHECK(loadTestConfig("nop 3\n", &config));
+    CHECK(newPrefetcher(&config) == NULL);
+
+    for(int i = 0; i < REQUEST_COUNT; i++)
+        unlink(paths[i]);
+    return TEST_RESULT("testPrefetcher");
+}
@@ -0,0 +1,89 @@
+/**
+ * @file testProgress.c
+ * 
+ * @brief File testing the progress and the throughput of the stages of the running requests
+ * 
+ * The progress of a stage is the share of its expected input it has read, the input of a stage fed by another
+ * one being extrapolated from the ratio observed so far on that one, and its throughput the one since its
+ * previous sample, or its average one once it is done. A finished request is summarized and no longer followed.
+ * 
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "progress.h"
+#include "request.h"
+#include "test.h"
+#include "usage.h"
+
+int testFailures;
+
+/**
+ * @brief Records a sample of a stage
+ * 
+ * @param tracker The given #ProgressTracker
+ * @param request The #Request
+ * @param stage The index of the stage
+ * @param bytesRead The bytes read by the stage so far
+ * @param bytesWritten The bytes written by the stage so far
+ * @param realTime The time the stage has been running (microseconds)
+ * @param finished Whether the stage has finished
+ */
+void sample(ProgressTracker tracker, Request request, int stage, long bytesRead, long bytesWritten, long realTime, bool finished) {
+    STAGE_USAGE usage;
+    memset(&usage, 0, sizeof(usage));
+    usage.bytesRead = bytesRead;
+    usage.bytesWritten = bytesWritten;
+    usage.realTime = realTime;
+    recordProgress(tracker, request, stage, &usage, finished);
+}
+
+int main() {
+    //nop, then gcompress, with a branch running bcompress on the output of nop
+    char* operations[] = { "nop", "gcompress" };
+    char* branchOperations[] = { "bcompress" };
+    BRANCH branch = { -1, 1, "out.bz2", 1, branchOperations };
+    REQUEST request, idle;
+    memset(&request, 0, sizeof(REQUEST));
+    request.operationCount = 2;
+    request.operations = operations;
+    request.branchCount = 1;
+    request.branches = &branch;
+    request.inputSize = 10 * 1000 * 1000;
+    //Beyond the requests the tracker has room for at first
+    request.timeOfArrival = 100;
+    request.running = true;
+    idle = request;
+    idle.timeOfArrival = 3;
+
+    ProgressTracker tracker = newProgressTracker();
+    Request requests[] = { &idle, NULL, &request };
+    char* status = getProgressStatus(tracker, requests, 3);
+    CHECK(!strcmp(status, ""));
+    free(status);
+    CHECK(finishProgress(tracker, &request) == NULL);
+
+    sample(tracker, &request, 0, 2000000, 2000000, 1000000, false);
+    sample(tracker, &request, 0, 6000000, 6000000, 2000000, false);
+    sample(tracker, &request, 1, 3000000, 1000000, 1000000, false);
+    sample(tracker, &request, 2, 6000000, 500000, 3000000, true);
+    status = getProgressStatus(tracker, requests, 3);
+    CHECK(!strcmp(status, "progress task #100: nop 60% 4.0 MB/s gcompress 30% 3.0 MB/s bcompress done 2.0 MB/s\n"));
+    free(status);
+
+    //A request that is not running is not shown
+    request.running = false;
+    status = getProgressStatus(tracker, requests, 3);
+    CHECK(!strcmp(status, ""));
+    free(status);
+
+    char* summary = finishProgress(tracker, &request);
+    CHECK(summary != NULL && !strcmp(summary, "Stages: nop (6.0 MB in, 6.0 MB out, 3.0 MB/s) "
+        "gcompress (3.0 MB in, 1.0 MB out, 3.0 MB/s) bcompress (6.0 MB in, 0.5 MB out, 2.0 MB/s)"));
+    free(summary);
+    CHECK(finishProgress(tracker, &request) == NULL);
+
+    deleteProgressTracker(tracker);
+    return TEST_RESULT("testProgress");
+}
@@ -0,0 +1,155 @@
+/**
+ * @file testRequestLayout.c
+ * 
+ * @brief File testing the layout of the requests read from frames
+ * 
+ * A #Request read from a frame is a single block of the exact size needed, holding its branches, its
+ * operations and its strings, whatever their length. The fields set by the server start zeroed, or at -1 where
+ * 0 is meaningful.
+ * 
+ */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pipeWrapper.h"
+#include "request.h"
+#include "test.h"
+#include "wire.h"
+
+int testFailures;
+
+/**
+ * @brief The start of the block of the #Request checked
+ * 
+ */
+char* blockStart;
+
+/**
+ * @brief The end of the block of the #Request checked
+ * 
+ */
+char* blockEnd;
+
+/**
+ * @brief Checks that a field of the #Request checked lies inside its block
+ * 
+ * @param field The address of the field
+ * @param size The size of the field
+ * 
+ * @return true If it does
+ * @return false Otherwise
+ */
+bool inBlock(const void* field, long size) {
+    return (const char*)field >= blockStart && (const char*)field + size <= blockEnd;
+}
+
+/**
+ * @brief Writes a #Request through a pipe and reads it back
+ * 
+ * @param sent The #Request to write
+ * 
+ * @return Request The #Request read back (NULL if none was)
+ */
+Request roundTrip(Request sent) {
+    PIPE_WRITTER pw;
+    PIPE_READER pr;
+    file_d fds[2];
+    if(pipe(fds))
+        return NULL;
+
+    initPipeWritter(&pw, fds[1]);
+    bool written = writeRequest(&pw, sent) && flushPipe(&pw);
+    close(fds[1]);
+
+    initPipeReader(&pr, fds[0]);
+    Request read = written ? readRequest(&pr) : NULL;
+    close(fds[0]);
+    return read;
+}
+
+/**
+ * @brief Checks that the fields set by the server start unset
+ * 
+ * @param r The #Request read
+ * 
+ * @return true If they do
+ * @return false Otherwise
+ */
+bool serverFieldsUnset(Request r) {
+    return r->senderFD == -1 && r->inputFD == -1 && r->outputFD == -1 && r->cpuDomain == -1 && r->leader == -1
+        && !r->clientPid && !r->timeOfArrival && !r->arrivalOrder && !r->running && !r->cpuLoad && !r->admitted
+        && !r->prefetched && !r->inputSize && !r->predictedSize && !r->inputHashed && !r->cachedOperations
+        && !r->chunkWidth;
+}
+
+int main() {
+    //A path far longer than the strings of the former fixed-size fields
+    char longPath[1024];
+    memset(longPath, 'a', sizeof(longPath) - 1);
+    longPath[sizeof(longPath) - 1] = '\0';
+    longPath[0] = '/';
+
+    char* operations[] = { "nop", "bcompress", "nop" };
+    char* branchOperations[] = { "gcompress" };
+    BRANCH branches[] = { { -1, 1, "out.gz", 1, branchOperations }, { 0, 1, longPath, 0, NULL } };
+    REQUEST sent;
+    memset(&sent, 0, sizeof(REQUEST));
+    sent.type = PROCESS_FILE;
+    sent.priority = 4;
+    sent.sender = "";
+    sent.inputFile = "in";
+    sent.outputFile = "out.bz2";
+    sent.operationCount = 3;
+    sent.operations = operations;
+    sent.branchCount = 2;
+    sent.branches = branches;
+
+    Request r = roundTrip(&sent);
+    CHECK(r != NULL);
+    if(r) {
+        blockStart = (char*)r;
+        blockEnd = blockStart + malloc_usable_size(r);
+        //The request, its branches, its operations and the payload, up to the rounding of the allocator
+        long size = sizeof(REQUEST) + 2 * sizeof(BRANCH) + 4 * sizeof(char*) + getRequestFrameLength(&sent);
+        CHECK(blockEnd - blockStart >= size && blockEnd - blockStart < size + 32);
+
+        CHECK(r->type == PROCESS_FILE && r->priority == 4 && serverFieldsUnset(r));
+        CHECK(inBlock(r->sender, 1) && !strcmp(r->sender, ""));
+        CHECK(inBlock(r->inputFile, 3) && !strcmp(r->inputFile, "in"));
+        CHECK(inBlock(r->outputFile, 8) && !strcmp(r->outputFile, "out.bz2"));
+        CHECK(r->operationCount == 3 && inBlock(r->operations, 3 * sizeof(char*)));
+        for(int i = 0; i < 3; i++)
+            CHECK(inBlock(r->operations[i], strlen(operations[i]) + 1) && !strcmp(r->operations[i], operations[i]));
+
+        CHECK(r->branchCount == 2 && inBlock(r->branches, 2 * sizeof(BRANCH)));
+        Branch first = &r->branches[0], second = &r->branches[1];
+        CHECK(first->parent == -1 && first->after == 1 && first->operationCount == 1);
+        CHECK(inBlock(first->outputFile, 7) && !strcmp(first->outputFile, "out.gz"));
+        CHECK(inBlock(first->operations, sizeof(char*)) && inBlock(first->operations[0], 10));
+        CHECK(!strcmp(first->operations[0], "gcompress"));
+        CHECK(second->parent == 0 && second->after == 1 && second->operationCount == 0);
+        CHECK(inBlock(second->outputFile, sizeof(longPath)) && !strcmp(second->outputFile, longPath));
+        CHECK(getStageCount(r) == 4 && !strcmp(getStageOperation(r, 3), "gcompress"));
+        freeRequest(r);
+    }
+
+    //A status request has no operations, and nothing of a request processing files
+    REQUEST status;
+    memset(&status, 0, sizeof(REQUEST));
+    status.type = STATUS;
+    status.sender = "client";
+    r = roundTrip(&status);
+    CHECK(r != NULL);
+    if(r) {
+        blockStart = (char*)r;
+        blockEnd = blockStart + malloc_usable_size(r);
+        CHECK(r->type == STATUS && inBlock(r->sender, 7) && !strcmp(r->sender, "client"));
+        CHECK(!r->inputFile && !r->outputFile && !r->operationCount && !r->branchCount && serverFieldsUnset(r));
+        freeRequest(r);
+    }
+
+    return TEST_RESULT("testRequestLayout");
+}
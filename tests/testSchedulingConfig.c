@@ -0,0 +1,57 @@
+/**
+ * @file testSchedulingConfig.c
+ * 
+ * @brief File testing the parsing of the OS scheduling settings of the request priorities in the config file
+ * 
+ * A priority line sets the niceness, the I/O class and level and the CPU policy of its priority, leaving the
+ * settings it does not give and the other priorities unchanged. A priority outside the range of the requests,
+ * or a setting out of its range, makes the config file invalid. A request priority out of range gets the
+ * settings of the nearest priority.
+ * 
+ */
+
+#include <sched.h>
+
+#include "config.h"
+#include "test.h"
+
+int testFailures;
+
+int main() {
+    CONFIG config;
+    CHECK(loadTestConfig("nop 1\npriority 0 nice=10 io=idle sched=batch\npriority 5 nice=-5 io=rt:2\npriority 3 io=be\n", &config));
+
+    SchedulingClass low = getSchedulingClass(&config, 0);
+    CHECK(low->nice == 10 && low->ioClass == 3 && low->policy == SCHED_BATCH);
+    SchedulingClass high = getSchedulingClass(&config, 5);
+    CHECK(high->nice == -5 && high->ioClass == 1 && high->ioLevel == 2 && high->policy == POLICY_UNCHANGED);
+    //The default level of a class is 4
+    SchedulingClass middle = getSchedulingClass(&config, 3);
+    CHECK(middle->nice == NICE_UNCHANGED && middle->ioClass == 2 && middle->ioLevel == 4);
+    SchedulingClass unset = getSchedulingClass(&config, 1);
+    CHECK(unset->nice == NICE_UNCHANGED && unset->ioClass == 0 && unset->policy == POLICY_UNCHANGED);
+
+    CHECK(getSchedulingClass(&config, -1) == low);
+    CHECK(getSchedulingClass(&config, MAX_PRIORITY + 1) == high);
+
+    CHECK(loadTestConfig("nop 1\npriority 2 sched=idle nice=19 io=be:0\n", &config));
+    CHECK(config.scheduling[2].policy == SCHED_IDLE && config.scheduling[2].nice == 19 && config.scheduling[2].ioLevel == 0);
+
+    const char* invalid[] = {
+        "nop 1\npriority 6 nice=1\n",
+        "nop 1\npriority -1 nice=1\n",
+        "nop 1\npriority\n",
+        "nop 1\npriority x nice=1\n",
+        "nop 1\npriority 1 nice=20\n",
+        "nop 1\npriority 1 nice=-21\n",
+        "nop 1\npriority 1 io=rt:8\n",
+        "nop 1\npriority 1 io=fast\n",
+        "nop 1\npriority 1 sched=fifo\n",
+        "nop 1\npriority 1 weight=2\n",
+        "nop 1\npriority 1 nice\n",
+    };
+    for(int i = 0; i < (int)(sizeof(invalid) / sizeof(invalid[0])); i++)
+        CHECK(!loadTestConfig(invalid[i], &config));
+
+    return TEST_RESULT("testSchedulingConfig");
+}
@@ -0,0 +1,130 @@
+/**
+ * @file testStagePipe.c
+ * 
+ * @brief File testing the capacity of the pipes between the stages and the sampling of their occupancy
+ * 
+ * The output pipe of a transformation has the capacity set for it, rounded up to a power of two, or one
+ * holding 20 ms of the output throughput observed so far, within the limit of the kernel. A pipe is sampled
+ * through the standard input of its reader, as full when a write of PIPE_BUF bytes would block and as empty
+ * when a read would.
+ * 
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "stagePipe.h"
+#include "test.h"
+#include "usage.h"
+
+int testFailures;
+
+/**
+ * @brief The capacity of the pipes sampled (a few pages, so that one can be neither empty nor full)
+ * 
+ */
+#define SAMPLED_PIPE_SIZE 16384
+
+/**
+ * @brief Reads the maximum capacity of a pipe allowed by the kernel
+ * 
+ * @return long The maximum capacity
+ */
+long readMaxPipeSize() {
+    char buffer[32] = "";
+    FILE* file = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if(file) {
+        if(!fgets(buffer, sizeof(buffer), file))
+            buffer[0] = '\0';
+        fclose(file);
+    }
+    return atol(buffer) > 0 ? atol(buffer) : 1024 * 1024;
+}
+
+/**
+ * @brief Samples a pipe whose reader does not read, holding the given number of bytes
+ * 
+ * @param bytes The number of bytes written to the pipe
+ * @param usage The #StageUsage to count the sample in
+ * 
+ * @return true If the pipe was sampled
+ * @return false Otherwise
+ */
+bool samplePipe(int bytes, StageUsage usage) {
+    static char data[SAMPLED_PIPE_SIZE];
+    file_d fd[2];
+    if(!openStagePipe(fd, SAMPLED_PIPE_SIZE) || fcntl(fd[1], F_GETPIPE_SZ) != SAMPLED_PIPE_SIZE)
+        return false;
+
+    pid_t reader = fork();
+    if(reader == 0) {
+        dup2(fd[0], STDIN_FILENO);
+        pause();
+        _exit(0);
+    }
+    close(fd[0]);
+
+    long samples = usage->pipeSamples;
+    bool sampled = reader > 0 && write(fd[1], data, bytes) == bytes;
+    //The reader is sampled once it holds the pipe as its standard input
+    for(int i = 0; sampled && i < 100 && usage->pipeSamples == samples; i++) {
+        sampleStagePipe(reader, usage);
+        if(usage->pipeSamples == samples)
+            usleep(10000);
+    }
+
+    close(fd[1]);
+    if(reader > 0) {
+        kill(reader, SIGKILL);
+        waitpid(reader, NULL, 0);
+    }
+    return sampled && usage->pipeSamples == samples + 1;
+}
+
+int main() {
+    CONFIG config;
+    CHECK(loadTestConfig("nop 1 pipe=256K\ngcompress 1 pipe=100K\nbcompress 1 pipe=auto\nbdecompress 1\n", &config));
+    long maxSize = readMaxPipeSize();
+
+    USAGE_STATS stats[4];
+    for(int i = 0; i < 4; i++)
+        initUsageStats(&stats[i]);
+    CHECK(getPipeSize(&config, stats, 0) == MIN(256 * 1024, maxSize));
+    CHECK(getPipeSize(&config, stats, 1) == MIN(128 * 1024, maxSize));
+    CHECK(getPipeSize(&config, stats, 3) == 0);
+
+    //Sized automatically once an output was observed: 20 ms of 10 MB/s
+    CHECK(getPipeSize(&config, stats, 2) == 0);
+    stats[2].total.bytesWritten = 10 * 1000 * 1000;
+    stats[2].total.realTime = 1000 * 1000;
+    CHECK(getPipeSize(&config, stats, 2) == MIN(256 * 1024, maxSize));
+    stats[2].total.bytesWritten *= 1000;
+    CHECK(getPipeSize(&config, stats, 2) == maxSize);
+
+    file_d fd[2];
+    CHECK(openStagePipe(fd, getPipeSize(&config, stats, 0)));
+    CHECK(fcntl(fd[1], F_GETPIPE_SZ) == MIN(256 * 1024, maxSize));
+    CHECK((fcntl(fd[0], F_GETFD) & FD_CLOEXEC) && (fcntl(fd[1], F_GETFD) & FD_CLOEXEC));
+    close(fd[0]);
+    close(fd[1]);
+
+    STAGE_USAGE usage;
+    memset(&usage, 0, sizeof(usage));
+    CHECK(samplePipe(0, &usage) && usage.pipeEmpty == 1 && usage.pipeFull == 0);
+    CHECK(samplePipe(SAMPLED_PIPE_SIZE - PIPE_BUF + 1, &usage) && usage.pipeEmpty == 1 && usage.pipeFull == 1);
+    CHECK(samplePipe(100, &usage) && usage.pipeEmpty == 1 && usage.pipeFull == 1);
+
+    char* status = getUsageStatus(&config, stats);
+    CHECK(strstr(status, "usage nop: 0 stages") != NULL && strstr(status, "output pipe 256 KiB: ") != NULL);
+    CHECK(strstr(status, "usage bdecompress: 0 stages") != NULL && strstr(status, "output pipe 64 KiB: ") != NULL);
+    CHECK(strstr(status, " KiB (auto): ") != NULL);
+    free(status);
+
+    return TEST_RESULT("testStagePipe");
+}
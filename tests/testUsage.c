@@ -0,0 +1,101 @@
+/**
+ * @file testUsage.c
+ * 
+ * @brief File testing the accounting of the resources used by the stages of a request
+ * 
+ * A stage is reaped the way the job handlers do it: its bytes are read from /proc while it is a zombie, then
+ * wait4 gives its resource usage. The usage of the stages of a transformation is summed in its statistics,
+ * except for the resident set size, whose peak is kept, and shown by the status command.
+ * 
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "test.h"
+#include "usage.h"
+
+int testFailures;
+
+/**
+ * @brief The number of bytes written by the stage
+ * 
+ */
+#define STAGE_OUTPUT (256 * 1024)
+
+/**
+ * @brief Runs a stage that uses the CPU for a while and writes #STAGE_OUTPUT bytes, and reaps it
+ * 
+ * @param usage The #StageUsage to write the usage of the stage to
+ * 
+ * @return true If the stage was run and reaped
+ * @return false Otherwise
+ */
+bool runStage(StageUsage usage) {
+    pid_t pid = fork();
+    if(pid < 0)
+        return false;
+
+    if(pid == 0) {
+        static char buffer[STAGE_OUTPUT];
+        file_d out = open("/dev/null", O_WRONLY);
+        if(out < 0 || write(out, buffer, sizeof(buffer)) != sizeof(buffer))
+            _exit(1);
+
+        volatile long spin = 0;
+        clock_t start = clock();
+        while(clock() - start < CLOCKS_PER_SEC / 20)
+            spin++;
+        _exit(0);
+    }
+
+    siginfo_t info;
+    struct rusage ru;
+    int status;
+    memset(usage, 0, sizeof(STAGE_USAGE));
+    if(waitid(P_PID, pid, &info, WEXITED | WNOWAIT))
+        return false;
+    readProcessIo(usage, pid);
+    if(wait4(pid, &status, 0, &ru) != pid)
+        return false;
+    fromRusage(usage, &ru);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main() {
+    CONFIG config;
+    CHECK(loadTestConfig("nop 2\ngcompress 1\n", &config));
+
+    STAGE_USAGE first, second;
+    CHECK(runStage(&first));
+    CHECK(first.bytesWritten >= STAGE_OUTPUT);
+    CHECK(first.userTime + first.systemTime >= 40000);
+    CHECK(first.maxRss > 0);
+    CHECK(runStage(&second));
+
+    USAGE_STATS stats[2];
+    initUsageStats(&stats[0]);
+    initUsageStats(&stats[1]);
+    first.maxRss = 1000;
+    second.maxRss = 3000;
+    addUsage(&stats[0], &first);
+    addUsage(&stats[0], &second);
+    CHECK(stats[0].stages == 2);
+    CHECK(stats[0].total.userTime == first.userTime + second.userTime);
+    CHECK(stats[0].total.bytesWritten == first.bytesWritten + second.bytesWritten);
+    CHECK(stats[0].total.maxRss == 4000 && stats[0].peakRss == 3000);
+
+    char* status = getUsageStatus(&config, stats);
+    CHECK(strstr(status, "usage nop: 2 stages, ") != NULL);
+    CHECK(strstr(status, "rss 2000 KiB avg / 3000 KiB peak") != NULL);
+    CHECK(strstr(status, "usage gcompress: 0 stages, cpu 0.000s user / 0.000s sys") != NULL);
+    free(status);
+
+    return TEST_RESULT("testUsage");
+}
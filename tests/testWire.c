@@ -0,0 +1,203 @@
+/**
+ * @file testWire.c
+ * 
+ * @brief File testing that the frames written by the clients read back as they were sent
+ * 
+ * Each #Request goes through a pipe as a frame and is read back by the same functions as the relay and the
+ * router. A frame preceded by garbage, or one longer than the reader allows, must be skipped without losing
+ * the valid frame that follows it, and a payload cut anywhere must be rejected.
+ * 
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pipeWrapper.h"
+#include "request.h"
+#include "test.h"
+#include "wire.h"
+
+int testFailures;
+
+/**
+ * @brief Checks that two #Request carry the same fields
+ * 
+ * @param sent The #Request written
+ * @param read The #Request read back
+ * 
+ * @return true If they are the same
+ * @return false Otherwise
+ */
+bool sameRequest(Request sent, Request read) {
+    if(!read || read->type != sent->type || strcmp(read->sender, sent->sender))
+        return false;
+    if(sent->type == STATUS)
+        return true;
+
+    if(read->priority != sent->priority || strcmp(read->inputFile, sent->inputFile)
+     || strcmp(read->outputFile, sent->outputFile) || read->operationCount != sent->operationCount
+     || read->branchCount != sent->branchCount)
+        return false;
+    for(int i = 0; i < sent->operationCount; i++)
+        if(strcmp(read->operations[i], sent->operations[i]))
+            return false;
+
+    for(int i = 0; i < sent->branchCount; i++) {
+        Branch s = &sent->branches[i], r = &read->branches[i];
+        if(r->parent != s->parent || r->after != s->after || strcmp(r->outputFile, s->outputFile)
+         || r->operationCount != s->operationCount)
+            return false;
+        for(int j = 0; j < s->operationCount; j++)
+            if(strcmp(r->operations[j], s->operations[j]))
+                return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes a #Request through a pipe and reads it back
+ * 
+ * @param sent The #Request to write
+ * @param garbage Bytes written before the frame (NULL for none)
+ * @param garbageLength The number of bytes of garbage
+ * 
+ * @return Request The #Request read back (NULL if none was)
+ */
+Request roundTrip(Request sent, const char* garbage, int garbageLength) {
+    PIPE_WRITTER pw;
+    PIPE_READER pr;
+    file_d fds[2];
+    if(pipe(fds))
+        return NULL;
+
+    initPipeWritter(&pw, fds[1]);
+    if(garbage)
+        writeBytes(&pw, garbageLength, (void*)garbage);
+    bool written = writeRequest(&pw, sent) && flushPipe(&pw);
+    close(fds[1]);
+
+    initPipeReader(&pr, fds[0]);
+    Request read = NULL;
+    //The garbage is reported as invalid frames, until the reader is back at the magic of the frame
+    for(int attempts = 0; written && !read && attempts <= garbageLength; attempts++)
+        read = readRequest(&pr);
+    releasePipeReader(&pr);
+    close(fds[0]);
+    return read;
+}
+
+/**
+ * @brief Checks that a payload of a request frame cut anywhere is rejected
+ * 
+ * @param sent The #Request to write
+ */
+void checkTruncations(Request sent) {
+    PIPE_WRITTER pw;
+    PIPE_READER pr;
+    WIRE_HEADER header;
+    char* payload;
+    file_d fds[2];
+    if(pipe(fds))
+        return;
+
+    initPipeWritter(&pw, fds[1]);
+    CHECK(writeRequest(&pw, sent) && flushPipe(&pw));
+    close(fds[1]);
+    initPipeReader(&pr, fds[0]);
+    CHECK(readFrame(&pr, &header, &payload, WIRE_MAX_SIZE) && payload);
+    CHECK(header.kind == WIRE_REQUEST && (int)header.length == getRequestFrameLength(sent));
+
+    CHECK(payload && checkRequestFrame(payload, header.length));
+    for(uint32_t length = 0; payload && length < header.length; length++)
+        CHECK(!checkRequestFrame(payload, length));
+
+    releasePipeReader(&pr);
+    close(fds[0]);
+}
+
+/**
+ * @brief Checks that a frame longer than the reader allows is skipped, and the next one read
+ */
+void checkOversizedFrame() {
+    char* operations[] = { "nop" };
+    REQUEST small = { .type = PROCESS_FILE, .sender = "a", .inputFile = "in", .outputFile = "out",
+        .operationCount = 1, .operations = operations };
+    char large[WIRE_FIFO_MAX_SIZE + 1];
+    memset(large, 'x', sizeof(large) - 1);
+    large[sizeof(large) - 1] = '\0';
+    REQUEST big = small;
+    big.sender = large;
+
+    PIPE_WRITTER pw;
+    PIPE_READER pr;
+    WIRE_HEADER header;
+    char* payload;
+    file_d fds[2];
+    if(pipe(fds))
+        return;
+
+    initPipeWritter(&pw, fds[1]);
+    CHECK(writeRequest(&pw, &big) && flushPipe(&pw));
+    CHECK(writeRequest(&pw, &small) && flushPipe(&pw));
+    close(fds[1]);
+
+    initPipeReader(&pr, fds[0]);
+    bool found = false;
+    while(!found && readFrame(&pr, &header, &payload, WIRE_FIFO_MAX_SIZE)) {
+        if(payload) {
+            CHECK((int)header.length == getRequestFrameLength(&small) && checkRequestFrame(payload, header.length));
+            found = true;
+        }
+    }
+    CHECK(found);
+    releasePipeReader(&pr);
+    close(fds[0]);
+}
+
+int main() {
+    char* operations[] = { "bcompress", "nop", "gcompress" };
+    char* first[] = { "encrypt" };
+    char* second[] = { "gdecompress", "nop" };
+    BRANCH branches[] = {
+        { .parent = -1, .after = 1, .outputFile = "/tmp/branch0", .operationCount = 1, .operations = first },
+        { .parent = 0, .after = 0, .outputFile = "/tmp/branch1", .operationCount = 2, .operations = second },
+        { .parent = -1, .after = 3, .outputFile = "", .operationCount = 0, .operations = NULL }
+    };
+    REQUEST requests[] = {
+        { .type = STATUS, .sender = "/tmp/client" },
+        { .type = PROCESS_FILE, .sender = "", .priority = 5, .inputFile = "in", .outputFile = "out",
+            .operationCount = 3, .operations = operations },
+        { .type = PROCESS_FILE, .sender = "/tmp/client", .priority = 0, .inputFile = "/tmp/a b",
+            .outputFile = "/tmp/c", .operationCount = 3, .operations = operations, .branchCount = 3,
+            .branches = branches },
+        { .type = PROCESS_STREAM, .sender = "", .priority = 2, .inputFile = STANDARD_STREAMS,
+            .outputFile = STANDARD_STREAMS, .operationCount = 1, .operations = operations }
+    };
+    //Garbage holding the start of a magic, which must not be mistaken for a frame
+    const char garbage[] = { 'x', 'S', 'D', 'S', 'y', 'S', 'D' };
+
+    for(size_t i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        Request read = roundTrip(&requests[i], NULL, 0);
+        CHECK(sameRequest(&requests[i], read));
+        CHECK(!read || isStreamRequest(read) == (requests[i].type == PROCESS_STREAM));
+        freeRequest(read);
+
+        read = roundTrip(&requests[i], garbage, sizeof(garbage));
+        CHECK(sameRequest(&requests[i], read));
+        freeRequest(read);
+
+        checkTruncations(&requests[i]);
+    }
+
+    //A header of another version is skipped like garbage
+    WIRE_HEADER header = { .magic = WIRE_MAGIC, .version = WIRE_VERSION + 1, .kind = WIRE_REQUEST, .length = 0 };
+    CHECK(!checkWireHeader(&header));
+    header.version = WIRE_VERSION;
+    header.length = WIRE_MAX_SIZE + 1;
+    CHECK(!checkWireHeader(&header));
+
+    checkOversizedFrame();
+    return TEST_RESULT("testWire");
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Regression test of the persistent workers: a wrapped worker runs its executable for each job it is given, and is
+# replaced by a new one once it ran worker-jobs of them, the jobs and replacements being shown by status.
+# Runs a server of bin/ in a directory of its own, with gcompress wrapped in a single worker replaced every two jobs.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "workerRecycling: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+cp "$ROOT/sample-transformations/gcompress" .
+printf 'gcompress 1 worker\noption worker-jobs 2\n' > config.txt
+seq 1 100000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+for i in 1 2 3 4 5; do
+    timeout 20 "$ROOT/bin/sdstore" proc-file in.txt out$i.gz gcompress > out$i.log 2>&1 || fail "request $i did not conclude"
+    gzip -dc out$i.gz | cmp -s - in.txt || fail "the output of request $i is not the compressed input"
+done
+
+[ "$(grep -c "Worker [0-9]* started for gcompress" server.log)" -eq 3 ] || fail "the worker was not replaced every two jobs"
+"$ROOT/bin/sdstore" status > status.log 2>&1
+grep -q "workers: 1 running, 3 started, 2 recycled" status.log || fail "the replacements were not accounted for"
+
+echo "workerRecycling: OK" >&2
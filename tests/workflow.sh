@@ -0,0 +1,50 @@
+#!/bin/sh
+# Regression test of the workflows: the nodes of a workflow are sent as a single request, each node reading the
+# output of another one being fed by it directly, so the input is read once and the output of a node marked "-" is
+# never written. A workflow whose nodes do not form a tree rooted at one input file is rejected by the client.
+# Runs a server of bin/ in a directory of its own, with a nop that counts how many times it runs.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "workflow: FAILED ($1)" >&2
+    sed 's/^/  server: /' server.log >&2
+    exit 1
+}
+
+printf '#!/bin/sh\necho >> "%s/runs"\nexec cat\n' "$DIR" > nop
+chmod +x nop
+cp "$ROOT/sample-transformations/gcompress" "$ROOT/sample-transformations/bcompress" .
+printf 'nop 1\ngcompress 2\nbcompress 1\n' > config.txt
+seq 1 200000 > in.txt
+
+"$ROOT/bin/sdstored" config.txt "$DIR/" > server.log 2>&1 &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S SDStore.sock ] && break
+    sleep 0.2
+done
+[ -S SDStore.sock ] || fail "the server did not start"
+
+printf '# The input read once\nbz in.txt - nop bcompress\ngz @bz out.bz.gz gcompress\nraw in.txt out.gz gcompress\n' > flow.txt
+timeout 20 "$ROOT/bin/sdstore" proc-flow -p 2 flow.txt > flow.log 2>&1 || fail "the workflow did not conclude"
+[ "$(grep -c "Request received" server.log)" -eq 1 ] || fail "the workflow was not sent as a single request"
+[ "$(wc -l < runs)" -eq 1 ] || fail "the node shared by the others was not run once"
+[ ! -e - ] || fail "the output of the streamed node was written"
+gzip -dc out.bz.gz | bzip2 -dc | cmp -s - in.txt || fail "the output of the node fed by another one is wrong"
+gzip -dc out.gz | cmp -s - in.txt || fail "the output of the node reading the input is wrong"
+
+printf 'a @b a.txt nop\nb @a b.txt nop\nc in.txt c.gz gcompress\n' > cycle.txt
+printf 'a in.txt a.gz gcompress\nb out.gz b.gz gcompress\n' > inputs.txt
+printf 'a in.txt a.gz gcompress\na in.txt b.gz gcompress\n' > names.txt
+for invalid in cycle inputs names; do
+    timeout 20 "$ROOT/bin/sdstore" proc-flow $invalid.txt > $invalid.log 2>&1 && fail "the workflow $invalid was accepted"
+    grep -q "Invalid arguments" $invalid.log || fail "the workflow $invalid was not rejected by the client"
+done
+[ "$(grep -c "Request received" server.log)" -eq 1 ] || fail "an invalid workflow was sent"
+
+echo "workflow: OK" >&2
@@ -0,0 +1,129 @@
+/**
+ * @file nop.c
+ * 
+ * @brief The nop transformation as a native worker: its output is its input
+ * 
+ * Built as bin/workers/nop, it is used in place of the nop executable when it is copied over it and the
+ * transformation is declared with the "worker=native" attribute. Started by the server with SDSTORE_WORKER set,
+ * it runs every job sent to it over the protocol of workerProtocol.h, without a process per job. Started
+ * without it, it copies its standard input to its standard output like the executable it replaces.
+ * 
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "workerProtocol.h"
+
+/**
+ * @brief Reads exactly the given number of bytes
+ * 
+ * @param fd The descriptor to read from
+ * @param buffer The buffer to read to
+ * @param length The number of bytes to read
+ * 
+ * @return int 1 if they were read, 0 otherwise (the end of the stream or an error)
+ */
+static int readAll(int fd, char* buffer, size_t length) {
+    while(length > 0) {
+        ssize_t bytesRead = read(fd, buffer, length);
+        if(bytesRead < 0 && errno == EINTR)
+            continue;
+        if(bytesRead <= 0)
+            return 0;
+        buffer += bytesRead;
+        length -= bytesRead;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Writes exactly the given number of bytes
+ * 
+ * @param fd The descriptor to write to
+ * @param buffer The buffer to write
+ * @param length The number of bytes to write
+ * 
+ * @return int 1 if they were written, 0 on an error
+ */
+static int writeAll(int fd, const char* buffer, size_t length) {
+    while(length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return 0;
+        buffer += written;
+        length -= written;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Writes a frame
+ * 
+ * @param type The type of the frame
+ * @param data The payload
+ * @param length The length of the payload
+ * 
+ * @return int 1 if the frame was written, 0 on an error
+ */
+static int writeFrame(uint32_t type, const char* data, uint32_t length) {
+    FRAME_HEADER header = { .type = type, .length = length };
+    return writeAll(STDOUT_FILENO, (char*)&header, sizeof(header)) && (!length || writeAll(STDOUT_FILENO, data, length));
+}
+
+/**
+ * @brief Runs the jobs sent by the server, until it closes the standard input of the worker
+ * 
+ * Every data frame of a job is answered with the same data, and its end with a status of 0
+ * 
+ * @param buffer A buffer of #FRAME_MAX_DATA bytes
+ * 
+ * @return int The exit status of the worker (1 if the stream was broken)
+ */
+static int runJobs(char* buffer) {
+    FRAME_HEADER header;
+
+    while(readAll(STDIN_FILENO, (char*)&header, sizeof(header))) {
+        if((header.type != FRAME_DATA && header.type != FRAME_END) || header.length > FRAME_MAX_DATA
+         || !readAll(STDIN_FILENO, buffer, header.length))
+            return 1;
+
+        if(header.type == FRAME_DATA && !writeFrame(FRAME_DATA, buffer, header.length))
+            return 1;
+        if(header.type == FRAME_END) {
+            int32_t status = 0;
+            if(!writeFrame(FRAME_END, (char*)&status, sizeof(status)))
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    char* buffer = malloc(FRAME_MAX_DATA);
+    if(!buffer)
+        return 1;
+
+    if(getenv(WORKER_ENVIRONMENT)) {
+        //A server that is gone is noticed by the failed write
+        signal(SIGPIPE, SIG_IGN);
+        return runJobs(buffer);
+    }
+
+    ssize_t bytesRead;
+    while((bytesRead = read(STDIN_FILENO, buffer, FRAME_MAX_DATA)) != 0) {
+        if(bytesRead < 0 && errno == EINTR)
+            continue;
+        if(bytesRead < 0 || !writeAll(STDOUT_FILENO, buffer, bytesRead))
+            return 1;
+    }
+
+    return 0;
+}